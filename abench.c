@@ -0,0 +1,645 @@
+
+//
+//    This file is part of Dire Wolf, an amateur radio packet TNC.
+//
+//    Copyright (C) 2014  John Langner, WB2OSZ
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        abench.c
+ *
+ * Purpose:     Benchmark the demodulators with a collection of audio files.
+ *
+ * Description:	atest decodes one .WAV file with one set of options.
+ *		This runs it for every .WAV file in a directory, with every
+ *		combination of the listed profiles, fix bits levels, and
+ *		decimation factors.  Several copies run at the same time
+ *		to keep all of the processors busy.
+ *
+ *		The demodulator keeps its state in static variables so
+ *		it can only decode one file at a time in a process.
+ *		That is why separate atest processes are used rather than
+ *		threads calling it directly.
+ *
+ *		Results are written as JSON:  one line per combination,
+ *		always in the same order, followed by totals, including
+ *		how many packets needed each level of bit fixing.
+ *		Save one run as the baseline and use -b to compare a
+ *		later run against it after changing the demodulator.
+ *
+ *		The sample rate comes from each file so the sample rates
+ *		tested are the ones present in the collection.
+ *
+ * Usage:	abench  [options]  directory
+ *
+ *		-j n		Number to run at once.  Default is number of processors.
+ *		-P list		Demodulator profiles.  e.g.  C,F,ABC  Default C.
+ *		-F list		Fix bits levels.  e.g.  0,1,2  Default 2.
+ *		-D list		Decimation factors.  e.g.  1,2,3  Default 1.
+ *		-B n		Data rate passed along to atest.  Default 1200.
+ *		-a path		atest application.  Default ./atest
+ *		-o file		Write results here rather than stdout.
+ *		-b file		Compare with results from an earlier run.
+ *				Exit status is 1 if any combination decoded fewer
+ *				packets than the baseline, or nothing matched, or
+ *				some combinations in the baseline were not run.
+ *
+ *		Exit status is also 1 if atest gave no result for any
+ *		combination, with or without -b.
+ *
+ * Example:	abench -P C,F -F 0,2 -o new.json  tnc_test_cd
+ *		abench -P C,F -F 0,2 -b new.json -o newer.json  tnc_test_cd
+ *
+ *--------------------------------------------------------------------*/
+
+
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <dirent.h>
+#include <getopt.h>
+
+#if __WIN32__
+#include <windows.h>
+#include <process.h>
+#define popen _popen
+#define pclose _pclose
+#else
+#include <pthread.h>
+#endif
+
+
+#define MAX_FILES 500
+#define MAX_LIST 10			/* Maximum values for each option. */
+#define MAX_JOBS 5000
+#define MAX_THREADS 64
+#define JSON_LEN 600			/* Generous for one line of atest output. */
+#define NUM_RETRY 5			/* Levels of bit fixing, RETRY_NONE thru */
+					/* RETRY_TWO_SEP in hdlc_rec2.h. */
+
+
+static char *files[MAX_FILES];
+static int num_files = 0;
+
+static char *profiles[MAX_LIST];
+static int num_profiles = 0;
+
+static int fix_bits[MAX_LIST];
+static int num_fix_bits = 0;
+
+static int decimate[MAX_LIST];
+static int num_decimate = 0;
+
+static int baud = 1200;
+static char *atest_path = "./atest";
+static char *dir_name;
+
+
+static struct job_s {
+	char *file;
+	char *profile;
+	int fix_bits;
+	int decimate;
+	char result[JSON_LEN];		/* JSON from atest or empty if it failed. */
+} jobs[MAX_JOBS];
+
+static int num_jobs = 0;
+static int next_job = 0;		/* Next one for a worker to take. */
+
+#if __WIN32__
+static CRITICAL_SECTION job_cs;
+static unsigned __stdcall worker (void *arg);
+#else
+static pthread_mutex_t job_mutex;
+static void * worker (void *arg);
+#endif
+
+static void usage (void);
+static int split_list (char *str, char **result, int max);
+static void scan_dir (char *dname);
+static int compare_baseline (char *fname);
+static double json_number (char *json, char *key);
+static int json_string (char *json, char *key, char *result, int rlen);
+static void json_add_array (char *json, char *key, int *sum, int max);
+
+
+
+int main (int argc, char *argv[])
+{
+	int c;
+	int n, j, p, f, d;
+	int num_threads = 0;
+	char *outfile = NULL;
+	char *basefile = NULL;
+	FILE *out;
+	char *items[MAX_LIST];
+	int packets = 0;
+	int retries[NUM_RETRY];
+	double audio_sec = 0, cpu_sec = 0;
+	time_t start_time;
+	int failed = 0;
+	int status;
+#if __WIN32__
+	HANDLE th[MAX_THREADS];
+	SYSTEM_INFO si;
+#else
+	pthread_t th[MAX_THREADS];
+#endif
+
+	while ((c = getopt(argc, argv, "j:P:F:D:B:a:o:b:")) != -1) {
+
+	  switch (c) {
+
+	    case 'j':
+	      num_threads = atoi(optarg);
+	      break;
+
+	    case 'P':
+	      num_profiles = split_list (optarg, profiles, MAX_LIST);
+	      break;
+
+	    case 'F':
+	      num_fix_bits = split_list (optarg, items, MAX_LIST);
+	      for (n = 0; n < num_fix_bits; n++) fix_bits[n] = atoi(items[n]);
+	      break;
+
+	    case 'D':
+	      num_decimate = split_list (optarg, items, MAX_LIST);
+	      for (n = 0; n < num_decimate; n++) decimate[n] = atoi(items[n]);
+	      break;
+
+	    case 'B':
+	      baud = atoi(optarg);
+	      break;
+
+	    case 'a':
+	      atest_path = optarg;
+	      break;
+
+	    case 'o':
+	      outfile = optarg;
+	      break;
+
+	    case 'b':
+	      basefile = optarg;
+	      break;
+
+	    default:
+	      usage ();
+	  }
+	}
+
+	if (optind != argc - 1) {
+	  usage ();
+	}
+	dir_name = argv[optind];
+
+	if (num_profiles == 0) {
+	  profiles[num_profiles++] = "C";
+	}
+	if (num_fix_bits == 0) {
+	  fix_bits[num_fix_bits++] = 2;
+	}
+	if (num_decimate == 0) {
+	  decimate[num_decimate++] = 1;
+	}
+
+	if (num_threads <= 0) {
+#if __WIN32__
+	  GetSystemInfo (&si);
+	  num_threads = si.dwNumberOfProcessors;
+#else
+	  num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	}
+	if (num_threads < 1) num_threads = 1;
+	if (num_threads > MAX_THREADS) num_threads = MAX_THREADS;
+
+	scan_dir (dir_name);
+	if (num_files == 0) {
+	  fprintf (stderr, "No .WAV files found in %s\n", dir_name);
+	  exit (EXIT_FAILURE);
+	}
+
+/*
+ * Build the list of combinations in a fixed order so
+ * results can be compared line by line.
+ */
+	for (f = 0; f < num_files; f++) {
+	  for (p = 0; p < num_profiles; p++) {
+	    for (j = 0; j < num_fix_bits; j++) {
+	      for (d = 0; d < num_decimate; d++) {
+	        if (num_jobs >= MAX_JOBS) {
+	          fprintf (stderr, "Too many combinations.  Maximum is %d.\n", MAX_JOBS);
+	          exit (EXIT_FAILURE);
+	        }
+	        jobs[num_jobs].file = files[f];
+	        jobs[num_jobs].profile = profiles[p];
+	        jobs[num_jobs].fix_bits = fix_bits[j];
+	        jobs[num_jobs].decimate = decimate[d];
+	        jobs[num_jobs].result[0] = '\0';
+	        num_jobs++;
+	      }
+	    }
+	  }
+	}
+
+	if (num_threads > num_jobs) num_threads = num_jobs;
+
+	fprintf (stderr, "%d files, %d combinations, %d at a time.\n", num_files, num_jobs, num_threads);
+
+	start_time = time(NULL);
+
+#if __WIN32__
+	InitializeCriticalSection (&job_cs);
+	for (n = 0; n < num_threads; n++) {
+	  th[n] = (HANDLE)_beginthreadex (NULL, 0, worker, NULL, 0, NULL);
+	  if (th[n] == NULL) {
+	    fprintf (stderr, "Could not create worker thread\n");
+	    exit (EXIT_FAILURE);
+	  }
+	}
+	for (n = 0; n < num_threads; n++) {
+	  WaitForSingleObject (th[n], INFINITE);
+	}
+#else
+	pthread_mutex_init (&job_mutex, NULL);
+	for (n = 0; n < num_threads; n++) {
+	  if (pthread_create (&th[n], NULL, worker, NULL) != 0) {
+	    perror ("Could not create worker thread");
+	    exit (EXIT_FAILURE);
+	  }
+	}
+	for (n = 0; n < num_threads; n++) {
+	  pthread_join (th[n], NULL);
+	}
+#endif
+
+/*
+ * Write results.
+ */
+	if (outfile != NULL) {
+	  out = fopen (outfile, "w");
+	  if (out == NULL) {
+	    fprintf (stderr, "Can't open %s for write.\n", outfile);
+	    exit (EXIT_FAILURE);
+	  }
+	}
+	else {
+	  out = stdout;
+	}
+
+	memset (retries, 0, sizeof(retries));
+
+	fprintf (out, "{\n\"results\":[");
+	for (n = 0; n < num_jobs; n++) {
+	  if (jobs[n].result[0] == '\0') {
+	    fprintf (stderr, "No result for %s, profile %s, fix bits %d, decimate %d.\n",
+			jobs[n].file, jobs[n].profile, jobs[n].fix_bits, jobs[n].decimate);
+	    failed++;
+	    continue;
+	  }
+	  fprintf (out, "%s\n%s", n - failed > 0 ? "," : "", jobs[n].result);
+
+	  packets += (int)json_number (jobs[n].result, "packets");
+	  audio_sec += json_number (jobs[n].result, "audio_sec");
+	  cpu_sec += json_number (jobs[n].result, "cpu_sec");
+	  json_add_array (jobs[n].result, "retries", retries, NUM_RETRY);
+	}
+	fprintf (out, "\n],\n");
+
+	fprintf (out, "\"totals\":{\"combinations\":%d,\"failed\":%d,\"packets\":%d,\"audio_sec\":%.3f,\"cpu_sec\":%.3f,\"cpu_per_audio_sec\":%.5f,\"realtime_factor\":%.1f,\"elapsed_sec\":%d",
+		num_jobs, failed, packets, audio_sec, cpu_sec,
+		audio_sec > 0 ? cpu_sec / audio_sec : 0., cpu_sec > 0 ? audio_sec / cpu_sec : 0.,
+		(int)(time(NULL) - start_time));
+	fprintf (out, ",\"retries\":[");
+	for (n = 0; n < NUM_RETRY; n++) {
+	  fprintf (out, "%s%d", n ? "," : "", retries[n]);
+	}
+	fprintf (out, "]}\n");
+	fprintf (out, "}\n");
+
+	if (out != stdout) {
+	  fclose (out);
+	}
+
+	status = failed ? EXIT_FAILURE : EXIT_SUCCESS;
+
+	if (basefile != NULL && compare_baseline (basefile) != 0) {
+	  status = EXIT_FAILURE;
+	}
+
+	exit (status);
+}
+
+
+
+/*
+ * Each worker takes the next combination, runs atest, and keeps
+ * the JSON line from its output.  Repeat until there are no more.
+ */
+
+#if __WIN32__
+static unsigned __stdcall worker (void *arg)
+#else
+static void * worker (void *arg)
+#endif
+{
+	int n;
+	char cmd[1000];
+	char line[JSON_LEN];
+	FILE *pf;
+
+	while (1) {
+
+#if __WIN32__
+	  EnterCriticalSection (&job_cs);
+	  n = next_job++;
+	  LeaveCriticalSection (&job_cs);
+#else
+	  pthread_mutex_lock (&job_mutex);
+	  n = next_job++;
+	  pthread_mutex_unlock (&job_mutex);
+#endif
+	  if (n >= num_jobs) {
+	    break;
+	  }
+
+	  snprintf (cmd, sizeof(cmd), "\"%s\" -q -J -B %d -P %s -F %d -D %d \"%s/%s\"",
+			atest_path, baud, jobs[n].profile, jobs[n].fix_bits, jobs[n].decimate,
+			dir_name, jobs[n].file);
+
+	  pf = popen (cmd, "r");
+	  if (pf == NULL) {
+	    fprintf (stderr, "Could not run %s\n", cmd);
+	    continue;
+	  }
+
+	  while (fgets (line, sizeof(line), pf) != NULL) {
+	    if (line[0] == '{') {
+	      line[strcspn(line, "\r\n")] = '\0';
+	      strcpy (jobs[n].result, line);
+	    }
+	  }
+	  pclose (pf);
+
+	  fprintf (stderr, "%s  %s  %d  %d  -  %d packets\n", jobs[n].file, jobs[n].profile,
+		jobs[n].fix_bits, jobs[n].decimate,
+		jobs[n].result[0] ? (int)json_number(jobs[n].result, "packets") : -1);
+	}
+
+	return (0);
+}
+
+
+
+/*
+ * Find .WAV files in the directory and sort by name.
+ */
+
+static int name_cmp (const void *a, const void *b)
+{
+	return (strcmp (*(char * const *)a, *(char * const *)b));
+}
+
+static void scan_dir (char *dname)
+{
+	DIR *dp;
+	struct dirent *ep;
+	int len;
+
+	dp = opendir (dname);
+	if (dp == NULL) {
+	  fprintf (stderr, "Can't open directory %s\n", dname);
+	  exit (EXIT_FAILURE);
+	}
+
+	while ((ep = readdir (dp)) != NULL && num_files < MAX_FILES) {
+	  len = strlen(ep->d_name);
+	  if (len > 4 && (strcmp(ep->d_name + len - 4, ".wav") == 0 || strcmp(ep->d_name + len - 4, ".WAV") == 0)) {
+	    files[num_files++] = strdup(ep->d_name);
+	  }
+	}
+	closedir (dp);
+
+	qsort (files, num_files, sizeof(char *), name_cmp);
+}
+
+
+
+/*
+ * File name without the directory.  All files are directly in the
+ * corpus directory so this is the same no matter how the directory
+ * was named on the command line.
+ */
+
+static char *base_name (char *path)
+{
+	char *p;
+
+	p = strrchr (path, '/');
+#if __WIN32__
+	if (p == NULL || strrchr (path, '\\') > p) p = strrchr (path, '\\');
+#endif
+	return (p == NULL ? path : p + 1);
+}
+
+
+/*
+ * Compare with an earlier run.  Combinations are matched by
+ * file name and settings.  The new run can have more of them
+ * than the baseline but not fewer.
+ *
+ * Returns 1 if anything got worse, i.e. decoded fewer packets,
+ * if nothing matched, or if some of the baseline was not run again.
+ */
+
+static int compare_baseline (char *fname)
+{
+	FILE *fp;
+	char line[JSON_LEN];
+	char bfile[300], bprofile[20];
+	int n;
+	int matched = 0, missing = 0, worse = 0, better = 0;
+	int base_packets = 0, new_packets = 0;
+	double base_cpu = 0, new_cpu = 0;
+	int bp, np;
+
+	fp = fopen (fname, "r");
+	if (fp == NULL) {
+	  fprintf (stderr, "Can't open baseline %s\n", fname);
+	  return (1);
+	}
+
+	while (fgets (line, sizeof(line), fp) != NULL) {
+
+	  if ( ! json_string (line, "file", bfile, sizeof(bfile)) ||
+	       ! json_string (line, "profile", bprofile, sizeof(bprofile))) {
+	    continue;
+	  }
+
+	  for (n = 0; n < num_jobs; n++) {
+
+	    if (jobs[n].result[0] == '\0') continue;
+
+	    if (strcmp(jobs[n].file, base_name(bfile)) == 0 &&
+		strcmp(jobs[n].profile, bprofile) == 0 &&
+		jobs[n].fix_bits == (int)json_number(line, "fix_bits") &&
+		jobs[n].decimate == (int)json_number(line, "decimate")) {
+
+	      bp = (int)json_number(line, "packets");
+	      np = (int)json_number(jobs[n].result, "packets");
+
+	      if (np != bp) {
+	        fprintf (stderr, "%s  %s  %d  %d  -  %d packets, was %d\n", jobs[n].file, jobs[n].profile,
+			jobs[n].fix_bits, jobs[n].decimate, np, bp);
+	      }
+	      if (np < bp) worse++;
+	      if (np > bp) better++;
+
+	      matched++;
+	      base_packets += bp;
+	      new_packets += np;
+	      base_cpu += json_number(line, "cpu_sec");
+	      new_cpu += json_number(jobs[n].result, "cpu_sec");
+	      break;
+	    }
+	  }
+
+	  if (n == num_jobs) {
+	    fprintf (stderr, "%s  %s  %d  %d  -  in baseline but not in this run\n", base_name(bfile), bprofile,
+			(int)json_number(line, "fix_bits"), (int)json_number(line, "decimate"));
+	    missing++;
+	  }
+	}
+	fclose (fp);
+
+	fprintf (stderr, "\nCompared %d combinations with baseline:  %d better, %d worse, %d not run.\n", matched, better, worse, missing);
+	fprintf (stderr, "Packets %d, was %d.  CPU time %.1f sec, was %.1f", new_packets, base_packets, new_cpu, base_cpu);
+	if (base_cpu > 0) {
+	  fprintf (stderr, " (%+.1f%%)", 100. * (new_cpu - base_cpu) / base_cpu);
+	}
+	fprintf (stderr, ".\n");
+
+	if (matched == 0) {
+	  fprintf (stderr, "Nothing matched the baseline.  Is it for the same files and settings?\n");
+	}
+
+	return (worse > 0 || missing > 0 || matched == 0);
+}
+
+
+
+/*
+ * Just enough JSON to read back what atest writes.
+ */
+
+static double json_number (char *json, char *key)
+{
+	char pattern[40];
+	char *p;
+
+	snprintf (pattern, sizeof(pattern), "\"%s\":", key);
+	p = strstr (json, pattern);
+	if (p == NULL) {
+	  return (0.);
+	}
+	return (atof (p + strlen(pattern)));
+}
+
+static int json_string (char *json, char *key, char *result, int rlen)
+{
+	char pattern[40];
+	char *p;
+	int n = 0;
+
+	snprintf (pattern, sizeof(pattern), "\"%s\":\"", key);
+	p = strstr (json, pattern);
+	if (p == NULL) {
+	  return (0);
+	}
+	for (p += strlen(pattern); *p != '\0' && *p != '"' && n < rlen - 1; p++) {
+	  if (*p == '\\' && p[1] != '\0') p++;
+	  result[n++] = *p;
+	}
+	result[n] = '\0';
+	return (1);
+}
+
+
+
+/*
+ * Add numbers from an array such as  "retries":[1,2,3]  to sum.
+ */
+
+static void json_add_array (char *json, char *key, int *sum, int max)
+{
+	char pattern[40];
+	char *p;
+	int n;
+
+	snprintf (pattern, sizeof(pattern), "\"%s\":[", key);
+	p = strstr (json, pattern);
+	if (p == NULL) {
+	  return;
+	}
+	p += strlen(pattern);
+	for (n = 0; n < max && *p != ']' && *p != '\0'; n++) {
+	  sum[n] += atoi(p);
+	  p += strcspn (p, ",]");
+	  if (*p == ',') p++;
+	}
+}
+
+
+
+static int split_list (char *str, char **result, int max)
+{
+	int n = 0;
+	char *p;
+
+	for (p = strtok (str, ","); p != NULL && n < max; p = strtok (NULL, ",")) {
+	  result[n++] = p;
+	}
+	return (n);
+}
+
+
+
+static void usage (void)
+{
+	fprintf (stderr, "\n");
+	fprintf (stderr, "Usage:  abench [options] directory\n");
+	fprintf (stderr, "\n");
+	fprintf (stderr, "  -j n       Number to run at once.  Default is number of processors.\n");
+	fprintf (stderr, "  -P list    Demodulator profiles.  e.g.  C,F,ABC  Default C.\n");
+	fprintf (stderr, "  -F list    Fix bits levels.  e.g.  0,1,2  Default 2.\n");
+	fprintf (stderr, "  -D list    Decimation factors.  e.g.  1,2,3  Default 1.\n");
+	fprintf (stderr, "  -B n       Data rate.  Default 1200.\n");
+	fprintf (stderr, "  -a path    atest application.  Default ./atest\n");
+	fprintf (stderr, "  -o file    Write results to file rather than stdout.\n");
+	fprintf (stderr, "  -b file    Compare with results from an earlier run.\n");
+	fprintf (stderr, "\n");
+	exit (EXIT_FAILURE);
+}
+
+/* end abench.c */
@@ -0,0 +1,503 @@
+//
+//    This file is part of Dire Wolf, an amateur radio packet TNC.
+//
+//    Copyright (C) 2014  John Langner, WB2OSZ
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+/*------------------------------------------------------------------
+ *
+ * Module:      airtime.c
+ *
+ * Purpose:   	Keep track of how busy each radio channel is.
+ *
+ * Description:	Previously the only protection against flooding the
+ *		radio channel was a fixed count of packets, such as the
+ *		IGTXLIMIT for the IGate or the maximum length of the
+ *		transmit queue.  A fixed count doesn't know anything
+ *		about what else is happening on the channel.  Six packets
+ *		a minute might be fine on a quiet channel and far too
+ *		many on a congested 144.39 in a big city.
+ *
+ *		Here we keep a rolling history of:
+ *
+ *		  - Time our own transmitter was keyed.  xmit.c already
+ *		    calculates the duration of each transmission.
+ *
+ *		  - Time someone else was heard.  This comes from the
+ *		    "data carrier detect" in hdlc_rec.c which is based
+ *		    on HDLC flags rather than just audio level.
+ *
+ *		  - Number of times the DCD was active but nothing could
+ *		    be decoded.  Most of these will be collisions.
+ *		    A frame fixed later by the redecode thread arrives
+ *		    after the DCD has dropped.  It takes back the collision
+ *		    counted for the most recent such interval.
+ *
+ *		Each is accumulated into one second buckets so we can
+ *		answer questions like "What fraction of the last minute
+ *		was the channel busy?" without keeping a list of events.
+ *
+ *		The transmit queue, beacon, and IGate can then hold back
+ *		when the utilization exceeds the MAXUTIL configuration setting.
+ *
+ *---------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#if __WIN32__
+#include <windows.h>
+#endif
+
+#include "direwolf.h"
+#include "textcolor.h"
+#include "audio.h"
+#include "airtime.h"
+
+
+static int was_init = 0;
+
+static int num_channels;
+
+static int max_util[MAX_CHANS];		/* Percent.  0 means no limit. */
+
+
+/*
+ * One second of history.
+ * sec is used to recognize stale entries when we wrap around.
+ */
+
+struct bucket_s {
+	long sec;
+	int tx_ms;
+	int saved_ms;
+	int rx_ms;
+	int rx_frames;
+	int collisions;
+};
+
+static struct bucket_s history[MAX_CHANS][AIRTIME_HISTORY_SEC];
+
+
+/*
+ * Current state of the data carrier detect for each channel.
+ */
+
+static int dcd_busy[MAX_CHANS];		/* Is someone transmitting now? */
+
+static double dcd_start[MAX_CHANS];	/* When did it start? */
+
+static int dcd_frames[MAX_CHANS];	/* Number of good frames since DCD started. */
+
+static long last_collision[MAX_CHANS];	/* Bucket where the most recent interval, */
+					/* with nothing decoded, was counted as */
+					/* a collision.  -1 if none or taken back. */
+
+
+#if __WIN32__
+static CRITICAL_SECTION airtime_cs;
+#define AIRTIME_LOCK EnterCriticalSection (&airtime_cs)
+#define AIRTIME_UNLOCK LeaveCriticalSection (&airtime_cs)
+#else
+static pthread_mutex_t airtime_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define AIRTIME_LOCK pthread_mutex_lock (&airtime_mutex)
+#define AIRTIME_UNLOCK pthread_mutex_unlock (&airtime_mutex)
+#endif
+
+
+enum which_e { WHICH_TX, WHICH_RX };
+
+static double now_sec (void);
+static struct bucket_s * get_bucket (int chan, long sec);
+static void add_interval (int chan, enum which_e which, double t1, double t2);
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        airtime_init
+ *
+ * Purpose:     Initialize the channel utilization history.
+ *
+ * Inputs:	pa	- Audio / modem configuration.
+ *			  We are interested in num_channels and max_util.
+ *
+ *--------------------------------------------------------------------*/
+
+void airtime_init (struct audio_s *pa)
+{
+	int chan;
+
+	assert (pa != NULL);
+
+#if __WIN32__
+	if ( ! was_init) {
+	  InitializeCriticalSection (&airtime_cs);
+	}
+#endif
+	num_channels = pa->num_channels;
+
+	memset (history, 0, sizeof(history));
+
+	for (chan = 0; chan < MAX_CHANS; chan++) {
+	  max_util[chan] = pa->max_util[chan];
+	  dcd_busy[chan] = 0;
+	  dcd_start[chan] = 0;
+	  dcd_frames[chan] = 0;
+	  last_collision[chan] = -1;
+	}
+
+	was_init = 1;
+
+} /* end airtime_init */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        airtime_dcd_change
+ *
+ * Purpose:     Called by the HDLC receiver when the data carrier
+ *		detect, for any of the decoders on the channel,
+ *		changes state.
+ *
+ * Inputs:	chan	- Radio channel.
+ *
+ *		busy	- True if channel just became busy.
+ *			  False if it just became clear.
+ *
+ * Description:	When the channel goes clear, the elapsed time is
+ *		added to the receive history.  If nothing was decoded
+ *		during that time we count it as a probable collision.
+ *
+ *--------------------------------------------------------------------*/
+
+void airtime_dcd_change (int chan, int busy)
+{
+	double now;
+
+	if ( ! was_init) return;
+
+	assert (chan >= 0 && chan < MAX_CHANS);
+
+	now = now_sec ();
+
+	AIRTIME_LOCK;
+
+	if (busy && ! dcd_busy[chan]) {
+	  dcd_busy[chan] = 1;
+	  dcd_start[chan] = now;
+	  dcd_frames[chan] = 0;
+	}
+	else if ( ! busy && dcd_busy[chan]) {
+	  dcd_busy[chan] = 0;
+	  add_interval (chan, WHICH_RX, dcd_start[chan], now);
+	  if (dcd_frames[chan] == 0) {
+	    get_bucket(chan, (long)now)->collisions++;
+	    last_collision[chan] = (long)now;
+	  }
+	  else {
+	    last_collision[chan] = -1;
+	  }
+	}
+
+	AIRTIME_UNLOCK;
+
+} /* end airtime_dcd_change */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        airtime_rec_frame
+ *
+ * Purpose:     Called when a frame with a valid FCS has been received.
+ *
+ * Inputs:	chan	- Radio channel.
+ *
+ *		late	- True if it was fixed by the redecode thread,
+ *			  after the DCD for it has already dropped.
+ *
+ * Description:	A late frame doesn't belong to any interval in
+ *		progress.  It was most likely in the last interval
+ *		counted as a collision, so that is taken back.
+ *		If another interval, with something decoded, ended
+ *		in between, nothing is taken back and the collision
+ *		count stays a little high.
+ *
+ *--------------------------------------------------------------------*/
+
+void airtime_rec_frame (int chan, int late)
+{
+	long sec;
+
+	if ( ! was_init) return;
+
+	assert (chan >= 0 && chan < MAX_CHANS);
+
+	AIRTIME_LOCK;
+
+	if (late) {
+	  sec = last_collision[chan];
+	  if (sec >= 0 && history[chan][sec % AIRTIME_HISTORY_SEC].sec == sec &&
+			history[chan][sec % AIRTIME_HISTORY_SEC].collisions > 0) {
+	    history[chan][sec % AIRTIME_HISTORY_SEC].collisions--;
+	  }
+	  last_collision[chan] = -1;
+	}
+	else {
+	  dcd_frames[chan]++;
+	}
+	get_bucket(chan, (long)now_sec())->rx_frames++;
+
+	AIRTIME_UNLOCK;
+
+} /* end airtime_rec_frame */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        airtime_xmit
+ *
+ * Purpose:     Called by the transmit thread after each transmission.
+ *
+ * Inputs:	chan		- Radio channel.
+ *
+ *		duration_ms	- Time the transmitter was keyed, including
+ *				  TXDELAY and TXTAIL.  This is assumed
+ *				  to have just ended.
+ *
+ *		saved_ms	- Time we would have used for additional
+ *				  TXDELAY and TXTAIL if each frame had been
+ *				  sent in a separate transmission.
+ *
+ *--------------------------------------------------------------------*/
+
+void airtime_xmit (int chan, int duration_ms, int saved_ms)
+{
+	double now;
+
+	if ( ! was_init) return;
+
+	assert (chan >= 0 && chan < MAX_CHANS);
+
+	if (duration_ms <= 0) return;
+
+	now = now_sec ();
+
+	AIRTIME_LOCK;
+	add_interval (chan, WHICH_TX, now - duration_ms * 0.001, now);
+	get_bucket(chan, (long)now)->saved_ms += saved_ms;
+	AIRTIME_UNLOCK;
+
+} /* end airtime_xmit */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        airtime_get_stats
+ *
+ * Purpose:     Obtain channel activity for the recent past.
+ *
+ * Inputs:	chan		- Radio channel.
+ *
+ *		window_sec	- How far back to look.  Limited to
+ *				  range of 1 to AIRTIME_HISTORY_SEC.
+ *
+ * Outputs:	result		- Totals for the time period.
+ *
+ * Description:	If the channel is busy right now, the time since
+ *		the DCD came on is also included.
+ *
+ *--------------------------------------------------------------------*/
+
+void airtime_get_stats (int chan, int window_sec, struct airtime_stats_s *result)
+{
+	double now;
+	long sec, start;
+	int busy_ms;
+
+	assert (chan >= 0 && chan < MAX_CHANS);
+
+	memset (result, 0, sizeof(struct airtime_stats_s));
+
+	if (window_sec < 1) window_sec = 1;
+	if (window_sec > AIRTIME_HISTORY_SEC) window_sec = AIRTIME_HISTORY_SEC;
+	result->window_sec = window_sec;
+
+	if ( ! was_init) return;
+
+	now = now_sec ();
+	start = (long)now - window_sec + 1;
+
+	AIRTIME_LOCK;
+
+	for (sec = start; sec <= (long)now; sec++) {
+	  struct bucket_s *b = &history[chan][sec % AIRTIME_HISTORY_SEC];
+
+	  if (b->sec == sec) {
+	    result->tx_ms += b->tx_ms;
+	    result->saved_ms += b->saved_ms;
+
+	    result->rx_ms += b->rx_ms;
+	    result->rx_frames += b->rx_frames;
+	    result->collisions += b->collisions;
+	  }
+	}
+
+	if (dcd_busy[chan]) {
+	  double t1 = dcd_start[chan];
+
+	  if (t1 < (double)start) t1 = (double)start;
+	  result->rx_ms += (int)((now - t1) * 1000.);
+	}
+
+	AIRTIME_UNLOCK;
+
+	busy_ms = result->tx_ms + result->rx_ms;
+	result->utilization = (int)((busy_ms * 100L) / (window_sec * 1000L));
+	if (result->utilization > 100) result->utilization = 100;
+
+} /* end airtime_get_stats */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        airtime_utilization
+ *
+ * Purpose:     Percentage of time the channel was busy.
+ *
+ * Inputs:	chan		- Radio channel.
+ *
+ *		window_sec	- How far back to look.
+ *
+ * Returns:	0 - 100.
+ *
+ *--------------------------------------------------------------------*/
+
+int airtime_utilization (int chan, int window_sec)
+{
+	struct airtime_stats_s s;
+
+	airtime_get_stats (chan, window_sec, &s);
+	return (s.utilization);
+}
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        airtime_congested
+ *
+ * Purpose:     Should we hold back on adding more traffic?
+ *
+ * Inputs:	chan		- Radio channel.
+ *
+ * Returns:	True if MAXUTIL was configured for the channel and
+ *		utilization over the last AIRTIME_DEFAULT_WINDOW
+ *		seconds is at or above it.
+ *
+ *--------------------------------------------------------------------*/
+
+int airtime_congested (int chan)
+{
+	if (chan < 0 || chan >= MAX_CHANS) return (0);
+
+	if (max_util[chan] <= 0) return (0);
+
+	return (airtime_utilization (chan, AIRTIME_DEFAULT_WINDOW) >= max_util[chan]);
+}
+
+
+
+/*
+ * Add busy time to the one second buckets.
+ * An interval can be split over several of them.
+ * Caller must hold the lock.
+ */
+
+static void add_interval (int chan, enum which_e which, double t1, double t2)
+{
+	long sec;
+
+	if (t2 - t1 > AIRTIME_HISTORY_SEC) {
+	  t1 = t2 - AIRTIME_HISTORY_SEC;
+	}
+
+	for (sec = (long)t1; sec <= (long)t2; sec++) {
+	  double a = t1 > sec ? t1 : sec;
+	  double b = t2 < sec + 1 ? t2 : sec + 1;
+	  int ms;
+
+	  if (b <= a) continue;
+
+	  ms = (int)((b - a) * 1000. + 0.5);
+
+	  if (which == WHICH_TX) {
+	    get_bucket(chan, sec)->tx_ms += ms;
+	  }
+	  else {
+	    get_bucket(chan, sec)->rx_ms += ms;
+	  }
+	}
+}
+
+
+/*
+ * Find the bucket for the specified second, clearing out
+ * anything left over from an earlier trip around the ring.
+ * Caller must hold the lock.
+ */
+
+static struct bucket_s * get_bucket (int chan, long sec)
+{
+	struct bucket_s *b = &history[chan][sec % AIRTIME_HISTORY_SEC];
+
+	if (b->sec != sec) {
+	  memset (b, 0, sizeof(struct bucket_s));
+	  b->sec = sec;
+	}
+	return (b);
+}
+
+
+/*
+ * Monotonic time in seconds.
+ * Not affected if someone sets the clock.
+ */
+
+static double now_sec (void)
+{
+#if __WIN32__
+	return ((double)GetTickCount() * 0.001);
+#else
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ((double)ts.tv_sec + (double)ts.tv_nsec * 0.000000001);
+#endif
+}
+
+/* end airtime.c */
@@ -0,0 +1,75 @@
+
+/*------------------------------------------------------------------
+ *
+ * Module:      airtime.h
+ *
+ * Purpose:   	Keep track of how busy each radio channel is.
+ *
+ *---------------------------------------------------------------*/
+
+#ifndef AIRTIME_H
+#define AIRTIME_H 1
+
+#include "audio.h"		/* for struct audio_s */
+
+
+/*
+ * How far back we remember.  Queries can ask for any
+ * window up to this length.
+ */
+
+#define AIRTIME_HISTORY_SEC 600
+
+/*
+ * Window used when deciding whether the channel is too busy
+ * for us to add more traffic.
+ */
+
+#define AIRTIME_DEFAULT_WINDOW 60
+
+
+struct airtime_stats_s {
+
+	int window_sec;		/* Length of time covered by these results. */
+
+	int tx_ms;		/* Our own transmitter was keyed. */
+
+	int saved_ms;		/* TXDELAY and TXTAIL avoided by sending */
+				/* more than one frame per transmission. */
+
+	int rx_ms;		/* Someone else was heard (DCD active). */
+
+	int rx_frames;		/* Number of valid frames received. */
+
+	int collisions;		/* Number of times DCD was active but */
+				/* nothing could be decoded.  Most likely */
+				/* two stations transmitting at once but */
+				/* could also be a weak or distorted signal. */
+				/* Can be slightly high when the redecode */
+				/* thread fixes a frame after another */
+				/* interval has ended.  See airtime_rec_frame. */
+
+	int utilization;	/* Percentage of the window, 0 - 100, */
+				/* when the channel was busy for any reason. */
+};
+
+
+void airtime_init (struct audio_s *pa);
+
+void airtime_dcd_change (int chan, int busy);
+
+void airtime_rec_frame (int chan, int late);
+
+void airtime_xmit (int chan, int duration_ms, int saved_ms);
+
+
+void airtime_get_stats (int chan, int window_sec, struct airtime_stats_s *result);
+
+int airtime_utilization (int chan, int window_sec);
+
+int airtime_congested (int chan);
+
+
+#endif
+
+/* end airtime.h */
@@ -89,6 +89,7 @@ static int parse_location (char *e);
 static int parse_comment (char *e);
 static int expand_macro (char *e);
 static void raw_tt_data_to_app (int chan, char *msg);
+static void ttloc_compile (void);
 static int find_ttloc_match (char *e, char *xstr, char *ystr, char *zstr, char *bstr, char *dstr);
 
 
@@ -158,6 +159,7 @@ void aprs_tt_init (struct tt_config_s *p)
 	  msg_str[c][0] = '\0';
 	}
 
+	ttloc_compile ();
 }
 
 
@@ -1033,6 +1035,268 @@ static int parse_location (char *e)
 } /* end parse_location */
 
 
+/*------------------------------------------------------------------
+ *
+ * Name:        ttloc_compile
+ *
+ * Purpose:     Build an index of the location and macro patterns from
+ *		the configuration file so we don't need to try every one
+ *		for each received touch tone sequence.
+ *
+ * Inputs:      tt_config.ttloc_ptr, tt_config.ttloc_len
+ *
+ * Description:	There is a separate tree for each pattern length.
+ *		Each node has a branch for each possible character class:
+ *		a digit, "B", or anything else.  A lookup just follows
+ *		one branch for each character in the input so the time
+ *		depends only on the input length.
+ *
+ *		A placeholder, such as x or d, matches any digit so a 
+ *		pattern can be in more than one branch.  Each node
+ *		represents the set of patterns which could still match.
+ *		Nodes with the same set, at the same depth, are shared.
+ *		At the end, only the first pattern from the configuration
+ *		file matters, so all sets with the same first one are
+ *		the same node.
+ *
+ *		With unusual sets of patterns the number of nodes could
+ *		grow very large.  In that case, we give up and go back
+ *		to trying each pattern in order.
+ *
+ *----------------------------------------------------------------*/
+
+#define TTLOC_MAX_LEN 20		/* Same as size of pattern in ttloc_s. */
+
+#define TTLOC_NUM_CLASSES 12		/* 0-9, B, anything else. */
+
+#define TTLOC_MAX_NODES 50000
+
+struct ttloc_node_s {
+	int next[TTLOC_NUM_CLASSES];	/* Node for next character, -1 if no match. */
+	int ipat;			/* After the last character, index of */
+					/* pattern matched.  Otherwise -1. */
+};
+
+static struct ttloc_node_s *ttloc_node = NULL;
+static int ttloc_node_count = 0;
+static int ttloc_node_size = 0;
+
+static int ttloc_root[TTLOC_MAX_LEN];	/* Tree for each length, -1 if none. */
+
+static int ttloc_compiled = 0;		/* False if we had to give up. */
+
+
+static int ttloc_class (char ch)
+{
+	if (ch >= '0' && ch <= '9') return (ch - '0');
+	if (ch == 'B') return (10);
+	return (11);
+}
+
+/* Does pattern character match anything in the class? */
+
+static int ttloc_accepts (char mc, int cls)
+{
+	switch (mc) {
+	  case 'x':
+	  case 'y':
+	  case 'z':
+	  case 'b':
+	  case 'd':
+	    return (cls <= 9);
+	  case 'B':
+	  case '0': case '1': case '2': case '3': case '4':
+	  case '5': case '6': case '7': case '8': case '9':
+	    return (cls == ttloc_class(mc));
+	  default:
+	    return (0);
+	}
+}
+
+/* Does pattern p match everything that q does, from position "from" on? */
+
+static int ttloc_covers (char *p, char *q, int from)
+{
+	int k;
+
+	for (k = from; p[k] != '\0'; k++) {
+	  if (p[k] == q[k]) {
+	    continue;
+	  }
+	  if (strchr("xyzbd", p[k]) != NULL && (isdigit(q[k]) || strchr("xyzbd", q[k]) != NULL)) {
+	    continue;		/* Placeholder matches any digit. */
+	  }
+	  return (0);
+	}
+	return (1);
+}
+
+static int ttloc_new_node (void)
+{
+	int c;
+
+	if (ttloc_node_count == ttloc_node_size) {
+	  ttloc_node_size = ttloc_node_size == 0 ? 64 : ttloc_node_size * 2;
+	  ttloc_node = realloc (ttloc_node, sizeof(struct ttloc_node_s) * ttloc_node_size);
+	}
+	for (c = 0; c < TTLOC_NUM_CLASSES; c++) {
+	  ttloc_node[ttloc_node_count].next[c] = -1;
+	}
+	ttloc_node[ttloc_node_count].ipat = -1;
+	return (ttloc_node_count++);
+}
+
+
+struct ttloc_level_s {			/* Node and set of patterns it represents. */
+	int node;
+	int n;
+	int *pats;			/* Pattern indexes in ascending order. */
+};
+
+static void ttloc_compile (void)
+{
+	int len;
+	int npat = tt_config.ttloc_len;
+	struct ttloc_level_s *level, *next_level;
+	int nlevel, nnext;
+	int *subset;
+
+	free (ttloc_node);
+	ttloc_node = NULL;
+	ttloc_node_count = 0;
+	ttloc_node_size = 0;
+	ttloc_compiled = 1;
+
+	for (len = 0; len < TTLOC_MAX_LEN; len++) {
+	  ttloc_root[len] = -1;
+	}
+
+	if (npat == 0) {
+	  return;
+	}
+
+	subset = malloc (sizeof(int) * npat);
+
+	for (len = 1; len < TTLOC_MAX_LEN && ttloc_compiled; len++) {
+	  int ipat, depth, j;
+
+	  level = malloc (sizeof(struct ttloc_level_s));
+	  level[0].n = 0;
+	  level[0].pats = malloc (sizeof(int) * npat);
+	  for (ipat = 0; ipat < npat; ipat++) {
+	    if (strlen(tt_config.ttloc_ptr[ipat].pattern) == len) {
+	      level[0].pats[level[0].n++] = ipat;
+	    }
+	  }
+	  if (level[0].n == 0) {
+	    free (level[0].pats);
+	    free (level);
+	    continue;
+	  }
+	  level[0].node = ttloc_new_node ();
+	  ttloc_root[len] = level[0].node;
+	  nlevel = 1;
+
+	  for (depth = 0; depth < len; depth++) {
+	    int last = (depth == len - 1);
+
+	    next_level = NULL;
+	    nnext = 0;
+
+	    for (j = 0; j < nlevel && ttloc_compiled; j++) {
+	      int cls;
+
+	      for (cls = 0; cls < TTLOC_NUM_CLASSES; cls++) {
+	        int n = 0;
+	        int k, m;
+
+	        for (k = 0; k < level[j].n; k++) {
+	          if (ttloc_accepts (tt_config.ttloc_ptr[level[j].pats[k]].pattern[depth], cls)) {
+	            subset[n++] = level[j].pats[k];
+	          }
+	        }
+	        if (n == 0) {
+	          continue;
+	        }
+
+	        /* Drop any pattern which can't be first because an */
+	        /* earlier one matches everything it does from here on. */
+
+	        if ( ! last) {
+	          int kept = 1;
+
+	          for (k = 1; k < n; k++) {
+	            for (m = 0; m < kept; m++) {
+	              if (ttloc_covers (tt_config.ttloc_ptr[subset[m]].pattern, tt_config.ttloc_ptr[subset[k]].pattern, depth + 1)) {
+	                break;
+	              }
+	            }
+	            if (m == kept) {
+	              subset[kept++] = subset[k];
+	            }
+	          }
+	          n = kept;
+	        }
+
+	        /* Same set already at next depth? */
+	        /* At the end, only the first one matters. */
+
+	        for (m = 0; m < nnext; m++) {
+	          if (last ? next_level[m].pats[0] == subset[0] :
+	                     next_level[m].n == n && memcmp (next_level[m].pats, subset, sizeof(int) * n) == 0) {
+	            break;
+	          }
+	        }
+
+	        if (m == nnext) {
+	          if (ttloc_node_count >= TTLOC_MAX_NODES) {
+	            ttloc_compiled = 0;
+	            break;
+	          }
+	          next_level = realloc (next_level, sizeof(struct ttloc_level_s) * (nnext + 1));
+	          next_level[m].node = ttloc_new_node ();
+	          next_level[m].n = n;
+	          next_level[m].pats = malloc (sizeof(int) * n);
+	          memcpy (next_level[m].pats, subset, sizeof(int) * n);
+	          if (last) {
+	            ttloc_node[next_level[m].node].ipat = subset[0];
+	          }
+	          nnext++;
+	        }
+
+	        ttloc_node[level[j].node].next[cls] = next_level[m].node;
+	      }
+	    }
+
+	    for (j = 0; j < nlevel; j++) {
+	      free (level[j].pats);
+	    }
+	    free (level);
+	    level = next_level;
+	    nlevel = nnext;
+	  }
+
+	  for (j = 0; j < nlevel; j++) {
+	    free (level[j].pats);
+	  }
+	  free (level);
+	}
+
+	free (subset);
+
+	if ( ! ttloc_compiled) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("APRStt location and macro patterns are too complicated to index.\n");
+	  dw_printf ("Each will be tried in order which is slower.\n");
+	  free (ttloc_node);
+	  ttloc_node = NULL;
+	  ttloc_node_count = 0;
+	  ttloc_node_size = 0;
+	}
+
+} /* end ttloc_compile */
+
+
 /*------------------------------------------------------------------
  *
  * Name:        find_ttloc_match
@@ -1053,128 +1317,75 @@ static int parse_location (char *e)
  * Returns:     >= 0 for index into table if found.
  *		-1 if not found.
  *
- * Description:	
+ * Description:	The first pattern, in the configuration file order,
+ *		is found using the index built by ttloc_compile.
+ *		Then the digits are picked out for the placeholders.
  *
  *----------------------------------------------------------------*/
 
 static int find_ttloc_match (char *e, char *xstr, char *ystr, char *zstr, char *bstr, char *dstr)
 {
 	int ipat;	/* Index into patterns from configuration file */
-	int len;	/* Length of pattern we are trying to match. */
-	int match;
-	char mc;
+	int len;	/* Length of input. */
 	int k;
+	char *pattern;
+	int nx = 0, ny = 0, nz = 0, nb = 0, nd = 0;
 
-//TODO: remove dw_printf ("find_ttloc_match: e=%s\n", e);
+	len = strlen(e);
+	ipat = -1;
 
-	for (ipat=0; ipat<tt_config.ttloc_len; ipat++) {
-	  
-	  len = strlen(tt_config.ttloc_ptr[ipat].pattern);
+	if (ttloc_compiled) {
+	  if (len < TTLOC_MAX_LEN && ttloc_root[len] >= 0) {
+	    int node = ttloc_root[len];
 
-	  if (strlen(e) == len) {
+	    for (k = 0; k < len && node >= 0; k++) {
+	      node = ttloc_node[node].next[ttloc_class(e[k])];
+	    }
+	    if (node >= 0) {
+	      ipat = ttloc_node[node].ipat;
+	    }
+	  }
+	}
+	else {
+	  int i;
 
-	    match = 1;
-	    strcpy (xstr, "");
-	    strcpy (ystr, "");
-	    strcpy (zstr, "");
-	    strcpy (bstr, "");
-	    strcpy (dstr, "");
+	  for (i = 0; i < tt_config.ttloc_len && ipat < 0; i++) {
+	    if (strlen(tt_config.ttloc_ptr[i].pattern) == len) {
+	      for (k = 0; k < len && ttloc_accepts (tt_config.ttloc_ptr[i].pattern[k], ttloc_class(e[k])); k++) {
+	      }
+	      if (k == len) {
+	        ipat = i;
+	      }
+	    }
+	  }
+	}
 
-	    for (k=0; k<len; k++) {
-	      mc = tt_config.ttloc_ptr[ipat].pattern[k];
-	      switch (mc) {
+	if (ipat < 0) {
+	  return (-1);
+	}
 
-	        case 'B':
-	        case '0':
-	        case '1':
-	        case '2':
-	        case '3':
-	        case '4':
-	        case '5':
-	        case '6':
-	        case '7':
-	        case '8':
-	        case '9':
-		  if (e[k] != mc) {
-		    match = 0;
-		  }
-		  break;
-
-		case 'x':
-		   if (isdigit(e[k])) {
-	             char stemp[2];
-		     stemp[0] = e[k];
-		     stemp[1] = '\0';
-		     strcat (xstr, stemp);
-		   }
-		   else {
-		     match = 0;
-	           }
-		  break;
-
-		case 'y':
-		   if (isdigit(e[k])) {
-	             char stemp[2];
-		     stemp[0] = e[k];
-		     stemp[1] = '\0';
-		     strcat (ystr, stemp);
-		   }
-		   else {
-		     match = 0;
-	           }
-		  break;
-
-		case 'z':
-		   if (isdigit(e[k])) {
-	             char stemp[2];
-		     stemp[0] = e[k];
-		     stemp[1] = '\0';
-		     strcat (zstr, stemp);
-		   }
-		   else {
-		     match = 0;
-	           }
-		  break;
-
-		case 'b':
-		   if (isdigit(e[k])) {
-	             char stemp[2];
-		     stemp[0] = e[k];
-		     stemp[1] = '\0';
-		     strcat (bstr, stemp);
-		   }
-		   else {
-		     match = 0;
-	           }
-		  break;
-
-		case 'd':
-		   if (isdigit(e[k])) {
-	             char stemp[2];
-		     stemp[0] = e[k];
-		     stemp[1] = '\0';
-		     strcat (dstr, stemp);
-		   }
-		   else {
-		     match = 0;
-	           }
-		  break;
-
-		default:
-		  dw_printf ("find_ttloc_match: shouldn't be here.\n");
-		  /* Shouldn't be here. */
-		  match = 0;
-		  break;
-
-	      } /* switch */
-	    } /* for k */
-	  
-	    if (match) {
-	      return (ipat);
-	    }
-	  } /* if strlen */
+/*
+ * Pick out the digits for each placeholder.
+ */
+	pattern = tt_config.ttloc_ptr[ipat].pattern;
+
+	for (k = 0; k < len; k++) {
+	  switch (pattern[k]) {
+	    case 'x':  xstr[nx++] = e[k];  break;
+	    case 'y':  ystr[ny++] = e[k];  break;
+	    case 'z':  zstr[nz++] = e[k];  break;
+	    case 'b':  bstr[nb++] = e[k];  break;
+	    case 'd':  dstr[nd++] = e[k];  break;
+	    default:  break;
+	  }
 	}
-	return (-1);
+	xstr[nx] = '\0';
+	ystr[ny] = '\0';
+	zstr[nz] = '\0';
+	bstr[nb] = '\0';
+	dstr[nd] = '\0';
+
+	return (ipat);
 
 } /* end find_ttloc_match */
 
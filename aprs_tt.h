@@ -75,8 +75,12 @@ struct tt_config_s {
 	double corral_lon;
 	double corral_offset;
 	int corral_ambiguity;
+
+	int max_users;			/* Maximum number of users to remember. */
 };
 
+#define TT_DEFAULT_MAX_USERS 100
+
 	
 void aprs_tt_init (struct tt_config_s *p_config);
 
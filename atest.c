@@ -67,6 +67,26 @@
  *	  After more tweaking, version 0.6 gets 965 packets.
  *	  This is without the option to retry after getting a bad FCS.
  *
+ *	  Version 0.9 with profile C and -F 0, 1, 2:  971, 990, 992.
+ *
+ * Benchmarking:
+ *
+ *	-F n	Level of effort to fix bad FCS.  Same values as
+ *		FIX_BITS in the configuration file.  Default 2.
+ *
+ *	-q	Quiet.  Don't display each packet.
+ *
+ *	-J	Finish with a single line of JSON containing the
+ *		settings and results:  packets decoded, number at each
+ *		retry level, audio duration, CPU time, and real time factor.
+ *
+ *	-S file	Save blocks of bits, which could not be fixed, in file.
+ *		The rbench application can then try the various
+ *		bit fixing strategies on them.
+ *
+ *	The abench application runs this for a whole directory
+ *	of files and combinations of settings, several at once.
+ *
  *--------------------------------------------------------------------*/
 
 // #define X 1
@@ -122,6 +142,12 @@ static int packets_decoded = 0;
 static int decimate = 1;		/* Reduce that sampling rate. */
 					/* 1 = normal, 2 = half, etc. */
 
+static int packets_by_retry[RETRY_TWO_SEP+1];	/* How much effort was needed. */
+static int q_opt = 0;			/* Don't print each packet. */
+static int json_opt = 0;		/* Print summary as JSON. */
+
+static void print_json (char *fname, struct audio_s *pm, double audio_sec, double cpu_sec);
+
 
 int main (int argc, char *argv[])
 {
@@ -131,6 +157,10 @@ int main (int argc, char *argv[])
 	struct audio_s modem;
 	int channel;
 	time_t start_time;
+	clock_t start_cpu;
+	double cpu_sec;
+	double audio_sec;
+	long samples = 0;
 
 	text_color_init(1);
 	text_color_set(DW_COLOR_INFO);
@@ -145,14 +175,10 @@ int main (int argc, char *argv[])
 	modem.samples_per_sec = DEFAULT_SAMPLES_PER_SEC;	
 	modem.bits_per_sample = DEFAULT_BITS_PER_SAMPLE;	
 
-	/* TODO: should have a command line option for this. */
 	/* Results v0.9: 971/69, 990/64, 992/65, 992/67, 1004/476 */
+	/* Can be changed with -F option. */
 
-	modem.fix_bits = RETRY_NONE;
-	modem.fix_bits = RETRY_SINGLE;
 	modem.fix_bits = RETRY_DOUBLE;
-	//modem.fix_bits = RETRY_TRIPLE;
-	//modem.fix_bits = RETRY_TWO_SEP;
 
 	for (channel=0; channel<MAX_CHANS; channel++) {
 
@@ -194,7 +220,7 @@ int main (int argc, char *argv[])
 
 	  /* ':' following option character means arg is required. */
 
-          c = getopt_long(argc, argv, "B:P:D:",
+          c = getopt_long(argc, argv, "B:P:D:F:qJS:",
                         long_options, &option_index);
           if (c == -1)
             break;
@@ -245,6 +271,31 @@ int main (int argc, char *argv[])
 	      modem.decimate[0] = decimate;
 	      break;	
 
+	    case 'F':				/* -F level of effort to fix bad FCS. */
+
+	      modem.fix_bits = atoi(optarg);
+	      if (modem.fix_bits < RETRY_NONE || modem.fix_bits > RETRY_TWO_SEP) {
+                fprintf (stderr, "-F must be in range of %d to %d.\n", RETRY_NONE, RETRY_TWO_SEP);
+                exit (EXIT_FAILURE);
+	      }
+	      printf ("Fix bits level = %d\n", modem.fix_bits);
+	      break;	
+
+	    case 'q':				/* -q don't print each packet. */
+
+	      q_opt = 1;
+	      break;	
+
+	    case 'J':				/* -J JSON summary at end. */
+
+	      json_opt = 1;
+	      break;	
+
+	    case 'S':				/* -S save blocks which could not be fixed. */
+
+	      hdlc_rec2_spill_init (optarg);
+	      break;	
+
             case '?':
 
               /* Unknown option message was already printed. */
@@ -264,6 +315,11 @@ int main (int argc, char *argv[])
 	  exit (1);
 	}
 
+/* Profile might have been changed from default by -P. */
+
+	modem.num_subchan[0] = strlen(modem.profiles[0]);
+	modem.num_freq[0] = modem.num_subchan[0];
+
 	fp = fopen(argv[optind], "rb");
         if (fp == NULL) {
 	  text_color_set(DW_COLOR_ERROR);
@@ -273,6 +329,7 @@ int main (int argc, char *argv[])
         }
 
 	start_time = time(NULL);
+	start_cpu = clock();
 
 
 /*
@@ -326,6 +383,7 @@ int main (int argc, char *argv[])
 #if ONE_CHAN
             if (c != 0) continue;
 #endif
+            if (c == 0) samples++;
 
             multi_modem_process_sample(c,audio_sample);
           }
@@ -335,14 +393,51 @@ int main (int argc, char *argv[])
 
 	}
 
+	cpu_sec = (double)(clock() - start_cpu) / CLOCKS_PER_SEC;
+	audio_sec = (double)samples / modem.samples_per_sec;
+
 	text_color_set(DW_COLOR_INFO);
 	printf ("\n\n");
 	printf ("%d packets decoded in %d seconds.\n", packets_decoded, (int)(time(NULL) - start_time));
 
+	if (json_opt) {
+	  print_json (argv[optind], &modem, audio_sec, cpu_sec);
+	}
+
 	exit (0);
 }
 
 
+/*
+ * Summary for the abench application, all on one line.
+ * It doesn't need a full JSON parser to read this back.
+ */
+
+static void print_json (char *fname, struct audio_s *pm, double audio_sec, double cpu_sec)
+{
+	char *p;
+	int n;
+
+	printf ("{\"file\":\"");
+	for (p = fname; *p != '\0'; p++) {
+	  if (*p == '"' || *p == '\\') putchar ('\\');
+	  putchar (*p);
+	}
+	printf ("\",\"profile\":\"%s\",\"fix_bits\":%d,\"decimate\":%d,\"baud\":%d",
+		pm->profiles[0], pm->fix_bits, decimate, pm->baud[0]);
+	printf (",\"sample_rate\":%d,\"audio_sec\":%.3f,\"cpu_sec\":%.3f",
+		pm->samples_per_sec, audio_sec, cpu_sec);
+	printf (",\"cpu_per_audio_sec\":%.5f,\"realtime_factor\":%.1f",
+		audio_sec > 0 ? cpu_sec / audio_sec : 0., cpu_sec > 0 ? audio_sec / cpu_sec : 0.);
+	printf (",\"packets\":%d,\"retries\":[", packets_decoded);
+	for (n = 0; n <= RETRY_TWO_SEP; n++) {
+	  printf ("%s%d", n ? "," : "", packets_by_retry[n]);
+	}
+	printf ("]}\n");
+	fflush (stdout);
+}
+
+
 /*
  * Simulate sample from the audio device.
  */
@@ -398,6 +493,14 @@ void app_process_rec_packet (int chan, int subchan, packet_t pp, int alevel, ret
 
 
 	packets_decoded++;
+	if (retries >= RETRY_NONE && retries <= RETRY_TWO_SEP) {
+	  packets_by_retry[(int)retries]++;
+	}
+
+	if (q_opt) {
+	  ax25_delete (pp);
+	  return;
+	}
 
 
 	ax25_format_addrs (pp, stemp);
@@ -86,7 +86,9 @@
 
 #include "direwolf.h"
 #include "audio.h"
+#include "audio_udp.h"
 #include "textcolor.h"
+#include "metrics.h"
 
 
 #if USE_ALSA
@@ -105,6 +107,9 @@ static int oss_audio_device_fd = -1;	/* Single device, both directions. */
 
 #endif
 
+static metrics_t m_input_errors = -1;	/* Performance counters. */
+static metrics_t m_input_overruns = -1;
+
 static int inbuf_size_in_bytes = 0;	/* number of bytes allocated */
 static unsigned char *inbuf_ptr = NULL;
 static int inbuf_len = 0;		/* number byte of actual data available. */
@@ -118,10 +123,6 @@ static int outbuf_len = 0;
 		
 static enum audio_in_type_e audio_in_type;
 
-// UDP socket used for receiving data
-
-static int udp_sock;
-
 
 #define roundup1k(n) (((n) + 0x3ff) & ~0x3ff)
 #define calcbufsize(rate,chans,bits) roundup1k( ( (rate)*(chans)*(bits) / 8 * ONE_BUF_TIME)/1000  )
@@ -138,6 +139,9 @@ static int udp_sock;
  *		New in version 1.0, we recognize "udp:" optionally
  *		followed by a port number.
  *
+ *		"rtp:" is the same except each packet has an RTP
+ *		header.  See audio_udp.c.
+ *
  * Inputs:      pa		- Address of structure of type audio_s.
  *				
  *				Using a structure, rather than separate arguments
@@ -193,6 +197,11 @@ int audio_open (struct audio_s *pa)
 	assert (oss_audio_device_fd == -1);
 #endif
 
+	m_input_errors = metrics_counter ("audio_input_errors_total",
+			"Errors reading from the audio input device.", "");
+	m_input_overruns = metrics_counter ("audio_input_overruns_total",
+			"Audio input was not read fast enough and samples were lost.", "");
+
 /*
  * Fill in defaults for any missing values.
  */
@@ -223,8 +232,6 @@ int audio_open (struct audio_s *pa)
  * Open audio device.
  */
 
-	udp_sock = -1;
-
 	inbuf_size_in_bytes = 0;
 	inbuf_ptr = NULL;
 	inbuf_len = 0;
@@ -246,12 +253,12 @@ int audio_open (struct audio_s *pa)
 	  /* Change - to stdin for readability. */
 	  strcpy (pa->adevice_in, "stdin");
 	}
-	else if (strncasecmp(pa->adevice_in, "udp:", 4) == 0) {
+	else if (strncasecmp(pa->adevice_in, "udp:", 4) == 0 ||
+		 strncasecmp(pa->adevice_in, "rtp:", 4) == 0) {
 	  audio_in_type = AUDIO_IN_TYPE_SDR_UDP;
 	  /* Supply default port if none specified. */
-	  if (strcasecmp(pa->adevice_in,"udp") == 0 ||
-	    strcasecmp(pa->adevice_in,"udp:") == 0) {
-	    sprintf (pa->adevice_in, "udp:%d", DEFAULT_UDP_AUDIO_PORT);
+	  if (strlen(pa->adevice_in) == 4) {
+	    sprintf (pa->adevice_in + 4, "%d", DEFAULT_UDP_AUDIO_PORT);
 	  }
 	} 
 
@@ -302,31 +309,8 @@ int audio_open (struct audio_s *pa)
  */
 	  case AUDIO_IN_TYPE_SDR_UDP:
 
-	    //Create socket and bind socket
-	    
-	    {
-	      struct sockaddr_in si_me;
-	      int slen=sizeof(si_me);
-	      int data_size = 0;
-
-	      //Create UDP Socket
-	      if ((udp_sock=socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP))==-1) {
-	        text_color_set(DW_COLOR_ERROR);
-	        dw_printf ("Couldn't create socket, errno %d\n", errno);
-	        return -1;
-	      }
-
-	      memset((char *) &si_me, 0, sizeof(si_me));
-	      si_me.sin_family = AF_INET;   
-	      si_me.sin_port = htons((short)atoi(audio_in_name+4));
-	      si_me.sin_addr.s_addr = htonl(INADDR_ANY);
-
-	      //Bind to the socket
-	      if (bind(udp_sock, (const struct sockaddr *) &si_me, sizeof(si_me))==-1) {
-	        text_color_set(DW_COLOR_ERROR);
-	        dw_printf ("Couldn't bind socket, errno %d\n", errno);
-	        return -1;
-	      }
+	    if (audio_udp_open (audio_in_name, pa) < 0) {
+	      return -1;
 	    }
 	    inbuf_size_in_bytes = SDR_UDP_BUF_MAXLEN; 
 	
@@ -848,6 +832,7 @@ int audio_get (void)
 
 	        text_color_set(DW_COLOR_ERROR);
 	        dw_printf ("Audio input device error: %s\n", snd_strerror(n));
+	        metrics_add (m_input_errors, 1);
 
 	        /* Try to recover a few times and eventually give up. */
 	        if (++retries > 10) {
@@ -860,6 +845,7 @@ int audio_get (void)
 
 	          /* EPIPE means overrun */
 
+	          metrics_add (m_input_overruns, 1);
 	          snd_pcm_recover (audio_in_handle, n, 1);
 
 	        } 
@@ -883,17 +869,15 @@ int audio_get (void)
 	  case AUDIO_IN_TYPE_SDR_UDP:
 
 	    while (inbuf_next >= inbuf_len) {
-	      int ch, res,i;
+	      int res;
 
-              assert (udp_sock > 0);
-	      res = recv(udp_sock, inbuf_ptr, inbuf_size_in_bytes, 0);
+	      res = audio_udp_read (inbuf_ptr, inbuf_size_in_bytes);
 	      if (res < 0) {
-	        text_color_set(DW_COLOR_ERROR);
-	        dw_printf ("Can't read from udp socket, res=%d", res);
 	        inbuf_len = 0;
 	        inbuf_next = 0;
 	        return (-1);
 	      }
+
 	    
 	      inbuf_len = res;
 	      inbuf_next = 0;
@@ -114,6 +114,19 @@ struct audio_s {
 					/* dropping PTT too soon and chopping off the end */
 					/* of the frame.  Again 10 mS units. */
 					/* At this point, I'm thinking of 10 as the default. */
+
+	int maxframe[MAX_CHANS];	/* Maximum number of frames in one transmission. */
+					/* Once the transmitter is keyed, frames from both */
+					/* priority queues can be sent, high priority first. */
+
+	int linger[MAX_CHANS];		/* Hold a low priority frame up to this long, */
+					/* 10 mS units, in hopes that others will arrive and */
+					/* can share the same TXDELAY.  0 means don't wait. */
+
+	int max_util[MAX_CHANS];	/* Maximum channel utilization, in percent, before */
+					/* we hold back low priority transmissions, beacons, */
+					/* and IGate traffic.  Includes our own transmissions */
+					/* and others heard.  0 means no limit. */
 };
 
 #if __WIN32__
@@ -180,6 +193,13 @@ struct audio_s {
 #define DEFAULT_PERSIST		63
 #define DEFAULT_TXDELAY		30
 #define DEFAULT_TXTAIL		10	/* not sure yet. */
+#define DEFAULT_MAX_UTIL	0	/* No limit. */
+#define DEFAULT_MAXFRAME	7
+#define MAX_MAXFRAME		7
+#define DEFAULT_LINGER		0
+#define MAX_LINGER		100	/* 1 second */
+
+
 
 
 /* 
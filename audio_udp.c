@@ -0,0 +1,740 @@
+//
+//    This file is part of Dire Wolf, an amateur radio packet TNC.
+//
+//    Copyright (C) 2014  John Langner, WB2OSZ
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+/*------------------------------------------------------------------
+ *
+ * Module:      audio_udp.c
+ *
+ * Purpose:   	Receive audio stream over UDP, optionally with RTP header.
+ *
+ * Description:	This is used for audio from an SDR receiver, such as
+ *		rtl_fm or gqrx, on the same computer or local network,
+ *		so we don't need a "loopback" sound device.
+ *
+ *		"udp:port" is the original raw form.  Each datagram
+ *		contains nothing but audio samples in the same format
+ *		as a sound card:  little endian for 16 bits.
+ *
+ *		"rtp:port" expects an RTP header (RFC 3550) in front of
+ *		the audio.  Payload is linear PCM, which RFC 3551 says
+ *		is big endian for 16 bits, so it gets swapped.
+ *		The sequence number allows us to put reordered packets
+ *		back in order and to notice lost packets.
+ *
+ *		Unlike a telephone, nothing plays the audio out at
+ *		a fixed rate.  The demodulator takes samples as fast as
+ *		they arrive so the "jitter buffer" here only needs to hold
+ *		packets while waiting for a missing one.  We wait until
+ *		AUDIO_UDP_REORDER_DEPTH later packets have arrived, or
+ *		nothing has been heard for AUDIO_UDP_GAP_MS, then
+ *		give up on it.
+ *
+ *		A lost packet is replaced by the previous packet, faded
+ *		out, rather than simply dropped.  The frame being received
+ *		is probably lost either way but this keeps the sample
+ *		count, and therefore timing, correct for the demodulator.
+ *		Silence is used if more than one packet in a row is lost.
+ *
+ *		Where available, recvmmsg() picks up all waiting datagrams
+ *		with one system call.
+ *
+ *		Only one source is used at a time.  Packets from other
+ *		senders are counted and discarded, unless the current
+ *		source has been quiet for a while.
+ *
+ *---------------------------------------------------------------*/
+
+#if __WIN32__
+#include <winsock2.h>
+#define _WIN32_WINNT 0x0501
+#include <ws2tcpip.h>
+#else
+#define _GNU_SOURCE 1		/* for recvmmsg */
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#endif
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+
+#include "direwolf.h"
+#include "audio.h"
+#include "audio_udp.h"
+#include "textcolor.h"
+
+
+#if __WIN32__
+static SOCKET udp_sock = INVALID_SOCKET;
+#else
+static int udp_sock = -1;
+#endif
+
+static int use_rtp;			/* RTP header expected. */
+
+static int bytes_per_sample;		/* 1 or 2. */
+
+
+/*
+ * Packets waiting to be given to the demodulator,
+ * indexed by low bits of sequence number.
+ * For plain UDP, we make up sequence numbers in order of arrival.
+ */
+
+#define NUM_SLOTS 32			/* Power of 2, much larger than AUDIO_UDP_REORDER_DEPTH. */
+
+static struct slot_s {
+	int valid;
+	int len;
+	unsigned char data[SDR_UDP_BUF_MAXLEN];
+} slots[NUM_SLOTS];
+
+static int buffered;			/* Number of valid slots. */
+
+static int have_next;			/* Set once we know where the stream starts. */
+static unsigned short next_seq;		/* Next to hand out. */
+static unsigned short highest_seq;	/* Latest one received. */
+static unsigned short made_up_seq;	/* For plain UDP. */
+
+
+/*
+ * For packet loss concealment.
+ */
+
+static unsigned char prev_data[SDR_UDP_BUF_MAXLEN];
+static int prev_len;
+static int prev_concealed;		/* Previous was already a fill-in. */
+
+
+/*
+ * Everyone we've heard from.
+ */
+
+static struct audio_udp_stats_s sources[AUDIO_UDP_MAX_SOURCES];
+static int num_sources;
+
+static int active = -1;			/* Index into sources. */
+static time_t active_last;		/* Last heard from active source. */
+
+#define SWITCH_SEC 5			/* Another source can take over after */
+					/* the active one is quiet this long. */
+
+#define REPORT_SEC 60			/* Print statistics if there was a */
+					/* problem in the past minute. */
+
+
+/*
+ * Receive several datagrams at once.
+ */
+
+#define BATCH 16
+
+static unsigned char rbuf[BATCH][SDR_UDP_BUF_MAXLEN];
+static int rlen[BATCH];
+static struct sockaddr_in rfrom[BATCH];
+
+
+static void flush_slots (void);
+static int receive_batch (void);
+static void accept_packet (unsigned char *p, int len, struct sockaddr_in *from);
+static int conceal (unsigned char *buf, int bufsize);
+static void maybe_report (void);
+
+
+
+/*------------------------------------------------------------------
+ *
+ * Name:        audio_udp_open
+ *
+ * Purpose:     Create socket to receive audio stream.
+ *
+ * Inputs:	name	- "udp:" or "rtp:" followed by port number.
+ *
+ *		pa	- Audio configuration.  We care about bits_per_sample.
+ *
+ * Returns:     0 for success, -1 for failure.
+ *
+ *----------------------------------------------------------------*/
+
+int audio_udp_open (char *name, struct audio_s *pa)
+{
+	struct sockaddr_in si_me;
+	int port;
+#if __WIN32__
+	WSADATA wsadata;
+	DWORD timeout = AUDIO_UDP_GAP_MS;
+	int err;
+#else
+	struct timeval timeout;
+#endif
+
+	use_rtp = strncasecmp(name, "rtp:", 4) == 0;
+	bytes_per_sample = pa->bits_per_sample / 8;
+	port = atoi(name + 4);
+
+	memset (slots, 0, sizeof(slots));
+	buffered = 0;
+	have_next = 0;
+	made_up_seq = 0;
+	prev_len = 0;
+	prev_concealed = 0;
+	num_sources = 0;
+	active = -1;
+
+#if __WIN32__
+	err = WSAStartup (MAKEWORD(2,2), &wsadata);
+	if (err != 0) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf("WSAStartup failed: %d\n", err);
+	  return (-1);
+	}
+
+	if (LOBYTE(wsadata.wVersion) != 2 || HIBYTE(wsadata.wVersion) != 2) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf("Could not find a usable version of Winsock.dll\n");
+	  WSACleanup();
+	  return (-1);
+	}
+
+	udp_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (udp_sock == INVALID_SOCKET) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Couldn't create socket, errno %d\n", WSAGetLastError());
+	  return -1;
+	}
+#else
+	udp_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (udp_sock == -1) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Couldn't create socket, errno %d\n", errno);
+	  return -1;
+	}
+#endif
+
+	memset((char *) &si_me, 0, sizeof(si_me));
+	si_me.sin_family = AF_INET;
+	si_me.sin_port = htons((unsigned short)port);
+	si_me.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	if (bind(udp_sock, (struct sockaddr *) &si_me, sizeof(si_me)) != 0) {
+	  text_color_set(DW_COLOR_ERROR);
+#if __WIN32__
+	  dw_printf ("Couldn't bind socket, errno %d\n", WSAGetLastError());
+#else
+	  dw_printf ("Couldn't bind socket, errno %d\n", errno);
+#endif
+	  return -1;
+	}
+
+/*
+ * Don't wait forever so we can give up on a missing packet.
+ */
+
+#if __WIN32__
+	setsockopt (udp_sock, SOL_SOCKET, SO_RCVTIMEO, (char*)&timeout, sizeof(timeout));
+#else
+	timeout.tv_sec = 0;
+	timeout.tv_usec = AUDIO_UDP_GAP_MS * 1000;
+	setsockopt (udp_sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#endif
+
+	text_color_set(DW_COLOR_INFO);
+	dw_printf ("Listening for %s audio on UDP port %d.\n", use_rtp ? "RTP" : "raw", port);
+
+	return (0);
+
+} /* end audio_udp_open */
+
+
+/*------------------------------------------------------------------
+ *
+ * Name:        audio_udp_read
+ *
+ * Purpose:     Get the next block of audio.
+ *
+ * Inputs:	buf	- Where to put it.
+ *
+ *		bufsize	- Size of buf.  Should be SDR_UDP_BUF_MAXLEN.
+ *
+ * Returns:     Number of bytes placed in buf.
+ *              -1 for error.
+ *
+ * Description:	This will wait if nothing is available.
+ *
+ *----------------------------------------------------------------*/
+
+int audio_udp_read (unsigned char *buf, int bufsize)
+{
+	int timed_out = 0;
+	int n, len, i;
+
+	while (1) {
+
+	  if (have_next) {
+	    struct slot_s *s = &slots[next_seq & (NUM_SLOTS-1)];
+
+	    if (s->valid) {
+	      len = s->len < bufsize ? s->len : bufsize;
+	      memcpy (buf, s->data, len);
+	      memcpy (prev_data, s->data, len);
+	      prev_len = len;
+	      prev_concealed = 0;
+
+	      s->valid = 0;
+	      buffered--;
+	      next_seq++;
+	      return (len);
+	    }
+
+/*
+ * Next one is missing.  Give up on it if we have enough
+ * after it or the stream has gone quiet.
+ */
+	    if (buffered > 0 &&
+		((short)(highest_seq - next_seq) >= AUDIO_UDP_REORDER_DEPTH || timed_out)) {
+
+	      sources[active].lost++;
+	      next_seq++;
+	      len = conceal (buf, bufsize);
+	      if (len > 0) {
+	        sources[active].concealed++;
+	        return (len);
+	      }
+	      continue;
+	    }
+	  }
+
+	  n = receive_batch ();
+
+	  if (n < 0) {
+	    return (-1);
+	  }
+
+	  timed_out = (n == 0);
+
+	  for (i = 0; i < n; i++) {
+
+	    accept_packet (rbuf[i], rlen[i], &rfrom[i]);
+	  }
+
+	  maybe_report ();
+	}
+
+} /* end audio_udp_read */
+
+
+/*
+ * Forget about anything waiting.  Used when the stream
+ * starts over or switches to a different source.
+ */
+
+static void flush_slots (void)
+{
+	int i;
+
+	for (i = 0; i < NUM_SLOTS; i++) {
+	  slots[i].valid = 0;
+	}
+	buffered = 0;
+	have_next = 0;
+}
+
+
+/*------------------------------------------------------------------
+ *
+ * Name:        receive_batch
+ *
+ * Purpose:     Wait for one or more datagrams.
+ *
+ * Returns:     Number received into rbuf, rlen, and rfrom.
+ *		0 for timeout.
+ *		-1 for error.
+ *
+ *----------------------------------------------------------------*/
+
+static int receive_batch (void)
+{
+#if defined(MSG_WAITFORONE)
+
+	static struct mmsghdr msgs[BATCH];
+	static struct iovec iov[BATCH];
+	int i, n;
+
+	for (i = 0; i < BATCH; i++) {
+	  iov[i].iov_base = rbuf[i];
+	  iov[i].iov_len = SDR_UDP_BUF_MAXLEN;
+	  memset (&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+	  msgs[i].msg_hdr.msg_iov = &iov[i];
+	  msgs[i].msg_hdr.msg_iovlen = 1;
+	  msgs[i].msg_hdr.msg_name = &rfrom[i];
+	  msgs[i].msg_hdr.msg_namelen = sizeof(rfrom[i]);
+	}
+
+	/* Wait for the first one, then take whatever else is already there. */
+
+	n = recvmmsg (udp_sock, msgs, BATCH, MSG_WAITFORONE, NULL);
+
+	if (n < 0) {
+	  if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+	    return (0);
+	  }
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Can't read from udp socket, errno %d\n", errno);
+	  return (-1);
+	}
+
+	for (i = 0; i < n; i++) {
+	  rlen[i] = msgs[i].msg_len;
+	}
+	return (n);
+
+#else
+	int res;
+	socklen_t fromlen = sizeof(rfrom[0]);
+
+	res = recvfrom (udp_sock, (char*)(rbuf[0]), SDR_UDP_BUF_MAXLEN, 0, (struct sockaddr *)&rfrom[0], &fromlen);
+
+	if (res < 0) {
+#if __WIN32__
+	  if (WSAGetLastError() == WSAETIMEDOUT) {
+	    return (0);
+	  }
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Can't read from udp socket, errno %d\n", WSAGetLastError());
+#else
+	  if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+	    return (0);
+	  }
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Can't read from udp socket, errno %d\n", errno);
+#endif
+	  return (-1);
+	}
+
+	rlen[0] = res;
+	return (1);
+#endif
+
+} /* end receive_batch */
+
+
+/*------------------------------------------------------------------
+ *
+ * Name:        accept_packet
+ *
+ * Purpose:     Put received datagram into its place.
+ *
+ * Inputs:	p	- Datagram contents.
+ *
+ *		len	- Length.
+ *
+ *		from	- Where it came from.
+ *
+ *----------------------------------------------------------------*/
+
+static void accept_packet (unsigned char *p, int len, struct sockaddr_in *from)
+{
+	char name[40];
+	unsigned int ssrc = 0;
+	unsigned short seq = 0;
+	int hlen = 0;
+	int pad = 0;
+	int bad = 0;
+	int src;
+	short d;
+	time_t now = time(NULL);
+	struct slot_s *s;
+	int i;
+
+
+	sprintf (name, "%s:%d", inet_ntoa(from->sin_addr), ntohs(from->sin_port));
+
+/*
+ * RTP header.  Version must be 2.  Skip over any contributing
+ * source list, extension header, and padding.
+ */
+	if (use_rtp) {
+	  if (len < 12 || (p[0] >> 6) != 2) {
+	    bad = 1;
+	  }
+	  else {
+	    hlen = 12 + 4 * (p[0] & 0x0f);
+	    if ((p[0] & 0x10) && len >= hlen + 4) {
+	      hlen += 4 + 4 * ((p[hlen+2] << 8) | p[hlen+3]);
+	    }
+	    if (p[0] & 0x20) {
+	      pad = p[len-1];
+	    }
+	    if (hlen + pad > len) {
+	      bad = 1;
+	    }
+	    seq = (p[2] << 8) | p[3];
+	    ssrc = ((unsigned)p[8] << 24) | (p[9] << 16) | (p[10] << 8) | p[11];
+	  }
+	}
+
+/*
+ * Find statistics for this source.
+ */
+	for (src = 0; src < num_sources; src++) {
+	  if (strcmp(sources[src].name, name) == 0 && sources[src].ssrc == ssrc) break;
+	}
+
+	if (src == num_sources) {
+	  if (num_sources == AUDIO_UDP_MAX_SOURCES) {
+	    return;
+	  }
+	  memset (&sources[src], 0, sizeof(sources[src]));
+	  strcpy (sources[src].name, name);
+	  sources[src].ssrc = ssrc;
+	  num_sources++;
+	}
+
+	sources[src].packets++;
+
+	if (bad) {
+	  sources[src].malformed++;
+	  return;
+	}
+
+/*
+ * Stick with one source.  Switch if the current one has been quiet
+ * or, for RTP, the same sender started over with a new SSRC.
+ */
+	if (src != active) {
+	  if (active < 0 || now - active_last >= SWITCH_SEC || strcmp(sources[active].name, name) == 0) {
+	    text_color_set(DW_COLOR_INFO);
+	    if (use_rtp) {
+	      dw_printf ("Receiving audio from %s, SSRC %08x.\n", name, ssrc);
+	    }
+	    else {
+	      dw_printf ("Receiving audio from %s.\n", name);
+	    }
+	    active = src;
+	    flush_slots ();
+	  }
+	  else {
+	    sources[src].ignored++;
+	    return;
+	  }
+	}
+	active_last = now;
+
+	if ( ! use_rtp) {
+	  seq = made_up_seq++;
+	}
+
+	len -= hlen + pad;
+	p += hlen;
+	sources[src].bytes += len;
+
+	if ( ! have_next) {
+	  have_next = 1;
+	  next_seq = seq;
+	  highest_seq = seq;
+	}
+
+/*
+ * Where does it go relative to the next one we expect?
+ */
+	d = (short)(seq - next_seq);
+
+	if (d < 0 && d > -NUM_SLOTS) {
+	  sources[src].late++;
+	  return;
+	}
+
+	if (d < 0 || d >= NUM_SLOTS) {
+	  sources[src].resync++;
+	  flush_slots ();
+	  have_next = 1;
+	  next_seq = seq;
+	  highest_seq = seq;
+	}
+
+	s = &slots[seq & (NUM_SLOTS-1)];
+
+	if (s->valid) {
+	  sources[src].duplicate++;
+	  return;
+	}
+
+	if ((short)(seq - highest_seq) < 0) {
+	  sources[src].reordered++;
+	}
+	else {
+	  highest_seq = seq;
+	}
+
+	if (use_rtp && bytes_per_sample == 2) {
+	  for (i = 0; i + 1 < len; i += 2) {
+	    s->data[i] = p[i+1];
+	    s->data[i+1] = p[i];
+	  }
+	}
+	else {
+	  memcpy (s->data, p, len);
+	}
+	s->len = len;
+	s->valid = 1;
+	buffered++;
+
+} /* end accept_packet */
+
+
+/*------------------------------------------------------------------
+ *
+ * Name:        conceal
+ *
+ * Purpose:     Make up something in place of a lost packet.
+ *
+ * Outputs:	buf	- Previous packet faded out, or silence if
+ *			  the previous one was also made up.
+ *
+ * Returns:     Number of bytes, same as previous packet.
+ *
+ *----------------------------------------------------------------*/
+
+static int conceal (unsigned char *buf, int bufsize)
+{
+	int len = prev_len < bufsize ? prev_len : bufsize;
+	int nsamples, i;
+
+	if (bytes_per_sample == 2) {
+
+	  nsamples = len / 2;
+	  for (i = 0; i < nsamples; i++) {
+	    int s = (short)(prev_data[2*i] | (prev_data[2*i+1] << 8));
+
+	    s = prev_concealed ? 0 : s * (nsamples - i) / nsamples;
+	    buf[2*i] = s & 0xff;
+	    buf[2*i+1] = (s >> 8) & 0xff;
+	  }
+	}
+	else {
+
+	  /* 8 bit samples are unsigned with 128 for zero. */
+
+	  for (i = 0; i < len; i++) {
+	    int s = prev_data[i] - 128;
+
+	    s = prev_concealed ? 0 : s * (len - i) / len;
+	    buf[i] = s + 128;
+	  }
+	}
+
+	prev_concealed = 1;
+	return (len);
+
+} /* end conceal */
+
+
+/*------------------------------------------------------------------
+ *
+ * Name:        audio_udp_get_stats
+ *
+ * Purpose:     Get counters for one source.
+ *
+ * Inputs:	n	- Index starting from 0.
+ *
+ * Outputs:	result
+ *
+ * Returns:     1 for success, 0 if n is beyond the number of sources heard.
+ *
+ *----------------------------------------------------------------*/
+
+int audio_udp_get_stats (int n, struct audio_udp_stats_s *result)
+{
+	if (n < 0 || n >= num_sources) {
+	  return (0);
+	}
+	memcpy (result, &sources[n], sizeof(*result));
+	return (1);
+}
+
+
+/*------------------------------------------------------------------
+ *
+ * Name:        audio_udp_print_stats
+ *
+ * Purpose:     Print counters for all sources.
+ *
+ *----------------------------------------------------------------*/
+
+void audio_udp_print_stats (void)
+{
+	int n;
+
+	text_color_set(DW_COLOR_INFO);
+	dw_printf ("\nUDP audio     packets    lost    late     dup reorder conceal  ignore  resync     bad\n");
+
+	for (n = 0; n < num_sources; n++) {
+	  struct audio_udp_stats_s *s = &sources[n];
+
+	  dw_printf ("%s%s\n", s->name, n == active ? "  (active)" : "");
+	  dw_printf ("             %8u%8u%8u%8u%8u%8u%8u%8u%8u\n",
+		s->packets, s->lost, s->late, s->duplicate, s->reordered,
+		s->concealed, s->ignored, s->resync, s->malformed);
+	}
+	dw_printf ("\n");
+}
+
+
+/*
+ * Print statistics once a minute if anything went wrong.
+ */
+
+static void maybe_report (void)
+{
+	static time_t last_time = 0;
+	static unsigned int last_problems = 0;
+	unsigned int problems = 0;
+	time_t now = time(NULL);
+	int n;
+
+	if (last_time == 0) {
+	  last_time = now;
+	}
+
+	if (now < last_time + REPORT_SEC) {
+	  return;
+	}
+	last_time = now;
+
+	for (n = 0; n < num_sources; n++) {
+	  problems += sources[n].lost + sources[n].late + sources[n].duplicate +
+			sources[n].ignored + sources[n].resync + sources[n].malformed;
+	}
+
+	if (problems != last_problems) {
+	  last_problems = problems;
+	  audio_udp_print_stats ();
+	}
+}
+
+/* end audio_udp.c */
@@ -0,0 +1,79 @@
+
+/*------------------------------------------------------------------
+ *
+ * Module:      audio_udp.h
+ *
+ * Purpose:   	Receive audio stream over UDP, optionally with RTP header.
+ *
+ *---------------------------------------------------------------*/
+
+#ifndef AUDIO_UDP_H
+#define AUDIO_UDP_H 1
+
+#include "audio.h"		/* for struct audio_s */
+
+
+/*
+ * Wait for up to this many later packets to arrive before
+ * deciding that a missing one has been lost.
+ * Only applies to RTP because plain UDP has no sequence number.
+ */
+
+#define AUDIO_UDP_REORDER_DEPTH 4
+
+/*
+ * Give up waiting for a missing packet after this much silence.
+ */
+
+#define AUDIO_UDP_GAP_MS 100
+
+/*
+ * Statistics are kept separately for this many senders.
+ */
+
+#define AUDIO_UDP_MAX_SOURCES 8
+
+
+struct audio_udp_stats_s {
+
+	char name[40];			/* Sender address and port, e.g. "192.168.1.5:40000". */
+
+	unsigned int ssrc;		/* RTP synchronization source.  0 for plain UDP. */
+
+	unsigned int packets;		/* Received from this source. */
+
+	unsigned int bytes;		/* Audio data, not counting headers. */
+
+	unsigned int lost;		/* RTP sequence numbers never seen. */
+
+	unsigned int late;		/* Sequence number already played out, either */
+					/* given up on or a repeat of one used. */
+
+	unsigned int duplicate;		/* Repeat of a sequence number still waiting */
+					/* in the reorder buffer. */
+
+	unsigned int reordered;		/* Arrived out of order but in time to be used. */
+
+	unsigned int concealed;		/* Lost packets filled in with faded copy of previous. */
+
+	unsigned int ignored;		/* Discarded because another source was active. */
+
+	unsigned int resync;		/* Sequence number jumped too far to be reordering. */
+
+	unsigned int malformed;		/* RTP header not valid. */
+
+};
+
+
+int audio_udp_open (char *name, struct audio_s *pa);
+
+int audio_udp_read (unsigned char *buf, int bufsize);
+
+int audio_udp_get_stats (int n, struct audio_udp_stats_s *result);
+
+void audio_udp_print_stats (void);
+
+
+#endif
+
+/* end audio_udp.h */
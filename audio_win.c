@@ -63,6 +63,7 @@
 
 #include "direwolf.h"
 #include "audio.h"
+#include "audio_udp.h"
 #include "textcolor.h"
 #include "ptt.h"
 
@@ -84,11 +85,9 @@
 static enum audio_in_type_e audio_in_type;
 
 /*
- * UDP socket for receiving audio stream.
  * Buffer, length, and pointer for UDP or stdin.
  */
 
-static SOCKET udp_sock;
 static char stream_data[SDR_UDP_BUF_MAXLEN];
 static int stream_len;
 static int stream_next;
@@ -196,6 +195,9 @@ static void print_capabilities (DWORD formats)
  *		New in version 1.0, we recognize "udp:" optionally
  *		followed by a port number.
  *
+ *		"rtp:" is the same except each packet has an RTP
+ *		header.  See audio_udp.c.
+ *
  * Inputs:      pa		- Address of structure of type audio_s.
  *				
  *				Using a structure, rather than separate arguments
@@ -295,8 +297,6 @@ int audio_open (struct audio_s *pa)
 	outbuf_size = calcbufsize(wf.nSamplesPerSec,wf.nChannels,wf.wBitsPerSample);
 
 
-	udp_sock = INVALID_SOCKET;
-
 	in_dev_no = WAVE_MAPPER;	/* = -1 */
 	out_dev_no = WAVE_MAPPER;
 
@@ -309,12 +309,12 @@ int audio_open (struct audio_s *pa)
 	  /* Change - to stdin for readability. */
 	  strcpy (pa->adevice_in, "stdin");
 	}
-	else if (strncasecmp(pa->adevice_in, "udp:", 4) == 0) {
+	else if (strncasecmp(pa->adevice_in, "udp:", 4) == 0 ||
+		 strncasecmp(pa->adevice_in, "rtp:", 4) == 0) {
 	  audio_in_type = AUDIO_IN_TYPE_SDR_UDP;
 	  /* Supply default port if none specified. */
-	  if (strcasecmp(pa->adevice_in,"udp") == 0 ||
-	    strcasecmp(pa->adevice_in,"udp:") == 0) {
-	    sprintf (pa->adevice_in, "udp:%d", DEFAULT_UDP_AUDIO_PORT);
+	  if (strlen(pa->adevice_in) == 4) {
+	    sprintf (pa->adevice_in + 4, "%d", DEFAULT_UDP_AUDIO_PORT);
 	  }
 	} 
 	else {
@@ -498,51 +498,11 @@ int audio_open (struct audio_s *pa)
  */
 	  case AUDIO_IN_TYPE_SDR_UDP:
 
-	    {
-	      WSADATA wsadata;
-	      struct sockaddr_in si_me;
-	      //int slen=sizeof(si_me);
-	      //int data_size = 0;
-	      int err;
-
-	      err = WSAStartup (MAKEWORD(2,2), &wsadata);
-	      if (err != 0) {
-	          text_color_set(DW_COLOR_ERROR);
-	          dw_printf("WSAStartup failed: %d\n", err);
-	          return (-1);
-	      }
-
-	      if (LOBYTE(wsadata.wVersion) != 2 || HIBYTE(wsadata.wVersion) != 2) {
-	        text_color_set(DW_COLOR_ERROR);
-                dw_printf("Could not find a usable version of Winsock.dll\n");
-                WSACleanup();
-                return (-1);
-	      }
-
-	      // Create UDP Socket
-
-	      udp_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-	      if (udp_sock == INVALID_SOCKET) {
-	        text_color_set(DW_COLOR_ERROR);
-	        dw_printf ("Couldn't create socket, errno %d\n", WSAGetLastError());
-	        return -1;
-	      }
-
-	      memset((char *) &si_me, 0, sizeof(si_me));
-	      si_me.sin_family = AF_INET;   
-	      si_me.sin_port = htons((short)atoi(pa->adevice_in + 4));
-	      si_me.sin_addr.s_addr = htonl(INADDR_ANY);
-
-	      // Bind to the socket
-
-	      if (bind(udp_sock, (SOCKADDR *) &si_me, sizeof(si_me)) != 0) {
-	        text_color_set(DW_COLOR_ERROR);
-	        dw_printf ("Couldn't bind socket, errno %d\n", WSAGetLastError());
-	        return -1;
-	      }
-	      stream_next= 0;
-	      stream_len = 0;
+	    if (audio_udp_open (pa->adevice_in, pa) < 0) {
+	      return -1;
 	    }
+	    stream_next= 0;
+	    stream_len = 0;
 
 	    break;
 
@@ -717,12 +677,8 @@ int audio_get (void)
 	    while (stream_next >= stream_len) {
 	      int res;
 
-              assert (udp_sock > 0);
-
-	      res = recv (udp_sock, stream_data, SDR_UDP_BUF_MAXLEN, 0);
+	      res = audio_udp_read ((unsigned char *)stream_data, SDR_UDP_BUF_MAXLEN);
 	      if (res <= 0) {
-	        text_color_set(DW_COLOR_ERROR);
-	        dw_printf ("Can't read from udp socket, errno %d", WSAGetLastError());
 	        stream_len = 0;
 	        stream_next = 0;
 	        return (-1);
@@ -141,14 +141,8 @@
 #include <stdio.h>
 #include <ctype.h>
 #ifndef _POSIX_C_SOURCE
-
-#define _POSIX_C_SOURCE 1
-#endif
-
-#include "regex.h"
 
-#if __WIN32__
-char *strtok_r(char *str, const char *delim, char **saveptr);
+#define _POSIX_C_SOURCE 1
 #endif
 
 #include "ax25_pad.h"
@@ -164,6 +158,25 @@ char *strtok_r(char *str, const char *delim, char **saveptr);
 static int new_count = 0;
 static int delete_count = 0;
 
+static int parse_addr_n (char *in_addr, int len, int strict, char *out_addr, int *out_ssid, int *out_heard);
+static void put_addr (packet_t this_p, int n, char *call, int ssid_etc);
+static void fix_last (packet_t this_p);
+static void update_view (packet_t this_p, int n);
+static const struct ax25_addr_s * get_view (packet_t this_p, int n);
+static void set_fingerprint (packet_t this_p);
+
+
+/*
+ * Value of a hexadecimal digit.  Caller has already checked with isxdigit.
+ */
+
+static int hex_value (int ch)
+{
+	if (ch >= '0' && ch <= '9') return (ch - '0');
+	if (ch >= 'a' && ch <= 'f') return (ch - 'a' + 10);
+	return (ch - 'A' + 10);
+}
+
 
 /*------------------------------------------------------------------------------
  *
@@ -197,8 +210,18 @@ static packet_t ax25_new (void)
 	  dw_printf ("Memory leak for packet objects.  new=%d, delete=%d\n", new_count, delete_count);
 	}
 
-	this_p = calloc(sizeof (struct packet_s), (size_t)1);
+/*
+ * Only the header needs to be cleared.
+ * Nothing beyond frame_len, or an address view that is not valid, is ever looked at.
+ */
+	this_p = malloc(sizeof (struct packet_s));
 	this_p->magic1 = MAGIC;
+	this_p->nextp = NULL;
+	this_p->num_addr = 0;
+	this_p->frame_len = 0;
+	this_p->view_valid = 0;
+	this_p->fingerprint_valid = 0;
+	this_p->frame_data[0] = '\0';
 	this_p->magic2 = MAGIC;
 	return (this_p);
 }
@@ -219,12 +242,31 @@ void ax25_delete (packet_t this_p)
 #endif
 	assert (this_p->magic1 == MAGIC);
 	assert (this_p->magic2 == MAGIC);
-	memset (this_p, 0, sizeof (struct packet_s));
+	this_p->magic1 = 0;
+	this_p->magic2 = 0;
 	delete_count++;
 	free (this_p);
 }
 
 
+/*------------------------------------------------------------------------------
+ *
+ * Name:	ax25_get_alloc_counts
+ * 
+ * Purpose:	Find out how many packet objects have been created and destroyed.
+ *
+ * Outputs:	pnew	- Number created by ax25_new.
+ *		pdelete	- Number destroyed by ax25_delete.
+ *
+ *------------------------------------------------------------------------------*/
+
+void ax25_get_alloc_counts (int *pnew, int *pdelete)
+{
+	*pnew = new_count;
+	*pdelete = delete_count;
+}
+
+
 		
 /*------------------------------------------------------------------------------
  *
@@ -247,175 +289,110 @@ void ax25_delete (packet_t this_p)
 
 packet_t ax25_from_text (char *monitor, int strict)
 {
-
-/*
- * Tearing it apart is destructive so make our own copy first.
- */
-	char stuff[512];
-
-	char *pinfo;
-	char *pa;
-	char *saveptr;		/* Used with strtok_r because strtok is not thread safe. */
-
-	static int first_time = 1;
-	static regex_t unhex_re;
-	int e;
-	char emsg[100];
-#define MAXMATCH 1
-	regmatch_t match[MAXMATCH];
-	int keep_going;
-	char temp[512];
+	char *pcolon;		/* End of the addresses. */
+	char *p;
+	int len;
+	unsigned char *pinfo;
+	int n;
+	char call[AX25_MAX_ADDR_LEN];
 	int ssid_temp, heard_temp;
 
-
 	
 	packet_t this_p = ax25_new ();
 
-	/* Is it possible to have a nul character (zero byte) in the */
-	/* information field of an AX.25 frame? */
-
-	strcpy (stuff, monitor);
-
-/* 
- * Translate hexadecimal values like <0xff> to non-printing characters.
- * MIC-E message type uses 5 different non-printing characters.
- */
-
-	if (first_time) 
-	{
-	  e = regcomp (&unhex_re, "<0x[0-9a-fA-F][0-9a-fA-F]>", 0);
-	  if (e) {
-	    regerror (e, &unhex_re, emsg, sizeof(emsg));
-	    text_color_set(DW_COLOR_ERROR);
-	    dw_printf ("%s:%d: %s\n", __FILE__, __LINE__, emsg);
-	  }
-
-	  first_time = 0;
-	}
-
-#if 0
-	text_color_set(DW_COLOR_DEBUG);
-	dw_printf ("BEFORE: %s\n", stuff);
-	ax25_safe_print (stuff, -1, 0);
-	dw_printf ("\n");
-#endif
-	keep_going = 1;
-	while (keep_going) {
-	  if (regexec (&unhex_re, stuff, MAXMATCH, match, 0) == 0) {
-	    int n;
-	    char *p;
-  
-	    stuff[match[0].rm_so + 5] = '\0';
-	    n = strtol (stuff + match[0].rm_so + 3, &p, 16);
-	    stuff[match[0].rm_so] = n;
-	    strcpy (temp, stuff + match[0].rm_eo);
-	    strcpy (stuff + match[0].rm_so + 1, temp);
-	  }
-	  else {
-	    keep_going = 0;
-	  }
-	}
-#if 0
-	text_color_set(DW_COLOR_DEBUG);
-	dw_printf ("AFTER:  %s\n", stuff);
-	ax25_safe_print (stuff, -1, 0);
-	dw_printf ("\n");
-#endif
-
 /*
+ * This is done in a single pass over the original string, 
+ * without making a copy, because every line from a full
+ * feed APRS-IS server comes through here.
+ * The addresses and information go directly into the frame.
+ *
  * Separate the addresses from the rest.
  */
-	pinfo = strchr (stuff, ':');
+	pcolon = strchr (monitor, ':');
 
-	if (pinfo == NULL) {
+	if (pcolon == NULL) {
 	  ax25_delete (this_p);
 	  return (NULL);
 	}
 
-	*pinfo = '\0';
-	pinfo++;
-
-	if (strlen(pinfo) > AX25_MAX_INFO_LEN) {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf ("Warning: Information part truncated to %d characters.\n", AX25_MAX_INFO_LEN);
-	  pinfo[AX25_MAX_INFO_LEN] = '\0';
-	}
-	
-	strcpy ((char*)(this_p->the_rest + 2), pinfo);
-	this_p->the_rest_len = strlen(pinfo) + 2;
-
 /*
- * Now separate the addresses.
+ * Source address, before the ">".
  * Note that source and destination order is swappped.
  */
-
 	this_p->num_addr = 2;
 
-/*
- * Source address.
- * Don't use traditional strtok because it is not thread safe.
- */
-	pa = strtok_r (stuff, ">", &saveptr);
-	if (pa == NULL) {
+	p = monitor;
+	len = strcspn (p, ">:");
+
+	if (len == 0) {
 	  text_color_set(DW_COLOR_ERROR);
 	  dw_printf ("Failed to create packet from text.  No source address\n");
 	  ax25_delete (this_p);
 	  return (NULL);
 	}
 
-	if ( ! ax25_parse_addr (pa, strict, this_p->addrs[AX25_SOURCE], &ssid_temp, &heard_temp)) {
+	if ( ! parse_addr_n (p, len, strict, call, &ssid_temp, &heard_temp)) {
 	  text_color_set(DW_COLOR_ERROR);
 	  dw_printf ("Failed to create packet from text.  Bad source address\n");
 	  ax25_delete (this_p);
 	  return (NULL);
 	}
 
-	this_p->ssid_etc[AX25_SOURCE] = SSID_H_MASK | SSID_RR_MASK;
-	ax25_set_ssid (this_p, AX25_SOURCE, ssid_temp);
+	put_addr (this_p, AX25_SOURCE, call, SSID_H_MASK | SSID_RR_MASK | (ssid_temp << SSID_SSID_SHIFT));
 
 /*
  * Destination address.
  */
- 
-	pa = strtok_r (NULL, ",", &saveptr);
-	if (pa == NULL) {
+	p += len;
+	if (*p == '>') {
+	  p++;
+	}
+	len = (p < pcolon) ? strcspn (p, ",:") : 0;
+
+	if (len == 0) {
 	  text_color_set(DW_COLOR_ERROR);
 	  dw_printf ("Failed to create packet from text.  No destination address\n");
 	  ax25_delete (this_p);
 	  return (NULL);
 	}
 
-	if ( ! ax25_parse_addr (pa, strict, this_p->addrs[AX25_DESTINATION], &ssid_temp, &heard_temp)) {
+	if ( ! parse_addr_n (p, len, strict, call, &ssid_temp, &heard_temp)) {
 	  text_color_set(DW_COLOR_ERROR);
 	  dw_printf ("Failed to create packet from text.  Bad destination address\n");
 	  ax25_delete (this_p);
 	  return (NULL);
 	}
 
-	this_p->ssid_etc[AX25_DESTINATION] = SSID_H_MASK | SSID_RR_MASK;
-	ax25_set_ssid (this_p, AX25_DESTINATION, ssid_temp);
+	put_addr (this_p, AX25_DESTINATION, call, SSID_H_MASK | SSID_RR_MASK | (ssid_temp << SSID_SSID_SHIFT));
 
 /*
- * VIA path.
+ * VIA path.  
+ * Empty ones are skipped and any more than the maximum are ignored.
  */
-	while (( pa = strtok_r (NULL, ",", &saveptr)) != NULL && this_p->num_addr < AX25_MAX_ADDRS ) {
+	p += len;
+
+	while (p < pcolon && this_p->num_addr < AX25_MAX_ADDRS) {
 
-	  //char *last;
 	  int k;
 
+	  p++;			/* Skip over the ",". */
+	  len = strcspn (p, ",:");
+	  if (len == 0) {
+	    continue;
+	  }
+
 	  k = this_p->num_addr;
 
 	  this_p->num_addr++;
 
-	  if ( ! ax25_parse_addr (pa, strict, this_p->addrs[k], &ssid_temp, &heard_temp)) {
+	  if ( ! parse_addr_n (p, len, strict, call, &ssid_temp, &heard_temp)) {
 	    text_color_set(DW_COLOR_ERROR);
 	    dw_printf ("Failed to create packet from text.  Bad digipeater address\n");
 	    ax25_delete (this_p);
 	    return (NULL);
 	  }
 
-	  this_p->ssid_etc[k] = SSID_RR_MASK;
-	  ax25_set_ssid (this_p, k, ssid_temp);
+	  put_addr (this_p, k, call, SSID_RR_MASK | (ssid_temp << SSID_SSID_SHIFT));
 
 	  // Does it have an "*" at the end? 
 	  // TODO: Complain if more than one "*".
@@ -426,10 +403,47 @@ packet_t ax25_from_text (char *monitor, int strict)
 	      ax25_set_h (this_p, k);
 	    }
 	  }
+
+	  p += len;
         }
-	
-	this_p->the_rest[0] = AX25_UI_FRAME;
-	this_p->the_rest[1] = AX25_NO_LAYER_3;
+
+	fix_last (this_p);
+
+/*
+ * Information part goes directly into the packet.
+ *
+ * Translate hexadecimal values like <0xff> to non-printing characters
+ * along the way.  MIC-E message type uses 5 different non-printing characters.
+ */
+	pinfo = ax25_get_rest (this_p);
+	pinfo[0] = AX25_UI_FRAME;
+	pinfo[1] = AX25_NO_LAYER_3;
+	pinfo += 2;
+
+	n = 0;
+
+	for (p = pcolon + 1; *p != '\0'; ) {
+
+	  if (n >= AX25_MAX_INFO_LEN) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf ("Warning: Information part truncated to %d characters.\n", AX25_MAX_INFO_LEN);
+	    break;
+	  }
+
+	  if (p[0] == '<' && p[1] == '0' && p[2] == 'x' && 
+			isxdigit((unsigned char)(p[3])) && isxdigit((unsigned char)(p[4])) && p[5] == '>') {
+	    pinfo[n++] = (hex_value(p[3]) << 4) | hex_value(p[4]);
+	    p += 6;
+	  }
+	  else {
+	    pinfo[n++] = *p++;
+	  }
+	}
+	pinfo[n] = '\0';
+
+	this_p->frame_len = this_p->num_addr * 7 + 2 + n;
+
+	set_fingerprint (this_p);
 
 	return (this_p);
 }
@@ -458,8 +472,6 @@ packet_t ax25_from_text (char *monitor, int strict)
 
 packet_t ax25_from_frame (unsigned char *fbuf, int flen, int alevel)
 {
-	unsigned char *pf;
-	//int found_last;
 	packet_t this_p;
 
 	int a;
@@ -483,18 +495,21 @@ packet_t ax25_from_frame (unsigned char *fbuf, int flen, int alevel)
 	this_p = ax25_new ();
 
 /*
- * Extract the addresses.
- * The last one has '1' in the LSB of the last byte.
+ * The frame is kept just as it was received.
+ * Addresses are decoded later, only if someone asks for them.
  */
+	memcpy (this_p->frame_data, fbuf, (size_t)flen);
+	this_p->frame_data[flen] = '\0';
+	this_p->frame_len = flen;
 
-#if 1
-
-/* 
- * 0.9 - Try new strategy that will allow KISS mode 
- * to handle non AX.25 frame. 
+/*
+ * Find the number of addresses.
+ * The last one has '1' in the LSB of the last byte.
+ *
+ * 0.9 - Allow KISS mode to handle non AX.25 frame. 
  */
 
-	this_p->num_addr = 0;		/* Number of addresses extracted. */
+	this_p->num_addr = 0;
 	
 	addr_bytes = 0;
 	for (a = 0; a < flen && addr_bytes == 0; a++) {
@@ -507,100 +522,9 @@ packet_t ax25_from_frame (unsigned char *fbuf, int flen, int alevel)
 	  int addrs = addr_bytes / 7;
 	  if (addrs >= AX25_MIN_ADDRS && addrs <= AX25_MAX_ADDRS) {
 	    this_p->num_addr = addrs;
-	    
-	    for (a = 0; a < addrs; a++){ 
-	      unsigned char *pin;
-	      char *pout;
-	      int j;
-	      char ch;
-	
-	      pin = fbuf + a * 7;
-              pout = & this_p->addrs[a][0];
-
-	      for (j=0; j<6; j++) 
-	      {
-	        ch = *pin++ >> 1;
-	        if (ch != ' ')
-	        {
-	          *pout++ = ch;
-	        }
-	      }
-	      *pout = '\0';
-
-	      this_p->ssid_etc[a] = *pin & ~ SSID_LAST_MASK;
-	    }
-	  }
-	}
-	
-	pf = fbuf + this_p->num_addr * 7;
-
-#else 
-
-	pf = fbuf;		/* Transmitted form from here. */
-
-	this_p->num_addr = 0;		/* Number of addresses extracted. */
-	found_last = 0;
-
-	while (this_p->num_addr < AX25_MAX_ADDRS && ! found_last) {
-
-	  unsigned char *pin;
-	  char *pout;
-	  int j;
-	  char ch;
-	
-	  pin = pf;
-          pout = & this_p->addrs[this_p->num_addr][0];
-
-	  for (j=0; j<6; j++) 
-	  {
-	    ch = *pin++ >> 1;
-	    if (ch != ' ')
-	    {
-	      *pout++ = ch;
-	    }
-	  }
-	  *pout = '\0';
-
-	  this_p->ssid_etc[this_p->num_addr] = pf[6] & ~ SSID_LAST_MASK;
-	
-  	  this_p->num_addr++;
-
-	  if (pf[6] & SSID_LAST_MASK) {	/* Is this the last one? */
-	    found_last = 1;
-          }
-	  else {
-	    pf += 7;			/* Get ready for next one. */
 	  }
 	}
 
-	if (this_p->num_addr < 2) {
-	  int k;
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf ("Frame format error detected in ax25_from_frame, %s, line %d.\n", __FILE__, __LINE__);
-	  dw_printf ("Did not find a minimum of two addresses at beginning of AX.25 frame.\n");
-	  for (k=0; k<14; k++) {
-	    dw_printf (" %02x", fbuf[k]);
-	  }
-	  dw_printf ("\n");
-	  /* Should we keep going or delete the packet? */
-	}
-
-/*
- * pf still points to the last address (repeater or source).
- *
- * Verify that it has the last address bit set.
- */
-	if ((pf[6] & SSID_LAST_MASK) == 0) {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf ("Last address in header does not have LSB set.\n");
-	  ax25_delete (this_p);
-	  return (NULL);
-	}
-
-	pf += 7;
-
-#endif
-
 	if (this_p->num_addr * 7 > flen - 1) {
 	  text_color_set(DW_COLOR_ERROR);
 	  dw_printf ("Frame too short to include control field.\n");
@@ -608,23 +532,7 @@ packet_t ax25_from_frame (unsigned char *fbuf, int flen, int alevel)
 	  return (NULL);
 	}
 
-
-
-
-/*
- * pf should now point to control field.
- * Previously we separated out control, PID, and Info here.
- *
- * Now (version 0.8) we save control, PID, and info together.
- * This makes it easier to act as a dumb KISS TNC
- * for AX.25-based protocols other than APRS.
- */
-	this_p->the_rest_len = flen - (pf - fbuf);
-
-	assert (this_p->the_rest_len >= 1);
-
-	memcpy (this_p->the_rest, pf, (size_t)this_p->the_rest_len);
-	this_p->the_rest[this_p->the_rest_len] = '\0';
+	set_fingerprint (this_p);
 
 	return (this_p);
 }
@@ -649,10 +557,21 @@ packet_t ax25_dup (packet_t copy_from)
 
 	packet_t this_p;
 
+	assert (copy_from->magic1 == MAGIC);
+	assert (copy_from->magic2 == MAGIC);
 	
 	this_p = ax25_new ();
 
-	memcpy (this_p, copy_from, sizeof (struct packet_s));
+/*
+ * Copy only the part of the frame that is used.
+ */
+	this_p->num_addr = copy_from->num_addr;
+	this_p->frame_len = copy_from->frame_len;
+	this_p->view_valid = copy_from->view_valid;
+	this_p->fingerprint_valid = copy_from->fingerprint_valid;
+	this_p->fingerprint = copy_from->fingerprint;
+	memcpy (this_p->addr_view, copy_from->addr_view, sizeof (this_p->addr_view));
+	memcpy (this_p->frame_data, copy_from->frame_data, (size_t)(copy_from->frame_len + 1));
 
 	return (this_p);
 
@@ -691,7 +610,18 @@ packet_t ax25_dup (packet_t copy_from)
 
 int ax25_parse_addr (char *in_addr, int strict, char *out_addr, int *out_ssid, int *out_heard)
 {
-	char *p;
+	return (parse_addr_n (in_addr, strlen(in_addr), strict, out_addr, out_ssid, out_heard));
+}
+
+
+/*
+ * Same thing for the first len characters of in_addr, so
+ * ax25_from_text can take addresses directly from its input.
+ */
+
+static int parse_addr_n (char *in_addr, int len, int strict, char *out_addr, int *out_ssid, int *out_heard)
+{
+	char *p, *end;
 	char sstr[4];
 	int i, j, k;
 	int maxlen;
@@ -700,58 +630,58 @@ int ax25_parse_addr (char *in_addr, int strict, char *out_addr, int *out_ssid, i
 	*out_ssid = 0;
 	*out_heard = 0;
 
+	end = in_addr + len;
 	maxlen = strict ? 6 : (AX25_MAX_ADDR_LEN-1);
-	p = in_addr;
 	i = 0;
-	for (p = in_addr; isalnum(*p); p++) {
+	for (p = in_addr; p < end && isalnum((unsigned char)(*p)); p++) {
 	  if (i >= maxlen) {
 	    text_color_set(DW_COLOR_ERROR);
-	    dw_printf ("Address is too long. \"%s\" has more than %d characters.\n", in_addr, maxlen);
+	    dw_printf ("Address is too long. \"%.*s\" has more than %d characters.\n", len, in_addr, maxlen);
 	    return 0;
 	  }
 	  out_addr[i++] = *p;
 	  out_addr[i] = '\0';
-	  if (strict && islower(*p)) {
+	  if (strict && islower((unsigned char)(*p))) {
 	    text_color_set(DW_COLOR_ERROR);
-	    dw_printf ("Address has lower case letters. \"%s\" must be all upper case.\n", in_addr);
+	    dw_printf ("Address has lower case letters. \"%.*s\" must be all upper case.\n", len, in_addr);
 	    return 0;
 	  }
 	}
 	
 	strcpy (sstr, "");
 	j = 0;
-	if (*p == '-') {
-	  for (p++; isalnum(*p); p++) {
+	if (p < end && *p == '-') {
+	  for (p++; p < end && isalnum((unsigned char)(*p)); p++) {
 	    if (j >= 2) {
 	      text_color_set(DW_COLOR_ERROR);
-	      dw_printf ("SSID is too long. SSID part of \"%s\" has more than 2 characters.\n", in_addr);
+	      dw_printf ("SSID is too long. SSID part of \"%.*s\" has more than 2 characters.\n", len, in_addr);
 	      return 0;
 	    }
 	    sstr[j++] = *p;
 	    sstr[j] = '\0';
-	    if (strict && ! isdigit(*p)) {
+	    if (strict && ! isdigit((unsigned char)(*p))) {
 	      text_color_set(DW_COLOR_ERROR);
-	      dw_printf ("SSID must be digits. \"%s\" has letters in SSID.\n", in_addr);
+	      dw_printf ("SSID must be digits. \"%.*s\" has letters in SSID.\n", len, in_addr);
 	      return 0;
 	    }
 	  }
 	  k = atoi(sstr);
 	  if (k < 0 || k > 15) {
 	    text_color_set(DW_COLOR_ERROR);
-	    dw_printf ("SSID out of range. SSID of \"%s\" not in range of 0 to 15.\n", in_addr);
+	    dw_printf ("SSID out of range. SSID of \"%.*s\" not in range of 0 to 15.\n", len, in_addr);
 	    return 0;
 	  }
 	  *out_ssid = k;
 	}
 
-	if (*p == '*') {
+	if (p < end && *p == '*') {
 	  *out_heard = 1;
 	  p++;
 	}
 
-	if (*p != '\0') {
+	if (p < end) {
 	    text_color_set(DW_COLOR_ERROR);
-	    dw_printf ("Invalid character \"%c\" found in address \"%s\".\n", *p, in_addr);
+	    dw_printf ("Invalid character \"%c\" found in address \"%.*s\".\n", *p, len, in_addr);
 	  return 0;
 	}
 
@@ -816,6 +746,7 @@ packet_t ax25_unwrap_third_party (packet_t from_pp)
 
 void ax25_set_addr (packet_t this_p, int n, char *ad)
 {
+	char call[AX25_MAX_ADDR_LEN];
 	int ssid_temp, heard_temp;
 
 	assert (this_p->magic1 == MAGIC);
@@ -823,12 +754,28 @@ void ax25_set_addr (packet_t this_p, int n, char *ad)
 	assert (n >= 0 && n < AX25_MAX_ADDRS);
 	assert (strlen(ad) < AX25_MAX_ADDR_LEN);
 
+/*
+ * Make room if it goes beyond the current addresses.
+ */
 	if (n+1 > this_p->num_addr) {
+	  int k;
+	  int more = (n + 1 - this_p->num_addr) * 7;
+
+	  if (this_p->frame_len + more > AX25_MAX_PACKET_LEN) {
+	    return;
+	  }
+	  memmove (ax25_get_rest(this_p) + more, ax25_get_rest(this_p), (size_t)(ax25_get_rest_len(this_p) + 1));
+	  this_p->frame_len += more;
+
+	  for (k = this_p->num_addr; k <= n; k++) {
+	    put_addr (this_p, k, "", SSID_RR_MASK);
+	  }
 	  this_p->num_addr = n+1;
-	  this_p->ssid_etc[n] = SSID_RR_MASK;
+	  fix_last (this_p);
 	}
 
-	ax25_parse_addr (ad, 0, this_p->addrs[n], &ssid_temp, &heard_temp);
+	ax25_parse_addr (ad, 0, call, &ssid_temp, &heard_temp);
+	put_addr (this_p, n, call, this_p->frame_data[n*7+6]);
 	ax25_set_ssid (this_p, n, ssid_temp);
 }
 
@@ -862,8 +809,9 @@ void ax25_set_addr (packet_t this_p, int n, char *ad)
 
 void ax25_insert_addr (packet_t this_p, int n, char *ad)
 {
-	int k;
+	char call[AX25_MAX_ADDR_LEN];
 	int ssid_temp, heard_temp;
+	unsigned short below;
 
 	assert (this_p->magic1 == MAGIC);
 	assert (this_p->magic2 == MAGIC);
@@ -873,22 +821,24 @@ void ax25_insert_addr (packet_t this_p, int n, char *ad)
 	/* Don't do it if we already have the maximum number. */
 	/* Should probably return success/fail code but currently the caller doesn't care. */
 
-	if ( this_p->num_addr >= AX25_MAX_ADDRS) {
+	if ( this_p->num_addr >= AX25_MAX_ADDRS || this_p->frame_len + 7 > AX25_MAX_PACKET_LEN) {
 	  return;
 	}
 
 	/* Shift the current occupant and others up. */
 
-	for (k=this_p->num_addr; k>n; k--) {
-	  strcpy (this_p->addrs[k], this_p->addrs[k-1]);
-	  this_p->ssid_etc[k] = this_p->ssid_etc[k-1];
-	}
+	memmove (this_p->frame_data + (n+1) * 7, this_p->frame_data + n * 7, (size_t)(this_p->frame_len - n * 7 + 1));
+	this_p->frame_len += 7;
+
+	memmove (&(this_p->addr_view[n+1]), &(this_p->addr_view[n]), (this_p->num_addr - n) * sizeof(struct ax25_addr_s));
+	below = this_p->view_valid & ((1 << n) - 1);
+	this_p->view_valid = below | ((this_p->view_valid & ~ below) << 1);
 
 	this_p->num_addr++;
 
-	ax25_parse_addr (ad, 0, this_p->addrs[n], &ssid_temp, &heard_temp);
-	this_p->ssid_etc[n] = SSID_RR_MASK;
-	ax25_set_ssid (this_p, n, ssid_temp);
+	ax25_parse_addr (ad, 0, call, &ssid_temp, &heard_temp);
+	put_addr (this_p, n, call, SSID_RR_MASK | (ssid_temp << SSID_SSID_SHIFT));
+	fix_last (this_p);
 }
 
 
@@ -913,7 +863,7 @@ void ax25_insert_addr (packet_t this_p, int n, char *ad)
 
 void ax25_remove_addr (packet_t this_p, int n)
 {
-	int k;
+	unsigned short below;
 
 	assert (this_p->magic1 == MAGIC);
 	assert (this_p->magic2 == MAGIC);
@@ -921,12 +871,16 @@ void ax25_remove_addr (packet_t this_p, int n)
 
 	/* Shift those beyond to fill this position. */
 
+	memmove (this_p->frame_data + n * 7, this_p->frame_data + (n+1) * 7, (size_t)(this_p->frame_len - (n+1) * 7 + 1));
+	this_p->frame_len -= 7;
+
 	this_p->num_addr--;
 
-	for (k = n; k < this_p->num_addr; k++) {
-	  strcpy (this_p->addrs[k], this_p->addrs[k+1]);
-	  this_p->ssid_etc[k] = this_p->ssid_etc[k+1];
-	}
+	memmove (&(this_p->addr_view[n]), &(this_p->addr_view[n+1]), (this_p->num_addr - n) * sizeof(struct ax25_addr_s));
+	below = this_p->view_valid & ((1 << n) - 1);
+	this_p->view_valid = below | ((this_p->view_valid >> 1) & ~ ((1 << n) - 1));
+
+	fix_last (this_p);
 }
 
 
@@ -1002,8 +956,6 @@ int ax25_get_num_repeaters (packet_t this_p)
 
 void ax25_get_addr_with_ssid (packet_t this_p, int n, char *station)
 {	
-	int ssid;
-	char sstr[4];
 
 	assert (this_p->magic1 == MAGIC);
 	assert (this_p->magic2 == MAGIC);
@@ -1032,13 +984,146 @@ void ax25_get_addr_with_ssid (packet_t this_p, int n, char *station)
 	  return;
 	}
 
-	strcpy (station, this_p->addrs[n]);
+	strcpy (station, get_view(this_p, n)->with_ssid);
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Name:	ax25_get_addr_view
+ * 
+ * Purpose:	Return specified address, decoded into the parts that 
+ *		callers usually want.
+ *
+ * Inputs:	n	- Index of address.   Use the symbols 
+ *			  AX25_DESTINATION, AX25_SOURCE, AX25_REPEATER1, etc.
+ *
+ * Returns:	Pointer to callsign, SSID, "H" bit, and the usual
+ *		human readable form.
+ *
+ *		This belongs to the packet object.  It stays the same 
+ *		until the address is changed or the packet is deleted.
+ *
+ * Description:	The frame is kept in the form sent over the radio.
+ *		Each address is decoded the first time it is needed
+ *		and kept so asking again costs almost nothing.
+ *		  
+ * Assumption:	ax25_from_text or ax25_from_frame was called first.
+ *
+ *------------------------------------------------------------------------------*/
+
+const struct ax25_addr_s * ax25_get_addr_view (packet_t this_p, int n)
+{
+	assert (this_p->magic1 == MAGIC);
+	assert (this_p->magic2 == MAGIC);
+	assert (n >= 0 && n < this_p->num_addr);
+
+	return (get_view (this_p, n));
+}
+
+
+static const struct ax25_addr_s * get_view (packet_t this_p, int n)
+{
+	struct ax25_addr_s *v = &(this_p->addr_view[n]);
+
+	if ( ! (this_p->view_valid & (1 << n))) {
+	  unsigned char *pin = this_p->frame_data + n * 7;
+	  char *pout = v->call;
+	  int j;
+
+	  for (j=0; j<6; j++) {
+	    char ch = pin[j] >> 1;
+	    if (ch != ' ') {
+	      *pout++ = ch;
+	    }
+	  }
+	  *pout = '\0';
+
+	  this_p->view_valid |= 1 << n;
+	  update_view (this_p, n);
+	}
+
+	return (v);
+}
+
+
+/*
+ * After SSID or "H" bit changed.  Nothing to do if not decoded yet.
+ */
+
+static void update_view (packet_t this_p, int n)
+{
+	struct ax25_addr_s *v = &(this_p->addr_view[n]);
+	int len;
+
+	if ( ! (this_p->view_valid & (1 << n))) {
+	  return;
+	}
+
+	v->ssid = (this_p->frame_data[n*7+6] & SSID_SSID_MASK) >> SSID_SSID_SHIFT;
+	v->h = (this_p->frame_data[n*7+6] & SSID_H_MASK) >> SSID_H_SHIFT;
+
+	strcpy (v->with_ssid, v->call);
+	if (v->ssid != 0) {
+	  len = strlen(v->with_ssid);
+	  v->with_ssid[len++] = '-';
+	  if (v->ssid >= 10) {
+	    v->with_ssid[len++] = '1';
+	  }
+	  v->with_ssid[len++] = '0' + v->ssid % 10;
+	  v->with_ssid[len] = '\0';
+	}
+}
+
+
+/*
+ * Put address into frame in the transmitted form.
+ * fix_last must be called if it is now a different one that is last.
+ */
+
+static void put_addr (packet_t this_p, int n, char *call, int ssid_etc)
+{
+	unsigned char *pout = this_p->frame_data + n * 7;
+	int k;
+
+	memset (pout, ' ' << 1, (size_t)6);
+	for (k = 0; k < 6 && call[k] != '\0'; k++) {
+	  pout[k] = call[k] << 1;
+	}
+	pout[6] = ssid_etc;
+
+	if (n <= AX25_SOURCE) {
+	  this_p->fingerprint_valid = 0;
+	}
+
+	if (strlen(call) > 6) {
+	  /* Doesn't fit.  Keep the whole thing where it will be found. */
+	  strcpy (this_p->addr_view[n].call, call);
+	  this_p->view_valid |= 1 << n;
+	  update_view (this_p, n);
+	}
+	else {
+	  this_p->view_valid &= ~ (1 << n);
+	}
+}
+
+
+/*
+ * Only the last address has the LSB set.
+ */
+
+static void fix_last (packet_t this_p)
+{
+	int n;
 
-	ssid = ax25_get_ssid (this_p, n);
-	if (ssid != 0) {
-	  sprintf (sstr, "-%d", ssid);
-	  strcat (station, sstr);
-	}    
+	for (n = 0; n < this_p->num_addr; n++) {
+	  if (n == this_p->num_addr - 1) {
+	    this_p->frame_data[n*7+6] |= SSID_LAST_MASK;
+	  }
+	  else {
+	    this_p->frame_data[n*7+6] &= ~ SSID_LAST_MASK;
+	  }
+	}
 }
 
 
@@ -1068,7 +1153,7 @@ int ax25_get_ssid (packet_t this_p, int n)
 	assert (this_p->magic2 == MAGIC);
 	assert (n >= 0 && n < this_p->num_addr);
 
-	return ((this_p->ssid_etc[n] & SSID_SSID_MASK) >> SSID_SSID_SHIFT);
+	return ((this_p->frame_data[n*7+6] & SSID_SSID_MASK) >> SSID_SSID_SHIFT);
 }
 
 
@@ -1098,8 +1183,14 @@ void ax25_set_ssid (packet_t this_p, int n, int ssid)
 	assert (this_p->magic2 == MAGIC);
 	assert (n >= 0 && n < this_p->num_addr);
 
-	this_p->ssid_etc[n] =   (this_p->ssid_etc[n] & ~ SSID_SSID_MASK) |
+	this_p->frame_data[n*7+6] =   (this_p->frame_data[n*7+6] & ~ SSID_SSID_MASK) |
 		((ssid << SSID_SSID_SHIFT) & SSID_SSID_MASK) ;
+
+	if (n <= AX25_SOURCE) {
+	  this_p->fingerprint_valid = 0;
+	}
+
+	update_view (this_p, n);
 }
 
 
@@ -1127,7 +1218,7 @@ int ax25_get_h (packet_t this_p, int n)
 	assert (this_p->magic2 == MAGIC);
 	assert (n >= 0 && n < this_p->num_addr);
 
-	return ((this_p->ssid_etc[n] & SSID_H_MASK) >> SSID_H_SHIFT);
+	return ((this_p->frame_data[n*7+6] & SSID_H_MASK) >> SSID_H_SHIFT);
 }
 
 
@@ -1155,7 +1246,9 @@ void ax25_set_h (packet_t this_p, int n)
 	assert (this_p->magic2 == MAGIC);
 	assert (n >= 0 && n < this_p->num_addr);
 
-	this_p->ssid_etc[n] |= SSID_H_MASK;
+	this_p->frame_data[n*7+6] |= SSID_H_MASK;
+
+	update_view (this_p, n);
 }
 
 
@@ -1250,14 +1343,14 @@ int ax25_get_info (packet_t this_p, unsigned char **paddr)
 	assert (this_p->magic2 == MAGIC);
 
 	if (this_p->num_addr >= 2) {
-	  *paddr = this_p->the_rest + ax25_get_info_offset(this_p);
+	  *paddr = ax25_get_rest(this_p) + ax25_get_info_offset(this_p);
 	  return (ax25_get_num_info(this_p));
 	}
 
 	/* Not AX.25.  Whole packet is info. */
 
-	*paddr = this_p->the_rest;
-	return (this_p->the_rest_len);
+	*paddr = this_p->frame_data;
+	return (this_p->frame_len);
 }
 
 
@@ -1281,7 +1374,7 @@ int ax25_get_dti (packet_t this_p)
 	assert (this_p->magic2 == MAGIC);
 
 	if (this_p->num_addr >= 2) {
-	  return (this_p->the_rest[ax25_get_info_offset(this_p)]);
+	  return (ax25_get_rest(this_p)[ax25_get_info_offset(this_p)]);
 	}
 	return (' ');
 }
@@ -1364,7 +1457,7 @@ void ax25_format_addrs (packet_t this_p, char *result)
 {
 	int i;
 	int heard;
-	char stemp[AX25_MAX_ADDR_LEN];
+	char *p;
 
 	assert (this_p->magic1 == MAGIC);
 	assert (this_p->magic2 == MAGIC);
@@ -1378,25 +1471,28 @@ void ax25_format_addrs (packet_t this_p, char *result)
 	  return;
 	}
 
-	ax25_get_addr_with_ssid (this_p, AX25_SOURCE, stemp);
-	strcat (result, stemp);
-	strcat (result, ">");
+	p = result;
 
-	ax25_get_addr_with_ssid (this_p, AX25_DESTINATION, stemp);
-	strcat (result, stemp);
+	strcpy (p, get_view(this_p, AX25_SOURCE)->with_ssid);
+	p += strlen(p);
+	*p++ = '>';
+
+	strcpy (p, get_view(this_p, AX25_DESTINATION)->with_ssid);
+	p += strlen(p);
 
 	heard = ax25_get_heard(this_p);
 
 	for (i=(int)AX25_REPEATER_1; i<this_p->num_addr; i++) {
-	  ax25_get_addr_with_ssid (this_p, i, stemp);
-	  strcat (result, ",");
-	  strcat (result, stemp);
+	  *p++ = ',';
+	  strcpy (p, get_view(this_p, i)->with_ssid);
+	  p += strlen(p);
 	  if (i == heard) {
-	    strcat (result, "*");
+	    *p++ = '*';
 	  }
 	}
 	
-	strcat (result, ":");
+	*p++ = ':';
+	*p = '\0';
 }
 
 
@@ -1422,43 +1518,15 @@ void ax25_format_addrs (packet_t this_p, char *result)
 
 int ax25_pack (packet_t this_p, unsigned char result[AX25_MAX_PACKET_LEN]) 
 {
-	int j, k;
-	unsigned char *pout;
-	int len;
 
 	assert (this_p->magic1 == MAGIC);
 	assert (this_p->magic2 == MAGIC);
 
-	pout = result;
-
-	for (j=0; j<this_p->num_addr; j++) {
-
-	  char *s;
-
-	  memset (pout, ' ' << 1, (size_t)6);
-
-	  s = this_p->addrs[j];
-	  for (k=0; *s != '\0'; k++, s++) {
-	    pout[k] = *s << 1;	    
-	  }
-
-	  if (j == this_p->num_addr - 1) {
-	    pout[6] = this_p->ssid_etc[j] | SSID_LAST_MASK;
-	  }
-	  else {
-	   pout[6] = this_p->ssid_etc[j] & ~ SSID_LAST_MASK;
-	  }
-	  pout += 7;
-	}
-
-	memcpy (pout, this_p->the_rest, (size_t)this_p->the_rest_len);
-	pout += this_p->the_rest_len;
-
-	len = pout - result;
+	assert (this_p->frame_len <= AX25_MAX_PACKET_LEN);
 
-	assert (len <= AX25_MAX_PACKET_LEN);
+	memcpy (result, this_p->frame_data, (size_t)this_p->frame_len);
 
-	return (len);
+	return (this_p->frame_len);
 }
 
 
@@ -1514,7 +1582,7 @@ int ax25_get_control (packet_t this_p)
 	assert (this_p->magic2 == MAGIC);
 
 	if (this_p->num_addr >= 2) {
-	  return (this_p->the_rest[ax25_get_control_offset(this_p)]);
+	  return (ax25_get_rest(this_p)[ax25_get_control_offset(this_p)]);
 	}
 	return (-1);
 }
@@ -1539,7 +1607,7 @@ int ax25_get_pid (packet_t this_p)
 	assert (this_p->magic2 == MAGIC);
 
 	if (this_p->num_addr >= 2) {
-	  return (this_p->the_rest[ax25_get_pid_offset(this_p)]);
+	  return (ax25_get_rest(this_p)[ax25_get_pid_offset(this_p)]);
 	}
 	return (-1);
 }
@@ -1547,9 +1615,9 @@ int ax25_get_pid (packet_t this_p)
 
 /*------------------------------------------------------------------------------
  *
- * Name:	ax25_dedupe_crc 
+ * Name:	ax25_dedupe_fingerprint
  * 
- * Purpose:	Calculate a checksum for the packet source, destination, and
+ * Purpose:	Get a hash of the packet source, destination, and
  *		information but NOT the digipeaters.
  *		This is used for duplicate detection in the digipeater 
  *		and IGate algorithms.
@@ -1565,32 +1633,97 @@ int ax25_get_pid (packet_t this_p)
  *			+ information field
  *		but NOT the changing list of digipeaters.
  *
- *		Typically, only a checksum is kept to reduce memory 
+ *		Typically, only the hash is kept to reduce memory 
  *		requirements and amount of compution for comparisons.
- *		There is a very very small probability that two unrelated 
- *		packets will result in the same checksum, and the
- *		undesired dropping of the packet.
+ *
+ *		This used to be a 16 bit CRC.  With a few hundred
+ *		packets remembered there was a noticeable chance of
+ *		two unrelated packets matching, and the undesired 
+ *		dropping of one.  A 64 bit hash makes that practically
+ *		impossible.
+ *
+ *		The same packet is checked by the digipeater and 
+ *		both directions of the IGate so it is calculated 
+ *		once, when the packet is created, and only again 
+ *		if the source or destination is changed.
  *		
  *------------------------------------------------------------------------------*/
 
-unsigned short ax25_dedupe_crc (packet_t pp)
+unsigned long long ax25_dedupe_fingerprint (packet_t pp)
 {
-	unsigned short crc;
-	char src[AX25_MAX_ADDR_LEN];
-	char dest[AX25_MAX_ADDR_LEN];
+	assert (pp->magic1 == MAGIC);
+	assert (pp->magic2 == MAGIC);
+
+	if ( ! pp->fingerprint_valid) {
+	  set_fingerprint (pp);
+	}
+	return (pp->fingerprint);
+}
+
+
+/*
+ * 64 bit hash, taking 8 bytes at a time, with the MurmurHash3
+ * finalizer to mix the result.  Good distribution and fast.
+ * We are not defending against someone crafting collisions.
+ *
+ * The value depends on the byte order of the computer.
+ * That's fine because it is never saved or sent anywhere.
+ */
+
+#define FP_SEED  0x9e3779b97f4a7c15ULL
+#define FP_MULT  0xff51afd7ed558ccdULL
+
+static unsigned long long fp_hash (const unsigned char *p, int len, unsigned long long h)
+{
+	unsigned long long w;
+
+	while (len >= 8) {
+	  memcpy (&w, p, 8);
+	  h = (h ^ w) * FP_MULT;
+	  h ^= h >> 32;
+	  p += 8;
+	  len -= 8;
+	}
+	if (len > 0) {
+	  w = 0;
+	  memcpy (&w, p, (size_t)len);
+	  h = (h ^ w ^ ((unsigned long long)len << 56)) * FP_MULT;
+	  h ^= h >> 32;
+	}
+	return (h);
+}
+
+static unsigned long long fp_final (unsigned long long h)
+{
+	h ^= h >> 33;
+	h *= FP_MULT;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return (h);
+}
+
+static void set_fingerprint (packet_t this_p)
+{
+	unsigned long long h = FP_SEED;
 	unsigned char *pinfo;
 	int info_len;
 
-	ax25_get_addr_with_ssid(pp, AX25_SOURCE, src);
-	ax25_get_addr_with_ssid(pp, AX25_DESTINATION, dest);
-	info_len = ax25_get_info (pp, &pinfo);
+	if (this_p->num_addr >= 2) {
+	  const char *src = get_view(this_p, AX25_SOURCE)->with_ssid;
+	  const char *dest = get_view(this_p, AX25_DESTINATION)->with_ssid;
 
-	crc = 0xffff;
-	crc = crc16((unsigned char *)src, strlen(src), crc);
-	crc = crc16((unsigned char *)dest, strlen(dest), crc);
-	crc = crc16(pinfo, info_len, crc);
+	  /* Include the nul terminators so "AB" "C" doesn't match "A" "BC". */
 
-	return (crc);
+	  h = fp_hash ((const unsigned char *)src, strlen(src) + 1, h);
+	  h = fp_hash ((const unsigned char *)dest, strlen(dest) + 1, h);
+	}
+
+	info_len = ax25_get_info (this_p, &pinfo);
+	h = fp_hash (pinfo, info_len, h);
+
+	this_p->fingerprint = fp_final (h);
+	this_p->fingerprint_valid = 1;
 }
 
 /*------------------------------------------------------------------------------
@@ -1618,13 +1751,12 @@ unsigned short ax25_dedupe_crc (packet_t pp)
 unsigned short ax25_m_m_crc (packet_t pp)
 {
 	unsigned short crc;
-	unsigned char fbuf[AX25_MAX_PACKET_LEN];
-	int flen;
 
-	flen = ax25_pack (pp, fbuf); 
+	assert (pp->magic1 == MAGIC);
+	assert (pp->magic2 == MAGIC);
 
 	crc = 0xffff;
-	crc = crc16(fbuf, flen, crc);
+	crc = crc16(pp->frame_data, pp->frame_len, crc);
 
 	return (crc);
 }
@@ -1717,6 +1849,144 @@ void ax25_safe_print (char *pstr, int len, int ascii_only)
 
 } /* end ax25_safe_print */
 
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        main
+ *
+ * Purpose:     Measure how fast ax25_from_text can take apart 
+ *		text from an APRS-IS server.
+ *
+ * Usage:	axbench  file  [ repeat ]
+ *
+ *		file	- Captured APRS-IS stream, one packet per line,
+ *			  e.g. from  "nc rotate.aprs2.net 10152 > file"
+ *			  after logging in with a filter.
+ *			  Lines beginning with "#" are skipped.
+ *
+ *		repeat	- Number of times to go through all of it.  Default 10.
+ *
+ * Description:	Each packet is also converted back to text and compared
+ *		with the original.  This catches mistakes in parsing but
+ *		it can't be the same when the server sends an address 
+ *		with "-0" or the information part has hexadecimal escapes.
+ *
+ *--------------------------------------------------------------------*/
+
+#if AXBENCH
+
+#include <time.h>
+
+/*
+ * Longest packet in monitor format:  each address with "*" and
+ * a separator, then ":", the information part, and nul.
+ */
+#define AXBENCH_TEXT_LEN (AX25_MAX_ADDRS * (AX25_MAX_ADDR_LEN + 2) + 1 + AX25_MAX_INFO_LEN + 1)
+
+int main (int argc, char *argv[])
+{
+	FILE *fp;
+	char line[AXBENCH_TEXT_LEN + 1];	/* Room for newline too. */
+	char **lines = NULL;
+	int num_lines = 0;
+	long bytes = 0;
+	int repeat = 10;
+	int r, n;
+	int bad = 0, different = 0;
+	clock_t start;
+	double sec;
+
+	if (argc < 2) {
+	  fprintf (stderr, "Usage:  axbench  file  [ repeat ]\n");
+	  exit (EXIT_FAILURE);
+	}
+	if (argc >= 3) {
+	  repeat = atoi(argv[2]);
+	  if (repeat < 1) repeat = 1;
+	}
+
+	fp = fopen (argv[1], "r");
+	if (fp == NULL) {
+	  fprintf (stderr, "Can't open %s for read.\n", argv[1]);
+	  exit (EXIT_FAILURE);
+	}
+
+	while (fgets (line, sizeof(line), fp) != NULL) {
+	  line[strcspn(line, "\r\n")] = '\0';
+	  if (line[0] == '#' || line[0] == '\0') {
+	    continue;
+	  }
+	  lines = realloc (lines, (num_lines + 1) * sizeof(char *));
+	  lines[num_lines++] = strdup(line);
+	  bytes += strlen(line);
+	}
+	fclose (fp);
+
+	if (num_lines == 0) {
+	  fprintf (stderr, "No packets found in %s.\n", argv[1]);
+	  exit (EXIT_FAILURE);
+	}
+
+/*
+ * Check that each one comes back out the same.
+ */
+	for (n = 0; n < num_lines; n++) {
+	  packet_t pp = ax25_from_text (lines[n], 0);
+
+	  if (pp == NULL) {
+	    bad++;
+	  }
+	  else {
+	    char text[AXBENCH_TEXT_LEN];
+	    unsigned char *pinfo;
+	    int info_len;
+
+	    ax25_format_addrs (pp, text);
+	    info_len = ax25_get_info (pp, &pinfo);
+	    assert (strlen(text) + info_len < sizeof(text));
+	    memcpy (text + strlen(text), pinfo, info_len + 1);
+	    if (strcmp (text, lines[n]) != 0) {
+	      different++;
+	    }
+	    ax25_delete (pp);
+	  }
+	}
+
+/*
+ * Now the timing.
+ */
+	start = clock();
+
+	for (r = 0; r < repeat; r++) {
+	  for (n = 0; n < num_lines; n++) {
+	    packet_t pp = ax25_from_text (lines[n], 0);
+	    if (pp != NULL) {
+	      ax25_delete (pp);
+	    }
+	  }
+	}
+
+	sec = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	printf ("%d packets, %d could not be parsed, %d different when converted back to text.\n", 
+			num_lines, bad, different);
+	printf ("%d times in %.3f seconds.  %.0f packets/sec,  %.1f MB/sec,  %.3f microseconds/packet.\n",
+			repeat, sec, 
+			sec > 0 ? num_lines * repeat / sec : 0.,
+			sec > 0 ? bytes * repeat / sec / 1000000. : 0.,
+			1000000. * sec / (num_lines * repeat));
+
+	for (n = 0; n < num_lines; n++) {
+	  free (lines[n]);
+	}
+	free (lines);
+
+	exit (EXIT_SUCCESS);
+}
+
+#endif
+
 /* end ax25_pad.c */
 
 
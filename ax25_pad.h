@@ -67,6 +67,26 @@
 
 
 
+/*
+ * An address, decoded from the frame, in the form most callers want.
+ * See ax25_get_addr_view.
+ */
+
+struct ax25_addr_s {
+
+	char call[AX25_MAX_ADDR_LEN];		/* Without SSID.  e.g.  WB2OSZ */
+
+	char with_ssid[AX25_MAX_ADDR_LEN+3];	/* Usual human readable form.  e.g.  WB2OSZ-15 */
+						/* No SSID is added when it is zero. */
+
+	int ssid;				/* Substation ID, 0 - 15. */
+
+	int h;					/* "Has been repeated" flag for a digipeater. */
+						/* Command/response for source & destination. */
+};
+
+
+
 #ifdef AX25_PAD_C	/* Keep this hidden - implementation could change. */
 
 struct packet_s {
@@ -77,18 +97,45 @@ struct packet_s {
 
 	struct packet_s *nextp;	/* Pointer to next in queue. */
 
-	int num_addr;		/* Number of elements used in two below. */
+	int num_addr;		/* Number of addresses at the beginning of frame_data. */
 				/* Range of 0 .. AX25_MAX_ADDRS. */	
+				/* 0 for something other than AX.25 in KISS mode. */
+
+	int frame_len;		/* Number of octets in frame_data, not including */
+				/* the nul terminator or the HDLC frame FCS. */
+
+	unsigned short view_valid;
+				/* Bit mask of which addr_view entries below */
+				/* are current.  Bit n is for address n. */
+
+	int fingerprint_valid;	/* Set when fingerprint below is current. */
+				/* Cleared when source or destination changes. */
+
+	unsigned long long fingerprint;
+				/* Hash of source, destination and information */
+				/* for duplicate detection.  Calculated when the */
+				/* packet is created so the digipeater and IGate */
+				/* don't each do it again.  See ax25_dedupe_fingerprint. */
+
+	struct ax25_addr_s addr_view[AX25_MAX_ADDRS];
+				/* Addresses are decoded from frame_data only */
+				/* when asked for, then kept until changed. */
 
-	char addrs[AX25_MAX_ADDRS][AX25_MAX_ADDR_LEN];
-				/* Contains the address without the ssid. */
-				/* Why is it larger than 7? */
 				/* Messages from an IGate server can have longer */
 				/* addresses after qAC.  Up to 9 observed so far. */
+				/* These don't fit in the frame so only the first 6 */
+				/* characters are there.  The whole thing is kept */
+				/* here and always valid. */
 
-				/* usual human readable form.  e.g.  WB20SZ-15 */
+	unsigned char frame_data[AX25_MAX_PACKET_LEN + 1];
 
-	unsigned char ssid_etc[AX25_MAX_ADDRS];		/*  SSID octet from each address. */
+				/* The frame in the same form as sent over the radio: */
+				/* addresses, control, protocol ID, and Information. */
+				/* Throw in one more for a character string nul */
+				/* terminator after the Information. */
+
+				/* Each address is 7 octets, 6 characters */
+				/* shifted left one bit, then the SSID octet: */
 
 				/* 
 				 * Bits:   H  R  R  SSID  0
@@ -117,15 +164,6 @@ struct packet_s {
 
 #define SSID_LAST_MASK	0x01
 
-
-	int the_rest_len;	/* Frame length minus the address part. */
-
-	unsigned char the_rest[2 + 3 + AX25_MAX_INFO_LEN + 1];
-				/* The rest after removing the addresses. */
-				/* Includes control, protocol ID, Information, */
-				/* and throw in one more for a character */
-				/* string nul terminator. */
-
 	int magic2;		/* Will get stomped on if above overflows. */
 };
 
@@ -156,6 +194,20 @@ typedef struct packet_s *packet_t;
  * We can assume 1 for our purposes.
  */
 
+/*
+ * The part after the addresses, starting with the control field.
+ */
+
+static inline unsigned char *ax25_get_rest (packet_t this_p)
+{
+	return (this_p->frame_data + this_p->num_addr * 7);
+}
+
+static inline int ax25_get_rest_len (packet_t this_p)
+{
+	return (this_p->frame_len - this_p->num_addr * 7);
+}
+
 static inline int ax25_get_control_offset (packet_t this_p) 
 {
 	return (0);
@@ -182,12 +234,12 @@ static int ax25_get_num_pid (packet_t this_p)
 	int c;
 	int pid;
 
-	c = this_p->the_rest[ax25_get_control_offset(this_p)];
+	c = ax25_get_rest(this_p)[ax25_get_control_offset(this_p)];
 
 	if ( (c & 0x01) == 0 ||				/* I   xxxx xxx0 */
 	     c == 0x03 || c == 0x13) {			/* UI  000x 0011 */
 
-	  pid = this_p->the_rest[ax25_get_pid_offset(this_p)];
+	  pid = ax25_get_rest(this_p)[ax25_get_pid_offset(this_p)];
 	  if (pid == 0xff) {
 	    return (2);			/* pid 1111 1111 means another follows. */
 	  }
@@ -217,7 +269,7 @@ static int ax25_get_num_info (packet_t this_p)
 {
 	int len;
 
-	len = this_p->the_rest_len - ax25_get_num_control(this_p) - ax25_get_num_pid(this_p);
+	len = ax25_get_rest_len(this_p) - ax25_get_num_control(this_p) - ax25_get_num_pid(this_p);
 	if (len < 0) {
 	  len = 0;		/* print error? */
 	}
@@ -234,6 +286,8 @@ static int ax25_get_num_info (packet_t this_p)
 
 extern void ax25_delete (packet_t pp);
 
+extern void ax25_get_alloc_counts (int *pnew, int *pdelete);
+
 extern void ax25_clear (packet_t pp);
 
 extern packet_t ax25_from_text (char *, int strict);
@@ -255,6 +309,8 @@ extern int ax25_get_num_repeaters (packet_t this_p);
 
 extern void ax25_get_addr_with_ssid (packet_t pp, int n, char *);
 
+extern const struct ax25_addr_s * ax25_get_addr_view (packet_t this_p, int n);
+
 extern int ax25_get_ssid (packet_t pp, int n);
 extern void ax25_set_ssid (packet_t this_p, int n, int ssid);
 
@@ -284,7 +340,7 @@ extern int ax25_get_control (packet_t this_p);
 
 extern int ax25_get_pid (packet_t this_p);
 
-extern unsigned short ax25_dedupe_crc (packet_t pp);
+extern unsigned long long ax25_dedupe_fingerprint (packet_t pp);
 
 extern unsigned short ax25_m_m_crc (packet_t pp);
 
@@ -57,6 +57,8 @@
 #include "beacon.h"
 #include "latlong.h"
 #include "dwgps.h"
+#include "airtime.h"
+#include "rtsched.h"
 
 
 
@@ -75,6 +77,77 @@ static int g_using_gps = 0;
 static struct misc_config_s *g_misc_config_p;
 static struct digi_config_s *g_digi_config_p;
 
+/*
+ * The startup configuration belongs to the caller.
+ * Anything from beacon_reload is our own copy and is freed
+ * when replaced.
+ */
+
+static int g_config_owned = 0;
+
+/*
+ * New configuration from beacon_reload waiting for the
+ * beacon thread to pick it up.  Protected by wake_up_mutex.
+ */
+
+static struct misc_config_s *pending_misc = NULL;
+static struct digi_config_s *pending_digi = NULL;
+static volatile int reload_pending = 0;
+
+static int thread_started = 0;
+
+
+
+/*
+ * Schedule of pending transmissions.
+ *
+ * This is a binary min-heap ordered by due time so the next
+ * beacon is always at sched[0].  Adding, removing, or changing
+ * the time of one is O(log n) so there is no practical limit on
+ * the number of beacons or objects that can be handled.
+ *
+ * sched_pos[b] is the location of beacon b in the heap so the
+ * time can be changed in place, e.g. for corner pegging.
+ * Only the beacon thread touches any of this after init.
+ */
+
+typedef long long msec_t;	/* Milliseconds from monotonic clock. */
+
+struct sched_s {
+	msec_t due;		/* When to transmit. */
+	int b;			/* Index into g_misc_config_p->beacon. */
+};
+
+static struct sched_s *sched = NULL;
+static int sched_len = 0;
+static int *sched_pos = NULL;
+
+static void sched_set (int b, msec_t due);
+static msec_t now_ms (void);
+
+static void check_beacons (struct misc_config_s *pconfig, struct digi_config_s *pdigi, int at_startup);
+static void sched_build (void);
+static void start_thread (void);
+static void take_pending (void);
+static void free_misc (struct misc_config_s *pm);
+
+
+/*
+ * The beacon thread sleeps until the next scheduled time
+ * or until the GPS receiver has something new for us.
+ */
+
+#if __WIN32__
+static HANDLE wake_up_event;
+static CRITICAL_SECTION now_ms_cs;	/* For GetTickCount wrap around in now_ms. */
+#else
+static pthread_mutex_t wake_up_mutex;
+static pthread_cond_t wake_up_cond;
+#endif
+
+static volatile int gps_changed = 0;
+
+static void beacon_gps_notify (void);
 
 
 #if __WIN32__
@@ -98,10 +171,11 @@ static void * beacon_thread (void *arg);
  *
  * Outputs:	Remember required information for future use.
  *
- * Description:	Initialize the queue to be empty and set up other
- *		mechanisms for sharing it between different threads.
+ * Description:	Validate the configuration, put every usable
+ *		beacon into the schedule, and set up the mechanism
+ *		for waking up early when new GPS data arrives.
  *
- *		Start up xmit_thread to actually send the packets
+ *		Start up beacon_thread to actually send the packets
  *		at the appropriate time.
  *
  *--------------------------------------------------------------------*/
@@ -110,13 +184,8 @@ static void * beacon_thread (void *arg);
 
 void beacon_init (struct misc_config_s *pconfig, struct digi_config_s *pdigi)
 {
-	time_t now;
-	int j;
-	int count;
-#if __WIN32__
-	HANDLE beacon_th;
-#else
-	pthread_t beacon_tid;
+#if ! __WIN32__
+	pthread_condattr_t cattr;
 #endif
 
 
@@ -128,20 +197,115 @@ void beacon_init (struct misc_config_s *pconfig, struct digi_config_s *pdigi)
 
 
 
-/* 
+/*
  * Save parameters for later use.
  */
 	g_misc_config_p = pconfig;
 	g_digi_config_p = pdigi;
 
+#if __WIN32__
+	InitializeCriticalSection (&now_ms_cs);
+#endif
+
+	check_beacons (pconfig, pdigi, 1);
+
+
+/*
+ * Set up the wake up mechanism before connecting to
+ * the GPS receiver because it could notify us right away.
+ */
+
+#if __WIN32__
+	wake_up_event = CreateEvent (NULL, 0, 0, NULL);
+	if (wake_up_event == NULL) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("beacon_init: CreateEvent: can't create beacon wake up event");
+	  return;
+	}
+#else
+	pthread_mutex_init (&wake_up_mutex, NULL);
+	pthread_condattr_init (&cattr);
+	pthread_condattr_setclock (&cattr, CLOCK_MONOTONIC);
+	pthread_cond_init (&wake_up_cond, &cattr);
+	pthread_condattr_destroy (&cattr);
+#endif
+
+
+/*
+ * Connect to GPS receiver if any tracker beacons are configured.
+ * If open fails, disable all tracker beacons.
+ */
+
+	dwgps_set_notify (beacon_gps_notify);
+
+#if DEBUG_SIM
+
+	g_using_gps = 1;
+
+#elif ENABLE_GPS
+
+	if (g_using_gps > 0) {
+	  int err;
+	  int j;
+
+	  err = dwgps_init();
+	  if (err != 0) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf ("All tracker beacons disabled.\n");
+	    g_using_gps = 0;
+
+	    for (j=0; j<g_misc_config_p->num_beacons; j++) {
+              if (g_misc_config_p->beacon[j].btype == BEACON_TRACKER) {
+		g_misc_config_p->beacon[j].btype = BEACON_IGNORE;
+	      }
+	    }
+	  }
+
+	}
+#endif
+
+
 /*
- * Precompute the packet contents so any errors are 
+ * Put each valid beacon into the schedule.
+ * Start up thread for processing only if at least one is valid.
+ */
+
+	sched_build ();
+
+	if (sched_len >= 1) {
+	  start_thread ();
+	}
+
+} /* end beacon_init */
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        check_beacons
+ *
+ * Purpose:     Validate beacon configuration.
+ *
+ * Inputs:	pconfig		- misc. configuration from config file.
+ *		pdigi		- digipeater configuration from config file.
+ *		at_startup	- True for beacon_init, false for beacon_reload.
+ *
+ * Outputs:	Type of any unusable beacon is changed to BEACON_IGNORE.
+ *		g_using_gps is incremented for tracker beacons at startup.
+ *
+ *--------------------------------------------------------------------*/
+
+static void check_beacons (struct misc_config_s *pconfig, struct digi_config_s *pdigi, int at_startup)
+{
+	int j;
+
+/*
+ * Precompute the packet contents so any errors are
  * Reported once at start up time rather than for each transmission.
  * If a serious error is found, set type to BEACON_IGNORE and that
  * table entry should be ignored later on.
  */
-	for (j=0; j<g_misc_config_p->num_beacons; j++) {
-	  int chan = g_misc_config_p->beacon[j].chan;
+	for (j=0; j<pconfig->num_beacons; j++) {
+	  int chan = pconfig->beacon[j].chan;
 
 	  if (chan < 0) chan = 0;	/* For IGate, use channel 0 call. */
 
@@ -149,16 +313,16 @@ void beacon_init (struct misc_config_s *pconfig, struct digi_config_s *pdigi)
 
 	    if (strlen(pdigi->mycall[chan]) > 0 && strcasecmp(pdigi->mycall[chan], "NOCALL") != 0) {
 
-              switch (g_misc_config_p->beacon[j].btype) {
+              switch (pconfig->beacon[j].btype) {
 
 	        case BEACON_OBJECT:
 
 		  /* Object name is required. */
 
-		  if (strlen(g_misc_config_p->beacon[j].objname) == 0) {
+		  if (strlen(pconfig->beacon[j].objname) == 0) {
 	            text_color_set(DW_COLOR_ERROR);
-	            dw_printf ("Config file, line %d: OBJNAME is required for OBEACON.\n", g_misc_config_p->beacon[j].lineno);
-		    g_misc_config_p->beacon[j].btype = BEACON_IGNORE;
+	            dw_printf ("Config file, line %d: OBJNAME is required for OBEACON.\n", pconfig->beacon[j].lineno);
+		    pconfig->beacon[j].btype = BEACON_IGNORE;
 		    continue;
 		  }
 		  /* Fall thru.  Ignore any warning about missing break. */
@@ -167,22 +331,30 @@ void beacon_init (struct misc_config_s *pconfig, struct digi_config_s *pdigi)
 
 		  /* Location is required. */
 
-		  if (g_misc_config_p->beacon[j].lat == G_UNKNOWN || g_misc_config_p->beacon[j].lon == G_UNKNOWN) {
+		  if (pconfig->beacon[j].lat == G_UNKNOWN || pconfig->beacon[j].lon == G_UNKNOWN) {
 	            text_color_set(DW_COLOR_ERROR);
-	            dw_printf ("Config file, line %d: Latitude and longitude are required.\n", g_misc_config_p->beacon[j].lineno);
-		    g_misc_config_p->beacon[j].btype = BEACON_IGNORE;
+	            dw_printf ("Config file, line %d: Latitude and longitude are required.\n", pconfig->beacon[j].lineno);
+		    pconfig->beacon[j].btype = BEACON_IGNORE;
 		    continue;
-		  }	
+		  }
 		  break;
 
 	        case BEACON_TRACKER:
 
-#if defined(GPS_ENABLED) || defined(DEBUG_SIM)
-		  g_using_gps++;
+#if defined(ENABLE_GPS) || defined(DEBUG_SIM)
+		  if (at_startup) {
+		    g_using_gps++;
+		  }
+		  else if (g_using_gps == 0) {
+	            text_color_set(DW_COLOR_ERROR);
+	            dw_printf ("Config file, line %d: Restart is required to start using GPS for tracker beacon.\n", pconfig->beacon[j].lineno);
+	   	    pconfig->beacon[j].btype = BEACON_IGNORE;
+	   	    continue;
+		  }
 #else
 	          text_color_set(DW_COLOR_ERROR);
-	          dw_printf ("Config file, line %d: GPS tracker feature is not enabled.\n", g_misc_config_p->beacon[j].lineno);
-	   	  g_misc_config_p->beacon[j].btype = BEACON_IGNORE;
+	          dw_printf ("Config file, line %d: GPS tracker feature is not enabled.\n", pconfig->beacon[j].lineno);
+	   	  pconfig->beacon[j].btype = BEACON_IGNORE;
 	   	  continue;
 #endif
 		  break;
@@ -191,12 +363,12 @@ void beacon_init (struct misc_config_s *pconfig, struct digi_config_s *pdigi)
 
 		  /* INFO is required. */
 
-		  if (g_misc_config_p->beacon[j].custom_info == NULL) {
+		  if (pconfig->beacon[j].custom_info == NULL) {
 	            text_color_set(DW_COLOR_ERROR);
-	            dw_printf ("Config file, line %d: INFO is required for custom beacon.\n", g_misc_config_p->beacon[j].lineno);
-		    g_misc_config_p->beacon[j].btype = BEACON_IGNORE;
+	            dw_printf ("Config file, line %d: INFO is required for custom beacon.\n", pconfig->beacon[j].lineno);
+		    pconfig->beacon[j].btype = BEACON_IGNORE;
 		    continue;
-		  }	
+		  }
 		  break;
 
 	        case BEACON_IGNORE:
@@ -205,22 +377,57 @@ void beacon_init (struct misc_config_s *pconfig, struct digi_config_s *pdigi)
 	    }
 	    else {
 	      text_color_set(DW_COLOR_ERROR);
-	      dw_printf ("Config file, line %d: MYCALL must be set for beacon on channel %d. \n", g_misc_config_p->beacon[j].lineno, chan);
-	      g_misc_config_p->beacon[j].btype = BEACON_IGNORE;
+	      dw_printf ("Config file, line %d: MYCALL must be set for beacon on channel %d. \n", pconfig->beacon[j].lineno, chan);
+	      pconfig->beacon[j].btype = BEACON_IGNORE;
 	    }
 	  }
 	  else {
 	    text_color_set(DW_COLOR_ERROR);
-	    dw_printf ("Config file, line %d: Invalid channel number %d for beacon. \n", g_misc_config_p->beacon[j].lineno, chan);
-	    g_misc_config_p->beacon[j].btype = BEACON_IGNORE;
+	    dw_printf ("Config file, line %d: Invalid channel number %d for beacon. \n", pconfig->beacon[j].lineno, chan);
+	    pconfig->beacon[j].btype = BEACON_IGNORE;
 	  }
 	}
 
-/*
- * Calculate next time for each beacon.
- */
+} /* end check_beacons */
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        sched_build
+ *
+ * Purpose:     Put each valid beacon into a new schedule.
+ *
+ * Inputs:	g_misc_config_p->beacon
+ *
+ * Description:	The first transmission of each is after its delay
+ *		from now.  Any previous schedule is discarded.
+ *
+ *--------------------------------------------------------------------*/
+
+static void sched_build (void)
+{
+	msec_t now;
+	int j;
+
+	free (sched);
+	free (sched_pos);
+	sched = NULL;
+	sched_pos = NULL;
+	sched_len = 0;
+
+	if (g_misc_config_p->num_beacons < 1) {
+	  return;
+	}
+
+	sched = malloc (g_misc_config_p->num_beacons * sizeof(struct sched_s));
+	sched_pos = malloc (g_misc_config_p->num_beacons * sizeof(int));
+	if (sched == NULL || sched_pos == NULL) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Beacon: Out of memory for %d beacons.\n", g_misc_config_p->num_beacons);
+	  return;
+	}
 
-	now = time(NULL);
+	now = now_ms();
 
 	for (j=0; j<g_misc_config_p->num_beacons; j++) {
 #if DEBUG
@@ -232,77 +439,374 @@ void beacon_init (struct misc_config_s *pconfig, struct digi_config_s *pdigi)
 		g_misc_config_p->beacon[j].delay,
 		g_misc_config_p->beacon[j].every);
 #endif
-	  g_misc_config_p->beacon[j].next = now + g_misc_config_p->beacon[j].delay;
+	  sched_pos[j] = -1;
+          if (g_misc_config_p->beacon[j].btype != BEACON_IGNORE) {
+	    sched_set (j, now + g_misc_config_p->beacon[j].delay * 1000LL);
+	  }
 	}
 
+} /* end sched_build */
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        start_thread
+ *
+ * Purpose:     Start up beacon_thread to send the packets.
+ *
+ *--------------------------------------------------------------------*/
+
+static void start_thread (void)
+{
+#if __WIN32__
+	HANDLE beacon_th;
+#else
+	pthread_t beacon_tid;
+#endif
+
+#if __WIN32__
+	beacon_th = (HANDLE)_beginthreadex (NULL, 0, &beacon_thread, NULL, 0, NULL);
+	if (beacon_th == NULL) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Could not create beacon thread\n");
+	  return;
+	}
+#else
+	int e;
+
+	e = pthread_create (&beacon_tid, NULL, beacon_thread, (void *)0);
+	if (e != 0) {
+	  text_color_set(DW_COLOR_ERROR);
+	  perror("Could not create beacon thread");
+	  return;
+	}
+#endif
+
+	thread_started = 1;
+
+} /* end start_thread */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        sched_set
+ *
+ * Purpose:     Add beacon to the schedule or change its time.
+ *
+ * Inputs:	b	- Index into g_misc_config_p->beacon.
+ *
+ *		due	- When it should be sent, from now_ms().
+ *
+ * Description:	Put it at the end, or leave it where it is if
+ *		already present, then move it up or down the
+ *		heap until the ordering is restored.
+ *
+ *--------------------------------------------------------------------*/
+
+static inline void sched_swap (int i, int k)
+{
+	struct sched_s temp;
+
+	temp = sched[i];
+	sched[i] = sched[k];
+	sched[k] = temp;
+
+	sched_pos[sched[i].b] = i;
+	sched_pos[sched[k].b] = k;
+}
+
+
+static void sched_set (int b, msec_t due)
+{
+	int i;
+
+	i = sched_pos[b];
+	if (i < 0) {
+	  i = sched_len++;
+	  sched[i].b = b;
+	  sched_pos[b] = i;
+	}
+	sched[i].due = due;
+
+/* Move toward the top if earlier than parent. */
+
+	while (i > 0 && sched[i].due < sched[(i-1)/2].due) {
+	  sched_swap (i, (i-1)/2);
+	  i = (i-1)/2;
+	}
+
+/* Move toward the bottom if later than either child. */
+
+	while (1) {
+	  int c = 2 * i + 1;
+
+	  if (c >= sched_len) break;
+	  if (c + 1 < sched_len && sched[c+1].due < sched[c].due) c++;
+	  if (sched[i].due <= sched[c].due) break;
+	  sched_swap (i, c);
+	  i = c;
+	}
+}
+
 
 /*
- * Connect to GPS receiver if any tracker beacons are configured.
- * If open fails, disable all tracker beacons.
+ * Monotonic time in milliseconds.
+ * Not affected if someone sets the clock.
  */
 
-#if DEBUG_SIM
+static msec_t now_ms (void)
+{
+#if __WIN32__
+	/* GetTickCount wraps around after 49 days. */
+	/* Called from the beacon thread and from beacon_reload */
+	/* so the wrap around state needs protection. */
+
+	static DWORD prev = 0;
+	static msec_t wraps = 0;
+	DWORD t;
+	msec_t result;
+
+	EnterCriticalSection (&now_ms_cs);
+	t = GetTickCount();
+	if (t < prev) wraps += 0x100000000LL;
+	prev = t;
+	result = wraps + t;
+	LeaveCriticalSection (&now_ms_cs);
+	return (result);
+#else
+	struct timespec ts;
 
-	g_using_gps = 1;
-	
-#elif ENABLE_GPS
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ((msec_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+#endif
+}
 
-	if (g_using_gps > 0) {
-	  int err;
 
-	  err = dwgps_init();
-	  if (err != 0) {
-	    text_color_set(DW_COLOR_ERROR);
-	    dw_printf ("All tracker beacons disabled.\n");
-	    g_using_gps = 0;
+/*-------------------------------------------------------------------
+ *
+ * Name:        beacon_gps_notify
+ *
+ * Purpose:     Called by the GPS interface when there is new data.
+ *
+ * Description:	Wake up the beacon thread so SmartBeaconing can
+ *		react to a change of course right away rather than
+ *		at the next scheduled time.
+ *
+ *--------------------------------------------------------------------*/
 
-	    for (j=0; j<g_misc_config_p->num_beacons; j++) {
-              if (g_misc_config_p->beacon[j].btype == BEACON_TRACKER) {
-		g_misc_config_p->beacon[j].btype = BEACON_IGNORE;
-	      }
-	    }
-	  }
+static void beacon_gps_notify (void)
+{
+#if __WIN32__
+	gps_changed = 1;
+	SetEvent (wake_up_event);
+#else
+	pthread_mutex_lock (&wake_up_mutex);
+	gps_changed = 1;
+	pthread_cond_signal (&wake_up_cond);
+	pthread_mutex_unlock (&wake_up_mutex);
+#endif
+}
 
-	}
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        beacon_reload
+ *
+ * Purpose:     Replace the beacon configuration while running.
+ *
+ * Inputs:	pconfig		- New misc. configuration from config file.
+ *		pdigi		- New digipeater configuration, for MYCALL.
+ *
+ * Description:	We keep our own copies because the caller will
+ *		free its structures.  The beacon thread is the only
+ *		user of the configuration so it makes the switch
+ *		itself, between transmissions, and starts over
+ *		with a new schedule.
+ *
+ *		Tracker beacons can be added only if the GPS
+ *		receiver was already in use.
+ *
+ *--------------------------------------------------------------------*/
+
+void beacon_reload (struct misc_config_s *pconfig, struct digi_config_s *pdigi)
+{
+	struct misc_config_s *pm;
+	struct digi_config_s *pd;
+#if ! __WIN32__
+	struct misc_config_s *old_misc;
 #endif
 
+	pm = malloc (sizeof (struct misc_config_s));
+	pd = malloc (sizeof (struct digi_config_s));
+	if (pm == NULL || pd == NULL) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Beacon: Out of memory for new configuration.\n");
+	  free (pm);
+	  free (pd);
+	  return;
+	}
 
-/* 
- * Start up thread for processing only if at least one is valid.
+/*
+ * Take over the beacon table and strings from the caller.
+ * Only MYCALL is used from the digipeater configuration
+ * so a shallow copy is fine.  Never regfree it.
  */
+	memcpy (pm, pconfig, sizeof (struct misc_config_s));
+	memcpy (pd, pdigi, sizeof (struct digi_config_s));
+	pconfig->beacon = NULL;
+	pconfig->num_beacons = 0;
+	pconfig->max_beacons = 0;
 
-	count = 0;
-	for (j=0; j<g_misc_config_p->num_beacons; j++) {
-          if (g_misc_config_p->beacon[j].btype != BEACON_IGNORE) {
-	    count++;
+	check_beacons (pm, pd, 0);
+
+	if ( ! thread_started) {
+
+	  if (g_config_owned) {
+	    free_misc (g_misc_config_p);
+	    free (g_digi_config_p);
 	  }
-	}
+	  g_misc_config_p = pm;
+	  g_digi_config_p = pd;
+	  g_config_owned = 1;
 
-	if (count >= 1) {
+	  sched_build ();
 
-#if __WIN32__
-	  beacon_th = (HANDLE)_beginthreadex (NULL, 0, &beacon_thread, NULL, 0, NULL);
-	  if (beacon_th == NULL) {
-	    text_color_set(DW_COLOR_ERROR);
-	    dw_printf ("Could not create beacon thread\n");
-	    return;
+	  if (sched_len >= 1) {
+	    start_thread ();
 	  }
+	  return;
+	}
+
+#if __WIN32__
+	/* No mutex here.  Wait for the thread to take any previous */
+	/* one so only one of us touches pending_* at a time. */
+	while (reload_pending) {
+	  SLEEP_MS (10);
+	}
+	pending_misc = pm;
+	pending_digi = pd;
+	reload_pending = 1;
+	SetEvent (wake_up_event);
 #else
-	  int e;
+	pthread_mutex_lock (&wake_up_mutex);
+	old_misc = pending_misc;
+	if (old_misc != NULL) {
+	  /* Previous one never picked up. */
+	  free (pending_digi);
+	}
+	pending_misc = pm;
+	pending_digi = pd;
+	reload_pending = 1;
+	pthread_cond_signal (&wake_up_cond);
+	pthread_mutex_unlock (&wake_up_mutex);
+
+	if (old_misc != NULL) {
+	  free_misc (old_misc);
+	}
+#endif
 
-	  e = pthread_create (&beacon_tid, NULL, beacon_thread, (void *)0);
-	  if (e != 0) {
-	    text_color_set(DW_COLOR_ERROR);
-	    perror("Could not create beacon thread");
-	    return;
-	  }
+} /* end beacon_reload */
+
+
+/*
+ * Called by the beacon thread to switch to the new configuration.
+ */
+
+static void take_pending (void)
+{
+	struct misc_config_s *pm;
+	struct digi_config_s *pd;
+
+#if __WIN32__
+	pm = pending_misc;
+	pd = pending_digi;
+	pending_misc = NULL;
+	pending_digi = NULL;
+	reload_pending = 0;
+#else
+	pthread_mutex_lock (&wake_up_mutex);
+	pm = pending_misc;
+	pd = pending_digi;
+	pending_misc = NULL;
+	pending_digi = NULL;
+	reload_pending = 0;
+	pthread_mutex_unlock (&wake_up_mutex);
 #endif
+
+	if (pm == NULL) {
+	  return;
+	}
+
+	if (g_config_owned) {
+	  free_misc (g_misc_config_p);
+	  free (g_digi_config_p);
 	}
+	g_misc_config_p = pm;
+	g_digi_config_p = pd;
+	g_config_owned = 1;
 
+	sched_build ();
 
-} /* end beacon_init */
+	text_color_set(DW_COLOR_INFO);
+	dw_printf ("Beacon: %d scheduled from new configuration.\n", sched_len);
+}
 
 
+/*
+ * Free configuration from beacon_reload.
+ */
+
+static void free_misc (struct misc_config_s *pm)
+{
+	int j;
+
+	for (j=0; j<pm->num_beacons; j++) {
+	  free (pm->beacon[j].via);
+	  free (pm->beacon[j].custom_info);
+	  free (pm->beacon[j].comment);
+	}
+	free (pm->beacon);
+	free (pm);
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        wait_until
+ *
+ * Purpose:     Sleep until the specified time, new GPS data,
+ *		or a new configuration.
+ *
+ * Inputs:	due	- Time from now_ms().
+ *
+ *--------------------------------------------------------------------*/
+
+static void wait_until (msec_t due)
+{
+#if __WIN32__
+	msec_t now;
+
+	while (! gps_changed && ! reload_pending && (now = now_ms()) < due) {
+	  WaitForSingleObject (wake_up_event, (DWORD)(due - now));
+	}
+	gps_changed = 0;
+#else
+	struct timespec ts;
+
+	ts.tv_sec = due / 1000;
+	ts.tv_nsec = (due % 1000) * 1000000;
+
+	pthread_mutex_lock (&wake_up_mutex);
+	while (! gps_changed && ! reload_pending && now_ms() < due) {
+	  if (pthread_cond_timedwait (&wake_up_cond, &wake_up_mutex, &ts) != 0) {
+	    break;		/* Timed out. */
+	  }
+	}
+	gps_changed = 0;
+	pthread_mutex_unlock (&wake_up_mutex);
+#endif
+}
 
 
 
@@ -314,9 +818,10 @@ void beacon_init (struct misc_config_s *pconfig, struct digi_config_s *pdigi)
  *
  * Inputs:	g_misc_config_p->beacon
  *
- * Outputs:	g_misc_config_p->beacon[].next_time
+ * Outputs:	sched	- Time for next transmission of each.
  *
- * Description:	Go to sleep until it is time for the next beacon.
+ * Description:	Go to sleep until it is time for the next beacon
+ *		or until there is new GPS data.
  *		Transmit any beacons scheduled for now.
  *		Repeat.
  *
@@ -326,6 +831,33 @@ void beacon_init (struct misc_config_s *pconfig, struct digi_config_s *pdigi)
 
 #define MIN(x,y) ((x) < (y) ? (x) : (y))
 
+/* Try again after this many seconds if the channel is too busy. */
+
+#define CONGESTED_RETRY_SEC 30
+
+
+/*
+ * Information from GPS.
+ */
+static int fix = 0;			/* 0 = none, 2 = 2D, 3 = 3D */
+static double my_lat = 0;		/* degrees */
+static double my_lon = 0;
+static float  my_course = 0;		/* degrees */
+static float  my_speed_knots = 0;
+static float  my_speed_mph = 0;
+static float  my_alt = 0;		/* meters */
+
+/*
+ * SmartBeaconing state.
+ */
+static msec_t sb_prev_time = 0;		/* Time of most recent transmission. */
+static float sb_prev_course = 0;	/* Most recent course reported. */
+//static float sb_prev_speed_mph;	/* Most recent speed reported. */
+static int sb_every;			/* Calculated time between transmissions. */
+
+
+static msec_t beacon_send (int j, msec_t now);
+
 
 /* Difference between two angles. */
 
@@ -348,73 +880,54 @@ static void * beacon_thread (void *arg)
 #endif
 {
 	int j;
-	time_t earliest;
-	time_t now;
-
-/*
- * Information from GPS.
- */
-	int fix = 0;			/* 0 = none, 2 = 2D, 3 = 3D */
-	double my_lat = 0;		/* degrees */
-	double my_lon = 0;
-	float  my_course = 0;		/* degrees */
-	float  my_speed_knots = 0;
-	float  my_speed_mph = 0;
-	float  my_alt = 0;		/* meters */
-
-/*
- * SmartBeaconing state.
- */
-	time_t sb_prev_time = 0;	/* Time of most recent transmission. */
-	float sb_prev_course = 0;	/* Most recent course reported. */
-	//float sb_prev_speed_mph;	/* Most recent speed reported. */
-	int sb_every;			/* Calculated time between transmissions. */
+	msec_t now;
 
 
 #if DEBUG
 	struct tm tm;
 	char hms[20];
+	time_t t;
 
-	now = time(NULL);
-	localtime_r (&now, &tm);
+	t = time(NULL);
+	localtime_r (&t, &tm);
 	strftime (hms, sizeof(hms), "%H:%M:%S", &tm);
 	text_color_set(DW_COLOR_DEBUG);
 	dw_printf ("beacon_thread: started %s\n", hms);
 #endif
-	now = time(NULL);
 
-	while (1) {
+	rtsched_apply (RTSCHED_BEACON);
 
-	  assert (g_misc_config_p->num_beacons >= 1);
+	while (1) {
 
-/* 
- * Sleep until time for the earliest scheduled or
- * the soonest we could transmit due to corner pegging.
+/*
+ * Sleep until time for the earliest scheduled.
+ * Corner pegging could make a tracker beacon sooner but
+ * we find out about that when woken up by new GPS data.
+ * The schedule can be empty after a configuration reload.
  */
-	  
-	  earliest = g_misc_config_p->beacon[0].next;
-	  for (j=1; j<g_misc_config_p->num_beacons; j++) {
-	    if (g_misc_config_p->beacon[j].btype == BEACON_IGNORE)
-	      continue;
-	    earliest = MIN(g_misc_config_p->beacon[j].next, earliest);
-	  }
 
-	  if (g_misc_config_p->sb_configured && g_using_gps) {
-	    earliest = MIN(now + g_misc_config_p->sb_turn_time, earliest);
-            earliest = MIN(now + g_misc_config_p->sb_fast_rate, earliest);
-	  }
+#if DEBUG_SIM
+	  /* No notification from simulated GPS.  Look at it every second. */
+	  wait_until (MIN(sched_len > 0 ? sched[0].due : now_ms() + 3600000LL, now_ms() + 1000));
+#else
+	  wait_until (sched_len > 0 ? sched[0].due : now_ms() + 3600000LL);
+#endif
 
-	  if (earliest > now) {
-	    SLEEP_SEC (earliest - now);
+/*
+ * Switch to new configuration if there is one.
+ */
+	  if (reload_pending) {
+	    take_pending ();
 	  }
 
 /*
  * Woke up.  See what needs to be done.
  */
-	  now = time(NULL);
+	  now = now_ms();
 
 #if DEBUG
-	  localtime_r (&now, &tm);
+	  t = time(NULL);
+	  localtime_r (&t, &tm);
 	  strftime (hms, sizeof(hms), "%H:%M:%S", &tm);
 	  text_color_set(DW_COLOR_DEBUG);
 	  dw_printf ("beacon_thread: woke up %s\n", hms);
@@ -423,12 +936,11 @@ static void * beacon_thread (void *arg)
 /*
  * Get information from GPS if being used.
  * This needs to be done before the next scheduled tracker
- * beacon because corner pegging make it sooner. 
+ * beacon because corner pegging make it sooner.
  */
 
 #if DEBUG_SIM
 	  FILE *fp;
-	  char cs[40];
 
 	  fp = fopen ("c:\\cygwin\\tmp\\cs", "r");
 	  if (fp != NULL) {
@@ -476,47 +988,76 @@ static void * beacon_thread (void *arg)
 			g_misc_config_p->sb_fast_speed, g_misc_config_p->sb_fast_rate,
 			g_misc_config_p->sb_slow_speed, g_misc_config_p->sb_slow_rate,
 			my_speed_mph, sb_every);
-#endif 
-	
+#endif
+
 /*
  * Test for "Corner Pegging" if moving.
  */
 	    if (my_speed_mph >= 1.0) {
-	      int turn_threshold = g_misc_config_p->sb_turn_angle + 
+	      int turn_threshold = g_misc_config_p->sb_turn_angle +
 			g_misc_config_p->sb_turn_slope / my_speed_mph;
 
 #if DEBUG_SIM
 	  text_color_set(DW_COLOR_DEBUG);
 	  dw_printf ("SB-moving: course %.0f  prev %.0f  thresh %d\n",
 		my_course, sb_prev_course, turn_threshold);
-#endif 
+#endif
 	      if (heading_change(my_course, sb_prev_course) > turn_threshold &&
-		  now >= sb_prev_time + g_misc_config_p->sb_turn_time) {
+		  now >= sb_prev_time + g_misc_config_p->sb_turn_time * 1000LL) {
 
 		/* Send it now. */
 	        for (j=0; j<g_misc_config_p->num_beacons; j++) {
                   if (g_misc_config_p->beacon[j].btype == BEACON_TRACKER) {
-		    g_misc_config_p->beacon[j].next = now;
+		    sched_set (j, now);
 	          }
 	        }
 	      }  /* significant change in direction */
 	    }  /* is moving */
 	  }  /* apply SmartBeaconing */
-	    
-      
-	  for (j=0; j<g_misc_config_p->num_beacons; j++) {
 
-	    if (g_misc_config_p->beacon[j].btype == BEACON_IGNORE)
-	      continue;
+/*
+ * Send everything that is due and put it back in the
+ * schedule for next time.
+ */
+	  while (sched_len > 0 && sched[0].due <= now) {
+
+	    j = sched[0].b;
+	    sched_set (j, beacon_send (j, now));
+	  }
 
-	    if (g_misc_config_p->beacon[j].next <= now) {
+	}  /* do forever */
 
-	      int strict = 1;	/* Strict packet checking because they will go over air. */
-	      char stemp[20];
-	      char info[AX25_MAX_INFO_LEN];
-	      char beacon_text[AX25_MAX_PACKET_LEN];
-	      packet_t pp = NULL;
-	      char mycall[AX25_MAX_ADDR_LEN];
+	return (0);	/* to suppress compiler warning. */
+
+} /* end beacon_thread */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        beacon_send
+ *
+ * Purpose:     Transmit one beacon.
+ *
+ * Inputs:	j	- Index into g_misc_config_p->beacon.
+ *
+ *		now	- Current time from now_ms().
+ *
+ * Returns:	When it should be sent again.
+ *
+ *--------------------------------------------------------------------*/
+
+static msec_t beacon_send (int j, msec_t now)
+{
+	int strict = 1;	/* Strict packet checking because they will go over air. */
+	char stemp[20];
+	char info[AX25_MAX_INFO_LEN];
+	char beacon_text[AX25_MAX_PACKET_LEN];
+	packet_t pp = NULL;
+	char mycall[AX25_MAX_ADDR_LEN];
+	msec_t next;
+
+	next = now + g_misc_config_p->beacon[j].every * 1000LL;
 
 /*
  * Obtain source call for the beacon.
@@ -525,157 +1066,158 @@ static void * beacon_thread (void *arg)
  *
  * Check added in version 1.0a.  Previously used index of -1.
  */
-	      strcpy (mycall, "NOCALL");
+	strcpy (mycall, "NOCALL");
 
-	      if (g_misc_config_p->beacon[j].chan == -1) {
-		strcpy (mycall, g_digi_config_p->mycall[0]);
-	      }
-	      else {
-		strcpy (mycall, g_digi_config_p->mycall[g_misc_config_p->beacon[j].chan]);
-	      }
+	if (g_misc_config_p->beacon[j].chan == -1) {
+	  strcpy (mycall, g_digi_config_p->mycall[0]);
+	}
+	else {
+	  strcpy (mycall, g_digi_config_p->mycall[g_misc_config_p->beacon[j].chan]);
+	}
 
-	      if (strlen(mycall) == 0 || strcmp(mycall, "NOCALL") == 0) {
-	        text_color_set(DW_COLOR_ERROR);
-	        dw_printf ("MYCALL not set for beacon in config file line %d.\n", g_misc_config_p->beacon[j].lineno);
-		continue;
-	      }
+	if (strlen(mycall) == 0 || strcmp(mycall, "NOCALL") == 0) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("MYCALL not set for beacon in config file line %d.\n", g_misc_config_p->beacon[j].lineno);
+	  return (next);
+	}
 
-/* 
- * Prepare the monitor format header. 
+/*
+ * Don't add to the congestion if the radio channel is already too busy.
+ * Postpone rather than discarding it.
  */
+	if (g_misc_config_p->beacon[j].chan >= 0 && airtime_congested(g_misc_config_p->beacon[j].chan)) {
+	  text_color_set(DW_COLOR_INFO);
+	  dw_printf ("Channel %d utilization is above MAXUTIL.  Postponing beacon from config file line %d.\n",
+		  g_misc_config_p->beacon[j].chan, g_misc_config_p->beacon[j].lineno);
+	  return (now + CONGESTED_RETRY_SEC * 1000LL);
+	}
 
-	      strcpy (beacon_text, mycall);
-	      strcat (beacon_text, ">");
-	      sprintf (stemp, "%s%1d%1d", APP_TOCALL, MAJOR_VERSION, MINOR_VERSION);
-	      strcat (beacon_text, stemp);
-	      if (g_misc_config_p->beacon[j].via) {
-	        strcat (beacon_text, ",");
-	        strcat (beacon_text, g_misc_config_p->beacon[j].via);
-	      }
-	      strcat (beacon_text, ":");
 
-/* 
- * Add the info part depending on beacon type. 
+/*
+ * Prepare the monitor format header.
  */
-	      switch (g_misc_config_p->beacon[j].btype) {
-
-		case BEACON_POSITION:
-
-		  encode_position (g_misc_config_p->beacon[j].compress, g_misc_config_p->beacon[j].lat, g_misc_config_p->beacon[j].lon, 
-			g_misc_config_p->beacon[j].symtab, g_misc_config_p->beacon[j].symbol, 
-			g_misc_config_p->beacon[j].power, g_misc_config_p->beacon[j].height, g_misc_config_p->beacon[j].gain, g_misc_config_p->beacon[j].dir,
-			0, 0, /* course, speed */	
-			g_misc_config_p->beacon[j].freq, g_misc_config_p->beacon[j].tone, g_misc_config_p->beacon[j].offset,
-			g_misc_config_p->beacon[j].comment,
-			info);
-		  strcat (beacon_text, info);
-	          g_misc_config_p->beacon[j].next = now + g_misc_config_p->beacon[j].every;
-		  break;
-
-		case BEACON_OBJECT:
 
-		  encode_object (g_misc_config_p->beacon[j].objname, g_misc_config_p->beacon[j].compress, 0, g_misc_config_p->beacon[j].lat, g_misc_config_p->beacon[j].lon, 
-			g_misc_config_p->beacon[j].symtab, g_misc_config_p->beacon[j].symbol, 
-			g_misc_config_p->beacon[j].power, g_misc_config_p->beacon[j].height, g_misc_config_p->beacon[j].gain, g_misc_config_p->beacon[j].dir,
-			0, 0, /* course, speed */
-			g_misc_config_p->beacon[j].freq, g_misc_config_p->beacon[j].tone, g_misc_config_p->beacon[j].offset, g_misc_config_p->beacon[j].comment,
-			info);
-		  strcat (beacon_text, info);
-	          g_misc_config_p->beacon[j].next = now + g_misc_config_p->beacon[j].every;
-		  break;
+	strcpy (beacon_text, mycall);
+	strcat (beacon_text, ">");
+	sprintf (stemp, "%s%1d%1d", APP_TOCALL, MAJOR_VERSION, MINOR_VERSION);
+	strcat (beacon_text, stemp);
+	if (g_misc_config_p->beacon[j].via) {
+	  strcat (beacon_text, ",");
+	  strcat (beacon_text, g_misc_config_p->beacon[j].via);
+	}
+	strcat (beacon_text, ":");
 
-		case BEACON_TRACKER:
-
-		  if (fix >= 2) {
-		    int coarse;		/* APRS encoder wants 1 - 360.  */
-					/* 0 means none or unknown. */
-
-		    coarse = (int)roundf(my_course);
-		    if (coarse == 0) {
-		      coarse = 360;
-		    }
-		    encode_position (g_misc_config_p->beacon[j].compress, 
-			my_lat, my_lon, 
-			g_misc_config_p->beacon[j].symtab, g_misc_config_p->beacon[j].symbol, 
-			g_misc_config_p->beacon[j].power, g_misc_config_p->beacon[j].height, g_misc_config_p->beacon[j].gain, g_misc_config_p->beacon[j].dir,
-			coarse, (int)roundf(my_speed_knots),	
-			g_misc_config_p->beacon[j].freq, g_misc_config_p->beacon[j].tone, g_misc_config_p->beacon[j].offset,
-			g_misc_config_p->beacon[j].comment,
-			info);
-		    strcat (beacon_text, info);
-
-		    /* Remember most recent tracker beacon. */
-
-		    sb_prev_time = now;
-		    sb_prev_course = my_course;
-		    //sb_prev_speed_mph = my_speed_mph;
-
-		    /* Calculate time for next transmission. */
-	            if (g_misc_config_p->sb_configured) {
-	              g_misc_config_p->beacon[j].next = now + sb_every;
-	            }
-	            else {
-	              g_misc_config_p->beacon[j].next = now + g_misc_config_p->beacon[j].every;
-	            }
-	 	  }
-	          else {
-		    g_misc_config_p->beacon[j].next = now + 2;
-	            continue;   /* No fix.  Try again in a couple seconds. */
-		  }
-		  break;
+/*
+ * Add the info part depending on beacon type.
+ */
+	switch (g_misc_config_p->beacon[j].btype) {
+
+	  case BEACON_POSITION:
+
+	    encode_position (g_misc_config_p->beacon[j].compress, g_misc_config_p->beacon[j].lat, g_misc_config_p->beacon[j].lon,
+		  g_misc_config_p->beacon[j].symtab, g_misc_config_p->beacon[j].symbol,
+		  g_misc_config_p->beacon[j].power, g_misc_config_p->beacon[j].height, g_misc_config_p->beacon[j].gain, g_misc_config_p->beacon[j].dir,
+		  0, 0, /* course, speed */
+		  g_misc_config_p->beacon[j].freq, g_misc_config_p->beacon[j].tone, g_misc_config_p->beacon[j].offset,
+		  g_misc_config_p->beacon[j].comment,
+		  info);
+	    strcat (beacon_text, info);
+	    break;
+
+	  case BEACON_OBJECT:
+
+	    encode_object (g_misc_config_p->beacon[j].objname, g_misc_config_p->beacon[j].compress, 0, g_misc_config_p->beacon[j].lat, g_misc_config_p->beacon[j].lon,
+		  g_misc_config_p->beacon[j].symtab, g_misc_config_p->beacon[j].symbol,
+		  g_misc_config_p->beacon[j].power, g_misc_config_p->beacon[j].height, g_misc_config_p->beacon[j].gain, g_misc_config_p->beacon[j].dir,
+		  0, 0, /* course, speed */
+		  g_misc_config_p->beacon[j].freq, g_misc_config_p->beacon[j].tone, g_misc_config_p->beacon[j].offset, g_misc_config_p->beacon[j].comment,
+		  info);
+	    strcat (beacon_text, info);
+	    break;
+
+	  case BEACON_TRACKER:
+
+	    if (fix >= 2) {
+	      int coarse;		/* APRS encoder wants 1 - 360.  */
+				  /* 0 means none or unknown. */
+
+	      coarse = (int)roundf(my_course);
+	      if (coarse == 0) {
+		coarse = 360;
+	      }
+	      encode_position (g_misc_config_p->beacon[j].compress,
+		  my_lat, my_lon,
+		  g_misc_config_p->beacon[j].symtab, g_misc_config_p->beacon[j].symbol,
+		  g_misc_config_p->beacon[j].power, g_misc_config_p->beacon[j].height, g_misc_config_p->beacon[j].gain, g_misc_config_p->beacon[j].dir,
+		  coarse, (int)roundf(my_speed_knots),
+		  g_misc_config_p->beacon[j].freq, g_misc_config_p->beacon[j].tone, g_misc_config_p->beacon[j].offset,
+		  g_misc_config_p->beacon[j].comment,
+		  info);
+	      strcat (beacon_text, info);
+
+	      /* Remember most recent tracker beacon. */
+
+	      sb_prev_time = now;
+	      sb_prev_course = my_course;
+	      //sb_prev_speed_mph = my_speed_mph;
+
+	      /* Calculate time for next transmission. */
+	      if (g_misc_config_p->sb_configured) {
+		next = now + sb_every * 1000LL;
+	      }
+	    }
+	    else {
+	      return (now + 2000);   /* No fix.  Try again in a couple seconds. */
+	    }
+	    break;
 
-		case BEACON_CUSTOM:
+	  case BEACON_CUSTOM:
 
-		  if (g_misc_config_p->beacon[j].custom_info != NULL) {
-	            strcat (beacon_text, g_misc_config_p->beacon[j].custom_info);
-		  }
-		  else {
-		    text_color_set(DW_COLOR_ERROR);
-	    	    dw_printf ("Internal error. custom_info is null. %s %d\n", __FILE__, __LINE__);
-	            continue;
-	          }
-	          g_misc_config_p->beacon[j].next = now + g_misc_config_p->beacon[j].every;
-		  break;
+	    if (g_misc_config_p->beacon[j].custom_info != NULL) {
+	      strcat (beacon_text, g_misc_config_p->beacon[j].custom_info);
+	    }
+	    else {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf ("Internal error. custom_info is null. %s %d\n", __FILE__, __LINE__);
+	      return (next);
+	    }
+	    break;
 
-		case BEACON_IGNORE:		
-	        default:
-		  break;
+	  case BEACON_IGNORE:
+	  default:
+	    break;
 
-	      } /* switch beacon type. */
+	} /* switch beacon type. */
 
 /*
  * Parse monitor format into form for transmission.
- */	
-	      pp = ax25_from_text (beacon_text, strict);
+ */
+	pp = ax25_from_text (beacon_text, strict);
 
-              if (pp != NULL) {
+	if (pp != NULL) {
 
-		/* Send to IGate server or radio. */
+	  /* Send to IGate server or radio. */
 
-	        if (g_misc_config_p->beacon[j].chan == -1) {
+	  if (g_misc_config_p->beacon[j].chan == -1) {
 #if 1
-	  	  text_color_set(DW_COLOR_XMIT);
-	  	  dw_printf ("[ig] %s\n", beacon_text);
+	    text_color_set(DW_COLOR_XMIT);
+	    dw_printf ("[ig] %s\n", beacon_text);
 #endif
-		  igate_send_rec_packet (0, pp);
-		  ax25_delete (pp);
-	 	}
-		else {
-	          tq_append (g_misc_config_p->beacon[j].chan, TQ_PRIO_1_LO, pp);
-		}
-	      }
-	      else {
-	        text_color_set(DW_COLOR_ERROR);
-	        dw_printf ("Config file: Failed to parse packet constructed from line %d.\n", g_misc_config_p->beacon[j].lineno);
-	        dw_printf ("%s\n", beacon_text);
-	      }
-
-	    }  /* if time to send it */
-
-	  }  /* for each configured beacon */
+	    igate_send_rec_packet (0, pp);
+	    ax25_delete (pp);
+	  }
+	  else {
+	    tq_append (g_misc_config_p->beacon[j].chan, TQ_PRIO_1_LO, pp);
+	  }
+	}
+	else {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Config file: Failed to parse packet constructed from line %d.\n", g_misc_config_p->beacon[j].lineno);
+	  dw_printf ("%s\n", beacon_text);
+	}
 
-	}  /* do forever */
+	return (next);
 
-} /* end beacon_thread */
+} /* end beacon_send */
 
-/* end beacon.c */
+/* end beacon.c */
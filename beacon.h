@@ -2,3 +2,5 @@
 /* beacon.h */
 
 void beacon_init (struct misc_config_s *pconfig, struct digi_config_s *pdigi);
+
+void beacon_reload (struct misc_config_s *pconfig, struct digi_config_s *pdigi);
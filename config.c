@@ -54,6 +54,8 @@
 #include "igate.h"
 #include "latlong.h"
 #include "symbols.h"
+#include "pktlog.h"
+#include "pfilter.h"
 
 
 //#include "tq.h"
@@ -347,6 +349,9 @@ static int parse_interval (char *str, int line)
  *	
  *		p_misc_config	- Everything else.  This wasn't thought out well.
  *
+ * Returns:	0 for success, -1 if the file could not be opened.
+ *		Defaults are still applied in the latter case.
+ *
  * Description:	Apply default values for various parameters then read the 
  *		the configuration file which can override those values.
  *
@@ -360,7 +365,7 @@ static int parse_interval (char *str, int line)
  *--------------------------------------------------------------------*/
 
 
-void config_init (char *fname, struct audio_s *p_modem, 
+int config_init (char *fname, struct audio_s *p_modem, 
 			struct digi_config_s *p_digi_config,
 			struct tt_config_s *p_tt_config,
 			struct igate_config_s *p_igate_config,
@@ -421,6 +426,9 @@ void config_init (char *fname, struct audio_s *p_modem,
 	  p_modem->persist[channel] = DEFAULT_PERSIST;				
 	  p_modem->txdelay[channel] = DEFAULT_TXDELAY;				
 	  p_modem->txtail[channel] = DEFAULT_TXTAIL;				
+	  p_modem->maxframe[channel] = DEFAULT_MAXFRAME;
+	  p_modem->linger[channel] = DEFAULT_LINGER;
+	  p_modem->max_util[channel] = DEFAULT_MAX_UTIL;
 	}
 
 	memset (p_digi_config, 0, sizeof(struct digi_config_s));
@@ -447,11 +455,19 @@ void config_init (char *fname, struct audio_s *p_modem,
 	p_tt_config->xmit_delay[5] = 4 * 60;
 	p_tt_config->xmit_delay[6] = 8 * 60;
 
+	p_tt_config->max_users = TT_DEFAULT_MAX_USERS;
+
 	memset (p_misc_config, 0, sizeof(struct misc_config_s));
 	p_misc_config->num_channels = p_modem->num_channels;
 	p_misc_config->agwpe_port = DEFAULT_AGWPE_PORT;
 	p_misc_config->kiss_port = DEFAULT_KISS_PORT;
 	p_misc_config->enable_kiss_pt = 0;				/* -p option */
+	p_misc_config->metrics_port = 0;				/* disabled */
+	p_misc_config->mheard_port = 0;					/* disabled */
+	strcpy (p_misc_config->pktlog_dir, "");				/* disabled */
+	p_misc_config->pktlog_segment_mb = PKTLOG_DEFAULT_SEGMENT_MB;
+	p_misc_config->pktlog_max_total_mb = PKTLOG_DEFAULT_MAX_TOTAL_MB;
+	strcpy (p_misc_config->spill_file, "");				/* disabled */
 
 	/* Defaults from http://info.aprs.net/index.php?title=SmartBeaconing */
 
@@ -509,7 +525,7 @@ void config_init (char *fname, struct audio_s *p_modem,
 	  text_color_set(DW_COLOR_ERROR);
 	  dw_printf ("ERROR - Could not open config file %s\n", fname);
 	  dw_printf ("Try using -c command line option for alternate location.\n");
-	  return;
+	  return (-1);
 	}
 	
 
@@ -1076,6 +1092,80 @@ void config_init (char *fname, struct audio_s *p_modem,
    	    }
 	  }
 
+/*
+ * MAXFRAME 		- Maximum number of frames in one transmission.
+ */
+
+	  else if (strcasecmp(t, "MAXFRAME") == 0) {
+	    int n;
+	    t = strtok (NULL, " ,\t\n\r");
+	    if (t == NULL) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf ("Line %d: Missing number of frames for MAXFRAME command.\n", line);
+	      continue;
+	    }
+	    n = atoi(t);
+            if (n >= 1 && n <= MAX_MAXFRAME) {
+	      p_modem->maxframe[channel] = n;
+	    }
+	    else {
+	      p_modem->maxframe[channel] = DEFAULT_MAXFRAME;
+	      text_color_set(DW_COLOR_ERROR);
+              dw_printf ("Line %d: Invalid number of frames for MAXFRAME. Using %d.\n", 
+			line, p_modem->maxframe[channel]);
+   	    }
+	  }
+
+/*
+ * LINGER 		- Time to hold low priority frames waiting for others
+ *			  to share the same transmission.
+ */
+
+	  else if (strcasecmp(t, "LINGER") == 0) {
+	    int n;
+	    t = strtok (NULL, " ,\t\n\r");
+	    if (t == NULL) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf ("Line %d: Missing time for LINGER command.\n", line);
+	      continue;
+	    }
+	    n = atoi(t);
+            if (n >= 0 && n <= MAX_LINGER) {
+	      p_modem->linger[channel] = n;
+	    }
+	    else {
+	      p_modem->linger[channel] = DEFAULT_LINGER;
+	      text_color_set(DW_COLOR_ERROR);
+              dw_printf ("Line %d: Invalid time for LINGER. Using %d.\n", 
+			line, p_modem->linger[channel]);
+   	    }
+	  }
+
+/*
+ * MAXUTIL 		- Maximum channel utilization, percent, before holding
+ *			  back beacons, IGate, and other low priority traffic.
+ */
+
+	  else if (strcasecmp(t, "MAXUTIL") == 0) {
+	    int n;
+	    t = strtok (NULL, " ,\t\n\r");
+	    if (t == NULL) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf ("Line %d: Missing percentage for MAXUTIL command.\n", line);
+	      continue;
+	    }
+	    n = atoi(t);
+            if (n >= 0 && n <= 100) {
+	      p_modem->max_util[channel] = n;
+	    }
+	    else {
+	      p_modem->max_util[channel] = DEFAULT_MAX_UTIL;
+	      text_color_set(DW_COLOR_ERROR);
+              dw_printf ("Line %d: Invalid percentage for maximum channel utilization. Using %d.\n", 
+			line, p_modem->max_util[channel]);
+   	    }
+	  }
+
 /*
  * ==================== Digipeater parameters ==================== 
  */
@@ -1240,6 +1330,32 @@ void config_init (char *fname, struct audio_s *p_modem,
 	    //	p_tt_config->corral_lon, p_tt_config->corral_offset, p_tt_config->corral_ambiguity);
 	  }
 
+/*
+ * TTMAXUSERS 		- Maximum number of APRStt users to remember.
+ *
+ * TTMAXUSERS  n
+ */
+
+	  else if (strcasecmp(t, "TTMAXUSERS") == 0) {
+	    int n;
+	    t = strtok (NULL, " ,\t\n\r");
+	    if (t == NULL) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf ("Line %d: Missing number for TTMAXUSERS command.\n", line);
+	      continue;
+	    }
+	    n = atoi(t);
+	    if (n >= 1 && n <= 100000) {
+	      p_tt_config->max_users = n;
+	    }
+	    else {
+	      p_tt_config->max_users = TT_DEFAULT_MAX_USERS;
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf ("Line %d: Invalid number of users for TTMAXUSERS. Using %d.\n",
+			line, p_tt_config->max_users);
+	    }
+	  }
+
 /*
  * TTPOINT 		- Define a point represented by touch tone sequence.
  *
@@ -1902,6 +2018,45 @@ void config_init (char *fname, struct audio_s *p_modem,
 	    }
 	  }
 
+/*
+ * IGTXFILTER 		- Which messages from IGate server go to radio.
+ * IGCLIENTFILTER 	- Which messages from IGate server go to client applications.
+ *
+ * IGTXFILTER  filter-spec ... 
+ * IGCLIENTFILTER  filter-spec ... 
+ *
+ * Same syntax as IGFILTER but applied here rather than by the server.
+ */
+
+	  else if (strcasecmp(t, "IGTXFILTER") == 0 || strcasecmp(t, "IGCLIENTFILTER") == 0) {
+	    char **pfs;
+	    pfilter_t *pf;
+	    char errmsg[200];
+
+	    pfs = strcasecmp(t, "IGTXFILTER") == 0 ? &(p_igate_config->tx_filter) : &(p_igate_config->client_filter);
+
+	    t = strtok (NULL, "\n\r");		/* Take rest of line as one string. */
+
+	    if (t == NULL || strlen(t) == 0) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf ("Line %d: Missing filter specification.\n", line);
+	      continue;
+	    }
+
+	    pf = pfilter_compile (t, errmsg, sizeof(errmsg));
+	    if (pf == NULL) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf ("Line %d: %s\n", line, errmsg);
+	      continue;
+	    }
+	    pfilter_free (pf);
+
+	    if (*pfs != NULL) {
+	      free (*pfs);
+	    }
+	    *pfs = strdup (t);
+	  }
+
 
 /*
  * IGTXLIMIT 		- Limit transmissions during 1 and 5 minute intervals.
@@ -2001,6 +2156,112 @@ void config_init (char *fname, struct audio_s *p_modem,
    	    }
 	  }
 
+/*
+ * METRICSPORT 		- Port number for performance counters, over HTTP.
+ */
+
+	  else if (strcasecmp(t, "METRICSPORT") == 0) {
+	    int n;
+	    t = strtok (NULL, " ,\t\n\r");
+	    if (t == NULL) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf ("Line %d: Missing port number for METRICSPORT command.\n", line);
+	      continue;
+	    }
+	    n = atoi(t);
+            if (n == 0 || (n >= MIN_IP_PORT_NUMBER && n <= MAX_IP_PORT_NUMBER)) {
+	      p_misc_config->metrics_port = n;
+	    }
+	    else {
+	      p_misc_config->metrics_port = 0;
+	      text_color_set(DW_COLOR_ERROR);
+              dw_printf ("Line %d: Invalid port number for METRICSPORT.  Performance counters will not be available.\n", 
+			line);
+   	    }
+	  }
+
+/*
+ * MHEARDPORT 		- Port number for queries about stations heard.
+ */
+
+	  else if (strcasecmp(t, "MHEARDPORT") == 0) {
+	    int n;
+	    t = strtok (NULL, " ,\t\n\r");
+	    if (t == NULL) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf ("Line %d: Missing port number for MHEARDPORT command.\n", line);
+	      continue;
+	    }
+	    n = atoi(t);
+            if (n == 0 || (n >= MIN_IP_PORT_NUMBER && n <= MAX_IP_PORT_NUMBER)) {
+	      p_misc_config->mheard_port = n;
+	    }
+	    else {
+	      p_misc_config->mheard_port = 0;
+	      text_color_set(DW_COLOR_ERROR);
+              dw_printf ("Line %d: Invalid port number for MHEARDPORT.  Stations heard will not be available.\n", 
+			line);
+   	    }
+	  }
+
+/*
+ * PKTLOG 		- Binary log of received frames.
+ *
+ *	PKTLOG  directory  [ segment-size-MB  [ max-total-MB ] ]
+ */
+
+	  else if (strcasecmp(t, "PKTLOG") == 0) {
+	    t = strtok (NULL, " ,\t\n\r");
+	    if (t == NULL) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf ("Line %d: Missing directory name for PKTLOG command.\n", line);
+	      continue;
+	    }
+	    strncpy (p_misc_config->pktlog_dir, t, sizeof(p_misc_config->pktlog_dir)-1);
+
+	    t = strtok (NULL, " ,\t\n\r");
+	    if (t != NULL) {
+	      int n = atoi(t);
+              if (n >= 1 && n <= PKTLOG_MAX_SEGMENT_MB) {
+	        p_misc_config->pktlog_segment_mb = n;
+	      }
+	      else {
+	        text_color_set(DW_COLOR_ERROR);
+                dw_printf ("Line %d: PKTLOG segment size must be 1 to %d MB.  Using %d.\n", 
+			line, PKTLOG_MAX_SEGMENT_MB, p_misc_config->pktlog_segment_mb);
+	      }
+	    }
+
+	    t = strtok (NULL, " ,\t\n\r");
+	    if (t != NULL) {
+	      int n = atoi(t);
+	      if (n >= 0) {
+	        p_misc_config->pktlog_max_total_mb = n;
+	      }
+	      else {
+	        text_color_set(DW_COLOR_ERROR);
+	        dw_printf ("Line %d: PKTLOG maximum total size must be 0 (no limit) or more MB.  Using %d.\n", 
+			line, p_misc_config->pktlog_max_total_mb);
+	      }
+	    }
+	  }
+
+/*
+ * SPILLFILE 		- Save received bits which could not be fixed.
+ *
+ *	SPILLFILE  filename
+ */
+
+	  else if (strcasecmp(t, "SPILLFILE") == 0) {
+	    t = strtok (NULL, " ,\t\n\r");
+	    if (t == NULL) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf ("Line %d: Missing file name for SPILLFILE command.\n", line);
+	      continue;
+	    }
+	    strncpy (p_misc_config->spill_file, t, sizeof(p_misc_config->spill_file)-1);
+	  }
+
 /*
  * NULLMODEM		- Device name for our end of the virtual "null modem"
  */
@@ -2068,7 +2329,18 @@ void config_init (char *fname, struct audio_s *p_modem,
 		   strcasecmp(t, "TBEACON") == 0 ||
 		   strcasecmp(t, "CBEACON") == 0) {
 
-	    if (p_misc_config->num_beacons < MAX_BEACONS) {
+	    if (p_misc_config->num_beacons >= p_misc_config->max_beacons) {
+	      int n = p_misc_config->max_beacons > 0 ? 2 * p_misc_config->max_beacons : 32;
+	      struct beacon_s *p;
+
+	      p = realloc (p_misc_config->beacon, n * sizeof(struct beacon_s));
+	      if (p != NULL) {
+	        p_misc_config->beacon = p;
+	        p_misc_config->max_beacons = n;
+	      }
+	    }
+
+	    if (p_misc_config->num_beacons < p_misc_config->max_beacons) {
 
 	      memset (&(p_misc_config->beacon[p_misc_config->num_beacons]), 0, sizeof(struct beacon_s));
 	      if (strcasecmp(t, "PBEACON") == 0) {
@@ -2093,7 +2365,7 @@ void config_init (char *fname, struct audio_s *p_modem,
 	    }
 	    else {
 	      text_color_set(DW_COLOR_ERROR);
-	      dw_printf ("Config file: Maximum number of beacons exceeded on line %d.\n", line);
+	      dw_printf ("Config file: Out of memory for beacon on line %d.\n", line);
 	      continue;
 	    }
 	  }
@@ -2159,6 +2431,95 @@ void config_init (char *fname, struct audio_s *p_modem,
 	    p_misc_config->sb_configured = 1;
 	  }
 
+/*
+ * THREAD  class  [ FIFO | RR | OTHER [ priority ] ]  [ CPU n[-m] ... ]
+ *
+ * Scheduling for one class of threads, e.g.  THREAD AUDIO FIFO 70 CPU 1
+ */
+
+	  else if (strcasecmp(t, "THREAD") == 0) {
+	    int tclass;
+	    struct rtsched_s *ps;
+
+	    t = strtok (NULL, " ,\t\n\r");
+	    if (t == NULL) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf ("Line %d: Missing thread class for THREAD command.\n", line);
+	      continue;
+	    }
+	    tclass = rtsched_class_lookup (t);
+	    if (tclass < 0) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf ("Line %d: Unknown thread class '%s'.\n", line, t);
+	      dw_printf ("Use AUDIO, REDECODE, DISPATCH, XMIT, BEACON, IGATE, KISS, or AGW.\n");
+	      continue;
+	    }
+	    ps = &(p_misc_config->thread_sched[tclass]);
+
+	    t = strtok (NULL, " ,\t\n\r");
+
+	    if (t != NULL && (strcasecmp(t, "FIFO") == 0 || strcasecmp(t, "RR") == 0 || strcasecmp(t, "OTHER") == 0)) {
+
+	      if (strcasecmp(t, "FIFO") == 0) {
+	        ps->policy = RTSCHED_POLICY_FIFO;
+	      }
+	      else if (strcasecmp(t, "RR") == 0) {
+	        ps->policy = RTSCHED_POLICY_RR;
+	      }
+	      else {
+	        ps->policy = RTSCHED_POLICY_OTHER;
+	      }
+	      ps->priority = (ps->policy == RTSCHED_POLICY_OTHER) ? 0 : RTSCHED_DEFAULT_PRIORITY;
+
+	      t = strtok (NULL, " ,\t\n\r");
+	      if (t != NULL && isdigit(*t)) {
+	        int n = atoi(t);
+
+	        if (ps->policy == RTSCHED_POLICY_OTHER) {
+	          text_color_set(DW_COLOR_ERROR);
+	          dw_printf ("Line %d: Priority is ignored for OTHER.\n", line);
+	        }
+	        else if (n >= 1 && n <= RTSCHED_MAX_PRIORITY) {
+	          ps->priority = n;
+	        }
+	        else {
+	          text_color_set(DW_COLOR_ERROR);
+	          dw_printf ("Line %d: Real time priority must be in range of 1 to %d. Using %d.\n",
+			line, RTSCHED_MAX_PRIORITY, ps->priority);
+	        }
+	        t = strtok (NULL, " ,\t\n\r");
+	      }
+	    }
+
+	    if (t != NULL && strcasecmp(t, "CPU") == 0) {
+
+	      ps->cpus = 0;
+	      while ((t = strtok (NULL, " ,\t\n\r")) != NULL) {
+	        int lo, hi;
+
+	        if (sscanf (t, "%d-%d", &lo, &hi) != 2) {
+	          hi = lo = atoi(t);
+	        }
+	        if ( ! isdigit(*t) || lo < 0 || hi > 63 || lo > hi) {
+	          text_color_set(DW_COLOR_ERROR);
+	          dw_printf ("Line %d: Invalid CPU number or range '%s'.  Must be in range of 0 to 63.\n", line, t);
+	          continue;
+	        }
+	        for ( ; lo <= hi; lo++) {
+	          ps->cpus |= 1ULL << lo;
+	        }
+	      }
+	      if (ps->cpus == 0) {
+	        text_color_set(DW_COLOR_ERROR);
+	        dw_printf ("Line %d: Missing CPU list for THREAD command.\n", line);
+	      }
+	    }
+	    else if (t != NULL) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf ("Line %d: Unexpected '%s' for THREAD command.  Expected FIFO, RR, OTHER, or CPU.\n", line, t);
+	    }
+	  }
+
 /*
  * Invalid command.
  */
@@ -2201,7 +2562,7 @@ void config_init (char *fname, struct audio_s *p_modem,
 
 	      b = 0;
 	      for (k=0; k<p_misc_config->num_beacons; k++) {
-	        if (p_misc_config->beacon[p_misc_config->num_beacons].chan == j) b++;
+	        if (p_misc_config->beacon[k].chan == j) b++;
 	      }
 	      if (b == 0) {
 	        text_color_set(DW_COLOR_ERROR);
@@ -2228,6 +2589,8 @@ void config_init (char *fname, struct audio_s *p_modem,
 
 	}
 
+	return (0);
+
 } /* end config_init */
 
 
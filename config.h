@@ -17,6 +17,7 @@
 #include "digipeater.h"		/* for struct digi_config_s */
 #include "aprs_tt.h"		/* for struct tt_config_s */
 #include "igate.h"		/* for struct igate_config_s */
+#include "rtsched.h"		/* for struct rtsched_s */
 
 /*
  * All the leftovers.
@@ -25,7 +26,6 @@
 
 enum beacon_type_e { BEACON_IGNORE, BEACON_POSITION, BEACON_OBJECT, BEACON_TRACKER, BEACON_CUSTOM };
 
-#define MAX_BEACONS 30
 
 struct misc_config_s {
 
@@ -40,6 +40,24 @@ struct misc_config_s {
 	char nullmodem[40];	/* Serial port name for our end of the */
 				/* virtual null modem for native Windows apps. */
 
+	int metrics_port;	/* Port number for HTTP performance counters */
+				/* in Prometheus text format.  0 = disabled. */
+
+	int mheard_port;	/* Port number for queries about stations */
+				/* heard on the radio.  0 = disabled. */
+
+	char pktlog_dir[80];	/* Directory for binary log of received frames. */
+				/* Empty string = disabled. */
+
+	int pktlog_segment_mb;	/* Size of each log segment, in megabytes. */
+
+	int pktlog_max_total_mb; /* Oldest segments are removed to stay under */
+				/* this many megabytes.  0 = no limit. */
+
+	char spill_file[80];	/* File for saving received bits when the */
+				/* FCS is bad and they can't be fixed. */
+				/* Empty string = disabled. */
+
 	int sb_configured;	/* TRUE if SmartBeaconing is configured. */
 	int sb_fast_speed;	/* MPH */
 	int sb_fast_rate;	/* seconds */
@@ -49,9 +67,17 @@ struct misc_config_s {
 	int sb_turn_angle;	/* degrees */
 	int sb_turn_slope;	/* degrees * MPH */
 
+	struct rtsched_s thread_sched[RTSCHED_NUM_CLASSES];
+				/* Scheduling policy, priority, and CPU */
+				/* affinity for each class of thread. */
+
  			
 	int num_beacons;	/* Number of beacons defined. */
 
+	int max_beacons;	/* Number of slots allocated.  The table is */
+				/* enlarged as needed while reading the config */
+				/* file so there is no fixed limit. */
+
 	struct beacon_s {
 
 	  enum beacon_type_e btype;	/* Position or object. */
@@ -66,7 +92,6 @@ struct misc_config_s {
 				/* Remains fixed for PBEACON and OBEACON. */
 				/* Dynamically adjusted for TBEACON. */
 
-	  time_t next;		/* Unix time to transmit next one. */
 
 	  int compress;		/* Use more compact form? */
 
@@ -97,7 +122,7 @@ struct misc_config_s {
 	  char *comment;	/* Comment or NULL. */
 
 
-	} beacon[MAX_BEACONS];
+	} *beacon;
 
 };
 
@@ -115,7 +140,7 @@ struct misc_config_s {
 
 
 
-extern void config_init (char *fname, struct audio_s *p_modem, 
+extern int config_init (char *fname, struct audio_s *p_modem, 
 			struct digi_config_s *digi_config,
 			struct tt_config_s *p_tt_config,
 			struct igate_config_s *p_igate_config,
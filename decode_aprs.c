@@ -58,6 +58,8 @@ char *strsep(char **stringp, const char *delim);
 #include "textcolor.h"
 #include "symbols.h"
 #include "latlong.h"
+#include "decode_aprs.h"
+
 
 #define TRUE 1
 #define FALSE 0
@@ -96,146 +98,89 @@ typedef struct {
 	} compressed_position_t;
 
 
-static void print_decoded (void);
 
-static void aprs_ll_pos (unsigned char *, int);
-static void aprs_ll_pos_time (unsigned char *, int);
-static void aprs_raw_nmea (unsigned char *, int);
-static void aprs_mic_e (packet_t, unsigned char *, int);
+static void aprs_ll_pos (decode_aprs_t *A, unsigned char *, int);
+static void aprs_ll_pos_time (decode_aprs_t *A, unsigned char *, int);
+static void aprs_raw_nmea (decode_aprs_t *A, unsigned char *, int);
+static void aprs_mic_e (decode_aprs_t *A, packet_t, unsigned char *, int);
 //static void aprs_compressed_pos (unsigned char *, int);
-static void aprs_message (unsigned char *, int);
-static void aprs_object (unsigned char *, int);
-static void aprs_item (unsigned char *, int);
-static void aprs_station_capabilities (char *, int);
-static void aprs_status_report (char *, int);
-static void aprs_telemetry (char *, int);
-static void aprs_raw_touch_tone (char *, int);
-static void aprs_morse_code (char *, int);
-static void aprs_positionless_weather_report (unsigned char *, int);
-static void weather_data (char *wdata, int wind_prefix);
-static void aprs_ultimeter (char *, int);
-static void third_party_header (char *, int);
+static void aprs_message (decode_aprs_t *A, unsigned char *, int);
+static void aprs_object (decode_aprs_t *A, unsigned char *, int);
+static void aprs_item (decode_aprs_t *A, unsigned char *, int);
+static void aprs_station_capabilities (decode_aprs_t *A, char *, int);
+static void aprs_status_report (decode_aprs_t *A, char *, int);
+static void aprs_telemetry (decode_aprs_t *A, char *, int);
+static void aprs_raw_touch_tone (decode_aprs_t *A, char *, int);
+static void aprs_morse_code (decode_aprs_t *A, char *, int);
+static void aprs_positionless_weather_report (decode_aprs_t *A, unsigned char *, int);
+static void weather_data (decode_aprs_t *A, char *wdata, int wind_prefix);
+static void aprs_ultimeter (decode_aprs_t *A, char *, int);
+static void third_party_header (decode_aprs_t *A, char *, int);
 
 
-static void decode_position (position_t *ppos);
-static void decode_compressed_position (compressed_position_t *ppos);
+static void decode_position (decode_aprs_t *A, position_t *ppos);
+static void decode_compressed_position (decode_aprs_t *A, compressed_position_t *ppos);
 
-static double get_latitude_8 (char *p);
-static double get_longitude_9 (char *p);
+static double get_latitude_8 (char *p, int quiet);
+static double get_longitude_9 (char *p, int quiet);
 
-static double get_latitude_nmea (char *pstr, char *phemi);
-static double get_longitude_nmea (char *pstr, char *phemi);
+static double get_latitude_nmea (char *pstr, char *phemi, int quiet);
+static double get_longitude_nmea (char *pstr, char *phemi, int quiet);
 
 static time_t get_timestamp (char *p);
-static int get_maidenhead (char *p);
+static int get_maidenhead (char *p, int quiet);
 
-static int data_extension_comment (char *pdext);
-static void decode_tocall (char *dest);
+static int data_extension_comment (decode_aprs_t *A, char *pdext);
+static void decode_tocall (decode_aprs_t *A, char *dest);
 //static void get_symbol (char dti, char *src, char *dest);
-static void process_comment (char *pstart, int clen);
+static void process_comment (decode_aprs_t *A, char *pstart, int clen);
 
 
 /*
- * Information extracted from the message.
+ * Information extracted from the message is kept in a
+ * decode_aprs_t, defined in decode_aprs.h, supplied by the caller.
  */
 
-/* for unknown values. */
-
-//#define G_UNKNOWN -999999
-
-
-static char g_msg_type[30];		/* Message type. */
-
-static char g_symbol_table;		/* The Symbol Table Identifier character selects one */
-					/* of the two Symbol Tables, or it may be used as */
-					/* single-character (alpha or numeric) overlay, as follows: */
-					
-					/*	/ 	Primary Symbol Table (mostly stations) */
-
-					/* 	\ 	Alternate Symbol Table (mostly Objects) */
-
-					/*	0-9 	Numeric overlay. Symbol from Alternate Symbol */
-					/*		Table (uncompressed lat/long data format) */
-
-					/*	a-j	Numeric overlay. Symbol from Alternate */
-					/*		Symbol Table (compressed lat/long data */
-					/*		format only). i.e. a-j maps to 0-9 */
-
-					/*	A-Z	Alpha overlay. Symbol from Alternate Symbol Table */
-
-
-static char g_symbol_code;		/* Where the Symbol Table Identifier is 0-9 or A-Z (or a-j */
-					/* with compressed position data only), the symbol comes from */
-					/* the Alternate Symbol Table, and is overlaid with the */
-					/* identifier (as a single digit or a capital letter). */
-
-static double g_lat, g_lon;		/* Location, degrees.  Negative for South or West. */
-					/* Set to G_UNKNOWN if missing or error. */
-
-static char g_maidenhead[9];		/* 4 or 6 (or 8?) character maidenhead locator. */
-
-static char g_name[20];			/* Object or item name. */
-
-static float g_speed;			/* Speed in MPH.  */
-
-static float g_course;			/* 0 = North, 90 = East, etc. */
-	
-static int g_power;			/* Transmitter power in watts. */
-
-static int g_height;			/* Antenna height above average terrain, feet. */
-
-static int g_gain;			/* Antenna gain in dB. */
-
-static char g_directivity[10];		/* Direction of max signal strength */
-
-static float g_range;			/* Precomputed radio range in miles. */
-
-static float g_altitude;		/* Feet above median sea level.  */
-
-static char g_mfr[80];			/* Manufacturer or application. */
-
-static char g_mic_e_status[30];		/* MIC-E message. */
-
-static char g_freq[40];			/* Frequency, tone, xmit offset */
-
-static char g_comment[256];		/* Comment. */
-
 /*------------------------------------------------------------------
  *
  * Function:	decode_aprs
  *
- * Purpose:	Optionally print packet then decode it.
+ * Purpose:	Extract the information from an APRS packet.
  *
- * Inputs:	src	- Source Station.
+ * Inputs:	pp	- Packet.  The parts used are:
  *
+ *			  Source Station.
  *			  The SSID is used as a last resort for the
  *			  displayed symbol if not specified in any other way.
  *
- *		dest	- Destination Station.
- *
+ *			  Destination Station.
  *			  Certain destinations (GPSxxx, SPCxxx, SYMxxx) can
  *			  be used to specify the display symbol.
  *			  For the MIC-E format (used by Kenwood D7, D700), the
  *			  "destination" is really the latitude.
  *
- *		pinfo 	- pointer to information field.
- *		info_len - length of the information field.
+ *			  Information field.
  *
- * Outputs:	Variables above:
+ *		quiet	- Don't print error messages for malformed packets.
+ *			  Use when decoding for some purpose other than
+ *			  showing the packet to the user.
  *
- *			g_symbol_table, g_symbol_code,
- *			g_lat, g_lon, 
- *			g_speed, g_course, g_altitude,
- *			g_comment
- *			... and others...
+ * Outputs:	A	- Everything extracted from the packet:
  *
- *		Other functions are then called to retrieve the information.
+ *			A->g_symbol_table, A->g_symbol_code,
+ *			A->g_lat, A->g_lon, 
+ *			A->g_speed, A->g_course, A->g_altitude,
+ *			A->g_comment
+ *			... and others...
  *
- * Bug:		This is not thread-safe because it uses static data and strtok.
+ * Description:	Nothing is printed, other than error messages, and no
+ *		static data is modified so different threads can decode
+ *		at the same time, each with its own decode_aprs_t.
+ *		Use decode_aprs_print to display the result.
  *
  *------------------------------------------------------------------*/
 
-void decode_aprs (packet_t pp)
+void decode_aprs (decode_aprs_t *A, packet_t pp, int quiet)
 {
 	//int naddr;
 	//int err;
@@ -248,30 +193,34 @@ void decode_aprs (packet_t pp)
 
   	info_len = ax25_get_info (pp, &pinfo);
 
-	sprintf (g_msg_type, "Unknown message type %c", *pinfo);
+	memset (A, 0, sizeof(*A));
+	A->g_quiet = quiet;
+
+	sprintf (A->g_msg_type, "Unknown message type %c", *pinfo);
 
-	g_symbol_table = '/';
-	g_symbol_code = ' ';		/* What should we have for default? */
 
-	g_lat = G_UNKNOWN;
-	g_lon = G_UNKNOWN;
-	strcpy (g_maidenhead, "");
+	A->g_symbol_table = '/';
+	A->g_symbol_code = ' ';		/* What should we have for default? */
 
-	strcpy (g_name, "");
-	g_speed = G_UNKNOWN;
-	g_course = G_UNKNOWN;
+	A->g_lat = G_UNKNOWN;
+	A->g_lon = G_UNKNOWN;
+	strcpy (A->g_maidenhead, "");
 
-	g_power = G_UNKNOWN;
-	g_height = G_UNKNOWN;
-	g_gain = G_UNKNOWN;
-	strcpy (g_directivity, "");
+	strcpy (A->g_name, "");
+	A->g_speed = G_UNKNOWN;
+	A->g_course = G_UNKNOWN;
 
-	g_range = G_UNKNOWN;
-	g_altitude = G_UNKNOWN;
-	strcpy(g_mfr, "");
-	strcpy(g_mic_e_status, "");
-	strcpy(g_freq, "");
-	strcpy (g_comment, "");
+	A->g_power = G_UNKNOWN;
+	A->g_height = G_UNKNOWN;
+	A->g_gain = G_UNKNOWN;
+	strcpy (A->g_directivity, "");
+
+	A->g_range = G_UNKNOWN;
+	A->g_altitude = G_UNKNOWN;
+	strcpy(A->g_mfr, "");
+	strcpy(A->g_mic_e_status, "");
+	strcpy(A->g_freq, "");
+	strcpy (A->g_comment, "");
 
 /*
  * Extract source and destination including the SSID.
@@ -290,11 +239,11 @@ void decode_aprs (packet_t pp)
 
 	      if (strncmp((char*)pinfo, "!!", 2) == 0)
 	      {
-		aprs_ultimeter ((char*)pinfo, info_len);
+		aprs_ultimeter (A, (char*)pinfo, info_len);
 	      }
 	      else
 	      {	     
-	        aprs_ll_pos (pinfo, info_len);
+	        aprs_ll_pos (A, pinfo, info_len);
 	      }
 	      break;
 
@@ -307,72 +256,72 @@ void decode_aprs (packet_t pp)
 		
 	      if (strncmp((char*)pinfo, "$ULTW", 5) == 0)
 	      {
-		aprs_ultimeter ((char*)pinfo, info_len);
+		aprs_ultimeter (A, (char*)pinfo, info_len);
 	      }
 	      else
 	      {
-	        aprs_raw_nmea (pinfo, info_len);
+	        aprs_raw_nmea (A, pinfo, info_len);
 	      }
 	      break;
 
 	    case '\'':		/* Old Mic-E Data (but Current data for TM-D700) */
 	    case '`':		/* Current Mic-E Data (not used in TM-D700) */
 
-	      aprs_mic_e (pp, pinfo, info_len);
+	      aprs_mic_e (A, pp, pinfo, info_len);
 	      break;
 
 	    case ')':		/* Item. */
 
-	      aprs_item (pinfo, info_len);
+	      aprs_item (A, pinfo, info_len);
 	      break;
 		
 	    case '/':		/* Position with timestamp (no APRS messaging) */
 	    case '@':		/* Position with timestamp (with APRS messaging) */
 
-	      aprs_ll_pos_time (pinfo, info_len);
+	      aprs_ll_pos_time (A, pinfo, info_len);
 	      break;
 
 
 	    case ':':		/* Message */
 
-	      aprs_message (pinfo, info_len);
+	      aprs_message (A, pinfo, info_len);
 	      break;
 
 	    case ';':		/* Object */
 
-	      aprs_object (pinfo, info_len);
+	      aprs_object (A, pinfo, info_len);
 	      break;
 
 	    case '<':		/* Station Capabilities */
 
-	      aprs_station_capabilities ((char*)pinfo, info_len);
+	      aprs_station_capabilities (A, (char*)pinfo, info_len);
 	      break;
 
 	    case '>':		/* Status Report */
 
-	      aprs_status_report ((char*)pinfo, info_len);
+	      aprs_status_report (A, (char*)pinfo, info_len);
 	      break;
 
 	    //case '?':		/* Query */
 	      //break;
 		
 	    case 'T':		/* Telemetry */
-	      aprs_telemetry ((char*)pinfo, info_len);
+	      aprs_telemetry (A, (char*)pinfo, info_len);
 	      break;
 
 	    case '_':		/* Positionless Weather Report */
 
-	      aprs_positionless_weather_report (pinfo, info_len);
+	      aprs_positionless_weather_report (A, pinfo, info_len);
 	      break;
 
 	    case '{':		/* user defined data */
 				/* http://www.aprs.org/aprs11/expfmts.txt */
 
 	      if (strncmp((char*)pinfo, "{tt", 3) == 0) {
-	        aprs_raw_touch_tone (pinfo, info_len);
+	        aprs_raw_touch_tone (A, (char*)pinfo, info_len);
 	      }
 	      else if (strncmp((char*)pinfo, "{mc", 3) == 0) {
-	        aprs_morse_code ((char*)pinfo, info_len);
+	        aprs_morse_code (A, (char*)pinfo, info_len);
 	      }
 	      else {
 	        //aprs_user_defined (pinfo, info_len);
@@ -384,7 +333,7 @@ void decode_aprs (packet_t pp)
 				/* to an application that might want to interpret them. */
 				/* Might move into user defined data, above. */
 
-	      aprs_raw_touch_tone ((char*)pinfo, info_len);
+	      aprs_raw_touch_tone (A, (char*)pinfo, info_len);
 	      break;
 
 	    case 'm':		/* Morse Code data - NOT PART OF STANDARD */
@@ -393,12 +342,12 @@ void decode_aprs (packet_t pp)
 				/* other uses such as CW ID for station. */
 				/* Might move into user defined data, above. */
 
-	      aprs_morse_code ((char*)pinfo, info_len);
+	      aprs_morse_code (A, (char*)pinfo, info_len);
 	      break;
 
 	    case '}':		/* third party header */
 
-	      third_party_header ((char*)pinfo, info_len);
+	      third_party_header (A, (char*)pinfo, info_len);
 	      break;
 
 
@@ -417,9 +366,9 @@ void decode_aprs (packet_t pp)
  * Look in other locations if not found in information field.
  */
 
-	if (g_symbol_table == ' ' || g_symbol_code == ' ') {
+	if (A->g_symbol_table == ' ' || A->g_symbol_code == ' ') {
 
-	  symbols_from_dest_or_src (*pinfo, src, dest, &g_symbol_table, &g_symbol_code);
+	  symbols_from_dest_or_src (*pinfo, src, dest, &A->g_symbol_table, &A->g_symbol_code);
 	}
 
 /*
@@ -434,21 +383,58 @@ void decode_aprs (packet_t pp)
 	    break;
 
 	  default:
-	    decode_tocall (dest);
+	    decode_tocall (A, dest);
 	    break;
 	}
-	
+
 /*
- * Print it all out in human readable format.
+ * Convert Maidenhead locator to latitude and longitude.
+ * 
+ * Any example was checked for each hemihemisphere using
+ * http://www.amsat.org/cgi-bin/gridconv
+ *
+ * Bug: This does not check for invalid values.
  */
-	print_decoded ();
+
+	if (strlen(A->g_maidenhead) > 0 && A->g_lat == G_UNKNOWN && A->g_lon == G_UNKNOWN) {
+
+	  A->g_lon = (toupper(A->g_maidenhead[0]) - 'A') * 20 - 180;
+	  A->g_lat = (toupper(A->g_maidenhead[1]) - 'A') * 10 - 90;
+
+	  A->g_lon += (A->g_maidenhead[2] - '0') * 2;
+	  A->g_lat += (A->g_maidenhead[3] - '0');
+
+	  if (strlen(A->g_maidenhead) >=6) {
+	    A->g_lon += (toupper(A->g_maidenhead[4]) - 'A') * 5.0 / 60.0;
+	    A->g_lat += (toupper(A->g_maidenhead[5]) - 'A') * 2.5 / 60.0;
+
+	    A->g_lon += 2.5 / 60.0;	/* Move from corner to center of square */
+	    A->g_lat += 1.25 / 60.0;
+	  }
+	  else {
+	    A->g_lon += 1.0;	/* Move from corner to center of square */
+	    A->g_lat += 0.5;
+	  }
+	}
 }
 
 
-static void print_decoded (void) {
+
+/*------------------------------------------------------------------
+ *
+ * Function:	decode_aprs_print
+ *
+ * Purpose:	Print the information extracted by decode_aprs
+ *		in human readable format.
+ *
+ * Inputs:	A	- Result from decode_aprs.  Not modified.
+ *
+ *------------------------------------------------------------------*/
+
+void decode_aprs_print (const decode_aprs_t *A) {
+
 
 	char stemp[200];
-	char tmp2[2];
 	double absll;
 	char news;
 	int deg;
@@ -457,6 +443,7 @@ static void print_decoded (void) {
 	char s_lon[30];
 	int n;
 	char symbol_description[100];
+	char comment[sizeof(A->g_comment)];
 
 /*
  * First line has:
@@ -467,40 +454,40 @@ static void print_decoded (void) {
  * - mic-e status
  * - power/height/gain, range
  */
-	strcpy (stemp, g_msg_type);
+	strcpy (stemp, A->g_msg_type);
 
-	if (strlen(g_name) > 0) {
+	if (strlen(A->g_name) > 0) {
 	  strcat (stemp, ", \"");
-	  strcat (stemp, g_name);
+	  strcat (stemp, A->g_name);
 	  strcat (stemp, "\"");
 	}
 
-	symbols_get_description (g_symbol_table, g_symbol_code, symbol_description);	
+	symbols_get_description (A->g_symbol_table, A->g_symbol_code, symbol_description);	
 	strcat (stemp, ", ");
 	strcat (stemp, symbol_description);
 
-	if (strlen(g_mfr) > 0) {
+	if (strlen(A->g_mfr) > 0) {
 	  strcat (stemp, ", ");
-	  strcat (stemp, g_mfr);
+	  strcat (stemp, A->g_mfr);
 	}
 
-	if (strlen(g_mic_e_status) > 0) {
+	if (strlen(A->g_mic_e_status) > 0) {
 	  strcat (stemp, ", ");
-	  strcat (stemp, g_mic_e_status);
+	  strcat (stemp, A->g_mic_e_status);
 	}
 
 
-	if (g_power > 0) {
+	if (A->g_power > 0) {
 	  char phg[100];
 
-	  sprintf (phg, ", %d W height=%d %ddBi %s", g_power, g_height, g_gain, g_directivity);
+	  sprintf (phg, ", %d W height=%d %ddBi %s", A->g_power, A->g_height, A->g_gain, A->g_directivity);
 	  strcat (stemp, phg);
 	}
 
-	if (g_range > 0) {
+	if (A->g_range > 0) {
 	  char rng[100];
 
-	  sprintf (rng, ", range=%.1f", g_range);
+	  sprintf (rng, ", range=%.1f", A->g_range);
 	  strcat (stemp, rng);
 	}
 	text_color_set(DW_COLOR_DECODED);
@@ -518,53 +505,28 @@ static void print_decoded (void) {
 
 
 /*
- * Convert Maidenhead locator to latitude and longitude.
- * 
- * Any example was checked for each hemihemisphere using
- * http://www.amsat.org/cgi-bin/gridconv
- *
- * Bug: This does not check for invalid values.
+ * Maidenhead locator was converted to latitude and longitude
+ * by decode_aprs if no other location was available.
  */
 
-	if (strlen(g_maidenhead) > 0) {
-	  dw_printf("Grid square = %s, ", g_maidenhead);
-
-	  if (g_lat == G_UNKNOWN && g_lon == G_UNKNOWN) {
-	
-	    g_lon = (toupper(g_maidenhead[0]) - 'A') * 20 - 180;
-	    g_lat = (toupper(g_maidenhead[1]) - 'A') * 10 - 90;
-
-	    g_lon += (g_maidenhead[2] - '0') * 2;
-	    g_lat += (g_maidenhead[3] - '0');
-
-	    if (strlen(g_maidenhead) >=6) {
-	      g_lon += (toupper(g_maidenhead[4]) - 'A') * 5.0 / 60.0;
-	      g_lat += (toupper(g_maidenhead[5]) - 'A') * 2.5 / 60.0;
-
-	      g_lon += 2.5 / 60.0;	/* Move from corner to center of square */
-	      g_lat += 1.25 / 60.0;
-	    }
-	    else {
-	      g_lon += 1.0;	/* Move from corner to center of square */
-	      g_lat += 0.5;
-	    }
-	  }
+	if (strlen(A->g_maidenhead) > 0) {
+	  dw_printf("Grid square = %s, ", A->g_maidenhead);
 	}
 
 	strcpy (stemp, "");
 
-	if (g_lat != G_UNKNOWN || g_lon != G_UNKNOWN) {
+	if (A->g_lat != G_UNKNOWN || A->g_lon != G_UNKNOWN) {
 
 // Have location but it is posible one part is invalid.
 
-	  if (g_lat != G_UNKNOWN) {
+	  if (A->g_lat != G_UNKNOWN) {
   
-	    if (g_lat >= 0) {
-	      absll = g_lat;
+	    if (A->g_lat >= 0) {
+	      absll = A->g_lat;
 	      news = 'N';
 	    }
 	    else {
-	      absll = - g_lat;
+	      absll = - A->g_lat;
 	      news = 'S';
 	    }
 	    deg = (int) absll;
@@ -575,14 +537,14 @@ static void print_decoded (void) {
 	    strcpy (s_lat, "Invalid Latitude");
 	  }
 
-	  if (g_lon != G_UNKNOWN) {
+	  if (A->g_lon != G_UNKNOWN) {
 
-	    if (g_lon >= 0) {
-	      absll = g_lon;
+	    if (A->g_lon >= 0) {
+	      absll = A->g_lon;
 	      news = 'E';
 	    }
 	    else {
-	      absll = - g_lon;
+	      absll = - A->g_lon;
 	      news = 'W';
 	    }
 	    deg = (int) absll;
@@ -596,33 +558,33 @@ static void print_decoded (void) {
 	  sprintf (stemp, "%s, %s", s_lat, s_lon);
 	}
 
-	if (g_speed != G_UNKNOWN) {
+	if (A->g_speed != G_UNKNOWN) {
 	  char spd[20];
 
 	  if (strlen(stemp) > 0) strcat (stemp, ", ");
-	  sprintf (spd, "%.0f MPH", g_speed);
+	  sprintf (spd, "%.0f MPH", A->g_speed);
 	  strcat (stemp, spd);
 	};
 
-	if (g_course != G_UNKNOWN) {
+	if (A->g_course != G_UNKNOWN) {
 	  char cse[20];
 
 	  if (strlen(stemp) > 0) strcat (stemp, ", ");
-	  sprintf (cse, "course %.0f", g_course);
+	  sprintf (cse, "course %.0f", A->g_course);
 	  strcat (stemp, cse);
 	};
 
-	if (g_altitude != G_UNKNOWN) {
+	if (A->g_altitude != G_UNKNOWN) {
 	  char alt[20];
 
 	  if (strlen(stemp) > 0) strcat (stemp, ", ");
-	  sprintf (alt, "alt %.0f ft", g_altitude);
+	  sprintf (alt, "alt %.0f ft", A->g_altitude);
 	  strcat (stemp, alt);
 	};
 
-	if (strlen(g_freq) > 0) {
+	if (strlen(A->g_freq) > 0) {
 	  strcat (stemp, ", ");
-	  strcat (stemp, g_freq);
+	  strcat (stemp, A->g_freq);
 	}
 
 
@@ -642,19 +604,20 @@ static void print_decoded (void) {
  * Drop annoying trailing CR LF.  Anyone who cares can see it in the raw data.
  */
 
-	n = strlen(g_comment);
-	if (n >= 1 && g_comment[n-1] == '\n') {
-	  g_comment[n-1] = '\0';
+	strcpy (comment, A->g_comment);
+	n = strlen(comment);
+	if (n >= 1 && comment[n-1] == '\n') {
+	  comment[n-1] = '\0';
 	  n--;
 	}
-	if (n >= 1 && g_comment[n-1] == '\r') {
-	  g_comment[n-1] = '\0';
+	if (n >= 1 && comment[n-1] == '\r') {
+	  comment[n-1] = '\0';
 	  n--;
 	}
 	if (n > 0) {
 	  int j;
 
-	  ax25_safe_print (g_comment, -1, 0);
+	  ax25_safe_print (comment, -1, 0);
 	  dw_printf("\n");
 
 /*
@@ -665,14 +628,14 @@ static void print_decoded (void) {
  * To be part of a valid UTF-8 sequence, it would need to be followed by 10xxxxxx.
  */
 	  for (j=0; j<n; j++) {
-	    if ((unsigned)g_comment[j] == (char)0xb0 &&  (j == 0 || ! (g_comment[j-1] & 0x80))) {
+	    if ((unsigned)A->g_comment[j] == (char)0xb0 &&  (j == 0 || ! (A->g_comment[j-1] & 0x80))) {
 	      text_color_set(DW_COLOR_ERROR);
 	      dw_printf("Character code 0xb0 is probably an attempt at a degree symbol.\n");
 	      dw_printf("The correct encoding is 0xc2 0xb0 in UTF-8.\n");
 	    }	    	
 	  }
 	  for (j=0; j<n; j++) {
-	    if ((unsigned)g_comment[j] == (char)0xf8 && (j == n-1 || (g_comment[j+1] & 0xc0) != 0xc0)) {
+	    if ((unsigned)A->g_comment[j] == (char)0xf8 && (j == n-1 || (A->g_comment[j+1] & 0xc0) != 0xc0)) {
 	      text_color_set(DW_COLOR_ERROR);
 	      dw_printf("Character code 0xf8 is probably an attempt at a degree symbol.\n");
 	      dw_printf("The correct encoding is 0xc2 0xb0 in UTF-8.\n");	    	
@@ -694,7 +657,7 @@ static void print_decoded (void) {
  * Inputs:	info 	- Pointer to Information field.
  *		ilen 	- Information field length.
  *
- * Outputs:	g_lat, g_lon, g_symbol_table, g_symbol_code, g_speed, g_course, g_altitude.
+ * Outputs:	A->g_lat, A->g_lon, A->g_symbol_table, A->g_symbol_code, A->g_speed, A->g_course, A->g_altitude.
  *
  * Description:	Type identifier '=' has APRS messaging.
  *		Type identifier '!' does not have APRS messaging.
@@ -713,7 +676,7 @@ static void print_decoded (void) {
  *
  *------------------------------------------------------------------*/
 
-static void aprs_ll_pos (unsigned char *info, int ilen) 
+static void aprs_ll_pos (decode_aprs_t *A, unsigned char *info, int ilen) 
 {
 
 	struct aprs_ll_pos_s {
@@ -729,46 +692,46 @@ static void aprs_ll_pos (unsigned char *info, int ilen)
 	} *q;
 
 
-	strcpy (g_msg_type, "Position");
+	strcpy (A->g_msg_type, "Position");
 
 	p = (struct aprs_ll_pos_s *)info;
 	q = (struct aprs_compressed_pos_s *)info;
 	
 	if (isdigit((unsigned char)(p->pos.lat[0]))) 	/* Human-readable location. */
         {
-	  decode_position (&(p->pos));
+	  decode_position (A, &(p->pos));
 
-	  if (g_symbol_code == '_') {
+	  if (A->g_symbol_code == '_') {
 	    /* Symbol code indidates it is a weather report. */
 	    /* In this case, we expect 7 byte "data extension" */
 	    /* for the wind direction and speed. */
 
-	    strcpy (g_msg_type, "Weather Report");
-	    weather_data (p->comment, TRUE);
+	    strcpy (A->g_msg_type, "Weather Report");
+	    weather_data (A, p->comment, TRUE);
 	  } 
 	  else {
 	    /* Regular position report. */
 
-	    data_extension_comment (p->comment);
+	    data_extension_comment (A, p->comment);
 	  }
 	}
 	else					/* Compressed location. */
 	{
-	  decode_compressed_position (&(q->cpos));
+	  decode_compressed_position (A, &(q->cpos));
 
-	  if (g_symbol_code == '_') {
+	  if (A->g_symbol_code == '_') {
 	    /* Symbol code indidates it is a weather report. */
 	    /* In this case, the wind direction and speed are in the */
 	    /* compressed data so we don't expect a 7 byte "data */
 	    /* extension" for them. */
 
-	    strcpy (g_msg_type, "Weather Report");
-	    weather_data (q->comment, FALSE);
+	    strcpy (A->g_msg_type, "Weather Report");
+	    weather_data (A, q->comment, FALSE);
 	  } 
 	  else {
 	    /* Regular position report. */
 
-	    process_comment (q->comment, -1);
+	    process_comment (A, q->comment, -1);
 	  }
 	}
 
@@ -790,7 +753,7 @@ static void aprs_ll_pos (unsigned char *info, int ilen)
  * Inputs:	info 	- Pointer to Information field.
  *		ilen 	- Information field length.
  *
- * Outputs:	g_lat, g_lon, g_symbol_table, g_symbol_code, g_speed, g_course, g_altitude.
+ * Outputs:	A->g_lat, A->g_lon, A->g_symbol_table, A->g_symbol_code, A->g_speed, A->g_course, A->g_altitude.
  *
  * Description:	Type identifier '@' has APRS messaging.
  *		Type identifier '/' does not have APRS messaging.
@@ -814,7 +777,7 @@ static void aprs_ll_pos (unsigned char *info, int ilen)
 
 
 
-static void aprs_ll_pos_time (unsigned char *info, int ilen) 
+static void aprs_ll_pos_time (decode_aprs_t *A, unsigned char *info, int ilen) 
 {
 
 	struct aprs_ll_pos_time_s {
@@ -832,9 +795,7 @@ static void aprs_ll_pos_time (unsigned char *info, int ilen)
 	} *q;
 
 
-	strcpy (g_msg_type, "Position with time");
-
-	time_t ts = 0;
+	strcpy (A->g_msg_type, "Position with time");
 
 
 	p = (struct aprs_ll_pos_time_s *)info;
@@ -843,42 +804,42 @@ static void aprs_ll_pos_time (unsigned char *info, int ilen)
 
 	if (isdigit((unsigned char)(p->pos.lat[0]))) 		/* Human-readable location. */
         {
-	  ts = get_timestamp (p->time_stamp);
-	  decode_position (&(p->pos));
+	  A->g_timestamp = get_timestamp (p->time_stamp);
+	  decode_position (A, &(p->pos));
 
-	  if (g_symbol_code == '_') {
+	  if (A->g_symbol_code == '_') {
 	    /* Symbol code indidates it is a weather report. */
 	    /* In this case, we expect 7 byte "data extension" */
 	    /* for the wind direction and speed. */
 
-	    strcpy (g_msg_type, "Weather Report");
-	    weather_data (p->comment, TRUE);
+	    strcpy (A->g_msg_type, "Weather Report");
+	    weather_data (A, p->comment, TRUE);
 	  } 
 	  else {
 	    /* Regular position report. */
 
-	    data_extension_comment (p->comment);
+	    data_extension_comment (A, p->comment);
 	  }
 	}
 	else					/* Compressed location. */
 	{
-	  ts = get_timestamp (p->time_stamp);
+	  A->g_timestamp = get_timestamp (p->time_stamp);
 
-	  decode_compressed_position (&(q->cpos));
+	  decode_compressed_position (A, &(q->cpos));
 
-	  if (g_symbol_code == '_') {
+	  if (A->g_symbol_code == '_') {
 	    /* Symbol code indidates it is a weather report. */
 	    /* In this case, the wind direction and speed are in the */
 	    /* compressed data so we don't expect a 7 byte "data */
 	    /* extension" for them. */
 
-	    strcpy (g_msg_type, "Weather Report");
-	    weather_data (q->comment, FALSE);
+	    strcpy (A->g_msg_type, "Weather Report");
+	    weather_data (A, q->comment, FALSE);
 	  } 
 	  else {
 	    /* Regular position report. */
 
-	    process_comment (q->comment, -1);
+	    process_comment (A, q->comment, -1);
 	  }
 	}
 
@@ -915,10 +876,9 @@ static void aprs_ll_pos_time (unsigned char *info, int ilen)
  *
  *------------------------------------------------------------------*/
 
-static void nmea_checksum (char *sent)
+static void nmea_checksum (char *sent, int quiet)
 {
         char *p;
-        char *next;
         unsigned char cs;
 
 
@@ -931,70 +891,69 @@ static void nmea_checksum (char *sent)
 
         p = strchr (sent, '*');
         if (p == NULL) {
-	  text_color_set (DW_COLOR_INFO);
-          dw_printf("Missing GPS checksum.\n");
+	  if ( ! quiet) {
+	    text_color_set (DW_COLOR_INFO);
+	    dw_printf("Missing GPS checksum.\n");
+	  }
           return;
         }
         if (cs != strtoul(p+1, NULL, 16)) {
-	  text_color_set (DW_COLOR_ERROR);
-          dw_printf("GPS checksum error. Expected %02x but found %s.\n", cs, p+1);
+	  if ( ! quiet) {
+	    text_color_set (DW_COLOR_ERROR);
+	    dw_printf("GPS checksum error. Expected %02x but found %s.\n", cs, p+1);
+	  }
           return;
         }
         *p = '\0';      // Remove the checksum.
 }
 
-static void aprs_raw_nmea (unsigned char *info, int ilen) 
+static void aprs_raw_nmea (decode_aprs_t *A, unsigned char *info, int ilen) 
 {
 	char stemp[256];
 	char *ptype;
 	char *next;
 
 
-	strcpy (g_msg_type, "Raw NMEA");
+	strcpy (A->g_msg_type, "Raw NMEA");
 
 	strncpy (stemp, (char *)info, ilen);
 	stemp[ilen] = '\0';
-	nmea_checksum (stemp);
+	nmea_checksum (stemp, A->g_quiet);
 
 	next = stemp;
 	ptype = strsep(&next, ",");
 
 	if (strcmp(ptype, "$GPGGA") == 0) 
 	{
-	  char *ptime;			/* Time, hhmmss[.sss] */
 	  char *plat;			/* Latitude */
 	  char *pns;			/* North/South */
 	  char *plon;			/* Longitude */
 	  char *pew;			/* East/West */
-	  char *pquality;		/* Fix Quality: 0=invalid, 1=GPS, 2=DGPS */
-	  char *pnsat;			/* Number of satellites. */
-	  char *phdop;			/* Horizontal dilution of precision. */
 	  char *paltitude;		/* Altitude, meters above mean sea level. */
-   	  char *pm;			/* "M" = meters */
 					/* Various other stuff... */
 
 
-	  ptime = strsep(&next, ",");	
+	  strsep(&next, ",");		/* Time, hhmmss[.sss] */
 	  plat = strsep(&next, ",");
 	  pns = strsep(&next, ",");
 	  plon = strsep(&next, ",");
 	  pew = strsep(&next, ",");
-	  pquality = strsep(&next, ",");
-	  pnsat = strsep(&next, ",");
-	  phdop = strsep(&next, ",");
+	  strsep(&next, ",");		/* Fix Quality: 0=invalid, 1=GPS, 2=DGPS */
+	  strsep(&next, ",");		/* Number of satellites. */
+	  strsep(&next, ",");		/* Horizontal dilution of precision. */
 	  paltitude = strsep(&next, ",");
-	  pm = strsep(&next, ",");
+					/* "M" = meters */
 
 	  /* Process time??? */
 
 	  if (plat != NULL && strlen(plat) > 0) {
-	    g_lat = get_latitude_nmea(plat, pns);
+	    A->g_lat = get_latitude_nmea(plat, pns, A->g_quiet);
 	  }
 	  if (plon != NULL && strlen(plon) > 0) {
-	    g_lon = get_longitude_nmea(plon, pew);
+	    A->g_lon = get_longitude_nmea(plon, pew, A->g_quiet);
 	  }
 	  if (paltitude != NULL && strlen(paltitude) > 0) {
-	    g_altitude = METERS_TO_FEET(atof(paltitude));
+	    A->g_altitude = METERS_TO_FEET(atof(paltitude));
 	  }
 	}
 	else if (strcmp(ptype, "$GPGLL") == 0)
@@ -1012,10 +971,10 @@ static void aprs_raw_nmea (unsigned char *info, int ilen)
 	  pew = strsep(&next, ",");
 
 	  if (plat != NULL && strlen(plat) > 0) {
-	    g_lat = get_latitude_nmea(plat, pns);
+	    A->g_lat = get_latitude_nmea(plat, pns, A->g_quiet);
 	  }
 	  if (plon != NULL && strlen(plon) > 0) {
-	    g_lon = get_longitude_nmea(plon, pew);
+	    A->g_lon = get_longitude_nmea(plon, pew, A->g_quiet);
 	  }
 
 	}
@@ -1023,42 +982,39 @@ static void aprs_raw_nmea (unsigned char *info, int ilen)
 	{
 	  //char *ptime, *pstatus, *plat, *pns, *plon, *pew, *pspeed, *ptrack, *pdate;
 
-	  char *ptime;			/* Time, hhmmss[.sss] */
-	  char *pstatus;		/* Status, A=Active (valid position), V=Void */
 	  char *plat;			/* Latitude */
 	  char *pns;			/* North/South */
 	  char *plon;			/* Longitude */
 	  char *pew;			/* East/West */
 	  char *pknots;			/* Speed over ground, knots. */
 	  char *pcourse;		/* True course, degrees. */
-	  char *pdate;			/* Date, ddmmyy */
+					/* Date, ddmmyy */
 					/* Magnetic variation */
 					/* In version 3.00, mode is added: A D E N (see below) */
 					/* Checksum */
 
-	  ptime = strsep(&next, ",");
-	  pstatus = strsep(&next, ",");	
+	  strsep(&next, ",");		/* Time, hhmmss[.sss] */
+	  strsep(&next, ",");		/* Status, A=Active (valid position), V=Void */
 	  plat = strsep(&next, ",");
 	  pns = strsep(&next, ",");
 	  plon = strsep(&next, ",");
 	  pew = strsep(&next, ",");
 	  pknots = strsep(&next, ",");
 	  pcourse = strsep(&next, ",");
-	  pdate = strsep(&next, ",");	
 
 	  /* process time ??? date ??? */
 
 	  if (plat != NULL && strlen(plat) > 0) {
-	    g_lat = get_latitude_nmea(plat, pns);
+	    A->g_lat = get_latitude_nmea(plat, pns, A->g_quiet);
 	  }
 	  if (plon != NULL && strlen(plon) > 0) {
-	    g_lon = get_longitude_nmea(plon, pew);
+	    A->g_lon = get_longitude_nmea(plon, pew, A->g_quiet);
 	  }
 	  if (pknots != NULL && strlen(pknots) > 0) {
-	    g_speed = KNOTS_TO_MPH(atof(pknots));
+	    A->g_speed = KNOTS_TO_MPH(atof(pknots));
 	  }
 	  if (pcourse != NULL && strlen(pcourse) > 0) {
-	    g_course = atof(pcourse);
+	    A->g_course = atof(pcourse);
 	  }
 	}
 	else if (strcmp(ptype, "$GPVTG") == 0)
@@ -1067,31 +1023,24 @@ static void aprs_raw_nmea (unsigned char *info, int ilen)
 	  /* Speed and direction but NO location! */
 
 	  char *ptcourse;		/* True course, degrees. */
-	  char *pt;			/* "T" */
-	  char *pmcourse;		/* Magnetic course, degrees. */
-	  char *pm;			/* "M" */
 	  char *pknots;			/* Ground speed, knots. */
-	  char *pn;			/* "N" = Knots */
-	  char *pkmh;			/* Ground speed, km/hr */
-	  char *pk;			/* "K" = Kilometers per hour */
-	  char *pmode;			/* New in NMEA 0183 version 3.0 */
+					/* "N" = Knots */
+					/* Ground speed, km/hr */
+					/* "K" = Kilometers per hour */
+					/* New in NMEA 0183 version 3.0 */
 					/* Mode: A=Autonomous, D=Differential, */
 	
 	  ptcourse = strsep(&next, ",");
-	  pt = strsep(&next, ",");
-	  pmcourse = strsep(&next, ",");
-	  pm = strsep(&next, ",");
+	  strsep(&next, ",");		/* "T" */
+	  strsep(&next, ",");		/* Magnetic course, degrees. */
+	  strsep(&next, ",");		/* "M" */
 	  pknots = strsep(&next, ",");
-	  pn = strsep(&next, ",");
-	  pkmh = strsep(&next, ",");
-	  pk = strsep(&next, ",");
-	  pmode	 = strsep(&next, ",");	
 
 	  if (pknots != NULL && strlen(pknots) > 0) {
-	    g_speed = KNOTS_TO_MPH(atof(pknots));
+	    A->g_speed = KNOTS_TO_MPH(atof(pknots));
 	  }
 	  if (ptcourse != NULL && strlen(ptcourse) > 0) {
-	    g_course = atof(ptcourse);
+	    A->g_course = atof(ptcourse);
 	  }
 
 	}
@@ -1103,20 +1052,19 @@ static void aprs_raw_nmea (unsigned char *info, int ilen)
 	  char *pns;			/* North/South */
 	  char *plon;			/* Longitude */
 	  char *pew;			/* East/West */
-	  char *pident;			/* Identifier for Waypoint.  rules??? */
+					/* Identifier for Waypoint.  rules??? */
 					/* checksum */
 
 	  plat = strsep(&next, ",");
 	  pns = strsep(&next, ",");
 	  plon = strsep(&next, ",");
 	  pew = strsep(&next, ",");
-	  pident = strsep(&next, ",");
 
 	  if (plat != NULL && strlen(plat) > 0) {
-	    g_lat = get_latitude_nmea(plat, pns);
+	    A->g_lat = get_latitude_nmea(plat, pns, A->g_quiet);
 	  }
 	  if (plon != NULL && strlen(plon) > 0) {
-	    g_lon = get_longitude_nmea(plon, pew);
+	    A->g_lon = get_longitude_nmea(plon, pew, A->g_quiet);
 	  }
 
 	  /* do something with identifier? */
@@ -1168,7 +1116,7 @@ static void aprs_raw_nmea (unsigned char *info, int ilen)
  *
  *------------------------------------------------------------------*/
 
-static int mic_e_digit (char c, int mask, int *std_msg, int *cust_msg)
+static int mic_e_digit (char c, int mask, int *std_msg, int *cust_msg, int quiet)
 {
 
  	if (c >= '0' && c <= '9') {
@@ -1203,14 +1151,16 @@ static int mic_e_digit (char c, int mask, int *std_msg, int *cust_msg)
 	  return (0);
 	}
 
-	text_color_set(DW_COLOR_ERROR);
-	dw_printf("Invalid character \"%c\" in MIC-E destination/latitude.\n", c);
+	if ( ! quiet) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf("Invalid character \"%c\" in MIC-E destination/latitude.\n", c);
+	}
 
 	return (0);
 }
 
 
-static void aprs_mic_e (packet_t pp, unsigned char *info, int ilen) 
+static void aprs_mic_e (decode_aprs_t *A, packet_t pp, unsigned char *info, int ilen) 
 {
 	struct aprs_mic_e_s {
 	  char dti;			/* ' or ` */
@@ -1230,7 +1180,7 @@ static void aprs_mic_e (packet_t pp, unsigned char *info, int ilen)
 	const char *cust_text[8] = {"Emergency", "Custom-6", "Custom-5", "Custom-4", "Custom-3", "Custom-2", "Custom-1", "Custom-0" }; 
 	unsigned char *pfirst, *plast;
 
-	strcpy (g_msg_type, "MIC-E");
+	strcpy (A->g_msg_type, "MIC-E");
 
 	p = (struct aprs_mic_e_s *)info;
 
@@ -1239,19 +1189,19 @@ static void aprs_mic_e (packet_t pp, unsigned char *info, int ilen)
 
 	ax25_get_addr_with_ssid (pp, AX25_DESTINATION, dest);
 
-	g_lat = mic_e_digit(dest[0], 4, &std_msg, &cust_msg) * 10 + 
-		mic_e_digit(dest[1], 2, &std_msg, &cust_msg) +
-		(mic_e_digit(dest[2], 1, &std_msg, &cust_msg) * 1000 + 
-		 mic_e_digit(dest[3], 0, &std_msg, &cust_msg) * 100 + 
-		 mic_e_digit(dest[4], 0, &std_msg, &cust_msg) * 10 + 
-		 mic_e_digit(dest[5], 0, &std_msg, &cust_msg)) / 6000.0;
+	A->g_lat = mic_e_digit(dest[0], 4, &std_msg, &cust_msg, A->g_quiet) * 10 + 
+		mic_e_digit(dest[1], 2, &std_msg, &cust_msg, A->g_quiet) +
+		(mic_e_digit(dest[2], 1, &std_msg, &cust_msg, A->g_quiet) * 1000 + 
+		 mic_e_digit(dest[3], 0, &std_msg, &cust_msg, A->g_quiet) * 100 + 
+		 mic_e_digit(dest[4], 0, &std_msg, &cust_msg, A->g_quiet) * 10 + 
+		 mic_e_digit(dest[5], 0, &std_msg, &cust_msg, A->g_quiet)) / 6000.0;
 
 
 /* 4th character of desination indicates north / south. */
 
 	if ((dest[3] >= '0' && dest[3] <= '9') || dest[3] == 'L') {
 	  /* South */
-	  g_lat = ( - g_lat);
+	  A->g_lat = ( - A->g_lat);
 	}
 	else if (dest[3] >= 'P' && dest[3] <= 'Z') 
 	{
@@ -1259,8 +1209,10 @@ static void aprs_mic_e (packet_t pp, unsigned char *info, int ilen)
 	}
 	else 
 	{
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Invalid MIC-E N/S encoding in 4th character of destination.\n");	  
+	  if ( ! A->g_quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Invalid MIC-E N/S encoding in 4th character of destination.\n");	  
+	  }
 	}
 
 
@@ -1278,8 +1230,10 @@ static void aprs_mic_e (packet_t pp, unsigned char *info, int ilen)
 	else 
 	{
 	  offset = 0;
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Invalid MIC-E Longitude Offset in 5th character of destination.\n");
+	  if ( ! A->g_quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Invalid MIC-E Longitude Offset in 5th character of destination.\n");
+	  }
 	}
 
 /* First character of information field is longitude in degrees. */
@@ -1292,25 +1246,27 @@ static void aprs_mic_e (packet_t pp, unsigned char *info, int ilen)
 
 	if (offset && ch >= 118 && ch <= 127) 
 	{
-	    g_lon = ch - 118;			/* 0 - 9 degrees */
+	    A->g_lon = ch - 118;			/* 0 - 9 degrees */
 	}
 	else if ( ! offset && ch >= 38 && ch <= 127)
 	{
-	    g_lon = (ch - 38) + 10;		/* 10 - 99 degrees */
+	    A->g_lon = (ch - 38) + 10;		/* 10 - 99 degrees */
 	}
 	else if (offset && ch >= 108 && ch <= 117)
 	{
-	    g_lon = (ch - 108) + 100;		/* 100 - 109 degrees */
+	    A->g_lon = (ch - 108) + 100;		/* 100 - 109 degrees */
 	}
 	else if (offset && ch >= 38 && ch <= 107)
 	{
-	    g_lon = (ch - 38) + 110;		/* 110 - 179 degrees */
+	    A->g_lon = (ch - 38) + 110;		/* 110 - 179 degrees */
 	}
 	else 
 	{
-	    g_lon = G_UNKNOWN;
-	    text_color_set(DW_COLOR_ERROR);
-	    dw_printf("Invalid character 0x%02x for MIC-E Longitude Degrees.\n", ch);
+	    A->g_lon = G_UNKNOWN;
+	    if ( ! A->g_quiet) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf("Invalid character 0x%02x for MIC-E Longitude Degrees.\n", ch);
+	    }
 	}
 
 /* Second character of information field is g_longitude minutes. */
@@ -1330,40 +1286,44 @@ static void aprs_mic_e (packet_t pp, unsigned char *info, int ilen)
  * or anything else to corrupt the message.
  */
 
-	if (g_lon != G_UNKNOWN) 
+	if (A->g_lon != G_UNKNOWN) 
 	{
 	  ch = p->lon[1];
 
 	  if (ch >= 88 && ch <= 97)
 	  {
-	    g_lon += (ch - 88) / 60.0;	/* 0 - 9 minutes*/
+	    A->g_lon += (ch - 88) / 60.0;	/* 0 - 9 minutes*/
 	  }
 	  else if (ch >= 38 && ch <= 87)
 	  {
-    	    g_lon += ((ch - 38) + 10) / 60.0;	/* 10 - 59 minutes */
+    	    A->g_lon += ((ch - 38) + 10) / 60.0;	/* 10 - 59 minutes */
 	  }
 	  else {
-	    g_lon = G_UNKNOWN;
-	    text_color_set(DW_COLOR_ERROR);
-	    dw_printf("Invalid character 0x%02x for MIC-E Longitude Minutes.\n", ch);
+	    A->g_lon = G_UNKNOWN;
+	    if ( ! A->g_quiet) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf("Invalid character 0x%02x for MIC-E Longitude Minutes.\n", ch);
+	    }
 	  }
 
 /* Third character of information field is longitude hundredths of minutes. */
 /* There are 100 possible values, from 0 to 99. */
 /* Note that the range includes 4 unprintable control characters and DEL. */
 
-	  if (g_lon != G_UNKNOWN) 
+	  if (A->g_lon != G_UNKNOWN) 
 	  {
 	    ch = p->lon[2];
 
 	    if (ch >= 28 && ch <= 127) 
 	    {
-	      g_lon += ((ch - 28) + 0) / 6000.0;	/* 0 - 99 hundredths of minutes*/
+	      A->g_lon += ((ch - 28) + 0) / 6000.0;	/* 0 - 99 hundredths of minutes*/
 	    }
 	    else {
-	      g_lon = G_UNKNOWN;
-	      text_color_set(DW_COLOR_ERROR);
-	      dw_printf("Invalid character 0x%02x for MIC-E Longitude hundredths of Minutes.\n", ch);
+	      A->g_lon = G_UNKNOWN;
+	      if ( ! A->g_quiet) {
+		text_color_set(DW_COLOR_ERROR);
+		dw_printf("Invalid character 0x%02x for MIC-E Longitude hundredths of Minutes.\n", ch);
+	      }
 	    }
 	  }
 	}
@@ -1376,42 +1336,46 @@ static void aprs_mic_e (packet_t pp, unsigned char *info, int ilen)
 	else if (dest[5] >= 'P' && dest[5] <= 'Z') 
 	{
 	  /* West */
-	  if (g_lon != G_UNKNOWN) {
-	    g_lon = ( - g_lon);
+	  if (A->g_lon != G_UNKNOWN) {
+	    A->g_lon = ( - A->g_lon);
 	  }
 	}
 	else 
 	{
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Invalid MIC-E E/W encoding in 6th character of destination.\n");	  
+	  if ( ! A->g_quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Invalid MIC-E E/W encoding in 6th character of destination.\n");	  
+	  }
 	}
 
 /* Symbol table and codes like everyone else. */
 
-	g_symbol_table = p->sym_table_id;
-	g_symbol_code = p->symbol_code;
+	A->g_symbol_table = p->sym_table_id;
+	A->g_symbol_code = p->symbol_code;
 
-	if (g_symbol_table != '/' && g_symbol_table != '\\' 
-		&& ! isupper(g_symbol_table) && ! isdigit(g_symbol_table))
+	if (A->g_symbol_table != '/' && A->g_symbol_table != '\\' 
+		&& ! isupper(A->g_symbol_table) && ! isdigit(A->g_symbol_table))
 	{
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Invalid symbol table code not one of / \\ A-Z 0-9\n");	
-	  g_symbol_table = '/';
+	  if ( ! A->g_quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Invalid symbol table code not one of / \\ A-Z 0-9\n");	
+	  }
+	  A->g_symbol_table = '/';
 	}
 
 /* Message type from two 3-bit codes. */
 
 	if (std_msg == 0 && cust_msg == 0) {
-	  strcpy (g_mic_e_status, "Emergency");
+	  strcpy (A->g_mic_e_status, "Emergency");
 	}
 	else if (std_msg == 0 && cust_msg != 0) {
-	  strcpy (g_mic_e_status, cust_text[cust_msg]);
+	  strcpy (A->g_mic_e_status, cust_text[cust_msg]);
 	}
 	else if (std_msg != 0 && cust_msg == 0) {
-	  strcpy (g_mic_e_status, std_text[std_msg]);
+	  strcpy (A->g_mic_e_status, std_text[std_msg]);
 	}
 	else {
-	  strcpy (g_mic_e_status, "Unknown MIC-E Message Type");
+	  strcpy (A->g_mic_e_status, "Unknown MIC-E Message Type");
 	}
 
 /* Speed and course from next 3 bytes. */
@@ -1419,7 +1383,7 @@ static void aprs_mic_e (packet_t pp, unsigned char *info, int ilen)
 	n = ((p->speed_course[0] - 28) * 10) + ((p->speed_course[1] - 28) / 10);
 	if (n >= 800) n -= 800;
 
-	g_speed = KNOTS_TO_MPH(n); 
+	A->g_speed = KNOTS_TO_MPH(n); 
 
 	n = ((p->speed_course[1] - 28) % 10) * 100 + (p->speed_course[2] - 28);
 	if (n >= 400) n -= 400;
@@ -1428,11 +1392,11 @@ static void aprs_mic_e (packet_t pp, unsigned char *info, int ilen)
 	/* Convert to 0 - 360 and reserved value for unknown. */
 
 	if (n == 0) 
-	  g_course = G_UNKNOWN;
+	  A->g_course = G_UNKNOWN;
 	else if (n == 360)
-	  g_course = 0;
+	  A->g_course = 0;
 	else
-	  g_course = n;
+	  A->g_course = n;
 
 
 /* Now try to pick out manufacturer and other optional items. */
@@ -1448,27 +1412,27 @@ static void aprs_mic_e (packet_t pp, unsigned char *info, int ilen)
 
 	if (*pfirst == ' ' || *pfirst == '>' || *pfirst == ']' || *pfirst == '`' || *pfirst == '\'') {
 	
-	  if (*pfirst == ' ') { strcpy (g_mfr, "Original MIC-E"); pfirst++; }
+	  if (*pfirst == ' ') { strcpy (A->g_mfr, "Original MIC-E"); pfirst++; }
 
-	  else if (*pfirst == '>' && *plast == '=') { strcpy (g_mfr, "Kenwood TH-D72"); pfirst++; plast--; }
-	  else if (*pfirst == '>') { strcpy (g_mfr, "Kenwood TH-D7A"); pfirst++; }
+	  else if (*pfirst == '>' && *plast == '=') { strcpy (A->g_mfr, "Kenwood TH-D72"); pfirst++; plast--; }
+	  else if (*pfirst == '>') { strcpy (A->g_mfr, "Kenwood TH-D7A"); pfirst++; }
 
-	  else if (*pfirst == ']' && *plast == '=') { strcpy (g_mfr, "Kenwood TM-D710"); pfirst++; plast--; }
-	  else if (*pfirst == ']') { strcpy (g_mfr, "Kenwood TM-D700"); pfirst++; }
+	  else if (*pfirst == ']' && *plast == '=') { strcpy (A->g_mfr, "Kenwood TM-D710"); pfirst++; plast--; }
+	  else if (*pfirst == ']') { strcpy (A->g_mfr, "Kenwood TM-D700"); pfirst++; }
 
-	  else if (*pfirst == '`' && *(plast-1) == '_' && *plast == ' ') { strcpy (g_mfr, "Yaesu VX-8"); pfirst++; plast-=2; }
-	  else if (*pfirst == '`' && *(plast-1) == '_' && *plast == '"') { strcpy (g_mfr, "Yaesu FTM-350"); pfirst++; plast-=2; }
-	  else if (*pfirst == '`' && *(plast-1) == '_' && *plast == '#') { strcpy (g_mfr, "Yaesu VX-8G"); pfirst++; plast-=2; }
-	  else if (*pfirst == '\'' && *(plast-1) == '|' && *plast == '3') { strcpy (g_mfr, "Byonics TinyTrack3"); pfirst++; plast-=2; }
-	  else if (*pfirst == '\'' && *(plast-1) == '|' && *plast == '4') { strcpy (g_mfr, "Byonics TinyTrack4"); pfirst++; plast-=2; }
+	  else if (*pfirst == '`' && *(plast-1) == '_' && *plast == ' ') { strcpy (A->g_mfr, "Yaesu VX-8"); pfirst++; plast-=2; }
+	  else if (*pfirst == '`' && *(plast-1) == '_' && *plast == '"') { strcpy (A->g_mfr, "Yaesu FTM-350"); pfirst++; plast-=2; }
+	  else if (*pfirst == '`' && *(plast-1) == '_' && *plast == '#') { strcpy (A->g_mfr, "Yaesu VX-8G"); pfirst++; plast-=2; }
+	  else if (*pfirst == '\'' && *(plast-1) == '|' && *plast == '3') { strcpy (A->g_mfr, "Byonics TinyTrack3"); pfirst++; plast-=2; }
+	  else if (*pfirst == '\'' && *(plast-1) == '|' && *plast == '4') { strcpy (A->g_mfr, "Byonics TinyTrack4"); pfirst++; plast-=2; }
 
-	  else if (*(plast-1) == '\\') { strcpy (g_mfr, "Hamhud ?"); pfirst++; plast-=2; }
-	  else if (*(plast-1) == '/') { strcpy (g_mfr, "Argent ?"); pfirst++; plast-=2; }
-	  else if (*(plast-1) == '^') { strcpy (g_mfr, "HinzTec anyfrog"); pfirst++; plast-=2; }
-	  else if (*(plast-1) == '~') { strcpy (g_mfr, "OTHER"); pfirst++; plast-=2; }
+	  else if (*(plast-1) == '\\') { strcpy (A->g_mfr, "Hamhud ?"); pfirst++; plast-=2; }
+	  else if (*(plast-1) == '/') { strcpy (A->g_mfr, "Argent ?"); pfirst++; plast-=2; }
+	  else if (*(plast-1) == '^') { strcpy (A->g_mfr, "HinzTec anyfrog"); pfirst++; plast-=2; }
+	  else if (*(plast-1) == '~') { strcpy (A->g_mfr, "OTHER"); pfirst++; plast-=2; }
 
-	  else if (*pfirst == '`') { strcpy (g_mfr, "Mic-Emsg"); pfirst++; plast-=2; }
-	  else if (*pfirst == '\'') { strcpy (g_mfr, "McTrackr"); pfirst++; plast-=2; }
+	  else if (*pfirst == '`') { strcpy (A->g_mfr, "Mic-Emsg"); pfirst++; plast-=2; }
+	  else if (*pfirst == '\'') { strcpy (A->g_mfr, "McTrackr"); pfirst++; plast-=2; }
 	}
 
 /*
@@ -1494,22 +1458,24 @@ static void aprs_mic_e (packet_t pp, unsigned char *info, int ilen)
 
 	if (plast > pfirst && pfirst[3] == '}') {
 
-	  g_altitude = METERS_TO_FEET((pfirst[0]-33)*91*91 + (pfirst[1]-33)*91 + (pfirst[2]-33) - 10000);
+	  A->g_altitude = METERS_TO_FEET((pfirst[0]-33)*91*91 + (pfirst[1]-33)*91 + (pfirst[2]-33) - 10000);
 
 	  if (pfirst[0] < '!' || pfirst[0] > '{' ||
 	      pfirst[1] < '!' || pfirst[1] > '{' ||
 	      pfirst[2] < '!' || pfirst[2] > '{' ) 
 	  {
-	    text_color_set(DW_COLOR_ERROR);
-	    dw_printf("Invalid character in MIC-E altitude.  Must be in range of '!' to '{'.\n");
-	    dw_printf("Bogus altitude of %.0f changed to unknown.\n", g_altitude);
-	    g_altitude = G_UNKNOWN;
+	    if ( ! A->g_quiet) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf("Invalid character in MIC-E altitude.  Must be in range of '!' to '{'.\n");
+	      dw_printf("Bogus altitude of %.0f changed to unknown.\n", A->g_altitude);
+	    }
+	    A->g_altitude = G_UNKNOWN;
 	  }
 	  
 	  pfirst += 4;
 	}
 
-	process_comment ((char*)pfirst, (int)(plast - pfirst) + 1);
+	process_comment (A, (char*)pfirst, (int)(plast - pfirst) + 1);
 
 }
 
@@ -1537,7 +1503,7 @@ static void aprs_mic_e (packet_t pp, unsigned char *info, int ilen)
  *
  *------------------------------------------------------------------*/
 
-static void aprs_message (unsigned char *info, int ilen) 
+static void aprs_message (decode_aprs_t *A, unsigned char *info, int ilen) 
 {
 
 	struct aprs_message_s {
@@ -1551,11 +1517,11 @@ static void aprs_message (unsigned char *info, int ilen)
 
 	p = (struct aprs_message_s *)info;
 
-	sprintf (g_msg_type, "APRS Message for \"%9.9s\"", p->addressee);
+	sprintf (A->g_msg_type, "APRS Message for \"%9.9s\"", p->addressee);
 
 	/* No location so don't use  process_comment () */
 
-	strcpy (g_comment, p->message);
+	strcpy (A->g_comment, p->message);
 
 }
 
@@ -1570,7 +1536,7 @@ static void aprs_message (unsigned char *info, int ilen)
  * Inputs:	info 	- Pointer to Information field.
  *		ilen 	- Information field length.
  *
- * Outputs:	g_object_name, g_lat, g_lon, g_symbol_table, g_symbol_code, g_speed, g_course, g_altitude.
+ * Outputs:	g_object_name, A->g_lat, A->g_lon, A->g_symbol_table, A->g_symbol_code, A->g_speed, A->g_course, A->g_altitude.
  *
  * Description:	Message has a 9 character object name which could be quite different than
  *		the source station.
@@ -1585,7 +1551,7 @@ static void aprs_message (unsigned char *info, int ilen)
  *
  *------------------------------------------------------------------*/
 
-static void aprs_object (unsigned char *info, int ilen) 
+static void aprs_object (decode_aprs_t *A, unsigned char *info, int ilen) 
 {
 
 	struct aprs_object_s {
@@ -1607,64 +1573,63 @@ static void aprs_object (unsigned char *info, int ilen)
 	} *q;
 
 
-	time_t ts = 0;
 	int i;
 
 
 	p = (struct aprs_object_s *)info;
 	q = (struct aprs_compressed_object_s *)info;
 
-	strncpy (g_name, p->name, 9);
-	g_name[9] = '\0';
-	i = strlen(g_name) - 1;
-	while (i >= 0 && g_name[i] == ' ') {
-	  g_name[i--] = '\0';
+	strncpy (A->g_name, p->name, 9);
+	A->g_name[9] = '\0';
+	i = strlen(A->g_name) - 1;
+	while (i >= 0 && A->g_name[i] == ' ') {
+	  A->g_name[i--] = '\0';
 	}
 
 	if (p->live_killed == '*')
-	  strcpy (g_msg_type, "Object");
+	  strcpy (A->g_msg_type, "Object");
 	else if (p->live_killed == '_')
-	  strcpy (g_msg_type, "Killed Object");
+	  strcpy (A->g_msg_type, "Killed Object");
 	else
-	  strcpy (g_msg_type, "Object - invalid live/killed");
+	  strcpy (A->g_msg_type, "Object - invalid live/killed");
 
-	ts = get_timestamp (p->time_stamp);
+	A->g_timestamp = get_timestamp (p->time_stamp);
 
 	if (isdigit((unsigned char)(p->pos.lat[0]))) 	/* Human-readable location. */
         {
-	  decode_position (&(p->pos));
+	  decode_position (A, &(p->pos));
 
-	  if (g_symbol_code == '_') {
+	  if (A->g_symbol_code == '_') {
 	    /* Symbol code indidates it is a weather report. */
 	    /* In this case, we expect 7 byte "data extension" */
 	    /* for the wind direction and speed. */
 
-	    strcpy (g_msg_type, "Weather Report with Object");
-	    weather_data (p->comment, TRUE);
+	    strcpy (A->g_msg_type, "Weather Report with Object");
+	    weather_data (A, p->comment, TRUE);
 	  } 
 	  else {
 	    /* Regular object. */
 
-	    data_extension_comment (p->comment);
+	    data_extension_comment (A, p->comment);
 	  }
 	}
 	else					/* Compressed location. */
 	{
-	  decode_compressed_position (&(q->cpos));
+	  decode_compressed_position (A, &(q->cpos));
 
-	  if (g_symbol_code == '_') {
+	  if (A->g_symbol_code == '_') {
 	    /* Symbol code indidates it is a weather report. */
 	    /* The spec doesn't explicitly mention the combination */
 	    /* of weather report and object with compressed */
 	    /* position. */
 
-	    strcpy (g_msg_type, "Weather Report with Object");
-	    weather_data (q->comment, FALSE);
+	    strcpy (A->g_msg_type, "Weather Report with Object");
+	    weather_data (A, q->comment, FALSE);
 	  } 
 	  else {
 	    /* Regular position report. */
 
-	    process_comment (q->comment, -1);
+	    process_comment (A, q->comment, -1);
 	  }
 	}
 
@@ -1680,7 +1645,7 @@ static void aprs_object (unsigned char *info, int ilen)
  * Inputs:	info 	- Pointer to Information field.
  *		ilen 	- Information field length.
  *
- * Outputs:	g_object_name, g_lat, g_lon, g_symbol_table, g_symbol_code, g_speed, g_course, g_altitude.
+ * Outputs:	g_object_name, A->g_lat, A->g_lon, A->g_symbol_table, A->g_symbol_code, A->g_speed, A->g_course, A->g_altitude.
  *
  * Description:	An "item" is very much like an "object" except 
  *
@@ -1692,7 +1657,7 @@ static void aprs_object (unsigned char *info, int ilen)
  *
  *------------------------------------------------------------------*/
 
-static void aprs_item (unsigned char *info, int ilen) 
+static void aprs_item (decode_aprs_t *A, unsigned char *info, int ilen) 
 {
 
 	struct aprs_item_s {
@@ -1709,47 +1674,47 @@ static void aprs_item (unsigned char *info, int ilen)
 	  char live_killed;		/* ! for live or _ for killed */
 	  compressed_position_t cpos;
 	  char comment[40]; 		/* No data extension in this case. */
-	} *q;
+	};
 
 
-	time_t ts = 0;
 	int i;
 	char *ppos;
 
 
 	p = (struct aprs_item_s *)info;
-	q = (struct aprs_compressed_item_s *)info;
 
 	i = 0;
 	while (i < 9 && p->name[i] != '!' && p->name[i] != '_') {
-	  g_name[i] = p->name[i];
+	  A->g_name[i] = p->name[i];
 	  i++;
-	  g_name[i] = '\0';
+	  A->g_name[i] = '\0';
 	}
 
 	if (p->name[i] == '!')
-	  strcpy (g_msg_type, "Item");
+	  strcpy (A->g_msg_type, "Item");
 	else if (p->name[i] == '_')
-	  strcpy (g_msg_type, "Killed Item");
+	  strcpy (A->g_msg_type, "Killed Item");
 	else {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Item name too long or not followed by ! or _.\n");
-	  strcpy (g_msg_type, "Object - invalid live/killed");
+	  if ( ! A->g_quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Item name too long or not followed by ! or _.\n");
+	  }
+	  strcpy (A->g_msg_type, "Object - invalid live/killed");
 	}
 
 	ppos = p->name + i + 1;
  
 	if (isdigit(*ppos)) 		/* Human-readable location. */
         {
-	  decode_position ((position_t*) ppos);
+	  decode_position (A, (position_t*) ppos);
 
-	  data_extension_comment (ppos + sizeof(position_t));
+	  data_extension_comment (A, ppos + sizeof(position_t));
 	}
 	else					/* Compressed location. */
 	{
-	  decode_compressed_position ((compressed_position_t*)ppos);
+	  decode_compressed_position (A, (compressed_position_t*)ppos);
 
-	  process_comment (ppos + sizeof(compressed_position_t), -1);
+	  process_comment (A, ppos + sizeof(compressed_position_t), -1);
 	}
 
 }
@@ -1775,14 +1740,14 @@ static void aprs_item (unsigned char *info, int ilen)
  *
  *------------------------------------------------------------------*/
 
-static void aprs_station_capabilities (char *info, int ilen) 
+static void aprs_station_capabilities (decode_aprs_t *A, char *info, int ilen) 
 {
 
-	strcpy (g_msg_type, "Station Capabilities");
+	strcpy (A->g_msg_type, "Station Capabilities");
 
 	// 	Is process_comment() applicable?
 
-	strcpy (g_comment, info+1);
+	strcpy (A->g_comment, info+1);
 }
 
 
@@ -1831,7 +1796,7 @@ static void aprs_station_capabilities (char *info, int ilen)
  *	
  *------------------------------------------------------------------*/
 
-static void aprs_status_report (char *info, int ilen) 
+static void aprs_status_report (decode_aprs_t *A, char *info, int ilen) 
 {
 	struct aprs_status_time_s {
 	  char dti;			/* > */
@@ -1863,7 +1828,7 @@ static void aprs_status_report (char *info, int ilen)
 	} *ps;
 
 
-	strcpy (g_msg_type, "Status Report");
+	strcpy (A->g_msg_type, "Status Report");
 
 	pt = (struct aprs_status_time_s *)info;
 	pm4 = (struct aprs_status_m4_s *)info;
@@ -1881,68 +1846,76 @@ static void aprs_status_report (char *info, int ilen)
 	    isdigit(pt->ztime[5]) &&
 	    pt->ztime[6] == 'z') {
 
-	  strcpy (g_comment, pt->comment);
+	  strcpy (A->g_comment, pt->comment);
 	}
 
 /*
  * Do we have format with 6 character Maidenhead locator?
  */
-	else if (get_maidenhead (pm6->mhead6) == 6) {
+	else if (get_maidenhead (pm6->mhead6, A->g_quiet) == 6) {
 
-	  strncpy (g_maidenhead, pm6->mhead6, 6);
-	  g_maidenhead[6] = '\0';
+	  strncpy (A->g_maidenhead, pm6->mhead6, 6);
+	  A->g_maidenhead[6] = '\0';
 
-	  g_symbol_table = pm6->sym_table_id;
-	  g_symbol_code = pm6->symbol_code;
+	  A->g_symbol_table = pm6->sym_table_id;
+	  A->g_symbol_code = pm6->symbol_code;
 
-	  if (g_symbol_table != '/' && g_symbol_table != '\\' 
-		&& ! isupper(g_symbol_table) && ! isdigit(g_symbol_table))
+	  if (A->g_symbol_table != '/' && A->g_symbol_table != '\\' 
+		&& ! isupper(A->g_symbol_table) && ! isdigit(A->g_symbol_table))
 	  {
-	    text_color_set(DW_COLOR_ERROR);
-	    dw_printf("Invalid symbol table code '%c' not one of / \\ A-Z 0-9\n", g_symbol_table);	
-	    g_symbol_table = '/';
+	    if ( ! A->g_quiet) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf("Invalid symbol table code '%c' not one of / \\ A-Z 0-9\n", A->g_symbol_table);	
+	    }
+	    A->g_symbol_table = '/';
 	  }
 
 	  if (pm6->space != ' ' && pm6->space != '\0') {
-	    text_color_set(DW_COLOR_ERROR);
-	    dw_printf("Error: Found '%c' instead of space required after symbol code.\n", pm6->space);	
+	    if ( ! A->g_quiet) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf("Error: Found '%c' instead of space required after symbol code.\n", pm6->space);	
+	    }
 	  }
 
-	  strcpy (g_comment, pm6->comment);
+	  strcpy (A->g_comment, pm6->comment);
 	}
 
 /*
  * Do we have format with 4 character Maidenhead locator?
  */
-	else if (get_maidenhead (pm4->mhead4) == 4) {
+	else if (get_maidenhead (pm4->mhead4, A->g_quiet) == 4) {
 
-	  strncpy (g_maidenhead, pm4->mhead4, 4);
-	  g_maidenhead[4] = '\0';
+	  strncpy (A->g_maidenhead, pm4->mhead4, 4);
+	  A->g_maidenhead[4] = '\0';
 
-	  g_symbol_table = pm4->sym_table_id;
-	  g_symbol_code = pm4->symbol_code;
+	  A->g_symbol_table = pm4->sym_table_id;
+	  A->g_symbol_code = pm4->symbol_code;
 
-	  if (g_symbol_table != '/' && g_symbol_table != '\\' 
-		&& ! isupper(g_symbol_table) && ! isdigit(g_symbol_table))
+	  if (A->g_symbol_table != '/' && A->g_symbol_table != '\\' 
+		&& ! isupper(A->g_symbol_table) && ! isdigit(A->g_symbol_table))
 	  {
-	    text_color_set(DW_COLOR_ERROR);
-	    dw_printf("Invalid symbol table code '%c' not one of / \\ A-Z 0-9\n", g_symbol_table);	
-	    g_symbol_table = '/';
+	    if ( ! A->g_quiet) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf("Invalid symbol table code '%c' not one of / \\ A-Z 0-9\n", A->g_symbol_table);	
+	    }
+	    A->g_symbol_table = '/';
 	  }
 
 	  if (pm4->space != ' ' && pm4->space != '\0') {
-	    text_color_set(DW_COLOR_ERROR);
-	    dw_printf("Error: Found '%c' instead of space required after symbol code.\n", pm4->space);	
+	    if ( ! A->g_quiet) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf("Error: Found '%c' instead of space required after symbol code.\n", pm4->space);	
+	    }
 	  }
 
-	  strcpy (g_comment, pm4->comment);
+	  strcpy (A->g_comment, pm4->comment);
 	}
 
 /*
  * Whole thing is status text.
  */
 	else {
-	  strcpy (g_comment, ps->comment);
+	  strcpy (A->g_comment, ps->comment);
 	}
 
 
@@ -1950,29 +1923,14 @@ static void aprs_status_report (char *info, int ilen)
  * Last 3 characters can represent beam heading and ERP.
  */
 
-	if (strlen(g_comment) >= 3) {
-	  char *hp = g_comment + strlen(g_comment) - 3;
+	if (strlen(A->g_comment) >= 3) {
+	  char *hp = A->g_comment + strlen(A->g_comment) - 3;
 	
 	  if (*hp == '^') {
 
-	    char h = hp[1];
-	    char p = hp[2];
-	    int beam = -1;
-	    int erp = -1;
-
-	    if (h >= '0' && h <= '9') {
-	      beam = (h - '0') * 10;
-	    }
-	    else if (h >= 'A' && h <= 'Z') {
-	      beam = (h - 'A') * 10 + 100;
-	    }
-
-	    if (p >= '1' && p <= 'K') {
-	      erp = (p - '0') * (p - '0') * 10;
-	    }
-
-	// TODO:  put result somewhere.
-	// could use g_directivity and need new variable for erp.
+	// TODO:  Decode beam heading from hp[1] and ERP from hp[2]
+	// and put result somewhere.
+	// could use A->g_directivity and need new variable for erp.
 
 	    *hp = '\0';
 	  }
@@ -2000,15 +1958,15 @@ static void aprs_status_report (char *info, int ilen)
  *	
  *------------------------------------------------------------------*/
 
-static void aprs_telemetry (char *info, int ilen) 
+static void aprs_telemetry (decode_aprs_t *A, char *info, int ilen) 
 {
 
-	strcpy (g_msg_type, "Telemetry");
+	strcpy (A->g_msg_type, "Telemetry");
 
 	/* It's pretty much human readable already. */
 	/* Just copy the info field. */
 
-	strcpy (g_comment, info);
+	strcpy (A->g_comment, info);
 
 
 } /* end aprs_telemetry */
@@ -2030,17 +1988,17 @@ static void aprs_telemetry (char *info, int ilen)
  *		
  *------------------------------------------------------------------*/
 
-static void aprs_raw_touch_tone (char *info, int ilen) 
+static void aprs_raw_touch_tone (decode_aprs_t *A, char *info, int ilen) 
 {
 
-	strcpy (g_msg_type, "Raw Touch Tone Data");
+	strcpy (A->g_msg_type, "Raw Touch Tone Data");
 
 	/* Just copy the info field without the message type. */
 
 	if (*info == '{') 
-	  strcpy (g_comment, info+3);
+	  strcpy (A->g_comment, info+3);
 	else
-	  strcpy (g_comment, info+1);
+	  strcpy (A->g_comment, info+1);
 
 
 } /* end aprs_raw_touch_tone */
@@ -2061,17 +2019,17 @@ static void aprs_raw_touch_tone (char *info, int ilen)
  *		
  *------------------------------------------------------------------*/
 
-static void aprs_morse_code (char *info, int ilen) 
+static void aprs_morse_code (decode_aprs_t *A, char *info, int ilen) 
 {
 
-	strcpy (g_msg_type, "Morse Code Data");
+	strcpy (A->g_msg_type, "Morse Code Data");
 
 	/* Just copy the info field without the message type. */
 
 	if (*info == '{') 
-	  strcpy (g_comment, info+3);
+	  strcpy (A->g_comment, info+3);
 	else
-	  strcpy (g_comment, info+1);
+	  strcpy (A->g_comment, info+1);
 
 
 } /* end aprs_morse_code */
@@ -2086,7 +2044,7 @@ static void aprs_morse_code (char *info, int ilen)
  * Inputs:	info 	- Pointer to Information field.
  *		ilen 	- Information field length.
  *
- * Outputs:	g_symbol_table, g_symbol_code.
+ * Outputs:	A->g_symbol_table, A->g_symbol_code.
  *
  * Description:	Type identifier '_' is a weather report without a position.
  *
@@ -2094,7 +2052,7 @@ static void aprs_morse_code (char *info, int ilen)
 
 
 
-static void aprs_positionless_weather_report (unsigned char *info, int ilen) 
+static void aprs_positionless_weather_report (decode_aprs_t *A, unsigned char *info, int ilen) 
 {
 
 	struct aprs_positionless_weather_s {
@@ -2104,16 +2062,14 @@ static void aprs_positionless_weather_report (unsigned char *info, int ilen)
 	} *p;
 
 
-	strcpy (g_msg_type, "Positionless Weather Report");
-
-	time_t ts = 0;
+	strcpy (A->g_msg_type, "Positionless Weather Report");
 
 
 	p = (struct aprs_positionless_weather_s *)info;
 	
-	// not yet implemented for 8 character format // ts = get_timestamp (p->time_stamp);
+	// not yet implemented for 8 character format // A->g_timestamp = get_timestamp (p->time_stamp);
 
-	weather_data (p->comment, FALSE);
+	weather_data (A, p->comment, FALSE);
 }
 
 
@@ -2132,17 +2088,17 @@ static void aprs_positionless_weather_report (unsigned char *info, int ilen)
  *				  forgiving in what is accepted.)
  * TODO: call this context instead and have 3 enumerated values.
  *
- * Global In:	g_course	- Wind info for compressed location.
- *		g_speed
+ * Global In:	A->g_course	- Wind info for compressed location.
+ *		A->g_speed
  *
- * Outputs:	g_comment
+ * Outputs:	A->g_comment
  *
  * Description:	Extract weather details and format into a comment.
  *
  *		For human-readable locations, we expect wind direction
  *		and speed in a format like this:  999/999.
  *		For compressed location, this has already been 
- * 		processed and put in g_course and g_speed.
+ * 		processed and put in A->g_course and A->g_speed.
  *		Otherwise, for positionless weather data, the 
  *		wind is in the form c999s999.
  *
@@ -2205,7 +2161,7 @@ static int getwdata (char **wpp, char ch, int dlen, float *val)
 	return (1); 
 }	
 
-static void weather_data (char *wdata, int wind_prefix) 
+static void weather_data (decode_aprs_t *A, char *wdata, int wind_prefix) 
 {
 	int n;
 	float fval;
@@ -2221,42 +2177,46 @@ static void weather_data (char *wdata, int wind_prefix)
 	    // Fine point:  Officially, should be values of 001-360.
 	    // "000" or "..." or "   " means unknown. 
 	    // In practice we see do see "000" here.
-	    g_course = n;
+	    A->g_course = n;
 	  }
 	  if (sscanf (wp+4, "%3d", &n))
 	  {
-	    g_speed = KNOTS_TO_MPH(n);  /* yes, in knots */
+	    A->g_speed = KNOTS_TO_MPH(n);  /* yes, in knots */
 	  }
 	  wp += 7;
 	}
-	else if ( g_speed == G_UNKNOWN) {
+	else if ( A->g_speed == G_UNKNOWN) {
 
-	  if ( ! getwdata (&wp, 'c', 3, &g_course)) {
-	    text_color_set(DW_COLOR_ERROR);
-	    dw_printf("Didn't find wind direction in form c999.\n");
+	  if ( ! getwdata (&wp, 'c', 3, &A->g_course)) {
+	    if ( ! A->g_quiet) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf("Didn't find wind direction in form c999.\n");
+	    }
 	  }
-	  if ( ! getwdata (&wp, 's', 3, &g_speed)) {	/* MPH here */
-	    text_color_set(DW_COLOR_ERROR);
-	    dw_printf("Didn't find wind speed in form s999.\n");
+	  if ( ! getwdata (&wp, 's', 3, &A->g_speed)) {	/* MPH here */
+	    if ( ! A->g_quiet) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf("Didn't find wind speed in form s999.\n");
+	    }
 	  }
 	}
 
 // At this point, we should have the wind direction and speed
 // from one of three methods.
 
-	if (g_speed != G_UNKNOWN) {
+	if (A->g_speed != G_UNKNOWN) {
 	  char ctemp[30];
 
-	  sprintf (g_comment, "wind %.1f mph", g_speed);
-	  if (g_course != G_UNKNOWN) {
-	    sprintf (ctemp, ", direction %.0f", g_course);
-	    strcat (g_comment, ctemp);
+	  sprintf (A->g_comment, "wind %.1f mph", A->g_speed);
+	  if (A->g_course != G_UNKNOWN) {
+	    sprintf (ctemp, ", direction %.0f", A->g_course);
+	    strcat (A->g_comment, ctemp);
 	  }
 	}
 
 	/* We don't want this to show up on the location line. */
-	g_speed = G_UNKNOWN;
-	g_course = G_UNKNOWN;
+	A->g_speed = G_UNKNOWN;
+	A->g_course = G_UNKNOWN;
 
 /*
  * After the mandatory wind direction and speed (in 1 of 3 formats), the
@@ -2268,24 +2228,28 @@ static void weather_data (char *wdata, int wind_prefix)
 	  if (fval != G_UNKNOWN) {
 	    char ctemp[30];
 	    sprintf (ctemp, ", gust %.0f", fval);
-	    strcat (g_comment, ctemp);
+	    strcat (A->g_comment, ctemp);
 	  }
 	}
 	else {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Didn't find wind gust in form g999.\n");
+	  if ( ! A->g_quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Didn't find wind gust in form g999.\n");
+	  }
 	}
 
 	if (getwdata (&wp, 't', 3, &fval)) {
 	  if (fval != G_UNKNOWN) {
 	    char ctemp[30];
 	    sprintf (ctemp, ", temperature %.0f", fval);
-	    strcat (g_comment, ctemp);
+	    strcat (A->g_comment, ctemp);
 	  }
 	}
 	else {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Didn't find temperature in form t999.\n");
+	  if ( ! A->g_quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Didn't find temperature in form t999.\n");
+	  }
 	}
 
 /*
@@ -2301,7 +2265,7 @@ static void weather_data (char *wdata, int wind_prefix)
 	    if (fval != G_UNKNOWN) {
 	      char ctemp[30];
 	      sprintf (ctemp, ", rain %.2f in last hour", fval / 100.);
-	      strcat (g_comment, ctemp);
+	      strcat (A->g_comment, ctemp);
 	    }
 	  }
 	  else if (getwdata (&wp, 'p', 3, &fval)) {	
@@ -2311,7 +2275,7 @@ static void weather_data (char *wdata, int wind_prefix)
 	    if (fval != G_UNKNOWN) {
 	      char ctemp[30];
 	      sprintf (ctemp, ", rain %.2f in last 24 hours", fval / 100.);
-	      strcat (g_comment, ctemp);
+	      strcat (A->g_comment, ctemp);
 	    }
 	  }
 	  else if (getwdata (&wp, 'P', 3, &fval)) {	
@@ -2321,7 +2285,7 @@ static void weather_data (char *wdata, int wind_prefix)
 	    if (fval != G_UNKNOWN) {
 	      char ctemp[30];
 	      sprintf (ctemp, ", rain %.2f since midnight", fval / 100.);
-	      strcat (g_comment, ctemp);
+	      strcat (A->g_comment, ctemp);
 	    }
 	  }
 	  else if (getwdata (&wp, 'h', 2, &fval)) {	
@@ -2332,7 +2296,7 @@ static void weather_data (char *wdata, int wind_prefix)
 	      char ctemp[30];
 	      if (fval == 0) fval = 100;
 	      sprintf (ctemp, ", humidity %.0f", fval);
-	      strcat (g_comment, ctemp);
+	      strcat (A->g_comment, ctemp);
 	    }
 	  }
 	  else if (getwdata (&wp, 'b', 5, &fval)) {	
@@ -2344,7 +2308,7 @@ static void weather_data (char *wdata, int wind_prefix)
 	      char ctemp[30];
 	      fval = MBAR_TO_INHG(fval * 0.1);
 	      sprintf (ctemp, ", barometer %.2f", fval);
-	      strcat (g_comment, ctemp);
+	      strcat (A->g_comment, ctemp);
 	    }
 	  }
 	  else if (getwdata (&wp, 'L', 3, &fval)) {	
@@ -2354,7 +2318,7 @@ static void weather_data (char *wdata, int wind_prefix)
 	    if (fval != G_UNKNOWN) {
 	      char ctemp[30];
 	      sprintf (ctemp, ", %.0f watts/m^2", fval);
-	      strcat (g_comment, ctemp);
+	      strcat (A->g_comment, ctemp);
 	    }
 	  }
 	  else if (getwdata (&wp, 'l', 3, &fval)) {	
@@ -2364,7 +2328,7 @@ static void weather_data (char *wdata, int wind_prefix)
 	    if (fval != G_UNKNOWN) {
 	      char ctemp[30];
 	      sprintf (ctemp, ", %.0f watts/m^2", fval + 1000);
-	      strcat (g_comment, ctemp);
+	      strcat (A->g_comment, ctemp);
 	    }
 	  }
 	  else if (getwdata (&wp, 's', 3, &fval)) {	
@@ -2377,7 +2341,7 @@ static void weather_data (char *wdata, int wind_prefix)
 	    if (fval != G_UNKNOWN) {
 	      char ctemp[30];
 	      sprintf (ctemp, ", %.1f snow in 24 hours", fval);
-	      strcat (g_comment, ctemp);
+	      strcat (A->g_comment, ctemp);
 	    }
 	  }
 	  else if (getwdata (&wp, 's', 3, &fval)) {	
@@ -2387,7 +2351,7 @@ static void weather_data (char *wdata, int wind_prefix)
 	    if (fval != G_UNKNOWN) {
 	      char ctemp[30];
 	      sprintf (ctemp, ", raw rain counter %.f", fval);
-	      strcat (g_comment, ctemp);
+	      strcat (A->g_comment, ctemp);
 	    }
 	  }
 	  else if (getwdata (&wp, 'X', 3, &fval)) {	
@@ -2401,7 +2365,7 @@ static void weather_data (char *wdata, int wind_prefix)
 	    if (fval != G_UNKNOWN) {
 	      char ctemp[30];
 	      sprintf (ctemp, ", nuclear Radiation %.f", fval);
-	      strcat (g_comment, ctemp);
+	      strcat (A->g_comment, ctemp);
 	    }
 	  }
 
@@ -2423,22 +2387,22 @@ static void weather_data (char *wdata, int wind_prefix)
  *  / {UIV32N}
  */
 
-	strcat (g_comment, ", \"");
-	strcat (g_comment, wp);
+	strcat (A->g_comment, ", \"");
+	strcat (A->g_comment, wp);
 /*
  * Drop any CR / LF character at the end.
  */
-	n = strlen(g_comment);
-	if (n >= 1 && g_comment[n-1] == '\n') {
-	  g_comment[n-1] = '\0';
+	n = strlen(A->g_comment);
+	if (n >= 1 && A->g_comment[n-1] == '\n') {
+	  A->g_comment[n-1] = '\0';
 	}
 
-	n = strlen(g_comment);
-	if (n >= 1 && g_comment[n-1] == '\r') {
-	  g_comment[n-1] = '\0';
+	n = strlen(A->g_comment);
+	if (n >= 1 && A->g_comment[n-1] == '\r') {
+	  A->g_comment[n-1] = '\0';
 	}
 
-	strcat (g_comment, "\"");
+	strcat (A->g_comment, "\"");
 
 	return;
 }
@@ -2453,7 +2417,7 @@ static void weather_data (char *wdata, int wind_prefix)
  * Inputs:	info 	- Pointer to Information field.
  *		ilen 	- Information field length.
  *
- * Outputs:	g_comment
+ * Outputs:	A->g_comment
  *
  * Description:	http://www.peetbros.com/shop/custom.aspx?recid=7 
  *
@@ -2474,7 +2438,7 @@ static void weather_data (char *wdata, int wind_prefix)
  *
  *------------------------------------------------------------------*/
 
-static void aprs_ultimeter (char *info, int ilen) 
+static void aprs_ultimeter (decode_aprs_t *A, char *info, int ilen) 
 {
 
 				// Header = $ULTW 
@@ -2500,7 +2464,7 @@ static void aprs_ultimeter (char *info, int ilen)
 
 	int n;
 
-	strcpy (g_msg_type, "Ultimeter");
+	strcpy (A->g_msg_type, "Ultimeter");
 
 	if (*info == '$')
  	{
@@ -2529,7 +2493,7 @@ static void aprs_ultimeter (char *info, int ilen)
 	    baro = MBAR_TO_INHG(h_baro * 0.1);
 	    ohumid = h_ohumid * 0.1;
 	  
-	    sprintf (g_comment, "wind %.1f mph, direction %.0f, temperature %.1f, barometer %.2f, humidity %.0f",
+	    sprintf (A->g_comment, "wind %.1f mph, direction %.0f, temperature %.1f, barometer %.2f, humidity %.0f",
 			windpeak, wdir, otemp, baro, ohumid);
 	  }
 	}
@@ -2570,7 +2534,7 @@ static void aprs_ultimeter (char *info, int ilen)
 	    wdir = (h_wdir & 0xff) * 360. / 256.;
 	    otemp = h_otemp * 0.1;
 	  
-	    sprintf (g_comment, "wind %.1f mph, direction %.0f, temperature %.1f\n",
+	    sprintf (A->g_comment, "wind %.1f mph, direction %.0f, temperature %.1f\n",
 			windpeak, wdir, otemp);
 	  }
 
@@ -2588,17 +2552,15 @@ static void aprs_ultimeter (char *info, int ilen)
  * Inputs:	info 	- Pointer to Information field.
  *		ilen 	- Information field length.
  *
- * Outputs:	g_comment
+ * Outputs:	A->g_comment
  *
  * Description:	
  *
  *------------------------------------------------------------------*/
 
-static void third_party_header (char *info, int ilen) 
+static void third_party_header (decode_aprs_t *A, char *info, int ilen) 
 {
-	int n;
-
-	strcpy (g_msg_type, "Third Party Header");
+	strcpy (A->g_msg_type, "Third Party Header");
 
 	/* more later? */
 
@@ -2614,10 +2576,10 @@ static void third_party_header (char *info, int ilen)
  *
  * Inputs:	ppos 	- Pointer to position & symbol fields.
  *
- * Returns:	g_lat
- *		g_lon
- *		g_symbol_table
- *		g_symbol_code
+ * Returns:	A->g_lat
+ *		A->g_lon
+ *		A->g_symbol_table
+ *		A->g_symbol_code
  *
  * Description:	This provides resolution of about 60 feet.
  *		This can be improved by using !DAO! in the comment.
@@ -2625,14 +2587,14 @@ static void third_party_header (char *info, int ilen)
  *------------------------------------------------------------------*/
 
 
-static void decode_position (position_t *ppos)
+static void decode_position (decode_aprs_t *A, position_t *ppos)
 {
 
-	  g_lat = get_latitude_8 (ppos->lat);
-	  g_lon = get_longitude_9 (ppos->lon);
+	  A->g_lat = get_latitude_8 (ppos->lat, A->g_quiet);
+	  A->g_lon = get_longitude_9 (ppos->lon, A->g_quiet);
 
-	  g_symbol_table = ppos->sym_table_id;
-	  g_symbol_code = ppos->symbol_code;
+	  A->g_symbol_table = ppos->sym_table_id;
+	  A->g_symbol_code = ppos->symbol_code;
 }
 
 /*------------------------------------------------------------------
@@ -2643,15 +2605,15 @@ static void decode_position (position_t *ppos)
  *
  * Inputs:	ppos 	- Pointer to compressed position & symbol fields.
  *
- * Returns:	g_lat
- *		g_lon
- *		g_symbol_table
- *		g_symbol_code
+ * Returns:	A->g_lat
+ *		A->g_lon
+ *		A->g_symbol_table
+ *		A->g_symbol_code
  *
  *		One of the following:
- *			g_course & g_speeed
- *			g_altitude
- *			g_range
+ *			A->g_course & g_speeed
+ *			A->g_altitude
+ *			A->g_range
  *
  * Description:	The compressed position provides resolution of around ???
  *		This also includes course/speed or altitude.
@@ -2673,20 +2635,22 @@ static void decode_position (position_t *ppos)
  *------------------------------------------------------------------*/
 
 
-static void decode_compressed_position (compressed_position_t *pcpos)
+static void decode_compressed_position (decode_aprs_t *A, compressed_position_t *pcpos)
 {
 	if (pcpos->y[0] >= '!' && pcpos->y[0] <= '{' &&
 	    pcpos->y[1] >= '!' && pcpos->y[1] <= '{' &&
 	    pcpos->y[2] >= '!' && pcpos->y[2] <= '{' &&
 	    pcpos->y[3] >= '!' && pcpos->y[3] <= '{' ) 
 	{
-	  g_lat = 90 - ((pcpos->y[0]-33)*91*91*91 + (pcpos->y[1]-33)*91*91 + (pcpos->y[2]-33)*91 + (pcpos->y[3]-33)) / 380926.0;
+	  A->g_lat = 90 - ((pcpos->y[0]-33)*91*91*91 + (pcpos->y[1]-33)*91*91 + (pcpos->y[2]-33)*91 + (pcpos->y[3]-33)) / 380926.0;
 	}
 	else
  	{
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Invalid character in compressed latitude.  Must be in range of '!' to '{'.\n");
-	  g_lat = G_UNKNOWN;
+	  if ( ! A->g_quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Invalid character in compressed latitude.  Must be in range of '!' to '{'.\n");
+	  }
+	  A->g_lat = G_UNKNOWN;
 	}
 	  
 	if (pcpos->x[0] >= '!' && pcpos->x[0] <= '{' &&
@@ -2694,47 +2658,51 @@ static void decode_compressed_position (compressed_position_t *pcpos)
 	    pcpos->x[2] >= '!' && pcpos->x[2] <= '{' &&
 	    pcpos->x[3] >= '!' && pcpos->x[3] <= '{' ) 
 	{
-	  g_lon = -180 + ((pcpos->x[0]-33)*91*91*91 + (pcpos->x[1]-33)*91*91 + (pcpos->x[2]-33)*91 + (pcpos->x[3]-33)) / 190463.0;
+	  A->g_lon = -180 + ((pcpos->x[0]-33)*91*91*91 + (pcpos->x[1]-33)*91*91 + (pcpos->x[2]-33)*91 + (pcpos->x[3]-33)) / 190463.0;
 	}
 	else 
 	{
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Invalid character in compressed longitude.  Must be in range of '!' to '{'.\n");
-	  g_lon = G_UNKNOWN;
+	  if ( ! A->g_quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Invalid character in compressed longitude.  Must be in range of '!' to '{'.\n");
+	  }
+	  A->g_lon = G_UNKNOWN;
 	}
 
 	if (pcpos->sym_table_id == '/' || pcpos->sym_table_id == '\\' || isupper((int)(pcpos->sym_table_id))) {
 	  /* primary or alternate or alternate with upper case overlay. */
-	  g_symbol_table = pcpos->sym_table_id;
+	  A->g_symbol_table = pcpos->sym_table_id;
    	}
 	else if (pcpos->sym_table_id >= 'a' && pcpos->sym_table_id <= 'j') {
 	  /* Lower case a-j are used to represent overlay characters 0-9 */
 	  /* because a digit here would mean normal (non-compressed) location. */
-	  g_symbol_table = pcpos->sym_table_id - 'a' + '0';
+	  A->g_symbol_table = pcpos->sym_table_id - 'a' + '0';
 	}
 	else {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Invalid symbol table id for compressed position.\n");
-	  g_symbol_table = '/';
+	  if ( ! A->g_quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Invalid symbol table id for compressed position.\n");
+	  }
+	  A->g_symbol_table = '/';
 	}
 
-	g_symbol_code = pcpos->symbol_code;
+	A->g_symbol_code = pcpos->symbol_code;
 
 	if (pcpos->c == ' ') {
 	  ; /* ignore other two bytes */
 	}
 	else if (((pcpos->t - 33) & 0x18) == 0x10) {
-	  g_altitude = pow(1.002, (pcpos->c - 33) * 91 + pcpos->s - 33);
+	  A->g_altitude = pow(1.002, (pcpos->c - 33) * 91 + pcpos->s - 33);
 	}
 	else if (pcpos->c == '{')
 	{
-	  g_range = 2.0 * pow(1.08, pcpos->s - 33);
+	  A->g_range = 2.0 * pow(1.08, pcpos->s - 33);
 	}
 	else if (pcpos->c >= '!' && pcpos->c <= 'z')
 	{
 	  /* For a weather station, this is wind information. */
-	  g_course = (pcpos->c - 33) * 4;
-	  g_speed = KNOTS_TO_MPH(pow(1.08, pcpos->s - 33) - 1.0);
+	  A->g_course = (pcpos->c - 33) * 4;
+	  A->g_speed = KNOTS_TO_MPH(pow(1.08, pcpos->s - 33) - 1.0);
 	}
 
 }
@@ -2772,7 +2740,7 @@ static void decode_compressed_position (compressed_position_t *pcpos)
  *
  *------------------------------------------------------------------*/
 
-double get_latitude_8 (char *p)
+double get_latitude_8 (char *p, int quiet)
 {
 	struct lat_s {
 	  unsigned char deg[2];
@@ -2789,16 +2757,20 @@ double get_latitude_8 (char *p)
 	if (isdigit(plat->deg[0]))
 	  result += ((plat->deg[0]) - '0') * 10;
 	else {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Invalid character in latitude.  Expected 0-9 for tens of degrees.\n");
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Invalid character in latitude.  Expected 0-9 for tens of degrees.\n");
+	  }
 	  return (G_UNKNOWN);
 	}
 
 	if (isdigit(plat->deg[1]))
 	  result += ((plat->deg[1]) - '0') * 1;
 	else {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Invalid character in latitude.  Expected 0-9 for degrees.\n");
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Invalid character in latitude.  Expected 0-9 for degrees.\n");
+	  }
 	  return (G_UNKNOWN);
 	}
 
@@ -2807,8 +2779,10 @@ double get_latitude_8 (char *p)
 	else if (plat->minn[0] == ' ')
 	  ;
 	else {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Invalid character in latitude.  Expected 0-5 for tens of minutes.\n");
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Invalid character in latitude.  Expected 0-5 for tens of minutes.\n");
+	  }
 	  return (G_UNKNOWN);
 	}
 
@@ -2817,14 +2791,18 @@ double get_latitude_8 (char *p)
 	else if (plat->minn[1] == ' ')
 	  ;
 	else {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Invalid character in latitude.  Expected 0-9 for minutes.\n");
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Invalid character in latitude.  Expected 0-9 for minutes.\n");
+	  }
 	  return (G_UNKNOWN);
 	}
 
 	if (plat->dot != '.') {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Unexpected character \"%c\" found where period expected in latitude.\n", plat->dot);
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Unexpected character \"%c\" found where period expected in latitude.\n", plat->dot);
+	  }
 	  return (G_UNKNOWN);
 	} 
 
@@ -2833,8 +2811,10 @@ double get_latitude_8 (char *p)
 	else if (plat->hmin[0] == ' ')
 	  ;
 	else {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Invalid character in latitude.  Expected 0-9 for tenths of minutes.\n");
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Invalid character in latitude.  Expected 0-9 for tenths of minutes.\n");
+	  }
 	  return (G_UNKNOWN);
 	}
 
@@ -2843,8 +2823,10 @@ double get_latitude_8 (char *p)
 	else if (plat->hmin[1] == ' ')
 	  ;
 	else {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Invalid character in latitude.  Expected 0-9 for hundredths of minutes.\n");
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Invalid character in latitude.  Expected 0-9 for hundredths of minutes.\n");
+	  }
 	  return (G_UNKNOWN);
 	}
 
@@ -2854,21 +2836,27 @@ double get_latitude_8 (char *p)
 	  return (result);
         }
         else if (plat->ns == 'n') {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Warning: Lower case n found for latitude hemisphere.  Specification requires upper case N or S.\n");	  
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Warning: Lower case n found for latitude hemisphere.  Specification requires upper case N or S.\n");	  
+	  }
 	  return (result);
 	}
 	else if (plat->ns == 'S') {
 	  return ( - result);
 	}
 	else if (plat->ns == 's') {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Warning: Lower case s found for latitude hemisphere.  Specification requires upper case N or S.\n");	  
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Warning: Lower case s found for latitude hemisphere.  Specification requires upper case N or S.\n");	  
+	  }
 	  return ( - result);
 	}
 	else {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Error: '%c' found for latitude hemisphere.  Specification requires upper case N or s.\n", plat->ns);	  
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Error: '%c' found for latitude hemisphere.  Specification requires upper case N or s.\n", plat->ns);	  
+	  }
 	  return (G_UNKNOWN);	
 	}	
 }
@@ -2905,7 +2893,7 @@ double get_latitude_8 (char *p)
  *------------------------------------------------------------------*/
 
 
-double get_longitude_9 (char *p)
+double get_longitude_9 (char *p, int quiet)
 {
 	struct lat_s {
 	  unsigned char deg[3];
@@ -2922,24 +2910,30 @@ double get_longitude_9 (char *p)
 	if (plon->deg[0] == '0' || plon->deg[0] == '1')
 	  result += ((plon->deg[0]) - '0') * 100;
 	else {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Invalid character in longitude.  Expected 0 or 1 for hundreds of degrees.\n");
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Invalid character in longitude.  Expected 0 or 1 for hundreds of degrees.\n");
+	  }
 	  return (G_UNKNOWN);
 	}
 
 	if (isdigit(plon->deg[1]))
 	  result += ((plon->deg[1]) - '0') * 10;
 	else {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Invalid character in longitude.  Expected 0-9 for tens of degrees.\n");
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Invalid character in longitude.  Expected 0-9 for tens of degrees.\n");
+	  }
 	  return (G_UNKNOWN);
 	}
 
 	if (isdigit(plon->deg[2]))
 	  result += ((plon->deg[2]) - '0') * 1;
 	else {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Invalid character in longitude.  Expected 0-9 for degrees.\n");
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Invalid character in longitude.  Expected 0-9 for degrees.\n");
+	  }
 	  return (G_UNKNOWN);
 	}
 
@@ -2948,8 +2942,10 @@ double get_longitude_9 (char *p)
 	else if (plon->minn[0] == ' ')
 	  ;
 	else {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Invalid character in longitude.  Expected 0-5 for tens of minutes.\n");
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Invalid character in longitude.  Expected 0-5 for tens of minutes.\n");
+	  }
 	  return (G_UNKNOWN);
 	}
 
@@ -2958,14 +2954,18 @@ double get_longitude_9 (char *p)
 	else if (plon->minn[1] == ' ')
 	  ;
 	else {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Invalid character in longitude.  Expected 0-9 for minutes.\n");
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Invalid character in longitude.  Expected 0-9 for minutes.\n");
+	  }
 	  return (G_UNKNOWN);
 	}
 
 	if (plon->dot != '.') {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Unexpected character \"%c\" found where period expected in longitude.\n", plon->dot);
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Unexpected character \"%c\" found where period expected in longitude.\n", plon->dot);
+	  }
 	  return (G_UNKNOWN);
 	} 
 
@@ -2974,8 +2974,10 @@ double get_longitude_9 (char *p)
 	else if (plon->hmin[0] == ' ')
 	  ;
 	else {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Invalid character in longitude.  Expected 0-9 for tenths of minutes.\n");
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Invalid character in longitude.  Expected 0-9 for tenths of minutes.\n");
+	  }
 	  return (G_UNKNOWN);
 	}
 
@@ -2984,8 +2986,10 @@ double get_longitude_9 (char *p)
 	else if (plon->hmin[1] == ' ')
 	  ;
 	else {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Invalid character in longitude.  Expected 0-9 for hundredths of minutes.\n");
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Invalid character in longitude.  Expected 0-9 for hundredths of minutes.\n");
+	  }
 	  return (G_UNKNOWN);
 	}
 
@@ -2995,21 +2999,27 @@ double get_longitude_9 (char *p)
 	  return (result);
         }
         else if (plon->ew == 'e') {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Warning: Lower case e found for longitude hemisphere.  Specification requires upper case E or W.\n");	  
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Warning: Lower case e found for longitude hemisphere.  Specification requires upper case E or W.\n");	  
+	  }
 	  return (result);
 	}
 	else if (plon->ew == 'W') {
 	  return ( - result);
 	}
 	else if (plon->ew == 'w') {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Warning: Lower case w found for longitude hemisphere.  Specification requires upper case E or W.\n");	  
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Warning: Lower case w found for longitude hemisphere.  Specification requires upper case E or W.\n");	  
+	  }
 	  return ( - result);
 	}
 	else {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Error: '%c' found for longitude hemisphere.  Specification requires upper case E or W.\n", plon->ew);	  
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Error: '%c' found for longitude hemisphere.  Specification requires upper case E or W.\n", plon->ew);	  
+	  }
 	  return (G_UNKNOWN);	
 	}		
 }
@@ -3093,12 +3103,17 @@ time_t get_timestamp (char *p)
 				/* h = UTC. */
 	} *phms;
 
-	struct tm *ptm;
+	struct tm tm;
+	struct tm *ptm = &tm;
 
 	time_t ts;
 
 	ts = time(NULL);
-	ptm = gmtime(&ts);
+#if __WIN32__
+	tm = *gmtime(&ts);	/* Microsoft's version uses thread local storage. */
+#else
+	gmtime_r (&ts, &tm);
+#endif
 
 	pdhm = (void *)p;
 	phms = (void *)p;
@@ -3181,7 +3196,7 @@ time_t get_timestamp (char *p)
  *------------------------------------------------------------------*/
 
 
-int get_maidenhead (char *p)
+int get_maidenhead (char *p, int quiet)
 {
 
 	if (toupper(p[0]) >= 'A' && toupper(p[0]) <= 'R' &&
@@ -3191,8 +3206,10 @@ int get_maidenhead (char *p)
 	  /* We have 4 characters matching the rule. */
 
 	  if (islower(p[0]) || islower(p[1])) {
-	    text_color_set(DW_COLOR_ERROR);
-	    dw_printf("Warning: Lower case letter in Maidenhead locator.  Specification requires upper case.\n");	  
+	    if ( ! quiet) {
+	      text_color_set(DW_COLOR_ERROR);
+	      dw_printf("Warning: Lower case letter in Maidenhead locator.  Specification requires upper case.\n");	  
+	    }
 	  }
 
 	  if (toupper(p[4]) >= 'A' && toupper(p[4]) <= 'X' &&
@@ -3201,8 +3218,10 @@ int get_maidenhead (char *p)
 	    /* We have 6 characters matching the rule. */
 
 	    if (islower(p[4]) || islower(p[5])) {
-	      text_color_set(DW_COLOR_ERROR);
-	      dw_printf("Warning: Lower case letter in Maidenhead locator.  Specification requires upper case.\n");	  
+	      if ( ! quiet) {
+		text_color_set(DW_COLOR_ERROR);
+		dw_printf("Warning: Lower case letter in Maidenhead locator.  Specification requires upper case.\n");	  
+	      }
 	    }
 	  
 	    return 6;
@@ -3242,7 +3261,7 @@ int get_maidenhead (char *p)
  *------------------------------------------------------------------*/
 
 
-static double get_latitude_nmea (char *pstr, char *phemi)
+static double get_latitude_nmea (char *pstr, char *phemi, int quiet)
 {
 
 	double lat;
@@ -3255,8 +3274,10 @@ static double get_latitude_nmea (char *pstr, char *phemi)
 	lat = (pstr[0] - '0') * 10 + (pstr[1] - '0') + atof(pstr+2) / 60.0;
 
 	if (lat < 0 || lat > 90) {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Error: Latitude not in range of 0 to 90.\n");	  
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Error: Latitude not in range of 0 to 90.\n");	  
+	  }
 	}
 
 	// Saw this one time:
@@ -3266,8 +3287,10 @@ static double get_latitude_nmea (char *pstr, char *phemi)
 	// an empty string.  TODO: Check on this.
 
 	if (*phemi != 'N' && *phemi != 'S' && *phemi != '\0') {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Error: Latitude hemisphere should be N or S.\n");	  
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Error: Latitude hemisphere should be N or S.\n");	  
+	  }
 	}
 
 	if (*phemi == 'S') lat = ( - lat);
@@ -3304,7 +3327,7 @@ static double get_latitude_nmea (char *pstr, char *phemi)
  *------------------------------------------------------------------*/
 
 
-static double get_longitude_nmea (char *pstr, char *phemi)
+static double get_longitude_nmea (char *pstr, char *phemi, int quiet)
 {
 	double lon;
 
@@ -3315,13 +3338,17 @@ static double get_longitude_nmea (char *pstr, char *phemi)
 	lon = (pstr[0] - '0') * 100 + (pstr[1] - '0') * 10 + (pstr[2] - '0') + atof(pstr+3) / 60.0;
 
 	if (lon < 0 || lon > 180) {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Error: Longitude not in range of 0 to 180.\n");	  
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Error: Longitude not in range of 0 to 180.\n");	  
+	  }
 	}
 	
 	if (*phemi != 'E' && *phemi != 'W' && *phemi != '\0') {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf("Error: Longitude hemisphere should be E or W.\n");	  
+	  if ( ! quiet) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf("Error: Longitude hemisphere should be E or W.\n");	  
+	  }
 	}
 
 	if (*phemi == 'W') lon = ( - lon);
@@ -3342,17 +3369,17 @@ static double get_longitude_nmea (char *pstr, char *phemi)
  *
  * Outputs:	One or more of the following, depending the data found:
  *	
- *			g_course
- *			g_speed
- *			g_power 
- *			g_height 
- *			g_gain 
- *			g_directivity 
- *			g_range
+ *			A->g_course
+ *			A->g_speed
+ *			A->g_power 
+ *			A->g_height 
+ *			A->g_gain 
+ *			A->g_directivity 
+ *			A->g_range
  *
  *		Anything left over will be put in 
  *
- *			g_comment			
+ *			A->g_comment			
  *
  * Description:	
  *
@@ -3362,12 +3389,12 @@ static double get_longitude_nmea (char *pstr, char *phemi)
 
 const char *dir[9] = { "omni", "NE", "E", "SE", "S", "SW", "W", "NW", "N" };
 
-static int data_extension_comment (char *pdext)
+static int data_extension_comment (decode_aprs_t *A, char *pdext)
 {
 	int n;
 
 	if (strlen(pdext) < 7) {
-	  strcpy (g_comment, pdext);
+	  strcpy (A->g_comment, pdext);
 	  return 0;
 	}
 
@@ -3378,7 +3405,7 @@ static int data_extension_comment (char *pdext)
 	 	pdext[4] == 'C')
 	{
 	  /* not decoded at this time */
-	  process_comment (pdext+7, -1);
+	  process_comment (A, pdext+7, -1);
 	  return 1;
 	}
 
@@ -3390,21 +3417,21 @@ static int data_extension_comment (char *pdext)
 	{
 	  if (sscanf (pdext, "%3d", &n))
 	  {
-	    g_course = n;
+	    A->g_course = n;
 	  }
 	  if (sscanf (pdext+4, "%3d", &n))
 	  {
-	    g_speed = KNOTS_TO_MPH(n);
+	    A->g_speed = KNOTS_TO_MPH(n);
 	  }
 
 	  /* Bearing and Number/Range/Quality? */
 
 	  if (pdext[7] == '/' && pdext[11] == '/') 
 	  {
-	    process_comment (pdext + 7 + 8, -1);
+	    process_comment (A, pdext + 7 + 8, -1);
 	  }
 	  else {
-	    process_comment (pdext+7, -1);
+	    process_comment (A, pdext+7, -1);
 	  }
 	  return 1;
 	}
@@ -3413,14 +3440,14 @@ static int data_extension_comment (char *pdext)
 
 	if (strncmp(pdext, "PHG", 3) == 0)
 	{
-	  g_power = (pdext[3] - '0') * (pdext[3] - '0');
-	  g_height = (1 << (pdext[4] - '0')) * 10;
-	  g_gain = pdext[5] - '0';
+	  A->g_power = (pdext[3] - '0') * (pdext[3] - '0');
+	  A->g_height = (1 << (pdext[4] - '0')) * 10;
+	  A->g_gain = pdext[5] - '0';
 	  if (pdext[6] >= '0' && pdext[6] <= '8') {
-	    strcpy (g_directivity, dir[pdext[6]-'0']);
+	    strcpy (A->g_directivity, dir[pdext[6]-'0']);
 	  }
 
-	  process_comment (pdext+7, -1);
+	  process_comment (A, pdext+7, -1);
 	  return 1;
 	}
 
@@ -3430,9 +3457,9 @@ static int data_extension_comment (char *pdext)
 	{
 	  if (sscanf (pdext+3, "%4d", &n))
 	  {
-	    g_range = n;
+	    A->g_range = n;
 	  }
-	  process_comment (pdext+7, -1);
+	  process_comment (A, pdext+7, -1);
 	  return 1;
 	}
 
@@ -3441,17 +3468,17 @@ static int data_extension_comment (char *pdext)
 	if (strncmp(pdext, "DFS", 3) == 0)
 	{
 	  //g_strength = pdext[3] - '0';
-	  g_height = (1 << (pdext[4] - '0')) * 10;
-	  g_gain = pdext[5] - '0';
+	  A->g_height = (1 << (pdext[4] - '0')) * 10;
+	  A->g_gain = pdext[5] - '0';
 	  if (pdext[6] >= '0' && pdext[6] <= '8') {
-	    strcpy (g_directivity, dir[pdext[6]-'0']);
+	    strcpy (A->g_directivity, dir[pdext[6]-'0']);
 	  }
 
-	  process_comment (pdext+7, -1);
+	  process_comment (A, pdext+7, -1);
 	  return 1;
 	}
 
-	process_comment (pdext, -1);
+	process_comment (A, pdext, -1);
 	return 0;
 }
 
@@ -3465,7 +3492,7 @@ static int data_extension_comment (char *pdext)
  * Inputs:	dest	- Destination address.
  *			Don't care if SSID is present or not.
  *
- * Outputs:	g_mfr
+ * Outputs:	A->g_mfr
  *
  * Description:	For maximum flexibility, we will read the
  *		data file at run time rather than compiling it in.
@@ -3479,35 +3506,88 @@ static int data_extension_comment (char *pdext)
  *		Linux version: Search order is current working directory
  *			then /usr/share/direwolf directory.
  *
+ *		The file is read once, by decode_aprs_init at start up,
+ *		into a prefix tree.  Finding the longest matching prefix
+ *		then takes one step per character of the destination
+ *		rather than comparing against every entry.
+ *
  *------------------------------------------------------------------*/
 
 #define MAX_TOCALLS 150
 
-static struct tocalls_s {
-	unsigned char len;
-	char prefix[7];
-	char *description;
-} tocalls[MAX_TOCALLS];
+#define TOCALL_MAX_LEN 6			/* Longest prefix, not counting SSID. */
+
+#define TOCALL_NUM_CHARS 36			/* Only digits and upper case letters. */
+
+#define TOCALL_MAX_NODES (MAX_TOCALLS * TOCALL_MAX_LEN + 1)
+
+static struct tocall_node_s {
+	short child[TOCALL_NUM_CHARS];		/* Index of node for next character or 0 if none. */
+						/* Node 0 is the root so it can't be anyone's child. */
+	short desc;				/* 1 + index into tocall_desc if a prefix ends here, */
+						/* otherwise 0. */
+} tocall_trie[TOCALL_MAX_NODES];
+
+static int tocall_num_nodes = 1;		/* Root is always there. */
+
+static char *tocall_desc[MAX_TOCALLS];
 
 static int num_tocalls = 0;
 
-static int tocall_cmp (const struct tocalls_s *x, const struct tocalls_s *y) 
+
+static int tocall_char_index (int ch)
 {
-	if (x->len != y->len) return (y->len - x->len);
-	return (strcmp(x->prefix, y->prefix));
+	if (ch >= '0' && ch <= '9') return (ch - '0');
+	if (ch >= 'A' && ch <= 'Z') return (ch - 'A' + 10);
+	return (-1);
 }
 
-static void decode_tocall (char *dest)
+
+/*
+ * Add one prefix.  If the same prefix appears more than once,
+ * the first description is kept.
+ */
+
+static void tocall_add (char *prefix, char *description)
+{
+	int n = 0;
+	char *p;
+	int k;
+
+	if (num_tocalls >= MAX_TOCALLS) {
+	  return;
+	}
+
+	for (p = prefix; *p != '\0'; p++) {
+	  k = tocall_char_index (*p);
+	  assert (k >= 0);
+	  if (tocall_trie[n].child[k] == 0) {
+	    if (tocall_num_nodes >= TOCALL_MAX_NODES) {
+	      return;
+	    }
+	    tocall_trie[n].child[k] = tocall_num_nodes++;
+	  }
+	  n = tocall_trie[n].child[k];
+	}
+
+	if (tocall_trie[n].desc == 0) {
+	  tocall_desc[num_tocalls] = strdup(description);
+	  num_tocalls++;
+	  tocall_trie[n].desc = num_tocalls;
+	}
+}
+
+
+static pthread_once_t tocalls_once = PTHREAD_ONCE_INIT;
+
+static void load_tocalls (void)
 {
 	FILE *fp;
-	int n;
-	static int first_time = 1;
 	char stuff[100];
+	char prefix[TOCALL_MAX_LEN+1];
 	char *p;
 	char *r;
 
-	//dw_printf("debug: decode_tocall(\"%s\")\n", dest);
-
 /*
  * Extract the calls and descriptions from the file.
  *
@@ -3528,109 +3608,125 @@ static void decode_tocall (char *dest)
 
 // If search strategy changes, be sure to keep symbols_init in sync.
 
-	if (first_time) {
-
-	  fp = fopen("tocalls.txt", "r");
+	fp = fopen("tocalls.txt", "r");
 #ifndef __WIN32__
-	  if (fp == NULL) {
-	    fp = fopen("/usr/share/direwolf/tocalls.txt", "r");
-	  }
+	if (fp == NULL) {
+	  fp = fopen("/usr/share/direwolf/tocalls.txt", "r");
+	}
 #endif
-	  if (fp != NULL) {
+	if (fp == NULL) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf("Warning: Could not open 'tocalls.txt'.\n");
+	  dw_printf("System types in the destination field will not be decoded.\n");
+	  return;
+	}
 
-	    while (fgets(stuff, sizeof(stuff), fp) != NULL && num_tocalls < MAX_TOCALLS) {
+	while (fgets(stuff, sizeof(stuff), fp) != NULL) {
 	      
-	      p = stuff + strlen(stuff) - 1;
-	      while (p >= stuff && (*p == '\r' || *p == '\n')) {
-	        *p-- = '\0';
-	      }
+	  p = stuff + strlen(stuff) - 1;
+	  while (p >= stuff && (*p == '\r' || *p == '\n')) {
+	    *p-- = '\0';
+	  }
 
-	      // printf("debug: %s\n", stuff);
-
-	      if (stuff[0] == ' ' && 
-		  stuff[4] == ' ' &&
-		  stuff[5] == ' ' &&
-		  stuff[6] == 'A' && 
-		  stuff[7] == 'P' && 
-		  stuff[12] == ' ' &&
-		  stuff[13] == ' ' ) {
-
-	        p = stuff + 6;
-	        r = tocalls[num_tocalls].prefix;
-	        while (isupper((int)(*p)) || isdigit((int)(*p))) {
-	          *r++ = *p++;
-	        }
-	        *r = '\0';
-	        if (strlen(tocalls[num_tocalls].prefix) > 2) {
-	          tocalls[num_tocalls].description = strdup(stuff+14);
-		  tocalls[num_tocalls].len = strlen(tocalls[num_tocalls].prefix);
-	          // dw_printf("debug: %d '%s' -> '%s'\n", tocalls[num_tocalls].len, tocalls[num_tocalls].prefix, tocalls[num_tocalls].description);
-
-	          num_tocalls++;
-	        }
-	      }
-	      else if (stuff[0] == ' ' && 
-		  stuff[1] == 'A' && 
-		  stuff[2] == 'P' && 
-		  isupper((int)(stuff[3])) &&
-		  stuff[4] == ' ' &&
-		  stuff[5] == ' ' &&
-		  stuff[6] == ' ' &&
-		  stuff[12] == ' ' &&
-		  stuff[13] == ' ' ) {
-
-	        p = stuff + 1;
-	        r = tocalls[num_tocalls].prefix;
-	        while (isupper((int)(*p)) || isdigit((int)(*p))) {
-	          *r++ = *p++;
-	        }
-	        *r = '\0';
-	        if (strlen(tocalls[num_tocalls].prefix) > 2) {
-	          tocalls[num_tocalls].description = strdup(stuff+14);
-		  tocalls[num_tocalls].len = strlen(tocalls[num_tocalls].prefix);
-	          // dw_printf("debug: %d '%s' -> '%s'\n", tocalls[num_tocalls].len, tocalls[num_tocalls].prefix, tocalls[num_tocalls].description);
-
-	          num_tocalls++;
-	        }
-	      }
-	    }
-	    fclose(fp);
+	  // printf("debug: %s\n", stuff);
 
-/*
- * Sort by decreasing length so the search will go
- * from most specific to least specific.
- * Example:  APY350 or APY008 would match those specific
- * models before getting to the more generic APY.
- */
+	  if (strlen(stuff) < 14) {
+	    continue;
+	  }
 
-#if __WIN32__
-	    qsort (tocalls, num_tocalls, sizeof(struct tocalls_s), tocall_cmp);
-#else
-	    qsort (tocalls, num_tocalls, sizeof(struct tocalls_s), (__compar_fn_t)tocall_cmp);
-#endif
+	  if (stuff[0] == ' ' && 
+		stuff[4] == ' ' &&
+		stuff[5] == ' ' &&
+		stuff[6] == 'A' && 
+		stuff[7] == 'P' && 
+		stuff[12] == ' ' &&
+		stuff[13] == ' ' ) {
+
+	    p = stuff + 6;
+	  }
+	  else if (stuff[0] == ' ' && 
+		stuff[1] == 'A' && 
+		stuff[2] == 'P' && 
+		isupper((int)(stuff[3])) &&
+		stuff[4] == ' ' &&
+		stuff[5] == ' ' &&
+		stuff[6] == ' ' &&
+		stuff[12] == ' ' &&
+		stuff[13] == ' ' ) {
+
+	    p = stuff + 1;
 	  }
 	  else {
-	    text_color_set(DW_COLOR_ERROR);
-	    dw_printf("Warning: Could not open 'tocalls.txt'.\n");
-	    dw_printf("System types in the destination field will not be decoded.\n");
+	    continue;
 	  }
 
-	
-	  first_time = 0;
+	  r = prefix;
+	  while ((isupper((int)(*p)) || isdigit((int)(*p))) && r < prefix + TOCALL_MAX_LEN) {
+	    *r++ = *p++;
+	  }
+	  *r = '\0';
+
+	  if (strlen(prefix) > 2) {
+	    // dw_printf("debug: '%s' -> '%s'\n", prefix, stuff+14);
+	    tocall_add (prefix, stuff+14);
+	  }
 	}
+	fclose(fp);
+
+} /* end load_tocalls */
 
 
-	for (n=0; n<num_tocalls; n++) {
-	  if (strncmp(dest, tocalls[n].prefix, tocalls[n].len) == 0) {
-	    strncpy (g_mfr, tocalls[n].description, sizeof(g_mfr)-1);
-	    g_mfr[sizeof(g_mfr)-1] = '\0';
-	    return;
+/*
+ * Longest prefix wins.  For example, APY350 or APY008 would
+ * match those specific models rather than the more generic APY.
+ */
+
+static void decode_tocall (decode_aprs_t *A, char *dest)
+{
+	int n = 0;
+	int best = 0;
+	char *p;
+	int k;
+
+	//dw_printf("debug: decode_tocall(\"%s\")\n", dest);
+
+	pthread_once (&tocalls_once, load_tocalls);
+
+	for (p = dest; (k = tocall_char_index(*p)) >= 0; p++) {
+	  n = tocall_trie[n].child[k];
+	  if (n == 0) {
+	    break;
 	  }
+	  if (tocall_trie[n].desc != 0) {
+	    best = tocall_trie[n].desc;
+	  }
+	}
+
+	if (best != 0) {
+	  strncpy (A->g_mfr, tocall_desc[best-1], sizeof(A->g_mfr)-1);
+	  A->g_mfr[sizeof(A->g_mfr)-1] = '\0';
 	}
 
 } /* end decode_tocall */ 
 
 
+/*------------------------------------------------------------------
+ *
+ * Function:	decode_aprs_init
+ *
+ * Purpose:	Read tocalls.txt at start up, rather than when the
+ *		first packet is received.
+ *
+ * Description:	Optional.  decode_aprs will do it if necessary.
+ *
+ *------------------------------------------------------------------*/
+
+void decode_aprs_init (void)
+{
+	pthread_once (&tocalls_once, load_tocalls);
+}
+
+
 /*------------------------------------------------------------------
  *
  * Function:	process_comment
@@ -3641,7 +3737,7 @@ static void decode_tocall (char *dest)
  *
  *		clen		- Length of comment or -1 to take it all.
  *
- * Outputs:	g_comment
+ * Outputs:	A->g_comment
  *
  * Description:	After processing fixed and possible optional parts
  *		of the message, everything left over is a comment.
@@ -3651,7 +3747,7 @@ static void decode_tocall (char *dest)
  *		There are could be some other pieces of data, with 
  *		particular formats, buried in there.
  *		Pull out those special items and put everything 
- *		else into g_comment.
+ *		else into A->g_comment.
  *
  * References:	http://www.aprs.org/info/freqspec.txt
  *
@@ -3670,58 +3766,64 @@ static void decode_tocall (char *dest)
 
 #define sign(x) (((x)>=0)?1:(-1))
 
-static void process_comment (char *pstart, int clen)
+/*
+ * No sense in recompiling the patterns and freeing every time.
+ * Compiled once, shared by all threads.  regexec doesn't modify them.
+ */
+
+static pthread_once_t comment_re_once = PTHREAD_ONCE_INIT;
+
+static regex_t freq_re;
+static regex_t dao_re;
+static regex_t alt_re;
+
+static void compile_comment_re (void)
 {
-	static int first_time = 1;
-	static regex_t freq_re;	/* These must be static! */
-	static regex_t dao_re;	/* These must be static! */
-	static regex_t alt_re;	/* These must be static! */
 	int e;
 	char emsg[100];
-#define MAXMATCH 1
-	regmatch_t match[MAXMATCH];
-	char temp[256];
 
-/*
- * No sense in recompiling the patterns and freeing every time.
- */	
-	if (first_time) 
-	{
 /*
  * Present, frequency must be at the at the beginning.
  * Others can be anywhere in the comment.
  */
 		/* incomplete */
-	  e = regcomp (&freq_re, "^[0-9A-O][0-9][0-9]\\.[0-9][0-9][0-9 ]MHz( [TCDtcd][0-9][0-9][0-9]| Toff)?( [+-][0-9][0-9][0-9])?", REG_EXTENDED);
-	  if (e) {
-	    regerror (e, &freq_re, emsg, sizeof(emsg));
-	    dw_printf("%s:%d: %s\n", __FILE__, __LINE__, emsg);
-	  }
-
-	  e = regcomp (&dao_re, "!([A-Z][0-9 ][0-9 ]|[a-z][!-} ][!-} ])!", REG_EXTENDED);
-	  if (e) {
-	    regerror (e, &dao_re, emsg, sizeof(emsg));
-	    dw_printf("%s:%d: %s\n", __FILE__, __LINE__, emsg);
-	  }
+	e = regcomp (&freq_re, "^[0-9A-O][0-9][0-9]\\.[0-9][0-9][0-9 ]MHz( [TCDtcd][0-9][0-9][0-9]| Toff)?( [+-][0-9][0-9][0-9])?", REG_EXTENDED);
+	if (e) {
+	  regerror (e, &freq_re, emsg, sizeof(emsg));
+	  dw_printf("%s:%d: %s\n", __FILE__, __LINE__, emsg);
+	}
 
-	  e = regcomp (&alt_re, "/A=[0-9][0-9][0-9][0-9][0-9][0-9]", REG_EXTENDED);
-	  if (e) {
-	    regerror (e, &alt_re, emsg, sizeof(emsg));
-	    dw_printf("%s:%d: %s\n", __FILE__, __LINE__, emsg);
-	  }
+	e = regcomp (&dao_re, "!([A-Z][0-9 ][0-9 ]|[a-z][!-} ][!-} ])!", REG_EXTENDED);
+	if (e) {
+	  regerror (e, &dao_re, emsg, sizeof(emsg));
+	  dw_printf("%s:%d: %s\n", __FILE__, __LINE__, emsg);
+	}
 
-	  first_time = 0;
+	e = regcomp (&alt_re, "/A=[0-9][0-9][0-9][0-9][0-9][0-9]", REG_EXTENDED);
+	if (e) {
+	  regerror (e, &alt_re, emsg, sizeof(emsg));
+	  dw_printf("%s:%d: %s\n", __FILE__, __LINE__, emsg);
 	}
+}
+
+
+static void process_comment (decode_aprs_t *A, char *pstart, int clen)
+{
+#define MAXMATCH 1
+	regmatch_t match[MAXMATCH];
+	char temp[256];
+
+	pthread_once (&comment_re_once, compile_comment_re);
 
 	if (clen >= 0) {
-	  assert (clen < sizeof(g_comment));
-	  memcpy (g_comment, pstart, (size_t)clen);
-	  g_comment[clen] = '\0';
+	  assert (clen < sizeof(A->g_comment));
+	  memcpy (A->g_comment, pstart, (size_t)clen);
+	  A->g_comment[clen] = '\0';
 	}
 	else {
-	  strcpy (g_comment, pstart);
+	  strcpy (A->g_comment, pstart);
 	}
-	//dw_printf("\nInitial comment='%s'\n", g_comment);
+	//dw_printf("\nInitial comment='%s'\n", A->g_comment);
 
 
 /*
@@ -3730,17 +3832,17 @@ static void process_comment (char *pstart, int clen)
  * No futher interpretation at this time.
  */
 
-	if (regexec (&freq_re, g_comment, MAXMATCH, match, 0) == 0) 
+	if (regexec (&freq_re, A->g_comment, MAXMATCH, match, 0) == 0) 
 	{
 
           //dw_printf("start=%d, end=%d\n", (int)(match[0].rm_so), (int)(match[0].rm_eo));
 
-	  strcpy (temp, g_comment + match[0].rm_eo);
+	  strcpy (temp, A->g_comment + match[0].rm_eo);
 
-	  g_comment[match[0].rm_eo] = '\0';
-          strcpy (g_freq, g_comment + match[0].rm_so);
+	  A->g_comment[match[0].rm_eo] = '\0';
+          strcpy (A->g_freq, A->g_comment + match[0].rm_so);
 
-	  strcpy (g_comment + match[0].rm_so, temp);
+	  strcpy (A->g_comment + match[0].rm_so, temp);
 	}
 
 /*
@@ -3748,12 +3850,12 @@ static void process_comment (char *pstart, int clen)
  * The !DAO! option allows another digit or [almost two] for greater resolution.
  */
 
-	if (regexec (&dao_re, g_comment, MAXMATCH, match, 0) == 0) 
+	if (regexec (&dao_re, A->g_comment, MAXMATCH, match, 0) == 0) 
 	{
 
-	  int d = g_comment[match[0].rm_so+1];
-	  int a = g_comment[match[0].rm_so+2];
-	  int o = g_comment[match[0].rm_so+3];
+	  int d = A->g_comment[match[0].rm_so+1];
+	  int a = A->g_comment[match[0].rm_so+2];
+	  int o = A->g_comment[match[0].rm_so+3];
 
           //dw_printf("start=%d, end=%d\n", (int)(match[0].rm_so), (int)(match[0].rm_eo));
 
@@ -3766,10 +3868,10 @@ static void process_comment (char *pstart, int clen)
  *		Lon:	DDD HH.HHo
  */
  	    if (isdigit(a)) {
-	      g_lat += (a - '0') / 60000.0 * sign(g_lat);
+	      A->g_lat += (a - '0') / 60000.0 * sign(A->g_lat);
 	    }
  	    if (isdigit(o)) {
-	      g_lon += (o - '0') / 60000.0 * sign(g_lon);
+	      A->g_lon += (o - '0') / 60000.0 * sign(A->g_lon);
 	    }
 	  }
 	  else if (islower(d)) 
@@ -3785,35 +3887,35 @@ static void process_comment (char *pstart, int clen)
  * to stretch the numeric range to be 0 to 99.
  */
  	    if (a >= '!' && a <= '}') {
-	      g_lat += (a - '!') * 1.1 / 600000.0 * sign(g_lat);
+	      A->g_lat += (a - '!') * 1.1 / 600000.0 * sign(A->g_lat);
 	    }
  	    if (o >= '!' && o <= '}') {
-	      g_lon += (o - '!') * 1.1 / 600000.0 * sign(g_lon);
+	      A->g_lon += (o - '!') * 1.1 / 600000.0 * sign(A->g_lon);
 	    }
 	  }
 
-	  strcpy (temp, g_comment + match[0].rm_eo);
-	  strcpy (g_comment + match[0].rm_so, temp);
+	  strcpy (temp, A->g_comment + match[0].rm_eo);
+	  strcpy (A->g_comment + match[0].rm_so, temp);
 	}
 
 /*
  * Altitude in feet.  /A=123456
  */
 
-	if (regexec (&alt_re, g_comment, MAXMATCH, match, 0) == 0) 
+	if (regexec (&alt_re, A->g_comment, MAXMATCH, match, 0) == 0) 
 	{
 
           //dw_printf("start=%d, end=%d\n", (int)(match[0].rm_so), (int)(match[0].rm_eo));
 
-	  strcpy (temp, g_comment + match[0].rm_eo);
+	  strcpy (temp, A->g_comment + match[0].rm_eo);
 
-	  g_comment[match[0].rm_eo] = '\0';
-          g_altitude = atoi(g_comment + match[0].rm_so + 3);
+	  A->g_comment[match[0].rm_eo] = '\0';
+          A->g_altitude = atoi(A->g_comment + match[0].rm_so + 3);
 
-	  strcpy (g_comment + match[0].rm_so, temp);
+	  strcpy (A->g_comment + match[0].rm_so, temp);
 	}
 
-	//dw_printf("Final comment='%s'\n", g_comment);
+	//dw_printf("Final comment='%s'\n", A->g_comment);
 
 }
 
@@ -3930,7 +4032,11 @@ int main (int argc, char *argv[])
 	    pp = ax25_from_text(stuff, 1);
 	    if (pp != NULL) 
             {
-	      decode_aprs (pp);
+	      decode_aprs_t A;
+
+	      decode_aprs (&A, pp, 0);
+	      decode_aprs_print (&A);
+
 	      ax25_delete (pp);
 	    }
 	    else 
@@ -1,5 +1,101 @@
 
 /* decode_aprs.h */
 
-extern void decode_aprs (packet_t pp);
 
+#ifndef DECODE_APRS_H
+#define DECODE_APRS_H 1
+
+#include <time.h>
+
+#include "ax25_pad.h"
+
+
+/*
+ * Information extracted from an APRS packet by decode_aprs.
+ *
+ * Previously these were static variables inside decode_aprs.c
+ * so only one packet could be decoded at a time.  Now the caller
+ * supplies one of these so different threads can decode at the same
+ * time and others, such as the IGate and digipeater, can look at the
+ * fields without parsing the information part again.
+ *
+ * Numeric values are G_UNKNOWN (from latlong.h) if not present.
+ */
+
+typedef struct decoded_aprs {
+
+	int g_quiet;			/* Suppress error messages when decoding. */
+
+	char g_msg_type[30];		/* Message type. */
+
+	char g_symbol_table;		/* The Symbol Table Identifier character selects one */
+					/* of the two Symbol Tables, or it may be used as */
+					/* single-character (alpha or numeric) overlay, as follows: */
+
+					/*	/ 	Primary Symbol Table (mostly stations) */
+
+					/* 	\ 	Alternate Symbol Table (mostly Objects) */
+
+					/*	0-9 	Numeric overlay. Symbol from Alternate Symbol */
+					/*		Table (uncompressed lat/long data format) */
+
+					/*	a-j	Numeric overlay. Symbol from Alternate */
+					/*		Symbol Table (compressed lat/long data */
+					/*		format only). i.e. a-j maps to 0-9 */
+
+					/*	A-Z	Alpha overlay. Symbol from Alternate Symbol Table */
+
+
+	char g_symbol_code;		/* Where the Symbol Table Identifier is 0-9 or A-Z (or a-j */
+					/* with compressed position data only), the symbol comes from */
+					/* the Alternate Symbol Table, and is overlaid with the */
+					/* identifier (as a single digit or a capital letter). */
+
+	double g_lat, g_lon;		/* Location, degrees.  Negative for South or West. */
+					/* Set to G_UNKNOWN if missing or error. */
+
+	char g_maidenhead[9];		/* 4 or 6 (or 8?) character maidenhead locator. */
+
+	char g_name[20];			/* Object or item name. */
+
+	time_t g_timestamp;		/* Time in the packet, converted by */
+					/* get_timestamp.  0 if none. */
+
+	float g_speed;			/* Speed in MPH.  */
+
+	float g_course;			/* 0 = North, 90 = East, etc. */
+
+	int g_power;			/* Transmitter power in watts. */
+
+	int g_height;			/* Antenna height above average terrain, feet. */
+
+	int g_gain;			/* Antenna gain in dB. */
+
+	char g_directivity[10];		/* Direction of max signal strength */
+
+	float g_range;			/* Precomputed radio range in miles. */
+
+	float g_altitude;		/* Feet above median sea level.  */
+
+	char g_mfr[80];			/* Manufacturer or application. */
+
+	char g_mic_e_status[30];		/* MIC-E message. */
+
+	char g_freq[40];			/* Frequency, tone, xmit offset */
+
+	char g_comment[256];		/* Comment. */
+
+} decode_aprs_t;
+
+
+extern void decode_aprs_init (void);
+
+extern void decode_aprs (decode_aprs_t *A, packet_t pp, int quiet);
+
+
+extern void decode_aprs_print (const decode_aprs_t *A);
+
+
+#endif
+
+/* end decode_aprs.h */
@@ -78,10 +78,10 @@
  *			+ information field
  *		but NOT the changing list of digipeaters.
  *
- *		Typically, only a checksum is kept to reduce memory 
+ *		Typically, only a 64 bit hash is kept to reduce memory 
  *		requirements and amount of compution for comparisons.
- *		There is a very very small probability that two unrelated 
- *		packets will result in the same checksum, and the
+ *		There is a vanishingly small probability that two unrelated 
+ *		packets will result in the same hash, and the
  *		undesired dropping of the packet.
  *
  * References:	Original APRS specification:
@@ -142,9 +142,8 @@ static struct {
 
 	time_t time_stamp;		/* When the packet was transmitted. */
 
-	unsigned short checksum;	/* Some sort of checksum for the */
-					/* source, destination, and information. */
-					/* is is not used anywhere else. */
+	unsigned long long fingerprint;	/* Hash of the source, destination, */
+					/* and information.  See ax25_dedupe_fingerprint. */
 
 	short xmit_channel;		/* Radio channel number. */
 
@@ -159,6 +158,25 @@ void dedupe_init (int ttl)
 }
 
 
+/*------------------------------------------------------------------------------
+ *
+ * Name:	dedupe_set_time
+ * 
+ * Purpose:	Change the retention time without forgetting history.
+ *
+ * Input:	ttl	- Number of seconds to retain information
+ *			  about recent transmissions.
+ *
+ * Description:	Used when the configuration file is read again.
+ *
+ *------------------------------------------------------------------------------*/
+
+void dedupe_set_time (int ttl)
+{
+	history_time = ttl;
+}
+
+
 /*------------------------------------------------------------------------------
  *
  * Name:	dedupe_remember
@@ -198,7 +216,7 @@ void dedupe_init (int ttl)
 void dedupe_remember (packet_t pp, int chan)
 {
 	history[insert_next].time_stamp = time(NULL);
-	history[insert_next].checksum = ax25_dedupe_crc(pp);
+	history[insert_next].fingerprint = ax25_dedupe_fingerprint(pp);
 	history[insert_next].xmit_channel = chan;
 
 	insert_next++;
@@ -225,13 +243,13 @@ void dedupe_remember (packet_t pp, int chan)
 
 int dedupe_check (packet_t pp, int chan)
 {
-	unsigned short crc = ax25_dedupe_crc(pp);
+	unsigned long long fp = ax25_dedupe_fingerprint(pp);
 	time_t now = time(NULL);
 	int j;
 
 	for (j=0; j<HISTORY_MAX; j++) {
 	  if (history[j].time_stamp >= now - history_time &&
-	      history[j].checksum == crc && 
+	      history[j].fingerprint == fp && 
 	      history[j].xmit_channel == chan) {
 	    return 1;
 	  }
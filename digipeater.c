@@ -68,6 +68,7 @@
 #include "textcolor.h"
 #include "dedupe.h"
 #include "tq.h"
+#include "rcu.h"
 
 
 static packet_t digipeat_match (packet_t pp, char *mycall_rec, char *mycall_xmit, 
@@ -75,10 +76,13 @@ static packet_t digipeat_match (packet_t pp, char *mycall_rec, char *mycall_xmit
 
 /*
  * Set by digipeater_init and used later.
+ * Replaced by digipeater_reload while other threads could be using it.
  */
 
 
-static struct digi_config_s my_config;
+static struct digi_config_s *my_config_p = NULL;
+
+static void free_config (struct digi_config_s *p);
 
 
 /*------------------------------------------------------------------------------
@@ -98,12 +102,64 @@ static struct digi_config_s my_config;
 
 void digipeater_init (struct digi_config_s *p_digi_config) 
 {
-	memcpy (&my_config, p_digi_config, sizeof(my_config));
+	my_config_p = malloc (sizeof(struct digi_config_s));
+	memcpy (my_config_p, p_digi_config, sizeof(struct digi_config_s));
 
 	dedupe_init (p_digi_config->dedupe_time);
 }
 
 
+/*------------------------------------------------------------------------------
+ *
+ * Name:	digipeater_reload
+ * 
+ * Purpose:	Switch to new rules after the configuration file was read again.
+ *
+ * Input:	p_digi_config	- Address of structure with new configuration.
+ *				  The compiled patterns now belong to the
+ *				  digipeater and must not be freed by the caller.
+ *
+ * Description:	Packets already being processed finish with the old
+ *		rules.  They are freed when nobody could be using them.
+ *		Duplicate history is kept; only the time can change.
+ *
+ *------------------------------------------------------------------------------*/
+
+void digipeater_reload (struct digi_config_s *p_digi_config) 
+{
+	struct digi_config_s *p_new, *p_old;
+
+	p_new = malloc (sizeof(struct digi_config_s));
+	memcpy (p_new, p_digi_config, sizeof(struct digi_config_s));
+
+	p_old = my_config_p;
+	__atomic_store_n (&my_config_p, p_new, __ATOMIC_RELEASE);
+	rcu_synchronize ();
+
+	dedupe_set_time (p_new->dedupe_time);
+
+	if (p_old != NULL) {
+	  free_config (p_old);
+	}
+}
+
+
+static void free_config (struct digi_config_s *p)
+{
+	int i, j;
+
+	for (i=0; i<MAX_CHANS; i++) {
+	  for (j=0; j<MAX_CHANS; j++) {
+	    if (p->enabled[i][j]) {
+	      regfree (&(p->alias[i][j]));
+	      regfree (&(p->wide[i][j]));
+	    }
+	  }
+	}
+	free (p);
+}
+
+
 
 
 /*------------------------------------------------------------------------------
@@ -127,11 +183,16 @@ void digipeater (int from_chan, packet_t pp)
 {
 	int to_chan;
 	packet_t result;
+	int r;
+	struct digi_config_s *p;
 
 
 	// dw_printf ("digipeater()\n");
+
+	r = rcu_read_lock ();
+	p = __atomic_load_n (&my_config_p, __ATOMIC_ACQUIRE);
 	
-	assert (from_chan >= 0 && from_chan < my_config.num_chans);
+	assert (from_chan >= 0 && from_chan < p->num_chans);
 
 
 /*
@@ -140,12 +201,12 @@ void digipeater (int from_chan, packet_t pp)
  * We want these to get out quickly.
  */
 
-	for (to_chan=0; to_chan<my_config.num_chans; to_chan++) {
-	  if (my_config.enabled[from_chan][to_chan]) {
+	for (to_chan=0; to_chan<p->num_chans; to_chan++) {
+	  if (p->enabled[from_chan][to_chan]) {
 	    if (to_chan == from_chan) {
-	      result = digipeat_match (pp, my_config.mycall[from_chan], my_config.mycall[to_chan], 
-			&my_config.alias[from_chan][to_chan], &my_config.wide[from_chan][to_chan], 
-			to_chan, my_config.preempt[from_chan][to_chan]);
+	      result = digipeat_match (pp, p->mycall[from_chan], p->mycall[to_chan], 
+			&p->alias[from_chan][to_chan], &p->wide[from_chan][to_chan], 
+			to_chan, p->preempt[from_chan][to_chan]);
 	      if (result != NULL) {
 		dedupe_remember (pp, to_chan);
 	        tq_append (to_chan, TQ_PRIO_0_HI, result);
@@ -161,12 +222,12 @@ void digipeater (int from_chan, packet_t pp)
  * These are lower priority
  */
 
-	for (to_chan=0; to_chan<my_config.num_chans; to_chan++) {
-	  if (my_config.enabled[from_chan][to_chan]) {
+	for (to_chan=0; to_chan<p->num_chans; to_chan++) {
+	  if (p->enabled[from_chan][to_chan]) {
 	    if (to_chan != from_chan) {
-	      result = digipeat_match (pp, my_config.mycall[from_chan], my_config.mycall[to_chan], 
-			&my_config.alias[from_chan][to_chan], &my_config.wide[from_chan][to_chan], 
-			to_chan, my_config.preempt[from_chan][to_chan]);
+	      result = digipeat_match (pp, p->mycall[from_chan], p->mycall[to_chan], 
+			&p->alias[from_chan][to_chan], &p->wide[from_chan][to_chan], 
+			to_chan, p->preempt[from_chan][to_chan]);
 	      if (result != NULL) {
 		dedupe_remember (pp, to_chan);
 	        tq_append (to_chan, TQ_PRIO_1_LO, result);
@@ -175,6 +236,8 @@ void digipeater (int from_chan, packet_t pp)
 	  }
 	}
 
+	rcu_read_unlock (r);
+
 } /* end digipeater */
 
 
@@ -49,6 +49,12 @@ struct digi_config_s {
 
 extern void digipeater_init (struct digi_config_s *p_digi_config);
 
+/*
+ * Call when configuration file has been read again.
+ */
+
+extern void digipeater_reload (struct digi_config_s *p_digi_config);
+
 /*
  * Call this for each packet received.
  * Suitable packets will be queued for transmission.
@@ -53,6 +53,9 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <netdb.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <errno.h>
 #endif
 
 
@@ -80,21 +83,40 @@
 #include "beacon.h"
 #include "ax25_pad.h"
 #include "redecode.h"
+#include "rtsched.h"
 #include "dtmf.h"
 #include "aprs_tt.h"
 #include "tt_user.h"
 #include "igate.h"
 #include "symbols.h"
 #include "dwgps.h"
+#include "airtime.h"
+#include "rxq.h"
+#include "metrics.h"
+#include "pktlog.h"
+#include "mheard.h"
 
 
 #if __WIN32__
 static BOOL cleanup_win (int);
 #else
 static void cleanup_linux (int);
+static void reload_init (char *config_file);
 #endif
 
 static void usage (char **argv);
+static void app_dispatch_rec_packet (int chan, int subchan, packet_t pp, int alevel, retry_t retries, char *spectrum);
+static void register_metrics (void);
+
+/*
+ * Performance counters for the audio input and received frames.
+ * Subchannel index is offset by one for the APRStt special case of -1.
+ */
+
+static metrics_t m_samples[MAX_CHANS];
+static metrics_t m_frames[MAX_CHANS][MAX_SUBCHANS+1];
+static metrics_t m_retries[MAX_CHANS][RETRY_TWO_SEP+1];
+
 
 #if __SSE__
 
@@ -433,6 +455,8 @@ int main (int argc, char *argv[])
  */
 
 	symbols_init ();
+	decode_aprs_init ();
+
 
 	config_init (config_file, &modem, &digi_config, &tt_config, &igate_config, &misc_config);
 
@@ -477,6 +501,12 @@ int main (int argc, char *argv[])
 	  strcpy (modem.adevice_in, input_file);
 	}
 
+/*
+ * Scheduling priority and CPU affinity for each type of thread.
+ * Must be before any threads are started.
+ */
+	rtsched_init (misc_config.thread_sched);
+
 /*
  * Open the audio source 
  *	- soundcard
@@ -494,10 +524,18 @@ int main (int argc, char *argv[])
 	  exit (1);
 	}
 
+/*
+ * Keep track of how busy the channels are.
+ * Must be before HDLC decoder which reports carrier detect.
+ */
+	airtime_init (&modem);
+
 /*
  * Initialize the AFSK demodulator and HDLC decoder.
  */
 	multi_modem_init (&modem);
+	hdlc_rec2_spill_init (misc_config.spill_file);
+
 
 /*
  * Initialize the touch tone decoder & APRStt gateway.
@@ -565,6 +603,29 @@ int main (int argc, char *argv[])
  */
 	kiss_init (&misc_config);
 
+/*
+ * Performance counters, optionally available over HTTP.
+ * After everything they look at has been initialized.
+ */
+	register_metrics ();
+	metrics_init (misc_config.metrics_port);
+
+/*
+ * List of stations heard, optionally available to other applications.
+ */
+	mheard_init (misc_config.mheard_port);
+
+/*
+ * Binary log of received frames, if configured.
+ */
+	pktlog_init (misc_config.pktlog_dir, misc_config.pktlog_segment_mb, misc_config.pktlog_max_total_mb);
+
+/*
+ * Received frames are handed off to a separate thread
+ * so the audio input is never held up.
+ */
+	rxq_init (app_dispatch_rec_packet);
+
 /* 
  * Create thread for trying to salvage frames with bad FCS.
  */
@@ -575,19 +636,47 @@ int main (int argc, char *argv[])
  */
 	beacon_init (&misc_config, &digi_config);
 
+/*
+ * Read the configuration file again when we get SIGHUP.
+ */
+#if ! __WIN32__
+	reload_init (config_file);
+#endif
+
 
 /*
  * Get sound samples and decode them.
  * Use hot attribute for all functions called for every audio sample.
  * TODO: separate function with __attribute__((hot))
+ *
+ * This is done after starting the other threads so they
+ * don't inherit the audio thread scheduling.
  */
+	rtsched_apply (RTSCHED_AUDIO);
+
 	eof = 0;
 	while ( ! eof) 
 	{
 
 	  int audio_sample;
 	  int c;
-	  char tt;
+	  static int pending = 0;
+
+	  /* The DTMF decoder is much more efficient with a batch of */
+	  /* samples at once.  A delay of a few mS doesn't matter. */
+
+#define TT_BATCH 256
+	  static float tt_batch[MAX_CHANS][TT_BATCH];
+	  static int tt_count = 0;
+
+	  /* Counting every sample would be wasteful. */
+
+	  if (++pending >= 1024) {
+	    for (c=0; c<modem.num_channels; c++) {
+	      metrics_add (m_samples[c], pending);
+	    }
+	    pending = 0;
+	  }
 
 	  for (c=0; c<modem.num_channels; c++)
 	  {
@@ -609,10 +698,23 @@ int main (int argc, char *argv[])
 	    /* only when the APRStt gateway is configured. */
 
  	    if (tt_config.obj_xmit_header[0] != '\0') {
-	      tt = dtmf_sample (c, audio_sample/16384.);
-	      if (tt != ' ') {
-	        aprs_tt_button (c, tt);
+	      tt_batch[c][tt_count] = audio_sample/16384.;
+	    }
+	  }
+
+ 	  if (tt_config.obj_xmit_header[0] != '\0') {
+	    tt_count++;
+	    if (tt_count == TT_BATCH) {
+	      for (c=0; c<modem.num_channels; c++) {
+	        char tt[TT_BATCH / 200 + 1];	/* Block size is at least 205. */
+	        int n, k;
+
+	        n = dtmf_block (c, tt_batch[c], tt_count, tt);
+	        for (k = 0; k < n; k++) {
+	          aprs_tt_button (c, tt[k]);
+	        }
 	      }
+	      tt_count = 0;
 	    }
 	  }
 
@@ -621,6 +723,8 @@ int main (int argc, char *argv[])
 
 	}
 
+	rxq_flush ();
+
 	exit (EXIT_SUCCESS);
 }
 
@@ -644,13 +748,165 @@ int main (int argc, char *argv[])
  *		spectrum - Display of how well multiple decoders did.
  *
  *
+ * Description:	Called from the audio input or redecode thread.
+ *		Just queue it up for the dispatcher thread so
+ *		we can get back to demodulating.
+ *
+ *--------------------------------------------------------------------*/
+
+
+void app_process_rec_packet (int chan, int subchan, packet_t pp, int alevel, retry_t retries, char *spectrum)  
+{
+	metrics_add (m_frames[chan][subchan+1], 1);
+	metrics_add (m_retries[chan][retries], 1);
+
+	rxq_append (chan, subchan, pp, alevel, retries, spectrum);
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        register_metrics
+ *
+ * Purpose:     Make performance counters available for modules
+ *		which are shared with other applications and
+ *		can't know about metrics.c themselves.
+ *
+ * Description:	The modules used only by this application, such
+ *		as rdq, redecode, and igate, register their own.
+ *
+ *--------------------------------------------------------------------*/
+
+static double metric_tq_count (int arg)
+{
+	return (tq_count (arg / TQ_NUM_PRIO, arg % TQ_NUM_PRIO));
+}
+
+#define AIRTIME_TX 0
+#define AIRTIME_RX 1
+#define AIRTIME_UTIL 2
+#define AIRTIME_COLLISIONS 3
+
+static double metric_airtime (int arg)
+{
+	struct airtime_stats_s s;
+
+	airtime_get_stats (arg / 4, AIRTIME_DEFAULT_WINDOW, &s);
+
+	switch (arg % 4) {
+	  case AIRTIME_TX:	return (s.tx_ms * 0.001);
+	  case AIRTIME_RX:	return (s.rx_ms * 0.001);
+	  case AIRTIME_UTIL:	return (s.utilization);
+	  default:		return (s.collisions);
+	}
+}
+
+static double metric_rxq (int arg)
+{
+	struct rxq_stats_s s;
+
+	rxq_get_stats (arg / 4, &s);
+
+	switch (arg % 4) {
+	  case 0:		return (s.appended);
+	  case 1:		return (s.overruns);
+	  case 2:		return (s.dispatched);
+	  default:		return (s.high_water);
+	}
+}
+
+static double metric_packets (int arg)
+{
+	int n, d;
+
+	ax25_get_alloc_counts (&n, &d);
+	return (arg == 0 ? n : arg == 1 ? d : n - d);
+}
+
+static void register_metrics (void)
+{
+	int c, s, r, p;
+	char labels[80];
+	static const char *prio_name[TQ_NUM_PRIO] = { "hi", "lo" };
+	static const char *producer_name[RXQ_NUM_PRODUCERS] = { "audio", "redecode" };
+
+	for (c = 0; c < modem.num_channels; c++) {
+
+	  sprintf (labels, "chan=\"%d\"", c);
+	  m_samples[c] = metrics_counter ("audio_samples_total", "Audio samples processed.", labels);
+
+	  for (s = -1; s < modem.num_subchan[c]; s++) {
+	    if (s < 0) {
+	      sprintf (labels, "chan=\"%d\",subchan=\"dtmf\"", c);
+	    }
+	    else {
+	      sprintf (labels, "chan=\"%d\",subchan=\"%d\"", c, s);
+	    }
+	    m_frames[c][s+1] = metrics_counter ("frames_received_total",
+			"Frames received with valid FCS, by demodulator.", labels);
+	  }
+
+	  for (r = RETRY_NONE; r <= RETRY_TWO_SEP; r++) {
+	    sprintf (labels, "chan=\"%d\",retry=\"%s\"", c, retry_text[r]);
+	    m_retries[c][r] = metrics_counter ("frames_retry_total",
+			"Frames received, by level of bit fixing needed.", labels);
+	  }
+
+	  for (p = 0; p < TQ_NUM_PRIO; p++) {
+	    sprintf (labels, "chan=\"%d\",prio=\"%s\"", c, prio_name[p]);
+	    metrics_func (METRICS_GAUGE, "transmit_queue_length",
+			"Frames waiting to be transmitted.", labels, metric_tq_count, c * TQ_NUM_PRIO + p);
+	  }
+
+	  sprintf (labels, "chan=\"%d\",window=\"%d\"", c, AIRTIME_DEFAULT_WINDOW);
+	  metrics_func (METRICS_GAUGE, "airtime_tx_seconds",
+			"Time our transmitter was keyed, in recent window.", labels, metric_airtime, c * 4 + AIRTIME_TX);
+	  metrics_func (METRICS_GAUGE, "airtime_rx_seconds",
+			"Time someone else was heard, in recent window.", labels, metric_airtime, c * 4 + AIRTIME_RX);
+	  metrics_func (METRICS_GAUGE, "airtime_utilization_percent",
+			"Percentage of recent window when channel was busy.", labels, metric_airtime, c * 4 + AIRTIME_UTIL);
+	  metrics_func (METRICS_GAUGE, "airtime_collisions",
+			"Carrier detected but nothing decoded, in recent window.", labels, metric_airtime, c * 4 + AIRTIME_COLLISIONS);
+	}
+
+	for (p = 0; p < RXQ_NUM_PRODUCERS; p++) {
+	  sprintf (labels, "producer=\"%s\"", producer_name[p]);
+	  metrics_func (METRICS_COUNTER, "receive_queue_appended_total",
+			"Frames put into receive queue.", labels, metric_rxq, p * 4 + 0);
+	  metrics_func (METRICS_COUNTER, "receive_queue_overruns_total",
+			"Frames discarded because receive queue was full.", labels, metric_rxq, p * 4 + 1);
+	  metrics_func (METRICS_COUNTER, "receive_queue_dispatched_total",
+			"Frames taken out of receive queue and processed.", labels, metric_rxq, p * 4 + 2);
+	  metrics_func (METRICS_GAUGE, "receive_queue_high_water",
+			"Greatest number of frames found waiting in receive queue.", labels, metric_rxq, p * 4 + 3);
+	}
+
+	metrics_func (METRICS_COUNTER, "packets_allocated_total",
+			"Packet objects created.", "", metric_packets, 0);
+	metrics_func (METRICS_COUNTER, "packets_freed_total",
+			"Packet objects destroyed.", "", metric_packets, 1);
+	metrics_func (METRICS_GAUGE, "packets_in_use",
+			"Packet objects currently in existence.", "", metric_packets, 2);
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        app_dispatch_rec_packet
+ *
+ * Purpose:     Process a received frame taken from the receive queue.
+ *
+ * Inputs:	Same as app_process_rec_packet.
+ *
  * Description:	Print decoded packet.
  *		Optionally send to another application.
  *
+ *		This runs in the receive dispatcher thread.
+ *
  *--------------------------------------------------------------------*/
 
 
-void app_process_rec_packet (int chan, int subchan, packet_t pp, int alevel, retry_t retries, char *spectrum)  
+static void app_dispatch_rec_packet (int chan, int subchan, packet_t pp, int alevel, retry_t retries, char *spectrum)  
 {	
 	
 	char stemp[500];
@@ -662,6 +918,8 @@ void app_process_rec_packet (int chan, int subchan, packet_t pp, int alevel, ret
 
 	assert (chan >= 0 && chan < MAX_CHANS);
 	assert (subchan >= -1 && subchan < MAX_SUBCHANS);
+
+	pktlog_write (chan, subchan, alevel, (int)retries, pp);
 	     
 	  
 	ax25_format_addrs (pp, stemp);
@@ -768,11 +1026,24 @@ void app_process_rec_packet (int chan, int subchan, packet_t pp, int alevel, ret
 	}
 
 /* Decode the contents of APRS frames and display in human-readable form. */
+/* Remember stations heard, but not APRStt users or anything with bad CRC. */
 
 	if (ax25_is_aprs(pp)) {
-	  decode_aprs (pp);
+
+	  decode_aprs_t A;
+
+	  decode_aprs (&A, pp, 0);
+	  decode_aprs_print (&A);
+
+	  if (retries == RETRY_NONE && subchan != -1) {
+	    mheard_save (chan, &A, pp);
+	  }
+	}
+	else if (retries == RETRY_NONE && subchan != -1) {
+	  mheard_save (chan, NULL, pp);
 	}
 
+
 /* Send to another application if connected. */
 
 	int flen;
@@ -802,7 +1073,7 @@ void app_process_rec_packet (int chan, int subchan, packet_t pp, int alevel, ret
 
 	ax25_delete (pp);
 	
-} /* end app_process_rec_packet */
+} /* end app_dispatch_rec_packet */
 
 
 /* Process control C and window close events. */
@@ -834,6 +1105,132 @@ static void cleanup_linux (int x)
 	exit(0);
 }
 
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        reload_init
+ *
+ * Purpose:     Read the configuration file again on SIGHUP.
+ *
+ * Inputs:	config_file	- Name of configuration file.
+ *
+ * Description:	Very little can be done safely in a signal handler
+ *		so it only wakes up a thread to do the work.
+ *
+ *		Digipeater rules, IGate filter / via / rate limits,
+ *		and beacons are replaced while running.
+ *		Everything else, such as audio devices, modems, PTT,
+ *		APRStt, and network ports, stays the same until restart.
+ *
+ *--------------------------------------------------------------------*/
+
+static char *reload_file;		/* Points to config_file in main, */
+					/* which lasts until the end. */
+static sem_t reload_sem;
+
+static void reload_signal (int x)
+{
+	sem_post (&reload_sem);
+}
+
+static void reload_config (void)
+{
+	struct audio_s *new_modem;
+	struct digi_config_s *new_digi;
+	struct tt_config_s *new_tt;
+	struct igate_config_s *new_igate;
+	struct misc_config_s *new_misc;
+	int j;
+
+	text_color_set(DW_COLOR_INFO);
+	dw_printf ("\nReading configuration file %s again.\n", reload_file);
+
+	new_modem = calloc (1, sizeof (struct audio_s));
+	new_digi = calloc (1, sizeof (struct digi_config_s));
+	new_tt = calloc (1, sizeof (struct tt_config_s));
+	new_igate = calloc (1, sizeof (struct igate_config_s));
+	new_misc = calloc (1, sizeof (struct misc_config_s));
+
+	if (config_init (reload_file, new_modem, new_digi, new_tt, new_igate, new_misc) != 0) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Keeping current configuration.\n");
+	  /* Only the defaults were applied.  Nothing else to free. */
+	  free (new_tt->ttloc_ptr);
+	  free (new_modem);
+	  free (new_digi);
+	  free (new_tt);
+	  free (new_igate);
+	  free (new_misc);
+	  return;
+	}
+
+/*
+ * Channels can't be added or removed without restarting the audio.
+ */
+	if (new_modem->num_channels != modem.num_channels) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Number of radio channels changed.  This takes effect after restart.\n");
+	}
+	new_digi->num_chans = modem.num_channels;
+
+	text_color_set(DW_COLOR_INFO);
+	dw_printf ("Changes to audio, modem, PTT, APRStt, and network ports take effect after restart.\n");
+
+/*
+ * These take ownership of anything allocated inside.
+ */
+	digipeater_reload (new_digi);
+	igate_reload (new_igate);
+	beacon_reload (new_misc, new_digi);
+
+	for (j=0; j<new_tt->ttloc_len; j++) {
+	  if (new_tt->ttloc_ptr[j].type == TTLOC_MACRO) {
+	    free (new_tt->ttloc_ptr[j].macro.definition);
+	  }
+	}
+	free (new_tt->ttloc_ptr);
+
+	free (new_modem);
+	free (new_digi);
+	free (new_tt);
+	free (new_igate);
+	free (new_misc);
+
+	text_color_set(DW_COLOR_INFO);
+	dw_printf ("Configuration reloaded from %s.\n", reload_file);
+}
+
+static void * reload_thread (void *arg)
+{
+	while (1) {
+	  if (sem_wait (&reload_sem) != 0) {
+	    if (errno != EINTR) {
+	      return (NULL);
+	    }
+	    continue;
+	  }
+	  reload_config ();
+	}
+}
+
+static void reload_init (char *config_file)
+{
+	pthread_t reload_tid;
+	int e;
+
+	reload_file = config_file;
+	sem_init (&reload_sem, 0, 0);
+
+	e = pthread_create (&reload_tid, NULL, reload_thread, NULL);
+	if (e != 0) {
+	  text_color_set(DW_COLOR_ERROR);
+	  perror("Could not create configuration reload thread");
+	  return;
+	}
+
+	signal (SIGHUP, reload_signal);
+}
+
 #endif
 
 
@@ -34,6 +34,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <string.h>
 #include <assert.h>
 
 #include "direwolf.h"
@@ -55,28 +56,46 @@
 #define NUM_TONES 8
 static int const dtmf_tones[NUM_TONES] = { 697, 770, 852, 941, 1209, 1336, 1477, 1633 };
 
+
+/*
+ * The 4 row tones are processed together as one vector
+ * and the 4 column tones as another.
+ * This uses the gcc vector extension so the compiler picks
+ * what the target has:  SSE or NEON registers, or plain
+ * scalar code for anything else.
+ */
+
+typedef float group_t __attribute__ ((vector_size (4 * sizeof(float))));
+
+#define ROW 0
+#define COL 1
+
 /*
  * Current state of the decoding. 
  */
 
 static struct {
-	int sample_rate;	/* Samples per sec.  Typ. 44100, 8000, etc. */
-	int block_size;		/* Number of samples to process in one block. */
-	float coef[NUM_TONES];	
+	group_t coef[2];	/* Goertzel coefficient for each tone. */
+				/* Keep vectors first for alignment. */
 
 	struct {		/* Separate for each audio channel. */
 
+		group_t Q1[2];
+		group_t Q2[2];
 		int n;		/* Samples processed in this block. */
-		float Q1[NUM_TONES];
-		float Q2[NUM_TONES];
 		char prev_dec;	
 		char debounced;
 		char prev_debounced;
 		int timeout;
 	} C[MAX_CHANS];		
+
+	int sample_rate;	/* Samples per sec.  Typ. 44100, 8000, etc. */
+	int block_size;		/* Number of samples to process in one block. */
 } D;
 
 
+static char block_done (int c, float output[NUM_TONES]);
+
 
 
 /*------------------------------------------------------------------
@@ -97,6 +116,7 @@ void dtmf_init (int sample_rate)
 {
 	int j;		/* Loop over all tones frequencies. */
 	int c;		/* Loop over all audio channels. */
+	group_t zero = { 0 };
 
 /*
  * Processing block size.
@@ -119,20 +139,18 @@ void dtmf_init (int sample_rate)
 
 	  k = D.block_size * (float)(dtmf_tones[j]) / (float)(D.sample_rate);
 
-	  D.coef[j] = 2 * cos(2 * M_PI * (float)k / (float)(D.block_size));
+	  D.coef[j/4][j%4] = 2 * cos(2 * M_PI * (float)k / (float)(D.block_size));
 
-	  assert (D.coef[j] > 0 && D.coef[j] < 2.0);
+	  assert (D.coef[j/4][j%4] > 0 && D.coef[j/4][j%4] < 2.0);
 #if DEBUG
-	  dw_printf ("%8d   %5.1f   %8.5f  \n", dtmf_tones[j], k, D.coef[j]);
+	  dw_printf ("%8d   %5.1f   %8.5f  \n", dtmf_tones[j], k, D.coef[j/4][j%4]);
 #endif
 	}
 
 	for (c=0; c<MAX_CHANS; c++) {
 	  D.C[c].n = 0;
-	  for (j=0; j<NUM_TONES; j++) {
-	    D.C[c].Q1[j] = 0;
-	    D.C[c].Q2[j] = 0;
-	  }
+	  D.C[c].Q1[ROW] = D.C[c].Q1[COL] = zero;
+	  D.C[c].Q2[ROW] = D.C[c].Q2[COL] = zero;
 	  D.C[c].prev_dec = ' ';
 	  D.C[c].debounced = ' ';
 	  D.C[c].prev_debounced = ' ';
@@ -141,6 +159,7 @@ void dtmf_init (int sample_rate)
 
 }
 
+
 /*------------------------------------------------------------------
  *
  * Name:        dtmf_sample
@@ -156,41 +175,125 @@ void dtmf_init (int sample_rate)
  *		$ after several seconds of inactivity.
  *		space between sample intervals.
  *		
+ * Description:	dtmf_block is much more efficient when samples
+ *		can be accumulated first.
+ *
+ *----------------------------------------------------------------*/
+
+char dtmf_sample (int c, float input)
+{
+	char result;
+
+	if (dtmf_block (c, &input, 1, &result) == 0) {
+	  return (' ');
+	}
+	return (result);
+}
+
+
+/*------------------------------------------------------------------
+ *
+ * Name:        dtmf_block
+ *
+ * Purpose:     Process a block of audio samples from one channel.
+ *
+ * Inputs:	c	- Audio channel number.
+ *		in	- Audio samples.
+ *		count	- Number of samples.  Any number.
+ *			  It doesn't need to line up with the
+ *			  processing intervals.
+ *
+ * Outputs:	result	- One character for each processing interval
+ *			  completed, same as dtmf_sample would return:
+ *			  0123456789ABCD*# for a button push,
+ *			  . for nothing happening, or
+ *			  $ after several seconds of inactivity.
+ *			  Must have room for count / (sample_rate / 40) + 1.
+ *
+ * Returns:     Number of characters placed in result.
+ *
+ * Description:	The filter state stays in registers for the whole
+ *		block, rather than being loaded and saved for every
+ *		sample, and all tones are done with vector operations.
  *
  *----------------------------------------------------------------*/
 				
 __attribute__((hot))
-char dtmf_sample (int c, float input)
+int dtmf_block (int c, const float *in, int count, char *result)
+{
+	group_t Q1r = D.C[c].Q1[ROW], Q1c = D.C[c].Q1[COL];
+	group_t Q2r = D.C[c].Q2[ROW], Q2c = D.C[c].Q2[COL];
+	group_t coefr = D.coef[ROW], coefc = D.coef[COL];
+	int n = D.C[c].n;
+	int nresult = 0;
+
+	while (count > 0) {
+	  int run = D.block_size - n;
+	  int i;
+
+	  if (run > count) run = count;
+
+	  for (i = 0; i < run; i++) {
+	    group_t x = { in[i], in[i], in[i], in[i] };
+	    group_t Q0r, Q0c;
+
+	    /* Same as input + Q1 * coef - Q2 but the subtraction */
+	    /* doesn't need to wait for the previous sample. */
+
+	    Q0r = Q1r * coefr + (x - Q2r);
+	    Q0c = Q1c * coefc + (x - Q2c);
+	    Q2r = Q1r;
+	    Q2c = Q1c;
+	    Q1r = Q0r;
+	    Q1c = Q0c;
+	  }
+
+	  in += run;
+	  count -= run;
+	  n += run;
+
+	  if (n == D.block_size) {
+	    group_t zero = { 0 };
+	    group_t power[2];
+	    float output[NUM_TONES];
+
+	    /* Squared magnitude for each tone.  No need for the square root. */
+
+	    power[ROW] = Q1r * Q1r + Q2r * Q2r - Q1r * Q2r * coefr;
+	    power[COL] = Q1c * Q1c + Q2c * Q2c - Q1c * Q2c * coefc;
+	    memcpy (output, power, sizeof(output));
+
+	    result[nresult++] = block_done (c, output);
+	    Q1r = Q1c = zero;
+	    Q2r = Q2c = zero;
+	    n = 0;
+	  }
+	}
+
+	D.C[c].Q1[ROW] = Q1r;
+	D.C[c].Q1[COL] = Q1c;
+	D.C[c].Q2[ROW] = Q2r;
+	D.C[c].Q2[COL] = Q2c;
+	D.C[c].n = n;
+
+	return (nresult);
+}
+
+
+/*
+ * End of processing interval.  Decide what we heard.
+ */
+
+static char block_done (int c, float output[NUM_TONES])
 {
 	int i;
-	float Q0;
-	float output[NUM_TONES];
+	int row, col;
 	char decoded;
 	char ret;
 	static const char rc2char[16] = { 	'1', '2', '3', 'A',
 						'4', '5', '6', 'B',
 						'7', '8', '9', 'C',
 						'*', '0', '#', 'D' };
-	for (i=0; i<NUM_TONES; i++) {
-	  Q0 = input + D.C[c].Q1[i] * D.coef[i] - D.C[c].Q2[i];
-	  D.C[c].Q2[i] = D.C[c].Q1[i];
-	  D.C[c].Q1[i] = Q0;
-	}
-
-/*
- * Is it time to process the block?
- */
-	D.C[c].n++;
-	if (D.C[c].n == D.block_size) {
-	  int row, col;
-
-	  for (i=0; i<NUM_TONES; i++) {
-	    output[i] = sqrt(D.C[c].Q1[i] * D.C[c].Q1[i] + D.C[c].Q2[i] * D.C[c].Q2[i] - D.C[c].Q1[i] * D.C[c].Q2[i] * D.coef[i]);
-	    D.C[c].Q1[i] = 0;
-	    D.C[c].Q2[i] = 0;
-	  }
-	  D.C[c].n = 0;
-
 
 /*
  * The input signal can vary over a couple orders of
@@ -199,81 +302,81 @@ char dtmf_sample (int c, float input)
  * See if one tone is stronger than the sum of the 
  * others in the same group multiplied by some factor.
  *
- * For perfect synthetic signals this needs to be in
- * the range of about 1.33 (very senstive) to 2.15 (very fussy).
+ * This was originally done with the magnitude.
+ * For perfect synthetic signals, that needed to be
+ * in the range of about 1.33 (very senstive) to
+ * 2.15 (very fussy) and the mid point 1.74 was used.
+ *
+ * Now we compare the power, without taking the square root,
+ * and the range is about 4.7 to 10.7.  Use 7, close to
+ * the geometric mean.
  *
  * Too low will cause false triggers on random noise.
  * Too high will won't decode less than perfect signals.
- *
- * Use the mid point 1.74 as our initial guess.
- * It might need some fine tuning for imperfect real world signals.
  */
 
 
-#define THRESHOLD 1.74
+#define THRESHOLD 7.0
 
-	  if      (output[0] > THRESHOLD * (            output[1] + output[2] + output[3])) row = 0;
-	  else if (output[1] > THRESHOLD * (output[0]             + output[2] + output[3])) row = 1;
-	  else if (output[2] > THRESHOLD * (output[0] + output[1]             + output[3])) row = 2;
-	  else if (output[3] > THRESHOLD * (output[0] + output[1] + output[2]            )) row = 3;
-	  else row = -1;
+	if      (output[0] > THRESHOLD * (            output[1] + output[2] + output[3])) row = 0;
+	else if (output[1] > THRESHOLD * (output[0]             + output[2] + output[3])) row = 1;
+	else if (output[2] > THRESHOLD * (output[0] + output[1]             + output[3])) row = 2;
+	else if (output[3] > THRESHOLD * (output[0] + output[1] + output[2]            )) row = 3;
+	else row = -1;
 
-	  if      (output[4] > THRESHOLD * (            output[5] + output[6] + output[7])) col = 0;
-	  else if (output[5] > THRESHOLD * (output[4]             + output[6] + output[7])) col = 1;
-	  else if (output[6] > THRESHOLD * (output[4] + output[5]             + output[7])) col = 2;
-	  else if (output[7] > THRESHOLD * (output[4] + output[5] + output[6]            )) col = 3;
-	  else col = -1;
+	if      (output[4] > THRESHOLD * (            output[5] + output[6] + output[7])) col = 0;
+	else if (output[5] > THRESHOLD * (output[4]             + output[6] + output[7])) col = 1;
+	else if (output[6] > THRESHOLD * (output[4] + output[5]             + output[7])) col = 2;
+	else if (output[7] > THRESHOLD * (output[4] + output[5] + output[6]            )) col = 3;
+	else col = -1;
 
-	  for (i=0; i<NUM_TONES; i++) {
+	for (i=0; i<NUM_TONES; i++) {
 #if DEBUG
-	    dw_printf ("%5.0f ", output[i]);
+	  dw_printf ("%5.0f ", output[i]);
 #endif
-	  }
-	  if (row >= 0 && col >= 0) {
-	    decoded = rc2char[row*4+col];
-	  }
-	  else {
-	    decoded = '.';
-	  }
+	}
+	if (row >= 0 && col >= 0) {
+	  decoded = rc2char[row*4+col];
+	}
+	else {
+	  decoded = '.';
+	}
 
 // Consider valid only if we get same twice in a row.
 
-	  if (decoded == D.C[c].prev_dec) {
-	    D.C[c].debounced = decoded;
-	    /* Reset timeout timer. */
-	    if (decoded != ' ') {
-	      D.C[c].timeout = ((TIMEOUT_SEC) * D.sample_rate) / D.block_size;
-	    }
+	if (decoded == D.C[c].prev_dec) {
+	  D.C[c].debounced = decoded;
+	  /* Reset timeout timer. */
+	  if (decoded != '.') {
+	    D.C[c].timeout = ((TIMEOUT_SEC) * D.sample_rate) / D.block_size;
 	  }
-	  D.C[c].prev_dec = decoded;
+	}
+	D.C[c].prev_dec = decoded;
 
 // Return only new button pushes.
 // Also report timeout after period of inactivity.
 
-	  ret = '.';
-	  if (D.C[c].debounced != D.C[c].prev_debounced) {
-	    if (D.C[c].debounced != ' ') {
-	      ret = D.C[c].debounced;
-	    }
+	ret = '.';
+	if (D.C[c].debounced != D.C[c].prev_debounced) {
+	  if (D.C[c].debounced != ' ') {
+	    ret = D.C[c].debounced;
 	  }
-	  if (ret == '.') {
-	    if (D.C[c].timeout > 0) {
-	      D.C[c].timeout--;
-	      if (D.C[c].timeout == 0) {
-	        ret = '$';
-              }
+	}
+	if (ret == '.') {
+	  if (D.C[c].timeout > 0) {
+	    D.C[c].timeout--;
+	    if (D.C[c].timeout == 0) {
+	      ret = '$';
             }
-	  }
-	  D.C[c].prev_debounced = D.C[c].debounced;
+          }
+	}
+	D.C[c].prev_debounced = D.C[c].debounced;
 
 #if DEBUG
-	  dw_printf ("     dec=%c, deb=%c, ret=%c \n", 
+	dw_printf ("     dec=%c, deb=%c, ret=%c \n",
 			decoded, D.C[c].debounced, ret);
 #endif
-	  return (ret);
-	}
-
- 	return (' ');
+	return (ret);
 }
 
 
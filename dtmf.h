@@ -5,6 +5,8 @@ void dtmf_init (int sample_rate);
 
 char dtmf_sample (int c, float input);
 
+int dtmf_block (int c, const float *in, int count, char *result);
+
 
 /* end dtmf.h */
 
@@ -32,6 +32,12 @@
  *		This has the extra benefit that the system clock can
  *		be set from the GPS signal.
  *
+ *		A separate thread waits for new data from gpsd and
+ *		publishes a copy of the most recent.  Readers never
+ *		wait for gpsd or for each other.  Anyone interested
+ *		can be notified of updates, or wait for the next one,
+ *		instead of asking over and over again.
+ *
  *		Not yet implemented for Windows.  Not sure how yet.
  *		The Windows location API is new in Windows 7.
  *		At the end of 2013, about 1/3 of Windows users are
@@ -53,6 +59,7 @@
 #include <string.h>
 #include <errno.h>
 #include <sys/time.h>
+#include <time.h>
 
 #if __WIN32__
 #include <windows.h>
@@ -83,9 +90,84 @@ static enum { INIT_NOT_YET, INIT_SUCCESS, INIT_FAILED } init_status = INIT_NOT_Y
 
 static struct gps_data_t gpsdata;
 
+/*
+ * Normally we connect to the gpsd socket and the reading thread
+ * sleeps until something arrives.
+ *
+ * If that is not available, try the shared memory export.
+ * It offers no way to wait for something new so we must look
+ * at it periodically.  This is cheap, just a memory copy, so
+ * do it often enough that the delay is not noticeable.
+ */
+
+static int using_shm = 0;
+
+#define GPS_POLL_MS 100
+
+#define GPS_WAIT_US 1000000	/* Max time in gps_waiting. */
+
+#define GPS_RECONNECT_SEC 5	/* Delay before trying again if gpsd goes away. */
+
+/*
+ * Position is considered unknown if not updated for this long.
+ */
+
+#define GPS_STALE_SEC 10
+
+/*
+ * Most recent data, published with a sequence lock.
+ *
+ * There is only one writer, the reading thread.  It makes the
+ * sequence number odd while changing the data and even again
+ * when done.  A reader copies the data and tries again if the
+ * sequence number was odd or changed while it was copying.
+ * Readers don't block the writer or each other.
+ *
+ * Those wanting to wait for the next update use the
+ * mutex and condition variable.
+ */
+
+static unsigned int latest_seq = 0;
+
+static dwgps_info_t latest;
+
+static pthread_mutex_t wait_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wait_cond;
+
+static void publish (dwgps_info_t *info);
+
+static long long now_msec (void);
+
+static void * read_gps_thread (void *arg);
+
 #endif
 #endif
 
+static dwgps_notify_t notify_func = NULL;
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        dwgps_set_notify
+ *
+ * Purpose:    	Specify function to call when new GPS data arrives.
+ *
+ * Inputs:	func	- Function with no arguments or NULL for none.
+ *
+ * Description:	This should be called before dwgps_init.
+ *		The function is called from the GPS reading thread
+ *		so it must not do anything that takes a long time.
+ *		Typically it would just wake up some other thread
+ *		which can then use dwgps_read to get the details.
+ *
+ *--------------------------------------------------------------------*/
+
+void dwgps_set_notify (dwgps_notify_t func)
+{
+	notify_func = func;
+}
+
 
 /*-------------------------------------------------------------------
  *
@@ -98,7 +180,8 @@ static struct gps_data_t gpsdata;
  * Returns:	0 = success
  *		-1 = failure
  *
- * Description:	For Linux, this maps into gps_open.
+ * Description:	For Linux, this maps into gps_open and
+ *		starts up a thread to watch for new data.
  *		Not yet implemented for Windows.
  *
  *--------------------------------------------------------------------*/
@@ -116,21 +199,49 @@ int dwgps_init (void)
 #elif ENABLE_GPS
 
 	int err;
+	pthread_t read_gps_tid;
+	pthread_condattr_t cattr;
 
-	err = gps_open (GPSD_SHARED_MEMORY, NULL, &gpsdata);
+	err = gps_open ("localhost", DEFAULT_GPSD_PORT, &gpsdata);
+	if (err == 0) {
+	  gps_stream (&gpsdata, WATCH_ENABLE | WATCH_JSON, NULL);
+	  using_shm = 0;
+	}
+	else {
+	  err = gps_open (GPSD_SHARED_MEMORY, NULL, &gpsdata);
+	  if (err != 0) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf ("Unable to connect to GPS receiver.\n");
+	    if (err == NL_NOHOST) {
+	      dw_printf ("gpsd is not running and the shared memory interface is not enabled in libgps.\n");
+	      dw_printf ("Download the gpsd source and build with 'shm_export=True' option.\n");
+	    }
+	    else {
+	      dw_printf ("%s\n", gps_errstr(errno));
+	    }
+	    init_status = INIT_FAILED;
+	    return (-1);
+	  }
+	  using_shm = 1;
+	}
+
+	memset (&latest, 0, sizeof(latest));
+	latest_seq = 0;
+
+	pthread_condattr_init (&cattr);
+	pthread_condattr_setclock (&cattr, CLOCK_MONOTONIC);
+	pthread_cond_init (&wait_cond, &cattr);
+	pthread_condattr_destroy (&cattr);
+
+	err = pthread_create (&read_gps_tid, NULL, read_gps_thread, (void *)0);
 	if (err != 0) {
 	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf ("Unable to connect to GPS receiver.\n");
-	  if (err == NL_NOHOST) {
-	    dw_printf ("Shared memory interface is not enabled in libgps.\n");
-	    dw_printf ("Download the gpsd source and build with 'shm_export=True' option.\n");
-	  }
-	  else {
-	    dw_printf ("%s\n", gps_errstr(errno));
-	  }
+	  perror("Could not create GPS reader thread");
+	  gps_close (&gpsdata);
 	  init_status = INIT_FAILED;
 	  return (-1);
 	}
+
 	init_status = INIT_SUCCESS;
 	return (0);
 #else
@@ -153,6 +264,9 @@ int dwgps_init (void)
  *
  * Purpose:    	Obtain current location from GPS receiver.
  *
+ * Description:	This returns the most recent data captured by
+ *		the reading thread so it never has to wait.
+ *
  * Outputs:	*plat		- Latitude.
  *		*plon		- Longitude.
  *		*pspeed		- Speed, knots.
@@ -167,62 +281,280 @@ int dwgps_init (void)
  *--------------------------------------------------------------------*/
 
 int dwgps_read (double *plat, double *plon, float *pspeed, float *pcourse, float *palt)
+{
+	dwgps_info_t info;
+	int fix;
+
+	fix = dwgps_snapshot (&info);
+	if (fix >= 2) {
+	  *plat = info.lat;
+	  *plon = info.lon;
+	  *pcourse = info.course;
+	  *pspeed = info.speed;
+	  if (fix >= 3) {
+	    *palt = info.alt;
+	  }
+	}
+	return (fix);
+
+} /* end dwgps_read */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        dwgps_snapshot
+ *
+ * Purpose:    	Obtain everything known about the current location.
+ *
+ * Outputs:	info	- Copy of the most recent data.
+ *			  info->seq can be used to find out whether
+ *			  anything changed since last time.
+ *
+ * Returns:	Same as info->fix.
+ *		0 if the data is too old to be trusted.
+ *
+ * Description:	This can be called from any thread and never waits.
+ *
+ *--------------------------------------------------------------------*/
+
+int dwgps_snapshot (dwgps_info_t *info)
 {
 #if __WIN32__
 
 	text_color_set(DW_COLOR_ERROR);
-	dw_printf ("Internal error, dwgps_read, shouldn't be here.\n");
+	dw_printf ("Internal error, dwgps_snapshot, shouldn't be here.\n");
+	memset (info, 0, sizeof(dwgps_info_t));
+	info->fix = -1;
 	return (-1);
 
 #elif ENABLE_GPS
 
-	int err;
+	unsigned int s1, s2;
 
 	if (init_status != INIT_SUCCESS) {
 	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf ("Internal error, dwgps_read without successful init.\n");
+	  dw_printf ("Internal error, dwgps_snapshot without successful init.\n");
+	  memset (info, 0, sizeof(dwgps_info_t));
+	  info->fix = -1;
 	  return (-1);
 	}
 
-	err = gps_read (&gpsdata);
+	do {
+	  s1 = __atomic_load_n (&latest_seq, __ATOMIC_ACQUIRE);
+	  memcpy (info, &latest, sizeof(dwgps_info_t));
+	  __atomic_thread_fence (__ATOMIC_ACQUIRE);
+	  s2 = __atomic_load_n (&latest_seq, __ATOMIC_RELAXED);
+	} while ((s1 & 1) || s1 != s2);
 
-#if DEBUG
-	dw_printf ("gps_read returns %d bytes\n", err);
+	if (info->fix >= 2 && now_msec() - info->msec > GPS_STALE_SEC * 1000LL) {
+	  /* gpsd has stopped updating.  Don't keep using old position. */
+	  info->fix = 0;
+	}
+
+	return (info->fix);
+#else
+
+	text_color_set(DW_COLOR_ERROR);
+	dw_printf ("Internal error, dwgps_snapshot, shouldn't be here.\n");
+	memset (info, 0, sizeof(dwgps_info_t));
+	info->fix = -1;
+	return (-1);
 #endif
-	if (err > 0) {
-	  if (gpsdata.status >= STATUS_FIX && gpsdata.fix.mode >= MODE_2D) {
 
-	     *plat = gpsdata.fix.latitude;
-	     *plon = gpsdata.fix.longitude;
-	     *pcourse = gpsdata.fix.track;		
-	     *pspeed = MPS_TO_KNOTS * gpsdata.fix.speed; /* libgps uses meters/sec */
+} /* end dwgps_snapshot */
 
-	     if (gpsdata.fix.mode >= MODE_3D) {
-	       *palt = gpsdata.fix.altitude;
-	       return (3);
-	     }
-	     return (2);
-	   }
 
-	   /* No fix.  Probably temporary condition. */
-	   return (0);
-	}
-	else if (err == 0) {
-	   /* No data available */
-	   return (0);
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        dwgps_wait
+ *
+ * Purpose:    	Wait for new data from the GPS receiver.
+ *
+ * Inputs:	seq		- Sequence number of the data we already
+ *				  have, from a previous dwgps_snapshot or
+ *				  dwgps_wait.  0 for none.
+ *
+ *		timeout_ms	- Give up after this many milliseconds.
+ *
+ * Outputs:	info		- Copy of the most recent data.
+ *
+ * Returns:	Same as dwgps_snapshot.
+ *		Check info->seq to see whether it is really new
+ *		or the wait timed out.
+ *
+ *--------------------------------------------------------------------*/
+
+int dwgps_wait (unsigned int seq, int timeout_ms, dwgps_info_t *info)
+{
+#if ENABLE_GPS && ! __WIN32__
+
+	struct timespec ts;
+
+	if (init_status == INIT_SUCCESS) {
+
+	  clock_gettime (CLOCK_MONOTONIC, &ts);
+	  ts.tv_sec += timeout_ms / 1000;
+	  ts.tv_nsec += (timeout_ms % 1000) * 1000000L;
+	  if (ts.tv_nsec >= 1000000000L) {
+	    ts.tv_sec++;
+	    ts.tv_nsec -= 1000000000L;
+	  }
+
+	  pthread_mutex_lock (&wait_mutex);
+	  while (__atomic_load_n (&latest_seq, __ATOMIC_ACQUIRE) / 2 == seq) {
+	    if (pthread_cond_timedwait (&wait_cond, &wait_mutex, &ts) != 0) {
+	      break;		/* Timed out. */
+	    }
+	  }
+	  pthread_mutex_unlock (&wait_mutex);
 	}
-	else {
-	  /* More serious error. */
-	  return (-1);
+#endif
+	return (dwgps_snapshot (info));
+
+} /* end dwgps_wait */
+
+
+
+#if ENABLE_GPS && ! __WIN32__
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        publish
+ *
+ * Purpose:    	Make new data available to readers.
+ *
+ * Inputs:	info	- New data.  seq and msec are filled in here.
+ *
+ * Description:	Only the reading thread calls this.
+ *
+ *--------------------------------------------------------------------*/
+
+static void publish (dwgps_info_t *info)
+{
+	unsigned int s = latest_seq;
+
+	info->seq = s / 2 + 1;
+	info->msec = now_msec();
+
+	__atomic_store_n (&latest_seq, s + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence (__ATOMIC_RELEASE);
+	memcpy (&latest, info, sizeof(dwgps_info_t));
+	__atomic_store_n (&latest_seq, s + 2, __ATOMIC_RELEASE);
+
+	pthread_mutex_lock (&wait_mutex);
+	pthread_cond_broadcast (&wait_cond);
+	pthread_mutex_unlock (&wait_mutex);
+
+	if (notify_func != NULL) {
+	  (*notify_func) ();
 	}
-#else 
+}
 
-	text_color_set(DW_COLOR_ERROR);
-	dw_printf ("Internal error, dwgps_read, shouldn't be here.\n");
-	return (-1);
+
+static long long now_msec (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ((long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        read_gps_thread
+ *
+ * Purpose:    	Capture new data from gpsd as soon as it is available.
+ *
+ * Description:	Publish each update for dwgps_snapshot and
+ *		let the interested parties know about it.
+ *
+ *		If the connection to gpsd is lost, report an
+ *		error and keep trying to get it back.
+ *
+ *--------------------------------------------------------------------*/
+
+static void * read_gps_thread (void *arg)
+{
+	int err;
+	dwgps_info_t info;
+
+	while (1) {
+
+	  if (using_shm) {
+	    SLEEP_MS (GPS_POLL_MS);
+	  }
+	  else if ( ! gps_waiting (&gpsdata, GPS_WAIT_US)) {
+	    continue;
+	  }
+
+	  err = gps_read (&gpsdata);
+
+#if DEBUG
+	  dw_printf ("gps_read returns %d bytes\n", err);
 #endif
 
-} /* end dwgps_read */
+	  /* Zero means nothing new since last time. */
+
+	  if (err == 0) {
+	    continue;
+	  }
+
+	  memset (&info, 0, sizeof(info));
+
+	  if (err < 0) {
+	    /* More serious error. */
+	    info.fix = -1;
+	    publish (&info);
+
+	    if ( ! using_shm) {
+	      gps_close (&gpsdata);
+	      while (1) {
+	        SLEEP_SEC (GPS_RECONNECT_SEC);
+	        if (gps_open ("localhost", DEFAULT_GPSD_PORT, &gpsdata) == 0) {
+	          gps_stream (&gpsdata, WATCH_ENABLE | WATCH_JSON, NULL);
+	          break;
+	        }
+	      }
+	    }
+	    continue;
+	  }
+
+	  /* Ignore satellite lists and such.  Only position reports matter here. */
+
+	  if ( ! using_shm && ! (gpsdata.set & (MODE_SET | LATLON_SET | STATUS_SET))) {
+	    continue;
+	  }
+
+	  if (gpsdata.status >= STATUS_FIX && gpsdata.fix.mode >= MODE_2D) {
+
+	    info.lat = gpsdata.fix.latitude;
+	    info.lon = gpsdata.fix.longitude;
+	    info.course = gpsdata.fix.track;
+	    info.speed = MPS_TO_KNOTS * gpsdata.fix.speed; /* libgps uses meters/sec */
+	    info.fix = 2;
+
+	    if (gpsdata.fix.mode >= MODE_3D) {
+	      info.alt = gpsdata.fix.altitude;
+	      info.fix = 3;
+	    }
+	  }
+	  else {
+	    /* No fix.  Probably temporary condition. */
+	    info.fix = 0;
+	  }
+
+	  publish (&info);
+	}
+
+	return (NULL);
+
+} /* end read_gps_thread */
+
+#endif
 
 
 /*-------------------------------------------------------------------
@@ -279,24 +611,23 @@ int main (int argc, char *argv[])
 #elif ENABLE_GPS
 	int err;
 	int fix;
-	double lat;
-	double lon;
-	float speed;
-	float course;
-	float alt;
+	dwgps_info_t info;
 
 	err = dwgps_init ();
 
 	if (err != 0) exit(1);
 
+	info.seq = 0;
+
 	while (1) {
-	  fix = dwgps_read (&lat, &lon, &speed, &course, &alt);
+	  fix = dwgps_wait (info.seq, 3000, &info);
+	  dw_printf ("#%u  ", info.seq);
 	  switch (fix) {
 	    case 3:
 	    case 2:
-	      dw_printf ("%.6f  %.6f", lat, lon);
-	      dw_printf ("  %.1f knots  %.0f degrees", speed, course);
-	      if (fix==3) dw_printf ("  altitude = %.1f meters", alt);
+	      dw_printf ("%.6f  %.6f", info.lat, info.lon);
+	      dw_printf ("  %.1f knots  %.0f degrees", info.speed, info.course);
+	      if (fix==3) dw_printf ("  altitude = %.1f meters", info.alt);
 	      dw_printf ("\n");
 	      break;
 	    case 0:
@@ -305,7 +636,6 @@ int main (int argc, char *argv[])
 	    default:
 	      dw_printf ("ERROR getting GPS information.\n");
 	  }
-	  sleep (3);
 	}
 
 
@@ -2,14 +2,41 @@
 /* dwgps.h */
 
 
+/*
+ * Most recent information from the GPS receiver.
+ */
+
+typedef struct dwgps_info_s {
+
+	int fix;		/* -1 = error, 0 = none, 2 = 2D, 3 = 3D */
+	double lat;		/* degrees */
+	double lon;
+	float speed;		/* knots */
+	float course;		/* degrees */
+	float alt;		/* meters, only for 3D fix. */
+
+	unsigned int seq;	/* Incremented each time something new */
+				/* arrives.  0 if nothing yet. */
+
+	long long msec;		/* When it was received.  Monotonic clock */
+				/* in milliseconds, not time of day. */
+} dwgps_info_t;
+
+
+typedef void (*dwgps_notify_t) (void);
+
+void dwgps_set_notify (dwgps_notify_t func);
+
 int dwgps_init (void);
 
 int dwgps_read (double *plat, double *plon, float *pspeed, float *pcourse, float *palt);
 
-void dwgps_term (void);
+int dwgps_snapshot (dwgps_info_t *info);
 
+int dwgps_wait (unsigned int seq, int timeout_ms, dwgps_info_t *info);
 
-/* end dwgps.h */
+void dwgps_term (void);
 
 
+/* end dwgps.h */
 
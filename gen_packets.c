@@ -27,6 +27,24 @@
  * Description:	Given messages are converted to audio and written 
  *		to a .WAV type audio file.
  *
+ *		Optionally, the audio can be passed through a simple
+ *		model of a radio channel to see how well the decoders
+ *		cope with real world problems:
+ *
+ *			-S	Gaussian white noise at a given signal to
+ *				noise ratio, fixed or stepped across the packets.
+ *			-T	Twist, as from mismatched pre-emphasis and
+ *				de-emphasis.
+ *			-O	Frequency offset, as for mistuned SSB.
+ *			-D	Sample clock drift between transmitter and receiver.
+ *			-C	Clipping from an overdriven sound card input.
+ *			-X	Collisions with another station transmitting
+ *				at the same time.
+ *
+ *		-G writes the "ground truth," the time and SNR of each
+ *		frame sent, so the decoder results can be scored to
+ *		obtain packet error rate curves.
+ *
  *
  * Bugs:	Most options not implemented for second audio channel.
  *
@@ -40,6 +58,7 @@
 #include <getopt.h>
 #include <string.h>
 #include <assert.h>
+#include <math.h>
 
 #include "audio.h"
 #include "ax25_pad.h"
@@ -56,6 +75,39 @@ static int g_add_noise = 0;
 static float g_noise_level = 0;
 
 
+/*
+ * Channel simulation.
+ */
+
+static int g_channel_sim = 0;		/* Set if any of the options below are used. */
+
+static int g_have_snr = 0;		/* -S signal to noise ratio, dB. */
+static float g_snr_first = 0;		/* For the first and last packet, */
+static float g_snr_last = 0;		/* stepping evenly in between. */
+
+static float g_twist_db = 0;		/* -T space tone level relative to mark, dB. */
+
+static int g_freq_offset = 0;		/* -O Hz added to both tones. */
+
+static float g_drift_ppm = 0;		/* -D transmit sample clock error, parts per million. */
+
+static int g_clip_percent = 0;		/* -C clip at this % of full scale.  0 for none. */
+
+static int g_collide_percent = 0;	/* -X % of frames hit by another station. */
+static float g_collide_db = 0;		/*    Its level relative to the wanted signal. */
+
+static unsigned int g_seed = 1;		/* -R for random number generator. */
+
+static FILE *g_truth_fp = NULL;		/* -G ground truth file. */
+
+static void sim_init (struct audio_s *pa);
+static void sim_select (int which);
+static void sim_put (int c);
+
+static void sim_flush (float snr_db, char *wanted, char *other);
+static double sim_random (void);
+
+
 
 int main(int argc, char **argv)
 {
@@ -93,6 +145,7 @@ int main(int argc, char **argv)
     FILE *input_fp = NULL;		/* File or NULL for built-in message */
 
     packet_t pp;
+    char *text;				/* One of the built-in packets. */
 
 
     strcpy (output_file, "");
@@ -110,7 +163,7 @@ int main(int argc, char **argv)
 
 	/* ':' following option character means arg is required. */
 
-        c = getopt_long(argc, argv, "gm:s:a:b:B:r:n:o:z:82",
+        c = getopt_long(argc, argv, "gm:s:a:b:B:r:n:o:z:82S:T:O:D:C:X:R:G:",
                         long_options, &option_index);
         if (c == -1)
             break;
@@ -273,6 +326,107 @@ int main(int argc, char **argv)
             dw_printf ("Output file set to %s\n", output_file);
             break;
 
+          case 'S':				/* -S signal to noise ratio, dB */
+						/*    or first,last to step across packets. */
+
+	    g_channel_sim = 1;
+	    g_have_snr = 1;
+	    if (sscanf (optarg, "%f,%f", &g_snr_first, &g_snr_last) < 2) {
+	      g_snr_last = g_snr_first;
+	    }
+            text_color_set(DW_COLOR_INFO); 
+            dw_printf ("Signal to noise ratio %.1f to %.1f dB.\n", g_snr_first, g_snr_last);
+            if (g_snr_first < -20 || g_snr_first > 100 || g_snr_last < -20 || g_snr_last > 100) {
+              text_color_set(DW_COLOR_ERROR); 
+	      dw_printf ("Use a more reasonable value in range of -20 to 100.\n");
+              exit (EXIT_FAILURE);
+            }
+            break;
+
+          case 'T':				/* -T twist, dB */
+
+	    g_channel_sim = 1;
+            g_twist_db = atof(optarg);
+            text_color_set(DW_COLOR_INFO); 
+            dw_printf ("Space tone %+.1f dB relative to mark.\n", g_twist_db);
+            if (g_twist_db < -12 || g_twist_db > 12) {
+              text_color_set(DW_COLOR_ERROR); 
+	      dw_printf ("Use a more reasonable value in range of -12 to +12.\n");
+              exit (EXIT_FAILURE);
+            }
+            break;
+
+          case 'O':				/* -O frequency Offset, Hz */
+
+            g_freq_offset = atoi(optarg);
+            text_color_set(DW_COLOR_INFO); 
+            dw_printf ("Tones offset by %+d Hz.\n", g_freq_offset);
+            if (g_freq_offset < -500 || g_freq_offset > 500) {
+              text_color_set(DW_COLOR_ERROR); 
+	      dw_printf ("Use a more reasonable value in range of -500 to +500.\n");
+              exit (EXIT_FAILURE);
+            }
+            break;
+
+          case 'D':				/* -D clock Drift, ppm */
+
+	    g_channel_sim = 1;
+            g_drift_ppm = atof(optarg);
+            text_color_set(DW_COLOR_INFO); 
+            dw_printf ("Transmit clock off by %+.0f parts per million.\n", g_drift_ppm);
+            if (g_drift_ppm < -50000 || g_drift_ppm > 50000) {
+              text_color_set(DW_COLOR_ERROR); 
+	      dw_printf ("Use a more reasonable value in range of -50000 to +50000.\n");
+              exit (EXIT_FAILURE);
+            }
+            break;
+
+          case 'C':				/* -C Clip level, % of full scale */
+
+	    g_channel_sim = 1;
+            g_clip_percent = atoi(optarg);
+            text_color_set(DW_COLOR_INFO); 
+            dw_printf ("Clip at %d%% of full scale.\n", g_clip_percent);
+            if (g_clip_percent < 1 || g_clip_percent > 100) {
+              text_color_set(DW_COLOR_ERROR); 
+	      dw_printf ("Clip level must be in range of 1 to 100.\n");
+              exit (EXIT_FAILURE);
+            }
+            break;
+
+          case 'X':				/* -X percent of frames with collision */
+						/*    optionally ,dB for other station level. */
+
+	    g_channel_sim = 1;
+	    g_collide_db = 0;
+	    sscanf (optarg, "%d,%f", &g_collide_percent, &g_collide_db);
+            text_color_set(DW_COLOR_INFO); 
+            dw_printf ("Collision for %d%% of frames, other station %+.1f dB.\n", g_collide_percent, g_collide_db);
+            if (g_collide_percent < 0 || g_collide_percent > 100) {
+              text_color_set(DW_COLOR_ERROR); 
+	      dw_printf ("Collision percentage must be in range of 0 to 100.\n");
+              exit (EXIT_FAILURE);
+            }
+            break;
+
+          case 'R':				/* -R Random number seed */
+
+            g_seed = strtoul(optarg, NULL, 10);
+            break;
+
+          case 'G':				/* -G Ground truth file */
+
+            g_truth_fp = fopen (optarg, "w");
+            if (g_truth_fp == NULL) {
+              text_color_set(DW_COLOR_ERROR); 
+ 	      dw_printf ("Can't open %s for write.\n", optarg);
+              exit (EXIT_FAILURE);
+            }
+            text_color_set(DW_COLOR_INFO); 
+            dw_printf ("Ground truth written to %s\n", optarg);
+            break;
+
+
           case '?':
 
             /* Unknown option message was already printed. */
@@ -350,7 +504,43 @@ int main(int argc, char **argv)
         }
 
 
-	gen_tone_init (&modem, amplitude);
+/*
+ * Frequency offset is simply a matter of changing the tones.
+ */
+	if (g_freq_offset != 0) {
+	  for (chan = 0; chan < MAX_CHANS; chan++) {
+	    modem.mark_freq[chan] += g_freq_offset;
+	    modem.space_freq[chan] += g_freq_offset;
+	  }
+	}
+
+	if (g_channel_sim) {
+	  if (modem.num_channels != 1) {
+            text_color_set(DW_COLOR_ERROR); 
+            dw_printf ("ERROR - Channel simulation options are only for a single audio channel.\n");
+            exit (1);
+	  }
+	  sim_init (&modem);
+	}
+	else if (g_truth_fp != NULL) {
+	  text_color_set(DW_COLOR_ERROR); 
+	  dw_printf ("Note: Ground truth is written only with channel simulation options.\n");
+	}
+
+/*
+ * The tone generator only makes 16 bit samples.  With channel
+ * simulation, the conversion to 8 bits is done on the way out.
+ */
+	if (g_channel_sim && modem.bits_per_sample == 8) {
+	  struct audio_s modem16;
+
+	  memcpy (&modem16, &modem, sizeof(modem16));
+	  modem16.bits_per_sample = 16;
+	  gen_tone_init (&modem16, amplitude);
+	}
+	else {
+	  gen_tone_init (&modem, amplitude);
+	}
 
         assert (modem.bits_per_sample == 8 || modem.bits_per_sample == 16);
         assert (modem.num_channels == 1 || modem.num_channels == 2);
@@ -386,14 +576,47 @@ int main(int argc, char **argv)
 	      hdlc_send_flags (c, 2, 1);
 	    }
 	    ax25_delete (pp);
+
+	    if (g_channel_sim) {
+	      float snr;
+	      char other[80];
+	      int collide;
+
+	      snr = g_snr_first;
+	      if (packet_count > 1) {
+	        snr += (g_snr_last - g_snr_first) * (i - 1) / (packet_count - 1);
+	      }
+
+/*
+ * Another station, which didn't hear this one, transmits at the same time.
+ */
+	      collide = sim_random() * 100 < g_collide_percent;
+	      if (collide) {
+	        sprintf (other, "W1XYZ-7>APRS:>Collision %04d", i);
+
+	        sim_select (1);
+	        pp = ax25_from_text (other, 1);
+	        flen = ax25_pack (pp, fbuf);
+	        hdlc_send_flags (0, 8, 0);
+	        hdlc_send_frame (0, fbuf, flen);
+	        hdlc_send_flags (0, 2, 1);
+	        ax25_delete (pp);
+	        sim_select (0);
+	      }
+
+	      sim_flush (snr, stemp, collide ? other : NULL);
+	    }
 	  }
 	}
 	else {
 
 /*
  * Builtin default 4 packets.
+ * With channel simulation, each one is written out as it is
+ * finished so the ground truth has a line for each.
  */
-	  pp = ax25_from_text ("WB2OSZ-1>APRS,W1AB-9,W1ABC-10,WB1ABC-15:,Hello, world!", 1);
+	  text = "WB2OSZ-1>APRS,W1AB-9,W1ABC-10,WB1ABC-15:,Hello, world!";
+	  pp = ax25_from_text (text, 1);
 	  flen = ax25_pack (pp, fbuf);
 	  for (c=0; c<modem.num_channels; c++)
 	  {
@@ -402,39 +625,62 @@ int main(int argc, char **argv)
 	      hdlc_send_flags (c, 2, 1);
 	  }
 	  ax25_delete (pp);
+	  if (g_channel_sim) {
+	    sim_flush (g_snr_first, text, NULL);
+	  }
 
 	  hdlc_send_flags (c, 8, 0);
 	
-	  pp = ax25_from_text ("WB2OSZ-1>APRS,W1AB-9*,W1ABC-10,WB1ABC-15:,Hello, world!", 1);
+	  text = "WB2OSZ-1>APRS,W1AB-9*,W1ABC-10,WB1ABC-15:,Hello, world!";
+	  pp = ax25_from_text (text, 1);
 	  flen = ax25_pack (pp, fbuf);
 	  for (c=0; c<modem.num_channels; c++)
 	  {
 	    hdlc_send_frame (c, fbuf, flen);
 	  }
 	  ax25_delete (pp);
+	  if (g_channel_sim) {
+	    sim_flush (g_snr_first, text, NULL);
+	  }
 
-	  pp = ax25_from_text ("WB2OSZ-1>APRS,W1AB-9,W1ABC-10*,WB1ABC-15:,Hello, world!", 1);
+	  text = "WB2OSZ-1>APRS,W1AB-9,W1ABC-10*,WB1ABC-15:,Hello, world!";
+	  pp = ax25_from_text (text, 1);
 	  flen = ax25_pack (pp, fbuf);
 	  for (c=0; c<modem.num_channels; c++)
 	  {
 	    hdlc_send_frame (c, fbuf, flen);
 	  }
 	  ax25_delete (pp);
+	  if (g_channel_sim) {
+	    sim_flush (g_snr_first, text, NULL);
+	  }
 
-	  pp = ax25_from_text ("WB2OSZ-1>APRS,W1AB-9,W1ABC-10,WB1ABC-15*:,Hello, world!", 1);
+	  text = "WB2OSZ-1>APRS,W1AB-9,W1ABC-10,WB1ABC-15*:,Hello, world!";
+	  pp = ax25_from_text (text, 1);
 	  flen = ax25_pack (pp, fbuf);
 	  for (c=0; c<modem.num_channels; c++)
 	  {
 	    hdlc_send_frame (c, fbuf, flen);
 	  }
 	  ax25_delete (pp);
+	  if (g_channel_sim) {
+	    sim_flush (g_snr_first, text, NULL);
+	  }
 
 	  hdlc_send_flags (c, 2, 1);
 
+	  if (g_channel_sim) {
+	    sim_flush (g_snr_first, NULL, NULL);	/* Closing flags. */
+	  }
 	}
 
 	audio_file_close();
 
+	if (g_truth_fp != NULL) {
+	  fclose (g_truth_fp);
+	}
+
+
     	return EXIT_SUCCESS;
 }
 
@@ -459,6 +705,18 @@ static void usage (char **argv)
 	dw_printf ("  -2            2 channels of audio rather than 1.\n");
 	dw_printf ("  -z <number>   Number of leading zero bits before frame.\n");
 	dw_printf ("                  Default is 12 which is .01 seconds at 1200 bits/sec.\n");
+	dw_printf ("\n");
+	dw_printf ("Channel simulation, for a single audio channel:\n");
+	dw_printf ("  -S <db>       Signal to noise ratio, noise in a 3 kHz bandwidth.\n");
+	dw_printf ("  -S <db>,<db>  SNR for first and last packet, stepping in between.\n");
+	dw_printf ("  -T <db>       Twist.  Space tone level relative to mark.\n");
+	dw_printf ("  -O <hz>       Frequency offset added to both tones.\n");
+	dw_printf ("  -D <ppm>      Transmit sample clock drift, parts per million.\n");
+	dw_printf ("  -C <number>   Clip at this percentage of full scale.\n");
+	dw_printf ("  -X <%%>[,<db>] Percentage of frames colliding with another station\n");
+	dw_printf ("                  and its level relative to the wanted signal.  Default 0 dB.\n");
+	dw_printf ("  -R <number>   Random number seed so results can be repeated.\n");
+	dw_printf ("  -G <file>     Write time, SNR, and content of each frame sent.\n");
 
 	dw_printf ("\n");
 	dw_printf ("An optional file may be specified to provide messages other than\n");
@@ -485,6 +743,11 @@ static void usage (char **argv)
 	dw_printf ("Example:  echo -n \"WB2OSZ>WORLD:Hello, world!\" | %s -a 25 -o x.wav -\n", argv[0]);
 	dw_printf ("\n");
         dw_printf ("    Read message from stdin and put quarter volume sound into the file x.wav.\n");
+	dw_printf ("\n");
+	dw_printf ("Example:  %s -n 100 -S 20,0 -T -3 -G truth.txt -o sweep.wav\n", argv[0]);
+	dw_printf ("\n");
+        dw_printf ("    100 packets with signal to noise ratio going from 20 to 0 dB and\n");
+        dw_printf ("    de-emphasis twist.  Compare decoder output to truth.txt for packet error rate.\n");
 
 	exit (EXIT_FAILURE);
 }
@@ -633,7 +896,13 @@ int audio_put (int c)
 	static short sample16;
 	int s;
 
-	if (g_add_noise) {
+	if (g_channel_sim) {
+	  sim_put (c);			/* Written later by sim_flush. */
+	  return c;
+	}
+
+	else if (g_add_noise) {
+
 
 	  if ((byte_count & 1) == 0) {
 	    sample16 = c & 0xff;		/* save lower byte. */
@@ -674,6 +943,390 @@ int audio_flush ()
 	return 0;
 }
 
+
+/*------------------------------------------------------------------
+ *
+ * Name:        sim_init
+ *
+ * Purpose:     Prepare the channel simulation.
+ *
+ * Inputs:	pa	- Modem parameters.  Tones are used to design
+ *			  the twist filter.
+ *
+ * Description:	Twist is produced by first order filters like
+ *		those used for pre-emphasis and de-emphasis:
+ *
+ *			pre:	y[n] = g * (x[n] - a * x[n-1])
+ *			de:	y[n] = g * x[n] + a * y[n-1]
+ *
+ *		One section can't tilt more than about 6 dB per octave
+ *		so we use as many identical sections as needed.  Gain g
+ *		keeps the mark tone at its original level.
+ *
+ *----------------------------------------------------------------*/
+
+#define SIM_NOISE_BW 3000.	/* SNR is for noise in this bandwidth, Hz. */
+
+#define SIM_MAX_SECTIONS 8
+
+static int sim_samples_per_sec;
+
+static int sim_bits_per_sample;	/* 8 or 16 for the output file. */
+
+static struct sim_buf_s {	/* Audio for one frame, before impairments. */
+	float *sam;		/* [0] is wanted station, [1] is interfering station. */
+	int len;
+	int alloc;
+} sim_buf[2];
+
+static int sim_which = 0;	/* Which one gen_tone is filling now. */
+
+static int twist_sections;
+static int twist_pre;		/* Boost space tone rather than cut. */
+static double twist_a, twist_g;
+static double twist_x1[SIM_MAX_SECTIONS];	/* Previous input. */
+static double twist_y1[SIM_MAX_SECTIONS];	/* Previous output. */
+
+static double drift_step;	/* Input samples per output sample. */
+static double drift_pos;	/* Input position of next output sample. */
+static float drift_prev;	/* Last sample of previous buffer. */
+
+static long sim_out_count;	/* Number of samples written to file. */
+
+static unsigned int rand_state;
+
+
+static double twist_gain (double a, double w)
+{
+	return (sqrt(1. - 2. * a * cos(w) + a * a));
+}
+
+static void sim_init (struct audio_s *pa)
+{
+	double wm, ws, want, lo, hi;
+	int n;
+
+	sim_samples_per_sec = pa->samples_per_sec;
+	sim_bits_per_sample = pa->bits_per_sample;
+
+	rand_state = g_seed ? g_seed : 1;
+
+	drift_step = 1.0 + g_drift_ppm * 1.0e-6;
+	drift_pos = 0;
+	drift_prev = 0;
+
+	twist_sections = 0;
+
+	if (g_twist_db != 0) {
+
+	  wm = 2. * M_PI * pa->mark_freq[0] / pa->samples_per_sec;
+	  ws = 2. * M_PI * pa->space_freq[0] / pa->samples_per_sec;
+
+/*
+ * Gain ratio of one section approaches sin(ws/2)/sin(wm/2) as a
+ * approaches 1.  Stay a little below that for a well behaved filter.
+ */
+	  for (n = 1; n <= SIM_MAX_SECTIONS; n++) {
+	    if (fabs(g_twist_db) / n < 0.9 * 20. * log10(fabs(sin(ws/2) / sin(wm/2)))) {
+	      twist_sections = n;
+	      break;
+	    }
+	  }
+	  if (twist_sections == 0) {
+            text_color_set(DW_COLOR_ERROR); 
+            dw_printf ("ERROR - Can't get %.1f dB twist with tones this close together.\n", g_twist_db);
+            exit (1);
+	  }
+
+/*
+ * Find coefficient by bisection.  Gain ratio increases with a.
+ */
+	  want = fabs(g_twist_db) / twist_sections;
+	  lo = 0;
+	  hi = 1;
+	  for (n = 0; n < 50; n++) {
+	    twist_a = (lo + hi) / 2;
+	    if (20. * log10(fabs(twist_gain(twist_a, ws) / twist_gain(twist_a, wm))) < want) {
+	      lo = twist_a;
+	    }
+	    else {
+	      hi = twist_a;
+	    }
+	  }
+
+	  twist_pre = ((g_twist_db > 0) == (pa->space_freq[0] > pa->mark_freq[0]));
+	  twist_g = twist_pre ? 1. / twist_gain(twist_a, wm) : twist_gain(twist_a, wm);
+
+	  text_color_set(DW_COLOR_DEBUG); 
+	  dw_printf ("Twist filter: %s-emphasis, %d section(s), a = %.4f\n",
+			twist_pre ? "pre" : "de", twist_sections, twist_a);
+	}
+
+	if (g_truth_fp != NULL) {
+	  fprintf (g_truth_fp, "# frame\tstart_sec\tend_sec\tsnr_db\trole\tpacket\n");
+	}
+
+} /* end sim_init */
+
+
+/*------------------------------------------------------------------
+ *
+ * Name:        sim_random
+ *
+ * Purpose:     Random numbers which are the same on every platform
+ *		so a given seed always produces the same file.
+ *
+ * Returns:     Uniform distribution in range of 0 to < 1.
+ *
+ *----------------------------------------------------------------*/
+
+static double sim_random (void)
+{
+	/* Xorshift, Marsaglia 2003. */
+
+	rand_state ^= rand_state << 13;
+	rand_state ^= rand_state >> 17;
+	rand_state ^= rand_state << 5;
+
+	return (rand_state / 4294967296.0);
+}
+
+
+/*------------------------------------------------------------------
+ *
+ * Name:        sim_gaussian
+ *
+ * Purpose:     Normal distribution with mean 0 and variance 1.
+ *
+ * Description:	Box-Muller method.  Second value is saved for next time.
+ *
+ *----------------------------------------------------------------*/
+
+static double sim_gaussian (void)
+{
+	static int have_spare = 0;
+	static double spare;
+	double u, v, r;
+
+	if (have_spare) {
+	  have_spare = 0;
+	  return (spare);
+	}
+
+	do {
+	  u = sim_random();
+	} while (u == 0);
+	v = sim_random();
+
+	r = sqrt(-2. * log(u));
+	spare = r * sin(2. * M_PI * v);
+	have_spare = 1;
+	return (r * cos(2. * M_PI * v));
+}
+
+
+/*------------------------------------------------------------------
+ *
+ * Name:        sim_select
+ *
+ * Purpose:     Select which buffer receives audio from gen_tone.
+ *
+ * Inputs:	which	- 0 for wanted station, 1 for interfering station.
+ *
+ *----------------------------------------------------------------*/
+
+static void sim_select (int which)
+{
+	assert (which == 0 || which == 1);
+	sim_which = which;
+}
+
+
+static void sim_grow (struct sim_buf_s *b, int len)
+{
+	if (len > b->alloc) {
+	  b->alloc = len + len / 2 + 1024;
+	  b->sam = realloc (b->sam, b->alloc * sizeof(float));
+	  if (b->sam == NULL) {
+            text_color_set(DW_COLOR_ERROR); 
+            dw_printf ("ERROR - Out of memory.\n");
+            exit (1);
+	  }
+	}
+}
+
+
+/*
+ * One byte from gen_tone.  It always makes 16 bit samples here, lower
+ * byte first.  sim_flush converts to 8 bits if that was requested.
+ */
+
+static void sim_put (int c)
+{
+	static short sample16;
+	static int upper = 0;
+	struct sim_buf_s *b = &sim_buf[sim_which];
+
+	if ( ! upper) {
+	  sample16 = c & 0xff;		/* save lower byte. */
+	}
+	else {
+	  sample16 |= (c << 8) & 0xff00;	/* insert upper byte. */
+	  sim_grow (b, b->len + 1);
+	  b->sam[b->len++] = sample16;
+	}
+	upper = ! upper;
+}
+
+
+/*------------------------------------------------------------------
+ *
+ * Name:        sim_flush
+ *
+ * Purpose:     Apply channel impairments to audio for a frame and
+ *		write it to the file.
+ *
+ * Inputs:	snr_db	- Signal to noise ratio for this frame.
+ *			  Signal power is measured for the wanted station
+ *			  alone, after twist.  Noise power is for a 3 kHz bandwidth
+ *			  so results don't depend on sample rate.
+ *
+ *		wanted	- Text of the wanted frame, for ground truth.
+ *			  NULL if not to be recorded.
+ *
+ *		other	- Text of interfering frame or NULL for none.
+ *
+ * Description:	Order is meant to follow the path of the signal:
+ *		twist from the transmitter audio path, the two stations
+ *		add over the air, receiver adds noise, then sound card
+ *		clock error and clipping.
+ *
+ *----------------------------------------------------------------*/
+
+static void sim_flush (float snr_db, char *wanted, char *other)
+{
+	static int frame_num = 0;
+	struct sim_buf_s *w = &sim_buf[0];
+	struct sim_buf_s *x = &sim_buf[1];
+	double power = 0;
+	double sigma;
+	int wanted_len = w->len;
+	int other_start = 0;
+	int other_len = x->len;
+	double clip;
+	int n, k;
+
+
+	for (k = 0; k < twist_sections; k++) {
+	  for (n = 0; n < w->len; n++) {
+	    double in = w->sam[n];
+	    double out;
+
+	    if (twist_pre) {
+	      out = twist_g * (in - twist_a * twist_x1[k]);
+	    }
+	    else {
+	      out = twist_g * in + twist_a * twist_y1[k];
+	    }
+	    twist_x1[k] = in;
+	    twist_y1[k] = out;
+	    w->sam[n] = out;
+	  }
+	}
+
+	for (n = 0; n < w->len; n++) {
+	  power += (double)w->sam[n] * w->sam[n];
+	}
+	if (w->len > 0) {
+	  power /= w->len;
+	}
+
+/*
+ * Interfering station starts somewhere during the wanted frame
+ * and can continue after it.
+ */
+	if (other != NULL && x->len > 0) {
+	  float gain = pow(10., g_collide_db / 20.);
+
+	  other_start = sim_random() * w->len * 3 / 4;
+	  if (other_start + x->len > w->len) {
+	    sim_grow (w, other_start + x->len);
+	    memset (w->sam + w->len, 0, (other_start + x->len - w->len) * sizeof(float));
+	    w->len = other_start + x->len;
+	  }
+	  for (n = 0; n < x->len; n++) {
+	    w->sam[other_start + n] += gain * x->sam[n];
+	  }
+	}
+	x->len = 0;
+
+	if (g_have_snr && power > 0) {
+	  sigma = sqrt(power / pow(10., snr_db / 10.) * (sim_samples_per_sec / 2.) / SIM_NOISE_BW);
+	  for (n = 0; n < w->len; n++) {
+	    w->sam[n] += sigma * sim_gaussian();
+	  }
+	}
+
+/*
+ * Ground truth.  Times are after the clock drift.
+ */
+	if (g_truth_fp != NULL && wanted != NULL) {
+	  double t0 = (double)sim_out_count / sim_samples_per_sec;
+	  double scale = 1.0 / (drift_step * sim_samples_per_sec);
+
+	  frame_num++;
+	  fprintf (g_truth_fp, "%d\t%.4f\t%.4f\t%.1f\t%s\t%s\n", frame_num, 
+			t0, t0 + wanted_len * scale, snr_db, "wanted", wanted);
+	  if (other != NULL) {
+	    fprintf (g_truth_fp, "%d\t%.4f\t%.4f\t%.1f\t%s\t%s\n", frame_num, 
+			t0 + other_start * scale, t0 + (other_start + other_len) * scale,
+			snr_db - g_collide_db, "other", other);
+	  }
+	}
+
+/*
+ * Resample for the clock drift, with linear interpolation, then
+ * clip and write.  Position -1 refers to last sample of previous buffer.
+ */
+	clip = g_clip_percent ? 32767. * g_clip_percent / 100. : 32767.;
+
+	while (drift_pos < w->len - 1) {
+	  int i = (int) floor(drift_pos);
+	  double frac = drift_pos - i;
+	  double a = (i < 0) ? drift_prev : w->sam[i];
+	  double s = a + frac * (w->sam[i+1] - a);
+	  int s16;
+
+	  if (s > clip) s = clip;
+	  if (s < -clip) s = -clip;
+	  s16 = (int) floor(s + 0.5);
+
+	  if (sim_bits_per_sample == 8) {
+	    int s8 = (int) floor(s / 256. + 0.5);
+
+	    if (s8 > 127) s8 = 127;
+	    putc ((s8 + 128) & 0xff, out_fp);
+	    byte_count++;
+	  }
+	  else {
+	    putc (s16 & 0xff, out_fp);
+	    putc ((s16 >> 8) & 0xff, out_fp);
+	    byte_count += 2;
+	  }
+	  sim_out_count++;
+
+	  drift_pos += drift_step;
+	}
+
+	if (w->len > 0) {
+	  drift_pos -= w->len;
+	  drift_prev = w->sam[w->len - 1];
+	}
+	w->len = 0;
+
+} /* end sim_flush */
+
+
 /*------------------------------------------------------------------
  *
  * Name:        audio_file_close
@@ -28,6 +28,8 @@
 
 #include <stdio.h>
 #include <assert.h>
+#include <errno.h>
+#include <time.h>
 
 #include "direwolf.h"
 #include "demod.h"
@@ -38,6 +40,7 @@
 #include "ax25_pad.h"
 #include "rrbb.h"
 #include "multi_modem.h"
+#include "airtime.h"
 
 
 //#define TEST 1				/* Define for unit testing. */
@@ -105,6 +108,22 @@ static struct hdlc_state_s hdlc_state[MAX_CHANS][MAX_SUBCHANS];
 
 static int num_subchan[MAX_CHANS];
 
+static volatile int composite_dcd[MAX_CHANS];	/* One bit for each subchannel with data detect. */
+
+static void dcd_change (int chan, int subchan, int state);
+
+/*
+ * Changes of the composite DCD are announced so the transmit
+ * thread can wait for them rather than polling.
+ */
+
+#if __WIN32__
+static HANDLE dcd_event[MAX_CHANS];
+#else
+static pthread_mutex_t dcd_mutex[MAX_CHANS];
+static pthread_cond_t dcd_cond[MAX_CHANS];
+#endif
+
 
 /***********************************************************************************
  *
@@ -122,15 +141,31 @@ void hdlc_rec_init (struct audio_s *pa)
 {
 	int j, k;
 	struct hdlc_state_s *H;
+#if ! __WIN32__
+	pthread_condattr_t cattr;
+#endif
 
 	//text_color_set(DW_COLOR_DEBUG);
 	//dw_printf ("hdlc_rec_init (%p) \n", pa);
 
 	assert (pa != NULL);
+
+	for (j=0; j<MAX_CHANS && ! was_init; j++) {
+#if __WIN32__
+	  dcd_event[j] = CreateEvent (NULL, 0, 0, NULL);
+#else
+	  pthread_mutex_init (&dcd_mutex[j], NULL);
+	  pthread_condattr_init (&cattr);
+	  pthread_condattr_setclock (&cattr, CLOCK_MONOTONIC);
+	  pthread_cond_init (&dcd_cond[j], &cattr);
+	  pthread_condattr_destroy (&cattr);
+#endif
+	}
 	
 	for (j=0; j<pa->num_channels; j++)
 	{
 	  num_subchan[j] = pa->num_subchan[j];
+	  composite_dcd[j] = 0;
 
 	  assert (num_subchan[j] >= 1 && num_subchan[j] < MAX_SUBCHANS);
 
@@ -241,6 +276,7 @@ void hdlc_rec_bit (int chan, int subchan, int raw, int is_scrambled, int descram
 
 	  if ( ! H->data_detect) {
 	    H->data_detect = 1;
+	    dcd_change (chan, subchan, 1);
 #if DEBUG3
 	    text_color_set(DW_COLOR_DEBUG);
 	    dw_printf ("DCD%d = 1 flags\n", chan);
@@ -253,6 +289,7 @@ void hdlc_rec_bit (int chan, int subchan, int raw, int is_scrambled, int descram
 
 	  if ( ! H->data_detect) {
 	    H->data_detect = 1;
+	    dcd_change (chan, subchan, 1);
 #if DEBUG3
 	    text_color_set(DW_COLOR_DEBUG);
 	    dw_printf ("DCD%d = 1 zero fill\n", chan);
@@ -271,6 +308,7 @@ void hdlc_rec_bit (int chan, int subchan, int raw, int is_scrambled, int descram
 	  
 	  if ( H->data_detect ) {
 	    H->data_detect = 0;
+	    dcd_change (chan, subchan, 0);
 #if DEBUG3
 	    text_color_set(DW_COLOR_DEBUG);
 	    dw_printf ("DCD%d =   0\n", chan);
@@ -446,6 +484,72 @@ void hdlc_rec_bit (int chan, int subchan, int raw, int is_scrambled, int descram
 
 
 
+/*-------------------------------------------------------------------
+ *
+ * Name:        dcd_change
+ *
+ * Purpose:     Keep track of the composite "data carrier detect"
+ *		for the channel when one of the decoders changes.
+ *
+ * Inputs:	chan	- Audio channel.
+ *
+ *		subchan	- Which decoder changed.
+ *
+ *		state	- 1 for data detected, 0 for lost.
+ *
+ * Description:	The channel is busy if ANY of the decoders thinks
+ *		so.  This is called only when an individual decoder
+ *		changes state, which is rare compared to the number
+ *		of bits, so we can afford to tell other interested
+ *		parties when the channel as a whole changes.
+ *
+ *		The update is done while holding the lock used by
+ *		hdlc_rec_dcd_wait so a change can't slip in between
+ *		the waiter testing the state and going to sleep.
+ *
+ *--------------------------------------------------------------------*/
+
+static void dcd_change (int chan, int subchan, int state)
+{
+	int old;
+	int changed;
+
+	assert (chan >= 0 && chan < MAX_CHANS);
+	assert (subchan >= 0 && subchan < MAX_SUBCHANS);
+
+#if ! __WIN32__
+	pthread_mutex_lock (&dcd_mutex[chan]);
+#endif
+	old = composite_dcd[chan] != 0;
+
+	if (state) {
+	  composite_dcd[chan] |= (1 << subchan);
+	}
+	else {
+	  composite_dcd[chan] &= ~ (1 << subchan);
+	}
+
+	changed = (composite_dcd[chan] != 0) != old;
+
+#if __WIN32__
+	if (changed) {
+	  SetEvent (dcd_event[chan]);
+	}
+#else
+	if (changed) {
+	  pthread_cond_broadcast (&dcd_cond[chan]);
+	}
+	pthread_mutex_unlock (&dcd_mutex[chan]);
+#endif
+
+	if (changed) {
+	  airtime_dcd_change (chan, ! old);
+	}
+
+} /* end dcd_change */
+
+
+
 /*-------------------------------------------------------------------
  *
  * Name:        hdlc_rec_data_detect_1
@@ -508,6 +612,78 @@ int hdlc_rec_data_detect_any (int chan)
 } /* end hdlc_rec_data_detect_any */
 
 
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        hdlc_rec_dcd_wait
+ *
+ * Purpose:     Wait for the radio channel to become busy or clear.
+ *
+ * Inputs:	chan		- Audio channel.
+ *
+ *		busy		- 1 to wait for data detected on any decoder,
+ *				  0 to wait for all of them to be quiet.
+ *
+ *		timeout_ms	- Give up after this many milliseconds.
+ *
+ * Returns:	1 if channel is in the requested state, 0 for timeout.
+ *
+ * Description:	Returns immediately if already in the requested state.
+ *		Otherwise sleep until dcd_change announces a transition
+ *		or the time is up, whichever comes first.
+ *
+ *		The timeout is measured with the monotonic clock so
+ *		it also serves as an accurate timer for slot time.
+ *
+ *		Only one thread at a time may wait on any one channel.
+ *
+ *--------------------------------------------------------------------*/
+
+int hdlc_rec_dcd_wait (int chan, int busy, int timeout_ms)
+{
+	int ok;
+
+	assert (chan >= 0 && chan < MAX_CHANS);
+
+#if __WIN32__
+	DWORD start = GetTickCount();
+	DWORD elapsed;
+
+	while ((composite_dcd[chan] != 0) != busy) {
+
+	  elapsed = GetTickCount() - start;
+	  if (elapsed >= (DWORD)timeout_ms) {
+	    break;
+	  }
+	  WaitForSingleObject (dcd_event[chan], timeout_ms - elapsed);
+	}
+	ok = (composite_dcd[chan] != 0) == busy;
+#else
+	struct timespec deadline;
+
+	clock_gettime (CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += timeout_ms / 1000;
+	deadline.tv_nsec += (timeout_ms % 1000) * 1000000;
+	if (deadline.tv_nsec >= 1000000000) {
+	  deadline.tv_sec++;
+	  deadline.tv_nsec -= 1000000000;
+	}
+
+	pthread_mutex_lock (&dcd_mutex[chan]);
+	while ((composite_dcd[chan] != 0) != busy) {
+	  if (pthread_cond_timedwait (&dcd_cond[chan], &dcd_mutex[chan], &deadline) == ETIMEDOUT) {
+	    break;
+	  }
+	}
+	ok = (composite_dcd[chan] != 0) == busy;
+	pthread_mutex_unlock (&dcd_mutex[chan]);
+#endif
+
+	return (ok);
+
+} /* end hdlc_rec_dcd_wait */
+
+
 /* end hdlc_rec.c */
 
 
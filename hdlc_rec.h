@@ -22,3 +22,5 @@ void hdlc_rec_bit (int chan, int subchan, int raw, int is_scrambled, int descram
 
 int hdlc_rec_data_detect_1 (int chan, int subchan);
 int hdlc_rec_data_detect_any (int chan);
+
+int hdlc_rec_dcd_wait (int chan, int busy, int timeout_ms);
@@ -31,6 +31,7 @@
 #include <stdio.h>
 #include <assert.h>
 #include <ctype.h>
+#include <string.h>
 
 #include "direwolf.h"
 #include "hdlc_rec2.h"
@@ -86,12 +87,104 @@ struct hdlc_state_s {
 
 
 static int try_decode (rrbb_t block, int chan, int subchan, int alevel, retry_t bits_flipped, int flip_a, int flip_b, int flip_c);
+static int try_strategy (rrbb_t block, int chan, int subchan, int alevel, retry_t strategy);
 static int try_to_fix_quick_now (rrbb_t block, int chan, int subchan, int alevel, retry_t fix_bits);
 static int sanity_check (unsigned char *buf, int blen, retry_t bits_flipped);
+static void spill (rrbb_t block, retry_t fix_bits);
 #if DEBUG
 static double dtime_now (void);
 #endif
 
+
+/*
+ * Optional file for saving blocks which could not be fixed.
+ * Demodulator threads, for different channels, and the 
+ * redecode thread can all get here at the same time.
+ */
+
+static FILE *spill_fp = NULL;
+
+#if __WIN32__
+static CRITICAL_SECTION spill_cs;
+#else
+static pthread_mutex_t spill_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+
+/***********************************************************************************
+ *
+ * Name:	hdlc_rec2_spill_init
+ *
+ * Purpose:	Open file for saving blocks of bits with bad FCS which 
+ *		could not be fixed.
+ *
+ * Inputs:	fname	- File name or empty string to disable.
+ *			  New blocks are appended if it already exists.
+ *
+ * Description:	These are for tuning the bit fixing strategies,
+ *		with the rbench application, on real failures 
+ *		without replaying the audio.
+ *
+ ***********************************************************************************/
+
+void hdlc_rec2_spill_init (char *fname)
+{
+	if (fname == NULL || strlen(fname) == 0) {
+	  return;
+	}
+
+#if __WIN32__
+	InitializeCriticalSection (&spill_cs);
+#endif
+
+	spill_fp = fopen (fname, "ab");
+	if (spill_fp == NULL) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Can't open %s for saving frames with bad FCS.\n", fname);
+	  return;
+	}
+
+	fseek (spill_fp, 0L, SEEK_END);
+	if (ftell(spill_fp) == 0) {
+	  fwrite (RRBB_FILE_MAGIC, strlen(RRBB_FILE_MAGIC), 1, spill_fp);
+	  fflush (spill_fp);
+	}
+
+	text_color_set(DW_COLOR_INFO);
+	dw_printf ("Frames with bad FCS will be saved in %s\n", fname);
+}
+
+
+static void spill (rrbb_t block, retry_t fix_bits)
+{
+	if (spill_fp == NULL) {
+	  return;
+	}
+
+#if __WIN32__
+	EnterCriticalSection (&spill_cs);
+#else
+	pthread_mutex_lock (&spill_mutex);
+#endif
+
+	if (rrbb_write (block, fix_bits, spill_fp) == 0) {
+	  fflush (spill_fp);
+	}
+	else {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Error saving frame with bad FCS.  No more will be saved.\n");
+	  fclose (spill_fp);
+	  spill_fp = NULL;
+	}
+
+#if __WIN32__
+	LeaveCriticalSection (&spill_cs);
+#else
+	pthread_mutex_unlock (&spill_mutex);
+#endif
+}
+
+
 /***********************************************************************************
  *
  * Name:	hdlc_rec2_block
@@ -184,6 +277,7 @@ void hdlc_rec2_block (rrbb_t block, retry_t fix_bits)
  */
 
 	if (fix_bits < RETRY_TWO_SEP) {
+	  spill (block, fix_bits);
 	  rrbb_delete (block); 
 	  return;
 	}
@@ -195,79 +289,114 @@ void hdlc_rec2_block (rrbb_t block, retry_t fix_bits)
 
 static int try_to_fix_quick_now (rrbb_t block, int chan, int subchan, int alevel, retry_t fix_bits)
 {
-	int ok;
-	int len, i;
+	retry_t strategy;
+
+/* 
+ * Try fixing one bit, then two adjacent bits, then three adjacent bits.
+ */
+	for (strategy = RETRY_SINGLE; strategy <= fix_bits && strategy <= RETRY_TRIPLE; strategy++) {
+	  if (try_strategy (block, chan, subchan, alevel, strategy)) {
+	    return 1;
+	  }
+	}
+
+	return 0;
+}
+
+void hdlc_rec2_try_to_fix_later (rrbb_t block, int chan, int subchan, int alevel)
+{
+	if ( ! try_strategy (block, chan, subchan, alevel, RETRY_TWO_SEP)) {
+	  spill (block, RETRY_TWO_SEP);
+	}
+}
+
+
+/***********************************************************************************
+ *
+ * Name:	hdlc_rec2_try_strategy
+ *
+ * Purpose:	Try only one strategy for fixing a block.
+ *
+ * Inputs:	block 		- Handle for bit array.
+ *		strategy	- RETRY_NONE to just decode, or which bits to flip.
+ *
+ * Returns:	True if a frame was recovered.  It will be passed along
+ *		to multi_modem_process_rec_frame as usual.
+ *
+ * Description:	For the rbench application.  Unlike hdlc_rec2_block, this
+ *		does not try the easier strategies first.
+ *		The block is not deleted.
+ *
+ ***********************************************************************************/
+
+int hdlc_rec2_try_strategy (rrbb_t block, retry_t strategy)
+{
+	return (try_strategy (block, rrbb_get_chan(block), rrbb_get_subchan(block), rrbb_get_audio_level(block), strategy));
+}
 
 
+static int try_strategy (rrbb_t block, int chan, int subchan, int alevel, retry_t strategy)
+{
+	int len, i, j;
+#if DEBUG
+	double tstart, tend;
+#endif
+
 	len = rrbb_get_len(block);
 
+	switch (strategy) {
+
+	  case RETRY_NONE:
+
+	    return (try_decode (block, chan, subchan, alevel, RETRY_NONE, -1, -1, -1));
+
 /* 
  * Try fixing one bit.   
  */
-	if (fix_bits < RETRY_SINGLE) {
-	  return 0;
-	}
+	  case RETRY_SINGLE:
 
-	for (i=0; i<len; i++) {
-	  ok = try_decode (block, chan, subchan, alevel, RETRY_SINGLE, i, -1, -1);
-	  if (ok) {
+	    for (i=0; i<len; i++) {
+	      if (try_decode (block, chan, subchan, alevel, RETRY_SINGLE, i, -1, -1)) {
 #if DEBUG
-	    text_color_set(DW_COLOR_ERROR);
-	    dw_printf ("*** Success by flipping SINGLE bit %d of %d ***\n", i, len);
+	        text_color_set(DW_COLOR_ERROR);
+	        dw_printf ("*** Success by flipping SINGLE bit %d of %d ***\n", i, len);
 #endif
-	    return 1;
-	  }
-	}
+	        return 1;
+	      }
+	    }
+	    return 0;
 
 /* 
  * Try fixing two adjacent bits.  
  */
-	if (fix_bits < RETRY_DOUBLE) {
-	  return 0;
-	}
+	  case RETRY_DOUBLE:
 
-	for (i=0; i<len-1; i++) {
-	  ok = try_decode (block, chan, subchan, alevel, RETRY_DOUBLE, i, i+1, -1);
-	  if (ok) {
+	    for (i=0; i<len-1; i++) {
+	      if (try_decode (block, chan, subchan, alevel, RETRY_DOUBLE, i, i+1, -1)) {
 #if DEBUG
-	    text_color_set(DW_COLOR_ERROR);
-	    dw_printf ("*** Success by flipping DOUBLE bit %d of %d ***\n", i, len);
+	        text_color_set(DW_COLOR_ERROR);
+	        dw_printf ("*** Success by flipping DOUBLE bit %d of %d ***\n", i, len);
 #endif
-	    return 1;
-	  }
-	}
+	        return 1;
+	      }
+	    }
+	    return 0;
 
 /*
  * Try fixing adjacent three bits.
  */
-	if (fix_bits < RETRY_TRIPLE) {
-	  return 0;
-	}
-
-	len = rrbb_get_len(block);
-	for (i=0; i<len-2; i++) {
-	  ok = try_decode (block, chan, subchan, alevel, RETRY_TRIPLE, i, i+1, i+2);
-	  if (ok) {
-#if DEBUG
-	    text_color_set(DW_COLOR_ERROR);
-	    dw_printf ("*** Success by flipping TRIPLE bit %d of %d ***\n", i, len);
-#endif
-	    return 1;
-	  }
-	}
+	  case RETRY_TRIPLE:
 
-	return 0;
-}
-
-void hdlc_rec2_try_to_fix_later (rrbb_t block, int chan, int subchan, int alevel)
-{
-	int ok;
-	int len, i;
+	    for (i=0; i<len-2; i++) {
+	      if (try_decode (block, chan, subchan, alevel, RETRY_TRIPLE, i, i+1, i+2)) {
 #if DEBUG
-	double tstart, tend;
+	        text_color_set(DW_COLOR_ERROR);
+	        dw_printf ("*** Success by flipping TRIPLE bit %d of %d ***\n", i, len);
 #endif
-
-	len = rrbb_get_len(block);
+	        return 1;
+	      }
+	    }
+	    return 0;
 
 /*
  * Two  non-adjacent ("separated") single bits.
@@ -276,36 +405,32 @@ void hdlc_rec2_try_to_fix_later (rrbb_t block, int chan, int subchan, int alevel
  * Ran up to 4.82 seconds for 1040 bits before giving up.
  * Processing time is order N squared so time goes up rapidly with larger frames.
  */
+	  case RETRY_TWO_SEP:
 
 #if DEBUG
-	tstart = dtime_now();
+	    tstart = dtime_now();
 #endif
-	len = rrbb_get_len(block);
-	for (i=0; i<len-2; i++) {
-	  int j;
-
-	  ok = 0;
-	  for (j=i+2; j<len; j++) {
-	    ok = try_decode (block, chan, subchan, alevel, RETRY_TWO_SEP, i, j, -1);  
-	    if (ok)
-	      break;
-	  }	  
-	  if (ok) {
+	    for (i=0; i<len-2; i++) {
+	      for (j=i+2; j<len; j++) {
+	        if (try_decode (block, chan, subchan, alevel, RETRY_TWO_SEP, i, j, -1)) {
 #if DEBUG
+	          tend = dtime_now();
+	          text_color_set(DW_COLOR_ERROR);
+	          dw_printf ("*** Success by flipping TWO SEPARATED bits %d and %d of %d *** %.3f sec.\n", i, j, len, tend-tstart);
+#endif
+	          return 1;
+	        }
+	      }
+	    }
+#if DEBUGx
 	    tend = dtime_now();
 	    text_color_set(DW_COLOR_ERROR);
-	    dw_printf ("*** Success by flipping TWO SEPARATED bits %d and %d of %d *** %.3f sec.\n", i, j, len, tend-tstart);
+	    dw_printf ("*** No luck flipping TWO SEPARATED bits of %d *** %.3f sec.\n", len, tend-tstart);
 #endif
-	    return;
-	  }
+	    return 0;
 	}
-#if DEBUGx
-	tend = dtime_now();
-	text_color_set(DW_COLOR_ERROR);
-	dw_printf ("*** No luck flipping TWO SEPARATED bits of %d *** %.3f sec.\n", len, tend-tstart);
-#endif
 
-	return;
+	return 0;
 }
 
 
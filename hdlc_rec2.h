@@ -13,7 +13,7 @@ typedef enum retry_e {
 		RETRY_TRIPLE=3,
 		RETRY_TWO_SEP=4 } retry_t;
 
-#if defined(DIREWOLF_C) || defined(ATEST_C) || defined(UDPTEST_C)
+#if defined(DIREWOLF_C) || defined(ATEST_C) || defined(UDPTEST_C) || defined(PKTREPLAY_C) || defined(RBENCH_C)
 
 static const char * retry_text[] = {
 		"NONE",
@@ -27,6 +27,10 @@ void hdlc_rec2_block (rrbb_t block, retry_t fix_bits);
 
 void hdlc_rec2_try_to_fix_later (rrbb_t block, int chan, int subchan, int alevel);
 
+int hdlc_rec2_try_strategy (rrbb_t block, retry_t strategy);
+
+void hdlc_rec2_spill_init (char *fname);
+
 /* Provided by the top level application to process a complete frame. */
 
 void app_process_rec_packet (int chan, int subchan, packet_t pp, int level, retry_t retries, char *spectrum);
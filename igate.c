@@ -96,7 +96,19 @@
 #include "digipeater.h"
 #include "tq.h"
 #include "igate.h"
+#include "rtsched.h"
+#include "metrics.h"
 #include "latlong.h"
+#include "airtime.h"
+#include "rcu.h"
+#include "mheard.h"
+#include "pfilter.h"
+
+#if ! ITEST
+#include "server.h"
+#include "kissnet.h"
+#include "kiss.h"
+#endif
 
 
 
@@ -109,7 +121,9 @@ static void * igate_recv_thread (void *arg);
 #endif
 
 static void send_msg_to_server (char *msg);
-static void xmit_packet (char *message);
+static void from_server (char *message);
+static void to_clients (int chan, char *payload);
+static void xmit_packet (packet_t pp3, char *payload, struct igate_config_s *p);
 
 static void rx_to_ig_init (void);
 static void rx_to_ig_remember (packet_t pp);
@@ -117,7 +131,7 @@ static int rx_to_ig_allow (packet_t pp);
 
 static void ig_to_tx_init (void);
 static void ig_to_tx_remember (packet_t pp);
-static int ig_to_tx_allow (packet_t pp);
+static int ig_to_tx_allow (packet_t pp, struct igate_config_s *p);
 
 
 /* 
@@ -202,6 +216,8 @@ int main (int argc, char *argv[])
 	strcpy (igate_config.t2_login, "WB2OSZ-JL");
 	strcpy (igate_config.t2_passcode, "-1");
 	igate_config.t2_filter = strdup ("r/1/2/3");
+	igate_config.tx_filter = strdup ("t/m -b/N0CALL");
+	igate_config.client_filter = strdup ("t/mp");
 	
 	igate_config.tx_chan = 0;
 	strcpy (igate_config.tx_via, ",WIDE2-1");
@@ -273,6 +289,14 @@ int main (int argc, char *argv[])
 
 static struct igate_config_s g_config;
 
+/*
+ * Settings which can be changed by igate_reload while running:
+ * server filter, transmit via path, and transmit rate limits.
+ * Use these from here rather than g_config.
+ */
+
+static struct igate_config_s *g_live_p;
+
 static int g_num_chans;			/* Number of radio channels. */
 
 static char g_mycall[MAX_CHANS][AX25_MAX_ADDR_LEN];
@@ -283,7 +307,7 @@ static char g_mycall[MAX_CHANS][AX25_MAX_ADDR_LEN];
 
 /*
  * Statistics.  
- * TODO: need print function.
+ * Available as performance counters.  See metrics.c.
  */
 
 static int stats_failed_connect;	/* Number of times we tried to connect to */
@@ -316,6 +340,52 @@ static int stats_tx_igate_packets;	/* Number of packets from IGate server. */
 static int stats_rf_xmit_packets;	/* Number of packets passed along to radio */
 					/* after rate limiting or other restrictions. */
 
+static int stats_client_packets;	/* Number of packets from IGate server */
+					/* passed along to client applications. */
+
+static int stats_log_only_packets;	/* Number of packets from IGate server */
+					/* which were only displayed. */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        compile_filters
+ *
+ * Purpose:     Prepare the IGTXFILTER and IGCLIENTFILTER for use.
+ *
+ * Inputs:	p		- IGate configuration.
+ *
+ * Outputs:	p->tx_pf, p->client_pf
+ *
+ * Description:	The configuration file reader already checked them
+ *		so there shouldn't be any errors here.
+ *
+ *--------------------------------------------------------------------*/
+
+static void compile_filters (struct igate_config_s *p)
+{
+	char errmsg[200];
+
+	p->tx_pf = NULL;
+	p->client_pf = NULL;
+
+	if (p->tx_filter != NULL) {
+	  p->tx_pf = pfilter_compile (p->tx_filter, errmsg, sizeof(errmsg));
+	  if (p->tx_pf == NULL) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf ("IGTXFILTER: %s\n", errmsg);
+	  }
+	}
+
+	if (p->client_filter != NULL) {
+	  p->client_pf = pfilter_compile (p->client_filter, errmsg, sizeof(errmsg));
+	  if (p->client_pf == NULL) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf ("IGCLIENTFILTER: %s\n", errmsg);
+	  }
+	}
+}
 
 
 /*-------------------------------------------------------------------
@@ -370,6 +440,29 @@ void igate_init (struct igate_config_s *p_igate_config, struct digi_config_s *p_
 	stats_downlink_bytes = 0;	
 	stats_tx_igate_packets = 0;	
 	stats_rf_xmit_packets = 0;
+	stats_client_packets = 0;
+	stats_log_only_packets = 0;
+
+	metrics_int (METRICS_COUNTER, "igate_connect_failures_total",
+			"Attempts to connect to an IGate server that failed.", "", &stats_failed_connect);
+	metrics_int (METRICS_COUNTER, "igate_connects_total",
+			"Successful connections to an IGate server.", "", &stats_connects);
+	metrics_int (METRICS_COUNTER, "igate_rf_recv_packets_total",
+			"Candidate packets from the radio.", "", &stats_rf_recv_packets);
+	metrics_int (METRICS_COUNTER, "igate_rx_igate_packets_total",
+			"Packets passed along to the IGate server after filtering.", "", &stats_rx_igate_packets);
+	metrics_int (METRICS_COUNTER, "igate_uplink_bytes_total",
+			"Bytes sent to the IGate server.", "", &stats_uplink_bytes);
+	metrics_int (METRICS_COUNTER, "igate_downlink_bytes_total",
+			"Bytes received from the IGate server.", "", &stats_downlink_bytes);
+	metrics_int (METRICS_COUNTER, "igate_tx_igate_packets_total",
+			"Packets received from the IGate server.", "", &stats_tx_igate_packets);
+	metrics_int (METRICS_COUNTER, "igate_rf_xmit_packets_total",
+			"Packets from the IGate server passed along to the radio.", "", &stats_rf_xmit_packets);
+	metrics_int (METRICS_COUNTER, "igate_client_packets_total",
+			"Packets from the IGate server passed along to client applications.", "", &stats_client_packets);
+	metrics_int (METRICS_COUNTER, "igate_log_only_packets_total",
+			"Packets from the IGate server which were only displayed.", "", &stats_log_only_packets);
 	
 	rx_to_ig_init ();
 	ig_to_tx_init ();
@@ -378,6 +471,10 @@ void igate_init (struct igate_config_s *p_igate_config, struct digi_config_s *p_
  */
 	memcpy (&g_config, p_igate_config, sizeof (g_config));
 
+	g_live_p = malloc (sizeof (struct igate_config_s));
+	memcpy (g_live_p, p_igate_config, sizeof (struct igate_config_s));
+	compile_filters (g_live_p);
+
 	g_num_chans = p_digi_config->num_chans;
 	assert (g_num_chans >= 1 && g_num_chans <= MAX_CHANS);
 	for (j=0; j<g_num_chans; j++) {
@@ -503,10 +600,14 @@ static void * connnect_thread (void *arg)
 	int err;
 	char server_port_str[12];	/* text form of port number */
 	char ipaddr_str[46];		/* text form of IP address */
+	int r;
+	struct igate_config_s *p;
 #if __WIN32__
 	WSADATA wsadata;
 #endif
 
+	rtsched_apply (RTSCHED_IGATE);
+
 	sprintf (server_port_str, "%d", g_config.t2_server_port);
 #if DEBUGx
 	text_color_set(DW_COLOR_DEBUG);
@@ -710,10 +811,13 @@ static void * connnect_thread (void *arg)
 	      sprintf (stemp, "user %s pass %s vers Dire-Wolf %d.%d", 
 			g_config.t2_login, g_config.t2_passcode,
 			MAJOR_VERSION, MINOR_VERSION);
-	      if (g_config.t2_filter != NULL) {
+	      r = rcu_read_lock ();
+	      p = __atomic_load_n (&g_live_p, __ATOMIC_ACQUIRE);
+	      if (p->t2_filter != NULL) {
 	        strcat (stemp, " filter ");
-	        strcat (stemp, g_config.t2_filter);
+	        strcat (stemp, p->t2_filter);
 	      }
+	      rcu_read_unlock (r);
 	      strcat (stemp, "\r\n");
 	      send_msg_to_server (stemp);
 
@@ -753,6 +857,81 @@ static void * connnect_thread (void *arg)
 
 
 
+/*-------------------------------------------------------------------
+ *
+ * Name:        igate_reload
+ *
+ * Purpose:     Use new settings after the configuration file was read again.
+ *
+ * Inputs:	p_igate_config	- New IGate configuration.
+ *				  The filter strings now belong to the IGate
+ *				  and must not be freed by the caller.
+ *
+ * Description:	The filters, transmit via path, and rate limits are
+ *		used right away.  If IGFILTER changed and we are
+ *		connected, the server is told about it.
+ *
+ *		The server, login, and transmit channel stay the
+ *		same until the application is restarted.
+ *
+ *--------------------------------------------------------------------*/
+
+void igate_reload (struct igate_config_s *p_igate_config)
+{
+	struct igate_config_s *p_new, *p_old;
+	char stemp[256];
+
+	if (strcmp(p_igate_config->t2_server_name, g_config.t2_server_name) != 0 ||
+	    p_igate_config->t2_server_port != g_config.t2_server_port ||
+	    strcmp(p_igate_config->t2_login, g_config.t2_login) != 0 ||
+	    strcmp(p_igate_config->t2_passcode, g_config.t2_passcode) != 0 ||
+	    p_igate_config->tx_chan != g_config.tx_chan) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Changes to IGate server, login, or transmit channel take effect after restart.\n");
+	}
+
+	if (g_live_p == NULL) {
+	  /* igate_init was not called. */
+	  free (p_igate_config->t2_filter);
+	  free (p_igate_config->tx_filter);
+	  free (p_igate_config->client_filter);
+	  return;
+	}
+
+	p_new = malloc (sizeof (struct igate_config_s));
+	memcpy (p_new, p_igate_config, sizeof (struct igate_config_s));
+	compile_filters (p_new);
+
+	p_old = g_live_p;
+	__atomic_store_n (&g_live_p, p_new, __ATOMIC_RELEASE);
+	rcu_synchronize ();
+
+	if (p_new->t2_filter != NULL && ok_to_send &&
+	    (p_old->t2_filter == NULL || strcmp(p_new->t2_filter, p_old->t2_filter) != 0)) {
+
+	  snprintf (stemp, sizeof(stemp), "#filter %s\r\n", p_new->t2_filter);
+	  send_msg_to_server (stemp);
+	}
+
+/* The first one shares the filter strings with g_config.  Don't free them twice. */
+
+	if (p_old->t2_filter != g_config.t2_filter) {
+	  free (p_old->t2_filter);
+	}
+	if (p_old->tx_filter != g_config.tx_filter) {
+	  free (p_old->tx_filter);
+	}
+	if (p_old->client_filter != g_config.client_filter) {
+	  free (p_old->client_filter);
+	}
+	pfilter_free (p_old->tx_pf);
+	pfilter_free (p_old->client_pf);
+	free (p_old);
+
+} /* end igate_reload */
+
+
+
 
 /*-------------------------------------------------------------------
  *
@@ -1105,6 +1284,8 @@ static void * igate_recv_thread (void *arg)
 	dw_printf ("igate_recv_thread ( socket = %d )\n", igate_sock);
 #endif
 
+	rtsched_apply (RTSCHED_IGATE);
+
 	while (1) {
 
 	  len = 0;
@@ -1166,7 +1347,7 @@ static void * igate_recv_thread (void *arg)
 	    if (len >=2 && message[len-1] == '\n') { message[len-1] = '\0'; len--; }
 	    if (len >=1 && message[len-1] == '\r') { message[len-1] = '\0'; len--; }
 
-	    xmit_packet ((char*)message);
+	    from_server ((char*)message);
 	  }
 
 	}  /* while (1) */
@@ -1177,33 +1358,47 @@ static void * igate_recv_thread (void *arg)
 
 /*-------------------------------------------------------------------
  *
- * Name:        xmit_packet
+ * Name:        from_server
  *
- * Purpose:     Convert text string, from IGate server, to third party
- *		packet and send to transmit queue.
+ * Purpose:     Decide where a packet from the IGate server should go.
  *
  * Inputs:	message		- As sent by the server.  
  *
+ * Description:	The server sends everything selected by IGFILTER and it
+ *		has already been displayed.  Some of it might also go
+ *		to the radio (IGTXFILTER) and some to client
+ *		applications (IGCLIENTFILTER).  The rest is only
+ *		for the log.
+ *
+ *		The packet is parsed once here and the same packet
+ *		object is used for all of the decisions.
+ *
  *--------------------------------------------------------------------*/
 
-static void xmit_packet (char *message)
+static void from_server (char *message)
 {
 	packet_t pp3;
 	char payload[500];	/* what is max len? */
 	char *pinfo = NULL;
 	int info_len;
+	int r;
+	struct igate_config_s *p;
+	int to_client, to_rf;
+
+	stats_tx_igate_packets++;
+
+	r = rcu_read_lock ();
+	p = __atomic_load_n (&g_live_p, __ATOMIC_ACQUIRE);
 
 /*
- * Is IGate to Radio direction enabled?
+ * Don't bother parsing if it is not going anywhere.
  */
-	if (g_config.tx_chan == -1) {
+	if (g_config.tx_chan == -1 && p->client_pf == NULL) {
+	  stats_log_only_packets++;
+	  rcu_read_unlock (r);
 	  return;
 	}
 
-	stats_tx_igate_packets++;
-
-	assert (g_config.tx_chan >= 0 && g_config.tx_chan < MAX_CHANS);
-
 /*
  * Try to parse it into a packet object.
  * Bug:  Up to 8 digipeaters are allowed in radio format.
@@ -1214,6 +1409,17 @@ static void xmit_packet (char *message)
 	  text_color_set(DW_COLOR_ERROR);
 	  dw_printf ("Tx IGate: Could not parse message from server.\n");
 	  dw_printf ("%s\n", message);
+	  rcu_read_unlock (r);
+	  return;
+	}
+
+	to_client = p->client_pf != NULL && pfilter_match (p->client_pf, pp3);
+	to_rf = g_config.tx_chan != -1 && (p->tx_pf == NULL || pfilter_match (p->tx_pf, pp3));
+
+	if ( ! to_client && ! to_rf) {
+	  stats_log_only_packets++;
+	  rcu_read_unlock (r);
+	  ax25_delete (pp3);
 	  return;
 	}
 
@@ -1234,7 +1440,7 @@ static void xmit_packet (char *message)
  */
 	ax25_set_addr (pp3, AX25_REPEATER_1, "TCPIP");
 	ax25_set_h (pp3, AX25_REPEATER_1);
-	ax25_set_addr (pp3, AX25_REPEATER_2, g_mycall[g_config.tx_chan]); 
+	ax25_set_addr (pp3, AX25_REPEATER_2, g_mycall[g_config.tx_chan == -1 ? 0 : g_config.tx_chan]); 
 	ax25_set_h (pp3, AX25_REPEATER_2);
 
 /*
@@ -1247,18 +1453,102 @@ static void xmit_packet (char *message)
 	text_color_set(DW_COLOR_DEBUG);
 	dw_printf ("Tx IGate: payload=%s\n", payload);
 #endif
-	
+
+	if (to_client) {
+	  to_clients (g_config.tx_chan == -1 ? 0 : g_config.tx_chan, payload);
+	}
+
+	if (to_rf) {
+	  xmit_packet (pp3, payload, p);
+	}
+
+	rcu_read_unlock (r);
+
+	ax25_delete (pp3);
+
+} /* end from_server */
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        to_clients
+ *
+ * Purpose:     Send third party packet, from IGate server, to
+ *		client applications as if it had been received
+ *		over the radio.
+ *
+ * Inputs:	chan		- Channel number to report.
+ *
+ *		payload		- Packet from server with path replaced.
+ *
+ *--------------------------------------------------------------------*/
+
+static void to_clients (int chan, char *payload)
+{
+	char text [500];
+	packet_t pc;
+
+	snprintf (text, sizeof(text), "%s>%s%d%d:}%s",
+				g_mycall[chan],
+				APP_TOCALL, MAJOR_VERSION, MINOR_VERSION,
+				payload);
+
+	pc = ax25_from_text (text, 1);
+	if (pc == NULL) {
+	  return;
+	}
+
+#if ITEST
+	text_color_set(DW_COLOR_XMIT);
+	dw_printf ("Client: %s\n", text);
+#else
+	int flen;
+	unsigned char fbuf[AX25_MAX_PACKET_LEN];
+
+	flen = ax25_pack(pc, fbuf);
+
+	server_send_rec_packet (chan, pc, fbuf, flen);
+	kissnet_send_rec_packet (chan, fbuf, flen);
+	kiss_send_rec_packet (chan, fbuf, flen);
+#endif
+	stats_client_packets++;
+
+	ax25_delete (pc);
+
+} /* end to_clients */
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        xmit_packet
+ *
+ * Purpose:     Convert packet, from IGate server, to third party
+ *		packet and send to transmit queue.
+ *
+ * Inputs:	pp3		- Packet from server with path replaced.
+ *
+ *		payload		- Text representation of it.
+ *
+ *		p		- Current IGate settings.
+ *				  Caller must hold the RCU read lock.
+ *
+ *--------------------------------------------------------------------*/
+
+static void xmit_packet (packet_t pp3, char *payload, struct igate_config_s *p)
+{
+	assert (g_config.tx_chan >= 0 && g_config.tx_chan < MAX_CHANS);
+
 /*
  * Encapsulate for sending over radio if no reason to drop it.
  */
-	if (ig_to_tx_allow (pp3)) {
+	if (ig_to_tx_allow (pp3, p)) {
 	  char radio [500];
 	  packet_t pradio;
 
 	  sprintf (radio, "%s>%s%d%d%s:}%s",
 				g_mycall[g_config.tx_chan],
 				APP_TOCALL, MAJOR_VERSION, MINOR_VERSION,
-				g_config.tx_via,
+				p->tx_via,
 				payload);
 
 	  pradio = ax25_from_text (radio, 1);
@@ -1274,12 +1564,9 @@ static void xmit_packet (char *message)
 	  ig_to_tx_remember (pp3);
 	}
 
-	ax25_delete (pp3);
-
 } /* end xmit_packet */
 
 
-
 /*-------------------------------------------------------------------
  *
  * Name:        rx_to_ig_remember
@@ -1310,12 +1597,12 @@ static void xmit_packet (char *message)
  *		based on recent activity.  We will drop the packet if it is a
  *		duplicate of another sent recently.
  *
- *		Rather than storing the entire packet, we just keep a CRC to 
- *		reduce memory and processing requirements.  We do the same in
- *		the digipeater function to suppress duplicates.
+ *		Rather than storing the entire packet, we just keep a 64 bit
+ *		hash to reduce memory and processing requirements.  We do the
+ *		same in the digipeater function to suppress duplicates.
+ *		It is calculated once when the packet is created.
  *
- *		There is a 1 / 65536 chance of getting a false positive match
- *		which is good enough for this application.
+ *		A false positive match is practically impossible.
  *
  *--------------------------------------------------------------------*/
 
@@ -1324,14 +1611,14 @@ static void xmit_packet (char *message)
 
 static int rx2ig_insert_next;
 static time_t rx2ig_time_stamp[RX2IG_HISTORY_MAX];
-static unsigned short rx2ig_checksum[RX2IG_HISTORY_MAX];
+static unsigned long long rx2ig_fingerprint[RX2IG_HISTORY_MAX];
 
 static void rx_to_ig_init (void)
 {
 	int n;
 	for (n=0; n<RX2IG_HISTORY_MAX; n++) {
 	  rx2ig_time_stamp[n] = 0;
-	  rx2ig_checksum[n] = 0;
+	  rx2ig_fingerprint[n] = 0;
 	}
 	rx2ig_insert_next = 0;
 }
@@ -1340,7 +1627,7 @@ static void rx_to_ig_init (void)
 static void rx_to_ig_remember (packet_t pp)
 {
        	rx2ig_time_stamp[rx2ig_insert_next] = time(NULL);
-        rx2ig_checksum[rx2ig_insert_next] = ax25_dedupe_crc(pp);
+        rx2ig_fingerprint[rx2ig_insert_next] = ax25_dedupe_fingerprint(pp);
 
         rx2ig_insert_next++;
         if (rx2ig_insert_next >= RX2IG_HISTORY_MAX) {
@@ -1350,12 +1637,12 @@ static void rx_to_ig_remember (packet_t pp)
 
 static int rx_to_ig_allow (packet_t pp)
 {
-	unsigned short crc = ax25_dedupe_crc(pp);
+	unsigned long long fp = ax25_dedupe_fingerprint(pp);
 	time_t now = time(NULL);
 	int j;
 
 	for (j=0; j<RX2IG_HISTORY_MAX; j++) {
-	  if (rx2ig_time_stamp[j] >= now - RX2IG_DEDUPE_TIME && rx2ig_checksum[j] == crc) {
+	  if (rx2ig_time_stamp[j] >= now - RX2IG_DEDUPE_TIME && rx2ig_fingerprint[j] == fp) {
 	    return 0;
 	  }
 	}
@@ -1409,6 +1696,10 @@ static int rx_to_ig_allow (packet_t pp)
  *		number of packets sent during the past minute and past 5
  *		minutes and stop sending if a limit is reached.
  *
+ *		The fixed counts don't know how busy the channel is.
+ *		If MAXUTIL is configured for the transmit channel, we also
+ *		stop when the measured utilization reaches that level.
+ *
  * Future?	We might also want to avoid transmitting if the same packet
  *		was heard on the radio recently.  If everything is kept in
  *		the same table, we'd need to distinguish between those from
@@ -1426,16 +1717,19 @@ static int rx_to_ig_allow (packet_t pp)
 #define IG2TX_DEDUPE_TIME 60		/* Do not send duplicate within 60 seconds. */
 #define IG2TX_HISTORY_MAX 50		/* Remember the last 50 sent from server to radio. */
 
+#define IG2TX_MSG_HEARD_TIME (180*60)	/* Message addressee must have been heard */
+#define IG2TX_MSG_MAX_HOPS 2		/* on the radio this recently and this close. */
+
 static int ig2tx_insert_next;
 static time_t ig2tx_time_stamp[IG2TX_HISTORY_MAX];
-static unsigned short ig2tx_checksum[IG2TX_HISTORY_MAX];
+static unsigned long long ig2tx_fingerprint[IG2TX_HISTORY_MAX];
 
 static void ig_to_tx_init (void)
 {
 	int n;
 	for (n=0; n<IG2TX_HISTORY_MAX; n++) {
 	  ig2tx_time_stamp[n] = 0;
-	  ig2tx_checksum[n] = 0;
+	  ig2tx_fingerprint[n] = 0;
 	}
 	ig2tx_insert_next = 0;
 }
@@ -1444,7 +1738,7 @@ static void ig_to_tx_init (void)
 static void ig_to_tx_remember (packet_t pp)
 {
        	ig2tx_time_stamp[ig2tx_insert_next] = time(NULL);
-        ig2tx_checksum[ig2tx_insert_next] = ax25_dedupe_crc(pp);
+        ig2tx_fingerprint[ig2tx_insert_next] = ax25_dedupe_fingerprint(pp);
 
         ig2tx_insert_next++;
         if (ig2tx_insert_next >= IG2TX_HISTORY_MAX) {
@@ -1452,20 +1746,43 @@ static void ig_to_tx_remember (packet_t pp)
         }
 }
 
-static int ig_to_tx_allow (packet_t pp)
+static int ig_to_tx_allow (packet_t pp, struct igate_config_s *p)
 {
-	unsigned short crc = ax25_dedupe_crc(pp);
+	unsigned long long fp = ax25_dedupe_fingerprint(pp);
 	time_t now = time(NULL);
 	int j;
 	int count_1, count_5;
+	unsigned char *pinfo;
+	int info_len;
 
 	for (j=0; j<IG2TX_HISTORY_MAX; j++) {
-	  if (ig2tx_time_stamp[j] >= now - IG2TX_DEDUPE_TIME && ig2tx_checksum[j] == crc) {
+	  if (ig2tx_time_stamp[j] >= now - IG2TX_DEDUPE_TIME && ig2tx_fingerprint[j] == fp) {
 	    text_color_set(DW_COLOR_INFO);
 	    dw_printf ("Tx IGate: Drop duplicate packet transmitted recently.\n");
 	    return 0;
 	  }
 	}
+
+/*
+ * A message should go over the radio only if the addressee
+ * is likely to hear it.  Otherwise it just adds to congestion.
+ */
+	info_len = ax25_get_info (pp, &pinfo);
+	if (info_len >= 11 && pinfo[0] == ':' && pinfo[10] == ':') {
+	  char addressee[10];
+
+	  memcpy (addressee, pinfo + 1, 9);
+	  addressee[9] = '\0';
+	  for (j = 8; j >= 0 && addressee[j] == ' '; j--) {
+	    addressee[j] = '\0';
+	  }
+
+	  if ( ! mheard_was_recently_nearby (addressee, IG2TX_MSG_HEARD_TIME, IG2TX_MSG_MAX_HOPS)) {
+	    text_color_set(DW_COLOR_INFO);
+	    dw_printf ("Tx IGate: Drop message because %s was not heard on the radio recently.\n", addressee);
+	    return 0;
+	  }
+	}
 	count_1 = 0;
 	count_5 = 0;
 	for (j=0; j<IG2TX_HISTORY_MAX; j++) {
@@ -1473,14 +1790,21 @@ static int ig_to_tx_allow (packet_t pp)
 	  if (ig2tx_time_stamp[j] >= now - 300) count_5++;
 	}
 
-	if (count_1 >= g_config.tx_limit_1) {
+	if (count_1 >= p->tx_limit_1) {
 	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf ("Tx IGate: Already transmitted maximum of %d packets in 1 minute.\n", g_config.tx_limit_1);
+	  dw_printf ("Tx IGate: Already transmitted maximum of %d packets in 1 minute.\n", p->tx_limit_1);
 	  return 0;
 	}
-	if (count_5 >= g_config.tx_limit_5) {
+	if (count_5 >= p->tx_limit_5) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Tx IGate: Already transmitted maximum of %d packets in 5 minutes.\n", p->tx_limit_5);
+	  return 0;
+	}
+
+	if (airtime_congested(g_config.tx_chan)) {
 	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf ("Tx IGate: Already transmitted maximum of %d packets in 5 minutes.\n", g_config.tx_limit_5);
+	  dw_printf ("Tx IGate: Channel %d utilization is %d%%, above the MAXUTIL setting.\n", 
+			g_config.tx_chan, airtime_utilization(g_config.tx_chan, AIRTIME_DEFAULT_WINDOW));
 	  return 0;
 	}
 
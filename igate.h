@@ -37,6 +37,19 @@ struct igate_config_s {
 
 	char *t2_filter;		/* Optional filter for IS -> RF direction. */
 
+/*
+ * Everything from the server is displayed.  These select
+ * the parts of it for other destinations.
+ */
+	char *tx_filter;		/* IGTXFILTER - Which ones are transmitted. */
+					/* NULL means all. */
+
+	char *client_filter;		/* IGCLIENTFILTER - Which ones go to client */
+					/* applications.  NULL means none. */
+
+	struct pfilter_s *tx_pf;	/* Compiled forms of above.  Set by the IGate. */
+	struct pfilter_s *client_pf;
+
 /*
  * For transmitting.
  */
@@ -57,6 +70,10 @@ struct igate_config_s {
 
 void igate_init (struct igate_config_s *p_igate_config, struct digi_config_s *p_digi_config);
 
+/* Call this when the configuration file has been read again. */
+
+void igate_reload (struct igate_config_s *p_igate_config);
+
 /* Call this with each packet received from the radio. */
 
 void igate_send_rec_packet (int chan, packet_t recv_pp);
@@ -140,6 +140,7 @@
 #include "ax25_pad.h"
 #include "textcolor.h"
 #include "kiss.h"
+#include "rtsched.h"
 #include "kiss_frame.h"
 #include "xmit.h"
 
@@ -532,6 +533,27 @@ static MYFDTYPE kiss_open_nullmodem (char *devicename)
 	  dw_printf ("kiss_open_nullmodem: SetCommState failed.\n");
 	}
 
+/*
+ * Let ReadFile return whatever has arrived rather than
+ * waiting to fill the whole buffer.  With these values,
+ * it returns at once if anything is available, otherwise
+ * when the first byte arrives (or times out with nothing).
+ */
+	{
+	  COMMTIMEOUTS ct;
+
+	  memset (&ct, 0, sizeof(ct));
+	  ct.ReadIntervalTimeout = MAXDWORD;
+	  ct.ReadTotalTimeoutMultiplier = MAXDWORD;
+	  ct.ReadTotalTimeoutConstant = 1000;
+
+	  ok = SetCommTimeouts (fd, &ct);
+	  if (! ok) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf ("kiss_open_nullmodem: SetCommTimeouts failed.\n");
+	  }
+	}
+
 	text_color_set(DW_COLOR_INFO);
 	dw_printf("Virtual KISS TNC is connected to %s side of null modem.\n", devicename);
 
@@ -609,9 +631,8 @@ static MYFDTYPE kiss_open_nullmodem (char *devicename)
 
 void kiss_send_rec_packet (int chan, unsigned char *fbuf,  int flen)
 {
-	unsigned char kiss_buff[2 * AX25_MAX_PACKET_LEN];
+	unsigned char kiss_buff[2 * AX25_MAX_PACKET_LEN + 4];
 	int kiss_len;
-	int j;
 	int err;
 
 #if ! __WIN32__
@@ -636,27 +657,15 @@ void kiss_send_rec_packet (int chan, unsigned char *fbuf,  int flen)
 	  kiss_len = strlen((char *)kiss_buff);
 	}
 	else {
+	  unsigned char stemp[AX25_MAX_PACKET_LEN + 1];
 
-	  kiss_len = 0;
-	  kiss_buff[kiss_len++] = FEND;
-	  kiss_buff[kiss_len++] = chan << 4;
+	  assert (flen < sizeof(stemp));
 
-	  for (j=0; j<flen; j++) {
+	  stemp[0] = chan << 4;
+	  memcpy (stemp + 1, fbuf, flen);
+
+	  kiss_len = kiss_encapsulate (stemp, flen + 1, kiss_buff);
 
-	    if (fbuf[j] == FEND) {
-	      kiss_buff[kiss_len++] = FESC;
-	      kiss_buff[kiss_len++] = TFEND;
-	    }
-	    else if (fbuf[j] == FESC) {
-	      kiss_buff[kiss_len++] = FESC;
-	      kiss_buff[kiss_len++] = TFESC;
-	    }
-	    else {
-	      kiss_buff[kiss_len++] = fbuf[j];
-	    }
-	    assert (kiss_len < sizeof (kiss_buff));
-	  }
-	  kiss_buff[kiss_len++] = FEND;
 
 	  /* This has the escapes but not the surrounding FENDs. */
 
@@ -782,12 +791,15 @@ void kiss_send_rec_packet (int chan, unsigned char *fbuf,  int flen)
 //BUG: If we close it here, that fact doesn't get back 
 // to the main receiving thread.
 
-/* Return one byte (value 0 - 255) or terminate thread on error. */
+/*
+ * Return as many bytes as are available, at least one,
+ * or terminate thread on error.
+ * A burst of frames from the client can be taken in one read.
+ */
 
 
-static int kiss_get (MYFDTYPE fd)
+static int kiss_get (MYFDTYPE fd, unsigned char *buf, int bufsize)
 {
-	unsigned char ch;
 
 #if __WIN32__		/* Native Windows version. */
 
@@ -808,7 +820,7 @@ static int kiss_get (MYFDTYPE fd)
 
   	while (n == 0) {
 
-	  if ( ! ReadFile (fd, &ch, 1, &n, &ov_rd)) 
+	  if ( ! ReadFile (fd, buf, bufsize, &n, &ov_rd)) 
 	  {
 	    int err1 = GetLastError();
 
@@ -827,7 +839,7 @@ static int kiss_get (MYFDTYPE fd)
 	        }
 	        else 
 	        {
-		  /* Success!  n should be 1 */
+		  /* Success!  n is number of bytes. */
 	        }
 	      }
 	    }
@@ -845,23 +857,14 @@ static int kiss_get (MYFDTYPE fd)
 
 	CloseHandle(ov_rd.hEvent); 
 
-	if (n != 1) {
-	  text_color_set(DW_COLOR_ERROR);
-	  dw_printf ("\nKISS failed to get one byte. n=%d.\n\n", (int)n);
-
-#if DEBUG9
-	  fprintf (log_fp, "n=%d\n", n);
-#endif
-	}
-
 
 #else		/* Linux/Cygwin version */
 
 	int n;
 
-	n = read(fd, &ch, (size_t)1);
+	n = read(fd, buf, (size_t)bufsize);
 
-	if (n != 1) {
+	if (n <= 0) {
 	  //text_color_set(DW_COLOR_ERROR);
 	  //dw_printf ("\nError receiving kiss message from client application.  Closing connection %d.\n\n", fd);
 
@@ -875,23 +878,31 @@ static int kiss_get (MYFDTYPE fd)
 
 #if DEBUGx
 	text_color_set(DW_COLOR_DEBUG);
-	dw_printf ("kiss_get(%d) returns 0x%02x\n", fd, ch);
+	dw_printf ("kiss_get(%d) returns %d bytes\n", fd, (int)n);
 #endif
 
 #if DEBUG9
-	fprintf (log_fp, "%02x %c %c", ch, 
+	{
+	  int j;
+
+	  for (j = 0; j < n; j++) {
+	    unsigned char ch = buf[j];
+
+	    fprintf (log_fp, "%02x %c %c", ch, 
 			isprint(ch) ? ch : '.' , 
 			(isupper(ch>>1) || isdigit(ch>>1) || (ch>>1) == ' ') ? (ch>>1) : '.');
-	if (ch == FEND) fprintf (log_fp, "  FEND");
-	if (ch == FESC) fprintf (log_fp, "  FESC");
-	if (ch == TFEND) fprintf (log_fp, "  TFEND");
-	if (ch == TFESC) fprintf (log_fp, "  TFESC");
-	if (ch == '\r') fprintf (log_fp, "  CR");
-	if (ch == '\n') fprintf (log_fp, "  LF");
-	fprintf (log_fp, "\n");
-	if (ch == FEND) fflush (log_fp);
-#endif
-	return (ch);
+	    if (ch == FEND) fprintf (log_fp, "  FEND");
+	    if (ch == FESC) fprintf (log_fp, "  FESC");
+	    if (ch == TFEND) fprintf (log_fp, "  TFEND");
+	    if (ch == TFESC) fprintf (log_fp, "  TFESC");
+	    if (ch == '\r') fprintf (log_fp, "  CR");
+	    if (ch == '\n') fprintf (log_fp, "  LF");
+	    fprintf (log_fp, "\n");
+	    if (ch == FEND) fflush (log_fp);
+	  }
+	}
+#endif
+	return (n);
 }
 
 
@@ -901,20 +912,20 @@ static void * kiss_listen_thread (void *arg)
 {
 	MYFDTYPE fd = (MYFDTYPE)(long)arg;
 
-	unsigned char ch;
+	unsigned char buf[MAX_KISS_LEN];
+	int n;
 			
 #if DEBUG
 	text_color_set(DW_COLOR_DEBUG);
 	dw_printf ("kiss_listen_thread ( %d )\n", fd);
 #endif
 
+	rtsched_apply (RTSCHED_KISS);
 
 	while (1) {
-	  ch = kiss_get(fd);
+	  n = kiss_get (fd, buf, sizeof(buf));
 
-	  if (kiss_frame (&kf, ch, kiss_debug, kiss_send_rec_packet)) { 
-	    kiss_process_msg (&kf, kiss_debug);
-	  }
+	  kiss_frame_buffer (&kf, buf, n, kiss_debug, kiss_send_rec_packet);
 	}	/* while (1) */
 
 	return (NULL);	/* Unreachable but avoids compiler warning. */
@@ -101,6 +101,10 @@
  *
  * Returns:	TRUE when a complete frame is ready for processing.
  *
+ * Description:	This handles one byte at a time.  kiss_frame_buffer,
+ *		below, is used for reading and calls this only for
+ *		the uncommon cases.
+ *
  * Bug:		For send, the debug output shows exactly what is
  *		being sent including the surrounding FEND and any
  *		escapes.  For receive, we don't show those.
@@ -195,6 +199,11 @@ int kiss_frame (kiss_frame_t *kf, unsigned char ch, int debug, void (*sendfun)(i
 	      return 1;
 	    }
 
+	    if (ch == FESC) {
+	      kf->state = KS_ESCAPE;
+	      return 0;
+	    }
+
 	    if (kf->kiss_len < MAX_KISS_LEN) {
 	      kf->kiss_msg[kf->kiss_len++] = ch;
 	    }
@@ -231,8 +240,150 @@ int kiss_frame (kiss_frame_t *kf, unsigned char ch, int debug, void (*sendfun)(i
 	return 0;	/* unreachable but suppress compiler warning. */
 
 } /* end kiss_frame */   
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        kiss_frame_buffer
+ *
+ * Purpose:     Extract and process all KISS frames in a block of
+ *		bytes from the input stream.
+ *
+ * Inputs:	kf	- Current state of building a frame.
+ *		buf	- Bytes from the input stream.
+ *		len	- Number of bytes.  Frames can be split
+ *			  anywhere between one read and the next.
+ *		debug	- Activates debug output.
+ *		sendfun	- Function to send something to the client application.
+ *
+ * Outputs:	kf	- Current state is updated.
+ *
+ * Description:	Same result as calling kiss_frame for each byte and
+ *		kiss_process_msg for each complete frame, but the frame
+ *		contents are found with memchr and copied in bulk.
+ *		Only the FEND and FESC bytes, and noise outside of
+ *		frames, go through the byte at a time state machine.
+ *
+ *-----------------------------------------------------------------*/
+
+void kiss_frame_buffer (kiss_frame_t *kf, unsigned char *buf, int len, int debug, void (*sendfun)(int,unsigned char*,int))
+{
+	unsigned char *p = buf;
+	unsigned char *end = buf + len;
+	unsigned char *fend, *stop, *fesc;
+	int n;
+
+	while (p < end) {
+
+	  switch (kf->state) {
+
+	    case KS_SEARCHING:
+
+	      /* Anything before the next FEND is noise.  Let kiss_frame deal with it. */
+
+	      fend = memchr (p, FEND, end - p);
+	      stop = (fend != NULL) ? fend + 1 : end;
+	      while (p < stop) {
+	        kiss_frame (kf, *p++, debug, sendfun);
+	      }
+	      break;
+
+	    case KS_ESCAPE:
+
+	      kiss_frame (kf, *p++, debug, sendfun);
+	      break;
+
+	    case KS_COLLECTING:
+
+	      fend = memchr (p, FEND, end - p);
+	      stop = (fend != NULL) ? fend : end;
+
+	      /* Copy runs between escapes. */
+
+	      while (p < stop && kf->state == KS_COLLECTING) {
+
+	        fesc = memchr (p, FESC, stop - p);
+	        n = ((fesc != NULL) ? fesc : stop) - p;
+
+	        if (kf->kiss_len + n > MAX_KISS_LEN) {
+	          text_color_set(DW_COLOR_ERROR);
+	          dw_printf ("KISS message exceeded maximum length.\n");
+	          n = MAX_KISS_LEN - kf->kiss_len;
+	        }
+	        memcpy (kf->kiss_msg + kf->kiss_len, p, n);
+	        kf->kiss_len += n;
+	        p = (fesc != NULL) ? fesc : stop;
+
+	        if (fesc != NULL) {
+	          kiss_frame (kf, *p++, debug, sendfun);	/* FESC */
+	          if (p < stop) {
+	            kiss_frame (kf, *p++, debug, sendfun);	/* TFEND or TFESC */
+	          }
+	        }
+	      }
+
+	      if (p == fend) {
+	        if (kiss_frame (kf, *p++, debug, sendfun)) {
+	          kiss_process_msg (kf, debug);
+	        }
+	      }
+	      break;
+	  }
+	}
+
+} /* end kiss_frame_buffer */
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        kiss_encapsulate 
+ *
+ * Purpose:     Add the KISS framing and escapes to a message.
+ *
+ * Inputs:	in	- Message: the type/port byte followed by
+ *			  the AX.25 frame, if any.
+ *		ilen	- Number of bytes.
+ *
+ * Outputs:	out	- Result with FEND at beginning and end.
+ *			  Must be at least 2 * ilen + 2 bytes.
+ *
+ * Returns:	Number of bytes placed in out.
+ *
+ * Description:	Bytes which don't need escaping are copied in runs.
+ *
+ *-----------------------------------------------------------------*/
+
+int kiss_encapsulate (unsigned char *in, int ilen, unsigned char *out)
+{
+	int olen = 0;
+	int j = 0;
+	int k;
+
+	out[olen++] = FEND;
+
+	while (j < ilen) {
+
+	  for (k = j; k < ilen && in[k] != FEND && in[k] != FESC; k++) ;
+
+	  memcpy (out + olen, in + j, k - j);
+	  olen += k - j;
+	  j = k;
+
+	  if (j < ilen) {
+	    out[olen++] = FESC;
+	    out[olen++] = (in[j] == FEND) ? TFEND : TFESC;
+	    j++;
+	  }
+	}
+
+	out[olen++] = FEND;
+
+	return (olen);
+
+} /* end kiss_encapsulate */
 	      	    
 
+
 /*-------------------------------------------------------------------
  *
  * Name:        kiss_process_msg 
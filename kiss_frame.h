@@ -37,6 +37,11 @@ typedef struct kiss_frame_s {
 
 
 int kiss_frame (kiss_frame_t *kf, unsigned char ch, int debug, void (*sendfun)(int,unsigned char*,int)); 
+
+void kiss_frame_buffer (kiss_frame_t *kf, unsigned char *buf, int len, int debug, void (*sendfun)(int,unsigned char*,int));
+
+int kiss_encapsulate (unsigned char *in, int ilen, unsigned char *out);
+
  
 void kiss_process_msg (kiss_frame_t *kf, int debug);
 
@@ -120,8 +120,10 @@
 #include "textcolor.h"
 #include "audio.h"
 #include "kissnet.h"
+#include "rtsched.h"
 #include "kiss_frame.h"
 #include "xmit.h"
+#include "metrics.h"
 
 
 static kiss_frame_t kf;		/* Accumulated KISS frame and state of decoder. */
@@ -149,6 +151,24 @@ void kiss_net_set_debug (int n)
 
 
 
+/*
+ * Bytes waiting in the socket for the client to read, for metrics.
+ * A client that can't keep up shows here before anything is lost.
+ */
+
+#ifdef TIOCOUTQ
+static double client_queue_bytes (int arg)
+{
+	int n = 0;
+
+	if (client_sock <= 0 || ioctl (client_sock, TIOCOUTQ, &n) < 0) {
+	  n = 0;
+	}
+	return (n);
+}
+#endif
+
+
 /*-------------------------------------------------------------------
  *
  * Name:        kissnet_init
@@ -193,6 +213,11 @@ void kissnet_init (struct misc_config_s *mc)
 	client_sock = -1;
 	num_channels = mc->num_channels;
 
+#ifdef TIOCOUTQ
+	metrics_func (METRICS_GAUGE, "client_queue_bytes",
+			"Bytes sent to client application but not read yet.", "client=\"kiss\"", client_queue_bytes, 0);
+#endif
+
 /*
  * This waits for a client to connect and sets client_sock.
  */
@@ -452,9 +477,8 @@ static void * connect_listen_thread (void *arg)
 
 void kissnet_send_rec_packet (int chan, unsigned char *fbuf, int flen)
 {
-	unsigned char kiss_buff[2 * AX25_MAX_PACKET_LEN];
+	unsigned char kiss_buff[2 * AX25_MAX_PACKET_LEN + 4];
 	int kiss_len;
-	int j;
 	int err;
 
 
@@ -470,27 +494,15 @@ void kissnet_send_rec_packet (int chan, unsigned char *fbuf, int flen)
 	  kiss_len = strlen((char *)kiss_buff);
 	}
 	else {
+	  unsigned char stemp[AX25_MAX_PACKET_LEN + 1];
 
-	  kiss_len = 0;
-	  kiss_buff[kiss_len++] = FEND;
-	  kiss_buff[kiss_len++] = chan << 4;
+	  assert (flen < sizeof(stemp));
 
-	  for (j=0; j<flen; j++) {
+	  stemp[0] = chan << 4;
+	  memcpy (stemp + 1, fbuf, flen);
+
+	  kiss_len = kiss_encapsulate (stemp, flen + 1, kiss_buff);
 
-	    if (fbuf[j] == FEND) {
-	      kiss_buff[kiss_len++] = FESC;
-	      kiss_buff[kiss_len++] = TFEND;
-	    }
-	    else if (fbuf[j] == FESC) {
-	      kiss_buff[kiss_len++] = FESC;
-	      kiss_buff[kiss_len++] = TFESC;
-	    }
-	    else {
-	      kiss_buff[kiss_len++] = fbuf[j];
-	    }
-	    assert (kiss_len < sizeof (kiss_buff));
-	  }
-	  kiss_buff[kiss_len++] = FEND;
 
 	  /* Bug: This has the escapes but not the surrounding FENDs. */
 
@@ -524,63 +536,6 @@ void kissnet_send_rec_packet (int chan, unsigned char *fbuf, int flen)
 
 
 
-/*-------------------------------------------------------------------
- *
- * Name:        read_from_socket
- *
- * Purpose:     Read from socket until we have desired number of bytes.
- *
- * Inputs:	fd		- file descriptor.
- *		ptr		- address where data should be placed.
- *		len		- desired number of bytes.
- *
- * Description:	Just a wrapper for the "read" system call but it should
- *		never return fewer than the desired number of bytes.
- *
- * 		Not really needed for KISS because we are dealing with
- *		a stream of bytes rather than message blocks.
- *
- *--------------------------------------------------------------------*/
-
-static int read_from_socket (int fd, char *ptr, int len)
-{
-	int got_bytes = 0;
-
-#if DEBUG
-	text_color_set(DW_COLOR_DEBUG);
-	dw_printf ("read_from_socket (%d, %p, %d)\n", fd, ptr, len);
-#endif
-	while (got_bytes < len) {
-	  int n;
-
-#if __WIN32__
-
-//TODO: any flags for send/recv?
-
-	  n = recv (fd, ptr + got_bytes, len - got_bytes, 0);
-#else
-	  n = read (fd, ptr + got_bytes, len - got_bytes);
-#endif
-
-#if DEBUG
-	  text_color_set(DW_COLOR_DEBUG);
-	  dw_printf ("read_from_socket: n = %d\n", n);
-#endif
-	  if (n <= 0) {
-	    return (n);
-	  }
-
-	  got_bytes += n;
-	}
-	assert (got_bytes >= 0 && got_bytes <= len);
-
-#if DEBUG
-	text_color_set(DW_COLOR_DEBUG);
-	dw_printf ("read_from_socket: return %d\n", got_bytes);
-#endif
-	return (got_bytes);
-}
-
 
 /*-------------------------------------------------------------------
  *
@@ -599,12 +554,13 @@ static int read_from_socket (int fd, char *ptr, int len)
  *--------------------------------------------------------------------*/
 
 
-/* Return one byte (value 0 - 255) */
-
+/*
+ * Return as many bytes as are available, at least one.
+ * A burst of frames from the client can be taken in one read.
+ */
 
-static int kiss_get (void)
+static int kiss_get (unsigned char *buf, int bufsize)
 {
-	unsigned char ch;
 	int n;
 
 	while (1) {
@@ -613,25 +569,33 @@ static int kiss_get (void)
 	    SLEEP_SEC(1);			/* Not connected.  Try again later. */
 	  }
 
-	  /* Just get one byte at a time. */
-
-	  n = read_from_socket (client_sock, (char *)(&ch), 1);
+#if __WIN32__
+	  n = recv (client_sock, (char *)buf, bufsize, 0);
+#else
+	  n = read (client_sock, buf, bufsize);
+#endif
 
-	  if (n == 1) {
+	  if (n > 0) {
 #if DEBUG9
-	    dw_printf (log_fp, "%02x %c %c", ch, 
+	    int j;
+
+	    for (j = 0; j < n; j++) {
+	      unsigned char ch = buf[j];
+
+	      fprintf (log_fp, "%02x %c %c", ch, 
 			isprint(ch) ? ch : '.' , 
 			(isupper(ch>>1) || isdigit(ch>>1) || (ch>>1) == ' ') ? (ch>>1) : '.');
-	    if (ch == FEND) fprintf (log_fp, "  FEND");
-	    if (ch == FESC) fprintf (log_fp, "  FESC");
-	    if (ch == TFEND) fprintf (log_fp, "  TFEND");
-	    if (ch == TFESC) fprintf (log_fp, "  TFESC");
-	    if (ch == '\r') fprintf (log_fp, "  CR");
-	    if (ch == '\n') fprintf (log_fp, "  LF");
-	    fprintf (log_fp, "\n");
-	    if (ch == FEND) fflush (log_fp);
+	      if (ch == FEND) fprintf (log_fp, "  FEND");
+	      if (ch == FESC) fprintf (log_fp, "  FESC");
+	      if (ch == TFEND) fprintf (log_fp, "  TFEND");
+	      if (ch == TFESC) fprintf (log_fp, "  TFESC");
+	      if (ch == '\r') fprintf (log_fp, "  CR");
+	      if (ch == '\n') fprintf (log_fp, "  LF");
+	      fprintf (log_fp, "\n");
+	      if (ch == FEND) fflush (log_fp);
+	    }
 #endif
-	    return(ch);	
+	    return (n);	
 	  }
 
           text_color_set(DW_COLOR_ERROR);
@@ -649,19 +613,20 @@ static int kiss_get (void)
 
 static void * kissnet_listen_thread (void *arg)
 {
-	unsigned char ch;
+	unsigned char buf[MAX_KISS_LEN];
+	int n;
 			
 #if DEBUG
 	text_color_set(DW_COLOR_DEBUG);
 	dw_printf ("kissnet_listen_thread ( socket = %d )\n", client_sock);
 #endif
 
+	rtsched_apply (RTSCHED_KISS);
+
 	while (1) {
-	  ch = kiss_get();
+	  n = kiss_get (buf, sizeof(buf));
 
-	  if (kiss_frame (&kf, ch, kiss_debug, kissnet_send_rec_packet)) { 
-	    kiss_process_msg (&kf, kiss_debug);
-	  }
+	  kiss_frame_buffer (&kf, buf, n, kiss_debug, kissnet_send_rec_packet);
 	}  /* while (1) */
 
 	return (NULL);	/* to suppress compiler warning. */
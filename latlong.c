@@ -279,3 +279,154 @@ void longitude_to_comp_str (double dlong, char *clon)
 	clon[2] = x2 + 33;
 	clon[3] = x3 + 33;
 }
+
+
+
+/*------------------------------------------------------------------
+ *
+ * Name:        ll_distance_km
+ *
+ * Purpose:     Calculate distance between two locations.
+ *
+ * Inputs:      lat1, lon1	- One location, in degrees.
+ *		lat2, lon2	- other location
+ *
+ * Returns:     Distance in km.
+ *
+ * Description:	Haversine formula on a sphere.  Good enough for
+ *		deciding what is within radio range.
+ *
+ *----------------------------------------------------------------*/
+
+#define R_KM 6371.
+
+double ll_distance_km (double lat1, double lon1, double lat2, double lon2)
+{
+	double dlat, dlon, a;
+
+	lat1 *= M_PI / 180.;
+	lat2 *= M_PI / 180.;
+	dlat = lat2 - lat1;
+	dlon = (lon2 - lon1) * M_PI / 180.;
+
+	a = sin(dlat / 2) * sin(dlat / 2) +
+		cos(lat1) * cos(lat2) * sin(dlon / 2) * sin(dlon / 2);
+
+	return (R_KM * 2 * atan2(sqrt(a), sqrt(1 - a)));
+}
+
+
+
+/*------------------------------------------------------------------
+ *
+ * Name:        ll_grid_cell
+ *
+ * Purpose:     Find grid cell for a location.
+ *
+ * Inputs:      grid_deg	- Size of cell, in degrees.  Should divide
+ *				  evenly into 180.
+ *		dlat, dlon	- Location, in degrees.
+ *
+ * Returns:     Cell number:  row * columns + column.
+ *
+ * Description:	The poles go in the first and last rows.  Longitude
+ *		outside of -180 to 180 wraps around.
+ *
+ *----------------------------------------------------------------*/
+
+int ll_grid_cell (double grid_deg, double dlat, double dlon)
+{
+	int rows = (int)(180 / grid_deg);
+	int cols = (int)(360 / grid_deg);
+	int row, col;
+
+	row = (int)floor((dlat + 90.) / grid_deg);
+	col = (int)floor((dlon + 180.) / grid_deg);
+
+	if (row < 0) row = 0;
+	if (row >= rows) row = rows - 1;
+	col = ((col % cols) + cols) % cols;
+
+	return (row * cols + col);
+}
+
+
+
+/*------------------------------------------------------------------
+ *
+ * Name:        ll_grid_box
+ *
+ * Purpose:     Find grid cells overlapping a box.
+ *
+ * Inputs:      grid_deg	- Size of cell, in degrees.
+ *		south, north	- Latitude range.
+ *		west, east	- Longitude range.  east can be more than
+ *				  180 for a box crossing 180 degrees.
+ *
+ * Outputs:	span		- Rows and columns covered.  A cell is
+ *				  row * span->cols + (span->col_lo + k) % span->cols
+ *				  for k = 0 thru span->ncols - 1.
+ *
+ * Description:	If the box is nearly all the way around, counting
+ *		columns from west to east could wrap to the wrong
+ *		answer so all columns are used.
+ *
+ *----------------------------------------------------------------*/
+
+void ll_grid_box (double grid_deg, double south, double west, double north, double east, struct ll_grid_span_s *span)
+{
+	span->cols = (int)(360 / grid_deg);
+	span->row_lo = ll_grid_cell (grid_deg, south, 0) / span->cols;
+	span->row_hi = ll_grid_cell (grid_deg, north, 0) / span->cols;
+
+	if (east - west >= 360 - grid_deg) {
+	  span->col_lo = 0;
+	  span->ncols = span->cols;
+	}
+	else {
+	  span->col_lo = ll_grid_cell (grid_deg, 0, west) % span->cols;
+	  span->ncols = (ll_grid_cell (grid_deg, 0, east) % span->cols - span->col_lo + span->cols) % span->cols + 1;
+	}
+}
+
+
+
+/*------------------------------------------------------------------
+ *
+ * Name:        ll_grid_circle
+ *
+ * Purpose:     Find grid cells overlapping a circle.
+ *
+ * Inputs:      grid_deg	- Size of cell, in degrees.
+ *		dlat, dlon	- Center, in degrees.
+ *		km		- Radius.
+ *
+ * Outputs:	span		- Same as ll_grid_box.
+ *
+ * Description:	Use a box around the circle.  East-west degrees are
+ *		smaller toward the poles so the latitude furthest
+ *		from the equator decides the width.  If that reaches
+ *		a pole, all columns are used.
+ *
+ *----------------------------------------------------------------*/
+
+void ll_grid_circle (double grid_deg, double dlat, double dlon, double km, struct ll_grid_span_s *span)
+{
+	double dlat_deg, dlon_deg, north, south, c;
+
+	dlat_deg = km / 111.2;
+	north = dlat + dlat_deg;
+	south = dlat - dlat_deg;
+	if (north > 90) north = 90;
+	if (south < -90) south = -90;
+
+	c = cos (fmax(fabs(north), fabs(south)) * M_PI / 180.);
+	if (c < 0.0001 || km / (111.2 * c) >= 180) {
+	  dlon_deg = 180;
+	}
+	else {
+	  dlon_deg = km / (111.2 * c);
+	}
+
+	ll_grid_box (grid_deg, south, dlon - dlon_deg, north, dlon + dlon_deg, span);
+}
@@ -11,3 +11,30 @@ void latitude_to_str (double dlat, int ambiguity, char *slat);
 void longitude_to_str (double dlong, int ambiguity, char *slong);
 void latitude_to_comp_str (double dlat, char *clat);
 void longitude_to_comp_str (double dlon, char *clon);
+
+double ll_distance_km (double lat1, double lon1, double lat2, double lon2);
+
+
+/*
+ * Grid of cells, grid_deg on each side, for finding things by
+ * location.  Rows go from south to north and columns from west
+ * to east, wrapping around at 180 degrees.  Used by mheard.c and
+ * pfilter.c so they agree on the edge cases.
+ */
+
+struct ll_grid_span_s {
+	int cols;		/* Columns around the whole earth. */
+	int row_lo, row_hi;	/* Rows covered. */
+	int col_lo;		/* First column covered, at west edge. */
+	int ncols;		/* Number of columns covered. */
+};
+
+int ll_grid_cell (double grid_deg, double dlat, double dlon);
+
+void ll_grid_box (double grid_deg, double south, double west, double north, double east, struct ll_grid_span_s *span);
+
+void ll_grid_circle (double grid_deg, double dlat, double dlon, double km, struct ll_grid_span_s *span);
+
+/* Cells are hashed into a smaller number of buckets, a power of 2. */
+
+#define LL_GRID_BUCKET(cell,num_buckets) ((((unsigned)(cell) * 2654435761u) >> 20) & ((num_buckets) - 1))
@@ -0,0 +1,670 @@
+//
+//    This file is part of Dire Wolf, an amateur radio packet TNC.
+//
+//    Copyright (C) 2014  John Langner, WB2OSZ
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+/*------------------------------------------------------------------
+ *
+ * Module:      metrics.c
+ *
+ * Purpose:   	Performance counters for the whole receive and
+ *		transmit pipeline, available over HTTP.
+ *
+ * Description:	Statistics used to be scattered around, each module
+ *		with its own static variables and occasional printing.
+ *		Here they are gathered into a single registry and
+ *		made available in the Prometheus text format so they
+ *		can be watched while the application is running:
+ *
+ *			curl http://localhost:8080/metrics
+ *
+ *		There are three kinds of metrics:
+ *
+ *		Per thread counters - Used for things that happen very
+ *			often, such as audio samples and received frames.
+ *			Each thread gets its own block of counters, on first
+ *			use, so no locking is needed and threads don't fight
+ *			over the same cache lines.  The blocks are added
+ *			together only when someone asks for the results.
+ *
+ *		Existing int variables - Many modules already keep
+ *			counts.  We just need to know where they are.
+ *
+ *		Functions - For current values such as queue lengths.
+ *			They are called with the lock of the module that
+ *			owns the data so they shouldn't be used on any
+ *			hot path.  Here they are only called when formatting.
+ *
+ *		Registration is normally done once, at start up, by the
+ *		module that owns the data.
+ *
+ * Configuration:  METRICSPORT n	- Default is 0 for disabled.
+ *
+ *---------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#if __WIN32__
+#include <winsock2.h>
+#define _WIN32_WINNT 0x0501
+#include <ws2tcpip.h>
+#else
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0		/* Windows doesn't have SIGPIPE. */
+#endif
+
+#include "direwolf.h"
+#include "textcolor.h"
+#include "metrics.h"
+
+
+#define NAME_PREFIX "direwolf_"
+
+
+enum source_e { SOURCE_COUNTER, SOURCE_INT, SOURCE_FUNC };
+
+static struct metric_s {
+
+	char name[64];
+	char help[128];
+	char labels[96];
+	enum metrics_type_e type;
+	enum source_e source;
+
+	int slot;			/* SOURCE_COUNTER: index into thread blocks. */
+	double scale;			/* SOURCE_COUNTER: multiply by this for output. */
+
+	volatile int *pvalue;		/* SOURCE_INT */
+
+	double (*fn)(int arg);		/* SOURCE_FUNC */
+	int arg;
+
+} registry[METRICS_MAX];
+
+static volatile int num_metrics = 0;
+
+static int num_slots = 0;
+
+
+/*
+ * One block of counters for each thread that has ever called metrics_add.
+ * If we somehow get more threads than expected, the rest share
+ * a single block and pay the price of atomic read-modify-write.
+ */
+
+#define MAX_THREADS 64
+
+static long long *thread_block[MAX_THREADS];
+
+static volatile int num_blocks = 0;
+
+static long long shared_block[METRICS_MAX_COUNTERS];
+
+static __thread long long *my_block = NULL;
+
+
+#if __WIN32__
+static CRITICAL_SECTION registry_cs;
+static int was_init = 0;
+#else
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+
+static void registry_lock (void)
+{
+#if __WIN32__
+	/* First registration always comes from the main thread. */
+	if ( ! was_init) {
+	  InitializeCriticalSection (&registry_cs);
+	  was_init = 1;
+	}
+	EnterCriticalSection (&registry_cs);
+#else
+	pthread_mutex_lock (&registry_mutex);
+#endif
+}
+
+static void registry_unlock (void)
+{
+#if __WIN32__
+	LeaveCriticalSection (&registry_cs);
+#else
+	pthread_mutex_unlock (&registry_mutex);
+#endif
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        add_entry
+ *
+ * Purpose:     Common part of the registration functions.
+ *
+ * Returns:	Pointer to new entry, or NULL if the table is full.
+ *		Caller must have the registry lock.
+ *
+ *--------------------------------------------------------------------*/
+
+static struct metric_s *add_entry (enum metrics_type_e type, char *name, char *help, char *labels)
+{
+	struct metric_s *p;
+
+	if (num_metrics >= METRICS_MAX) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Too many performance counters.  Can't add %s{%s}.\n", name, labels);
+	  return (NULL);
+	}
+
+	p = &registry[num_metrics];
+	memset (p, 0, sizeof(struct metric_s));
+
+	strncpy (p->name, name, sizeof(p->name)-1);
+	strncpy (p->help, help, sizeof(p->help)-1);
+	strncpy (p->labels, labels, sizeof(p->labels)-1);
+	p->type = type;
+	p->scale = 1.0;
+	p->slot = -1;
+
+	return (p);
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        metrics_counter
+ *		metrics_counter_scaled
+ *
+ * Purpose:     Register a per thread counter.
+ *
+ * Inputs:	name	- e.g. "frames_received_total".  "direwolf_" is added.
+ *		help	- Description.
+ *		labels	- e.g.  chan="0"  or empty string.
+ *		scale	- Multiplier for output.  For example, it is
+ *			  more convenient to count microseconds but
+ *			  Prometheus convention is seconds.
+ *
+ * Returns:	Handle for use with metrics_add.
+ *		-1 if it could not be added.  Not fatal.
+ *
+ *--------------------------------------------------------------------*/
+
+metrics_t metrics_counter (char *name, char *help, char *labels)
+{
+	return (metrics_counter_scaled (name, help, labels, 1.0));
+}
+
+metrics_t metrics_counter_scaled (char *name, char *help, char *labels, double scale)
+{
+	struct metric_s *p;
+	int slot = -1;
+
+	registry_lock ();
+
+	if (num_slots >= METRICS_MAX_COUNTERS) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Too many performance counters.  Can't add %s{%s}.\n", name, labels);
+	}
+	else {
+	  p = add_entry (METRICS_COUNTER, name, help, labels);
+	  if (p != NULL) {
+	    p->source = SOURCE_COUNTER;
+	    p->scale = scale;
+	    p->slot = slot = num_slots++;
+	    num_metrics++;
+	  }
+	}
+
+	registry_unlock ();
+
+	return (slot);
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        metrics_int
+ *
+ * Purpose:     Register an existing int variable.
+ *
+ * Inputs:	type	- METRICS_COUNTER or METRICS_GAUGE.
+ *		name, help, labels - Same as for metrics_counter.
+ *		pvalue	- Address of variable.  It must stay around forever.
+ *
+ *--------------------------------------------------------------------*/
+
+void metrics_int (enum metrics_type_e type, char *name, char *help, char *labels, volatile int *pvalue)
+{
+	struct metric_s *p;
+
+	registry_lock ();
+
+	p = add_entry (type, name, help, labels);
+	if (p != NULL) {
+	  p->source = SOURCE_INT;
+	  p->pvalue = pvalue;
+	  num_metrics++;
+	}
+
+	registry_unlock ();
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        metrics_func
+ *
+ * Purpose:     Register a function which provides the current value.
+ *
+ * Inputs:	type	- METRICS_COUNTER or METRICS_GAUGE.
+ *		name, help, labels - Same as for metrics_counter.
+ *		fn	- Function to call.  It is called from the
+ *			  HTTP server thread so it must be thread safe.
+ *		arg	- Passed to function.  Typically a channel number.
+ *
+ *--------------------------------------------------------------------*/
+
+void metrics_func (enum metrics_type_e type, char *name, char *help, char *labels, double (*fn)(int arg), int arg)
+{
+	struct metric_s *p;
+
+	registry_lock ();
+
+	p = add_entry (type, name, help, labels);
+	if (p != NULL) {
+	  p->source = SOURCE_FUNC;
+	  p->fn = fn;
+	  p->arg = arg;
+	  num_metrics++;
+	}
+
+	registry_unlock ();
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        metrics_add
+ *
+ * Purpose:     Add to a per thread counter.
+ *
+ * Inputs:	m	- Handle from metrics_counter.
+ *		n	- Amount to add.
+ *
+ * Description:	Only the owning thread ever writes to its block
+ *		so a plain load and store is sufficient.  Relaxed atomic
+ *		operations are used so the reader never sees half of
+ *		a 64 bit value on a 32 bit processor.
+ *
+ *--------------------------------------------------------------------*/
+
+void metrics_add (metrics_t m, long long n)
+{
+	long long *p;
+
+	if (m < 0 || m >= METRICS_MAX_COUNTERS) {
+	  return;
+	}
+
+	p = my_block;
+
+	if (p == NULL) {
+	  registry_lock ();
+	  if (num_blocks < MAX_THREADS) {
+	    p = calloc (METRICS_MAX_COUNTERS, sizeof(long long));
+	  }
+	  if (p != NULL) {
+	    thread_block[num_blocks] = p;
+	    __atomic_store_n (&num_blocks, num_blocks + 1, __ATOMIC_RELEASE);
+	  }
+	  else {
+	    p = shared_block;
+	  }
+	  registry_unlock ();
+	  my_block = p;
+	}
+
+	if (p == shared_block) {
+	  __atomic_fetch_add (&p[m], n, __ATOMIC_RELAXED);
+	}
+	else {
+	  __atomic_store_n (&p[m], __atomic_load_n (&p[m], __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+	}
+}
+
+
+/*
+ * Total for one counter from all threads.
+ */
+
+static long long counter_sum (int slot)
+{
+	long long sum;
+	int nb, j;
+
+	sum = __atomic_load_n (&shared_block[slot], __ATOMIC_RELAXED);
+
+	nb = __atomic_load_n (&num_blocks, __ATOMIC_ACQUIRE);
+	for (j = 0; j < nb; j++) {
+	  sum += __atomic_load_n (&thread_block[j][slot], __ATOMIC_RELAXED);
+	}
+	return (sum);
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        metrics_format
+ *
+ * Purpose:     Produce text representation of all metrics.
+ *
+ * Inputs:	bufsize	- Size of buf.
+ *
+ * Outputs:	buf	- Prometheus text exposition format, e.g.
+ *
+ *			# HELP direwolf_frames_received_total Frames with valid FCS.
+ *			# TYPE direwolf_frames_received_total counter
+ *			direwolf_frames_received_total{chan="0",subchan="0"} 17
+ *
+ * Returns:	Number of characters placed in buf.
+ *
+ * Description:	All entries with the same name must be together,
+ *		following a single HELP and TYPE, but they could have
+ *		been registered in any order.
+ *
+ *--------------------------------------------------------------------*/
+
+int metrics_format (char *buf, int bufsize)
+{
+	int n, i, j, k;
+	int len = 0;
+	char done[METRICS_MAX];
+
+	assert (bufsize > 0);
+	buf[0] = '\0';
+
+	n = __atomic_load_n (&num_metrics, __ATOMIC_ACQUIRE);
+	memset (done, 0, sizeof(done));
+
+	for (i = 0; i < n; i++) {
+
+	  if (done[i]) continue;
+
+	  len += snprintf (buf + len, bufsize - len, "# HELP %s%s %s\n# TYPE %s%s %s\n",
+			NAME_PREFIX, registry[i].name, registry[i].help,
+			NAME_PREFIX, registry[i].name,
+			registry[i].type == METRICS_COUNTER ? "counter" : "gauge");
+	  if (len >= bufsize) break;
+
+	  for (j = i; j < n; j++) {
+
+	    struct metric_s *p = &registry[j];
+	    char value[40];
+
+	    if (done[j] || strcmp(p->name, registry[i].name) != 0) continue;
+	    done[j] = 1;
+
+	    switch (p->source) {
+	      case SOURCE_COUNTER:
+		if (p->scale == 1.0) {
+		  snprintf (value, sizeof(value), "%lld", counter_sum(p->slot));
+		}
+		else {
+		  snprintf (value, sizeof(value), "%.9g", counter_sum(p->slot) * p->scale);
+		}
+		break;
+	      case SOURCE_INT:
+		snprintf (value, sizeof(value), "%d", *(p->pvalue));
+		break;
+	      case SOURCE_FUNC:
+	      default:
+		snprintf (value, sizeof(value), "%.9g", p->fn(p->arg));
+		break;
+	    }
+
+	    if (p->labels[0] != '\0') {
+	      k = snprintf (buf + len, bufsize - len, "%s%s{%s} %s\n", NAME_PREFIX, p->name, p->labels, value);
+	    }
+	    else {
+	      k = snprintf (buf + len, bufsize - len, "%s%s %s\n", NAME_PREFIX, p->name, value);
+	    }
+	    len += k;
+	    if (len >= bufsize) break;
+	  }
+	  if (len >= bufsize) break;
+	}
+
+	if (len >= bufsize) {
+	  len = bufsize - 1;
+	}
+	return (len);
+
+} /* end metrics_format */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        metrics_init
+ *
+ * Purpose:     Start the HTTP server for performance counters.
+ *
+ * Inputs:	port	- TCP port number or 0 for none.
+ *
+ * Description:	Connections are accepted only from this computer.
+ *
+ *--------------------------------------------------------------------*/
+
+
+#if __WIN32__
+static unsigned __stdcall http_thread (void *arg);
+#else
+static void * http_thread (void *arg);
+#endif
+
+
+void metrics_init (int port)
+{
+#if __WIN32__
+	HANDLE http_th;
+#else
+	pthread_t http_tid;
+	int e;
+#endif
+
+	if (port == 0) {
+	  return;
+	}
+
+#if __WIN32__
+	http_th = (HANDLE)_beginthreadex (NULL, 0, http_thread, (void *)(long)port, 0, NULL);
+	if (http_th == NULL) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Could not create performance counter HTTP thread\n");
+	  return;
+	}
+#else
+	e = pthread_create (&http_tid, NULL, http_thread, (void *)(long)port);
+	if (e != 0) {
+	  text_color_set(DW_COLOR_ERROR);
+	  perror("Could not create performance counter HTTP thread");
+	  return;
+	}
+#endif
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        http_thread
+ *
+ * Purpose:     Answer HTTP requests for performance counters.
+ *
+ * Inputs:	arg	- TCP port number.
+ *
+ * Description:	This is not a general purpose web server.
+ *		"GET /metrics" gets the counters, anything else
+ *		gets "404 Not Found."  Requests are so quick that
+ *		they are simply handled one at a time.
+ *
+ *--------------------------------------------------------------------*/
+
+#define OUT_SIZE (METRICS_MAX * 320)
+
+#if __WIN32__
+static unsigned __stdcall http_thread (void *arg)
+#else
+static void * http_thread (void *arg)
+#endif
+{
+	int port = (int)(long)arg;
+	char *out;
+	char req[1024];
+	char hdr[200];
+	int n, len;
+
+#if __WIN32__
+	WSADATA wsadata;
+	SOCKET listen_sock, client;
+	struct sockaddr_in sockaddr;
+	DWORD timeout = 2000;
+
+	if (WSAStartup (MAKEWORD(2,2), &wsadata) != 0) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf("WSAStartup failed for performance counter HTTP server.\n");
+	  return (0);
+	}
+#else
+	int listen_sock, client;
+	struct sockaddr_in sockaddr;
+	struct timeval timeout;
+	int one = 1;
+
+	timeout.tv_sec = 2;
+	timeout.tv_usec = 0;
+#endif
+
+	out = malloc (OUT_SIZE);
+	if (out == NULL) {
+	  return (0);
+	}
+
+	listen_sock = socket (AF_INET, SOCK_STREAM, 0);
+#if __WIN32__
+	if (listen_sock == INVALID_SOCKET) {
+#else
+	if (listen_sock == -1) {
+#endif
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Performance counter HTTP server: Socket creation failed.\n");
+	  return (0);
+	}
+
+#if ! __WIN32__
+	setsockopt (listen_sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+#endif
+
+/*
+ * Only from this computer.  There is no reason to show
+ * our internals to the rest of the network.
+ */
+	memset (&sockaddr, 0, sizeof(sockaddr));
+	sockaddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	sockaddr.sin_port = htons(port);
+	sockaddr.sin_family = AF_INET;
+
+	if (bind (listen_sock, (struct sockaddr*)&sockaddr, sizeof(sockaddr)) != 0 ||
+	    listen (listen_sock, 5) != 0) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Performance counter HTTP server: Could not listen on port %d.\n", port);
+	  return (0);
+	}
+
+	text_color_set(DW_COLOR_INFO);
+	dw_printf ("Performance counters available at http://localhost:%d/metrics\n", port);
+
+	while (1) {
+
+	  client = accept (listen_sock, NULL, NULL);
+#if __WIN32__
+	  if (client == INVALID_SOCKET) {
+#else
+	  if (client == -1) {
+#endif
+	    SLEEP_SEC(1);
+	    continue;
+	  }
+
+/*
+ * Don't let a client that connects and never sends
+ * anything hold us up forever.
+ */
+	  setsockopt (client, SOL_SOCKET, SO_RCVTIMEO, (char *)&timeout, sizeof(timeout));
+
+	  len = 0;
+	  while (len < (int)sizeof(req) - 1) {
+	    n = recv (client, req + len, sizeof(req) - 1 - len, 0);
+	    if (n <= 0) break;
+	    len += n;
+	    req[len] = '\0';
+	    if (strstr(req, "\r\n\r\n") != NULL || strstr(req, "\n\n") != NULL) break;
+	  }
+	  req[len] = '\0';
+
+	  if (strncmp(req, "GET /metrics ", 13) == 0 || strncmp(req, "GET /metrics\r", 13) == 0) {
+
+	    len = metrics_format (out, OUT_SIZE);
+	    snprintf (hdr, sizeof(hdr), "HTTP/1.0 200 OK\r\n"
+			"Content-Type: text/plain; version=0.0.4\r\n"
+			"Content-Length: %d\r\n"
+			"Connection: close\r\n\r\n", len);
+	    send (client, hdr, strlen(hdr), MSG_NOSIGNAL);	/* Scraper might be gone already. */
+	    send (client, out, len, MSG_NOSIGNAL);
+	  }
+	  else {
+	    strcpy (hdr, "HTTP/1.0 404 Not Found\r\n"
+			"Content-Type: text/plain\r\n"
+			"Connection: close\r\n\r\n"
+			"Try /metrics\n");
+	    send (client, hdr, strlen(hdr), MSG_NOSIGNAL);
+	  }
+
+#if __WIN32__
+	  closesocket (client);
+#else
+	  close (client);
+#endif
+	}
+
+	return (0);
+
+} /* end http_thread */
+
+/* end metrics.c */
@@ -0,0 +1,87 @@
+
+/*------------------------------------------------------------------
+ *
+ * Module:      metrics.h
+ *
+ * Purpose:   	Performance counters for the whole receive and
+ *		transmit pipeline, available over HTTP.
+ *
+ *---------------------------------------------------------------*/
+
+#ifndef METRICS_H
+#define METRICS_H 1
+
+
+/*
+ * Maximum number of metrics, of all kinds, and of
+ * those which are per thread counters.
+ */
+
+#define METRICS_MAX 512
+
+#define METRICS_MAX_COUNTERS 256
+
+
+enum metrics_type_e {
+	METRICS_COUNTER,	/* Only goes up, e.g. number of frames received. */
+	METRICS_GAUGE };	/* Current value, e.g. queue length. */
+
+
+/*
+ * Handle for a per thread counter.
+ * Negative means it could not be registered and
+ * metrics_add will quietly ignore it.
+ */
+
+typedef int metrics_t;
+
+
+/*
+ * Registration.  This would normally be done once, by each
+ * module, in its initialization function.
+ *
+ * name		- Name without the common "direwolf_" prefix,
+ *		  e.g. "frames_received_total".
+ *		  The same name can be used more than once with
+ *		  different labels.
+ *
+ * help		- Description.  Only the first one for each name is used.
+ *
+ * labels	- Labels in Prometheus form, e.g.  chan="0",subchan="1"
+ *		  or empty string for none.
+ */
+
+metrics_t metrics_counter (char *name, char *help, char *labels);
+
+metrics_t metrics_counter_scaled (char *name, char *help, char *labels, double scale);
+
+void metrics_int (enum metrics_type_e type, char *name, char *help, char *labels, volatile int *pvalue);
+
+void metrics_func (enum metrics_type_e type, char *name, char *help, char *labels, double (*fn)(int arg), int arg);
+
+
+/*
+ * Update a per thread counter.  No locking.
+ */
+
+void metrics_add (metrics_t m, long long n);
+
+
+/*
+ * Produce everything in the Prometheus text exposition format.
+ * Returns number of characters, not counting the terminating nul.
+ */
+
+int metrics_format (char *buf, int bufsize);
+
+
+/*
+ * Start the HTTP server if port is not 0.
+ */
+
+void metrics_init (int port);
+
+
+#endif
+
+/* end metrics.h */
@@ -0,0 +1,985 @@
+//
+//    This file is part of Dire Wolf, an amateur radio packet TNC.
+//
+//    Copyright (C) 2014  John Langner, WB2OSZ
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+/*------------------------------------------------------------------
+ *
+ * Module:      mheard.c
+ *
+ * Purpose:   	Maintain a list of all stations heard on the radio.
+ *
+ * Description:	For each station (source address) we remember when it
+ *		was last heard on each channel, the path and number of
+ *		digipeater hops of the most recent, and the most recent
+ *		position from an APRS packet.
+ *
+ *		Stations are found by callsign with a hash table.
+ *
+ *		Those with a position are also kept in a grid of cells,
+ *		GRID_DEG degrees on each side, so finding those within
+ *		some distance or box only needs to look at nearby cells.
+ *		The cells themselves are hashed into a fixed number of
+ *		buckets so we don't need a slot for every cell on earth.
+ *
+ *		Stations not heard for MHEARD_RETAIN_SEC are forgotten
+ *		so the table can't grow forever.
+ *
+ *		This is used by the IGate to decide whether a message
+ *		should be sent over the radio.  It is also available
+ *		to mapping applications over a simple TCP socket.
+ *
+ * Configuration:  MHEARDPORT n		- Default is 0 for disabled.
+ *
+ *---------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <assert.h>
+
+#if __WIN32__
+#include <winsock2.h>
+#define _WIN32_WINNT 0x0501
+#include <ws2tcpip.h>
+#else
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+#if __WIN32__
+char *strtok_r(char *str, const char *delim, char **saveptr);
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0		/* Windows doesn't have SIGPIPE. */
+#endif
+
+#include "direwolf.h"
+#include "ax25_pad.h"
+#include "decode_aprs.h"
+#include "textcolor.h"
+#include "latlong.h"
+#include "mheard.h"
+
+
+#define MHEARD_RETAIN_SEC (24 * 60 * 60)	/* Forget after a day. */
+
+#define PRUNE_EVERY_SEC 300			/* How often to look for old ones. */
+
+
+/*
+ * Grid for finding stations by location.
+ * Half a degree is about 55 km north-south, less east-west
+ * away from the equator.  Typical radio range queries
+ * will look at a few dozen cells.
+ */
+
+#define GRID_DEG 0.5
+
+#define GRID_BUCKETS 4096			/* Must be power of 2. */
+
+#define NO_CELL (-1)
+
+
+typedef struct mheard_s {
+
+	mheard_info_t info;
+
+	struct mheard_s *call_next;	/* Next in same callsign hash bucket. */
+
+	int cell;			/* Grid cell or NO_CELL if position unknown. */
+
+	struct mheard_s *grid_next;	/* Others in same grid bucket. */
+	struct mheard_s *grid_prev;
+
+} mheard_t;
+
+
+static mheard_t **call_hash = NULL;	/* Size is call_hash_size. */
+
+static int call_hash_size = 0;		/* Power of 2. Grows as needed. */
+
+static int num_stations = 0;
+
+static mheard_t *grid[GRID_BUCKETS];
+
+static time_t last_prune = 0;
+
+
+#if __WIN32__
+static CRITICAL_SECTION mheard_cs;		/* Set up by mheard_init. */
+#define MHEARD_LOCK EnterCriticalSection (&mheard_cs)
+#define MHEARD_UNLOCK LeaveCriticalSection (&mheard_cs)
+#else
+static pthread_mutex_t mheard_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define MHEARD_LOCK pthread_mutex_lock (&mheard_mutex)
+#define MHEARD_UNLOCK pthread_mutex_unlock (&mheard_mutex)
+#endif
+
+
+static mheard_t * find (char *callsign);
+static void grid_move (mheard_t *mptr, int cell);
+static void prune (time_t now);
+
+
+
+/*
+ * Hash functions.
+ */
+
+static unsigned call_hash_func (char *callsign)
+{
+	unsigned h = 2166136261u;	/* FNV-1a */
+
+	while (*callsign != '\0') {
+	  h = (h ^ (unsigned char)(*callsign)) * 16777619u;
+	  callsign++;
+	}
+	return (h);
+}
+
+/* Grid cells come from latlong.c, shared with pfilter.c. */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        mheard_save
+ *
+ * Purpose:     Save information about station heard.
+ *
+ * Inputs:	chan	- Radio channel where heard.
+ *
+ *		A	- Decoded APRS information, or NULL if not APRS.
+ *
+ *		pp	- Received packet object.
+ *
+ * Description:	Call this only for frames with a good CRC.
+ *		We don't want to remember garbled callsigns.
+ *
+ *		Positions from objects and items are not about the
+ *		source station so they are ignored.
+ *
+ *--------------------------------------------------------------------*/
+
+void mheard_save (int chan, decode_aprs_t *A, packet_t pp)
+{
+	char source[AX25_MAX_ADDR_LEN];
+	char path[MHEARD_PATH_LEN];
+	char via[AX25_MAX_ADDR_LEN];
+	int hops;
+	int n, j, last_used;
+	time_t now;
+	mheard_t *mptr;
+
+	assert (chan >= 0 && chan < MAX_CHANS);
+
+	ax25_get_addr_with_ssid (pp, AX25_SOURCE, source);
+
+/*
+ * Count digipeaters used and make path in the usual
+ * form with "*" after the last one used.
+ */
+	n = ax25_get_num_repeaters (pp);
+	hops = 0;
+	last_used = -1;
+	for (j = 0; j < n; j++) {
+	  if (ax25_get_h (pp, AX25_REPEATER_1 + j)) {
+	    hops++;
+	    last_used = j;
+	  }
+	}
+
+	path[0] = '\0';
+	for (j = 0; j < n; j++) {
+	  ax25_get_addr_with_ssid (pp, AX25_REPEATER_1 + j, via);
+	  if (j > 0 && strlen(path) + 1 < sizeof(path)) {
+	    strcat (path, ",");
+	  }
+	  strncat (path, via, sizeof(path) - 1 - strlen(path));
+	  if (j == last_used && strlen(path) + 1 < sizeof(path)) {
+	    strcat (path, "*");
+	  }
+	}
+
+	now = time(NULL);
+
+	MHEARD_LOCK;
+
+	mptr = find (source);
+
+	if (mptr == NULL) {
+
+/*
+ * First time heard.  Enlarge hash table if getting crowded.
+ */
+	  unsigned h;
+
+	  if (num_stations >= call_hash_size * 2) {
+	    int new_size = call_hash_size == 0 ? 256 : call_hash_size * 2;
+	    mheard_t **new_hash = calloc (new_size, sizeof(mheard_t *));
+
+	    if (new_hash != NULL) {
+	      for (j = 0; j < call_hash_size; j++) {
+	        while (call_hash[j] != NULL) {
+	          mheard_t *m = call_hash[j];
+	          call_hash[j] = m->call_next;
+	          h = call_hash_func(m->info.callsign) & (new_size - 1);
+	          m->call_next = new_hash[h];
+	          new_hash[h] = m;
+	        }
+	      }
+	      free (call_hash);
+	      call_hash = new_hash;
+	      call_hash_size = new_size;
+	    }
+	  }
+
+	  mptr = calloc (1, sizeof(mheard_t));
+	  if (mptr == NULL || call_hash_size == 0) {
+	    MHEARD_UNLOCK;
+	    free (mptr);
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf ("Out of memory for list of stations heard.\n");
+	    return;
+	  }
+
+	  strcpy (mptr->info.callsign, source);
+	  mptr->info.dlat = G_UNKNOWN;
+	  mptr->info.dlon = G_UNKNOWN;
+	  mptr->cell = NO_CELL;
+
+	  h = call_hash_func(source) & (call_hash_size - 1);
+	  mptr->call_next = call_hash[h];
+	  call_hash[h] = mptr;
+	  num_stations++;
+	}
+
+	mptr->info.chan = chan;
+	mptr->info.last_heard = now;
+	mptr->info.last_heard_chan[chan] = now;
+	mptr->info.num_digi_hops = hops;
+	strcpy (mptr->info.path, path);
+
+	if (A != NULL && A->g_lat != G_UNKNOWN && A->g_lon != G_UNKNOWN && A->g_name[0] == '\0') {
+	  mptr->info.dlat = A->g_lat;
+	  mptr->info.dlon = A->g_lon;
+	  mptr->info.last_position = now;
+	  grid_move (mptr, ll_grid_cell (GRID_DEG, A->g_lat, A->g_lon));
+	}
+
+	if (now - last_prune >= PRUNE_EVERY_SEC) {
+	  prune (now);
+	  last_prune = now;
+	}
+
+	MHEARD_UNLOCK;
+
+} /* end mheard_save */
+
+
+/*
+ * Find by callsign.  Caller must have the lock.
+ */
+
+static mheard_t * find (char *callsign)
+{
+	mheard_t *p;
+
+	if (call_hash_size == 0) {
+	  return (NULL);
+	}
+
+	for (p = call_hash[call_hash_func(callsign) & (call_hash_size - 1)]; p != NULL; p = p->call_next) {
+	  if (strcmp(p->info.callsign, callsign) == 0) {
+	    return (p);
+	  }
+	}
+	return (NULL);
+}
+
+
+/*
+ * Put station in a different grid cell, or none.
+ * Caller must have the lock.
+ */
+
+static void grid_move (mheard_t *mptr, int cell)
+{
+	int b;
+
+	if (mptr->cell == cell) {
+	  return;
+	}
+
+	if (mptr->cell != NO_CELL) {
+	  if (mptr->grid_prev != NULL) {
+	    mptr->grid_prev->grid_next = mptr->grid_next;
+	  }
+	  else {
+	    grid[LL_GRID_BUCKET(mptr->cell, GRID_BUCKETS)] = mptr->grid_next;
+	  }
+	  if (mptr->grid_next != NULL) {
+	    mptr->grid_next->grid_prev = mptr->grid_prev;
+	  }
+	  mptr->grid_next = NULL;
+	  mptr->grid_prev = NULL;
+	}
+
+	mptr->cell = cell;
+
+	if (cell != NO_CELL) {
+	  b = LL_GRID_BUCKET(cell, GRID_BUCKETS);
+	  mptr->grid_prev = NULL;
+	  mptr->grid_next = grid[b];
+	  if (grid[b] != NULL) {
+	    grid[b]->grid_prev = mptr;
+	  }
+	  grid[b] = mptr;
+	}
+}
+
+
+/*
+ * Forget stations not heard for a long time.
+ * Caller must have the lock.
+ */
+
+static void prune (time_t now)
+{
+	int j;
+	mheard_t **pp;
+
+	for (j = 0; j < call_hash_size; j++) {
+	  pp = &(call_hash[j]);
+	  while (*pp != NULL) {
+	    mheard_t *m = *pp;
+
+	    if (m->info.last_heard < now - MHEARD_RETAIN_SEC) {
+	      *pp = m->call_next;
+	      grid_move (m, NO_CELL);
+	      free (m);
+	      num_stations--;
+	    }
+	    else {
+	      pp = &(m->call_next);
+	    }
+	  }
+	}
+}
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        mheard_get
+ *
+ * Purpose:     Get information about one station.
+ *
+ * Inputs:	callsign	- With SSID if not 0.  e.g. "WB2OSZ-5"
+ *
+ * Outputs:	info		- Copy of what we know.
+ *
+ * Returns:	1 if found, 0 if never heard.
+ *
+ *--------------------------------------------------------------------*/
+
+int mheard_get (char *callsign, mheard_info_t *info)
+{
+	mheard_t *mptr;
+
+	MHEARD_LOCK;
+	mptr = find (callsign);
+	if (mptr != NULL) {
+	  memcpy (info, &(mptr->info), sizeof(mheard_info_t));
+	}
+	MHEARD_UNLOCK;
+
+	return (mptr != NULL);
+}
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        mheard_was_recently_nearby
+ *
+ * Purpose:     Decide whether a station is within radio range.
+ *
+ * Inputs:	callsign	- With SSID if not 0.
+ *
+ *		time_limit	- Must have been heard within this many seconds.
+ *
+ *		max_hops	- Maximum number of digipeater hops.
+ *
+ * Returns:	1 if heard recently enough and close enough.
+ *
+ * Description:	The standard IGate rule is to send a message from
+ *		the Internet over the radio only if the addressee
+ *		was heard on the radio recently.
+ *
+ *--------------------------------------------------------------------*/
+
+int mheard_was_recently_nearby (char *callsign, int time_limit, int max_hops)
+{
+	mheard_info_t info;
+
+	if ( ! mheard_get (callsign, &info)) {
+	  return (0);
+	}
+
+	return (info.last_heard >= time(NULL) - time_limit && info.num_digi_hops <= max_hops);
+}
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        mheard_count
+ *
+ * Purpose:     Count stations heard on a channel.
+ *
+ * Inputs:	chan		- Radio channel.
+ *
+ *		time_limit	- Heard within this many seconds.
+ *
+ *		max_hops	- Maximum number of digipeater hops.
+ *				  Use 0 for only those heard directly.
+ *
+ * Returns:	Number of different stations.
+ *
+ * Description:	This looks at every station so don't use it for
+ *		each packet.
+ *
+ *--------------------------------------------------------------------*/
+
+int mheard_count (int chan, int time_limit, int max_hops)
+{
+	time_t since = time(NULL) - time_limit;
+	int count = 0;
+	int j;
+	mheard_t *p;
+
+	assert (chan >= 0 && chan < MAX_CHANS);
+
+	MHEARD_LOCK;
+	for (j = 0; j < call_hash_size; j++) {
+	  for (p = call_hash[j]; p != NULL; p = p->call_next) {
+	    if (p->info.last_heard_chan[chan] >= since && p->info.num_digi_hops <= max_hops) {
+	      count++;
+	    }
+	  }
+	}
+	MHEARD_UNLOCK;
+
+	return (count);
+}
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        mheard_range
+ *		mheard_box
+ *
+ * Purpose:     Find stations near a location.
+ *
+ * Inputs:	dlat, dlon	- Center, in degrees.
+ *		km		- Maximum distance.
+ *
+ *		north, west,	- Edges of box, in degrees.
+ *		south, east	  west > east if it crosses 180 degrees.
+ *
+ *		time_limit	- Position received within this many seconds.
+ *				  0 for any time.
+ *
+ *		max_results	- Size of result array.
+ *
+ * Outputs:	result		- Information for stations found.
+ *
+ * Returns:	Number of stations found.  This can be more than
+ *		max_results but only that many are returned.
+ *
+ * Description:	Only grid cells overlapping the area are examined.
+ *		If the area is very large, it is quicker to simply
+ *		go through all of the grid buckets once.
+ *
+ *--------------------------------------------------------------------*/
+
+#define MATCH_RANGE 1
+#define MATCH_BOX 2
+
+struct search_s {
+	int kind;
+	double dlat, dlon, km;
+	double north, west, south, east;
+	time_t since;
+	mheard_info_t *result;
+	int max_results;
+	int found;
+};
+
+
+static void check_station (struct search_s *s, mheard_t *p)
+{
+	int ok;
+
+	if (s->since != 0 && p->info.last_position < s->since) {
+	  return;
+	}
+
+	if (s->kind == MATCH_RANGE) {
+	  ok = ll_distance_km (s->dlat, s->dlon, p->info.dlat, p->info.dlon) <= s->km;
+	}
+	else {
+	  ok = p->info.dlat <= s->north && p->info.dlat >= s->south;
+	  if (s->west <= s->east) {
+	    ok = ok && p->info.dlon >= s->west && p->info.dlon <= s->east;
+	  }
+	  else {
+	    ok = ok && (p->info.dlon >= s->west || p->info.dlon <= s->east);
+	  }
+	}
+
+	if (ok) {
+	  if (s->found < s->max_results) {
+	    memcpy (&(s->result[s->found]), &(p->info), sizeof(mheard_info_t));
+	  }
+	  s->found++;
+	}
+}
+
+
+/*
+ * Visit everything in the cells from ll_grid_box or ll_grid_circle.
+ */
+
+static void search_cells (struct search_s *s, struct ll_grid_span_s *span)
+{
+	int row, k, b;
+	mheard_t *p;
+
+	MHEARD_LOCK;
+
+	if ((span->row_hi - span->row_lo + 1) * span->ncols > GRID_BUCKETS) {
+
+	  for (b = 0; b < GRID_BUCKETS; b++) {
+	    for (p = grid[b]; p != NULL; p = p->grid_next) {
+	      check_station (s, p);
+	    }
+	  }
+	}
+	else {
+
+	  for (row = span->row_lo; row <= span->row_hi; row++) {
+	    for (k = 0; k < span->ncols; k++) {
+	      int cell = row * span->cols + (span->col_lo + k) % span->cols;
+
+	      for (p = grid[LL_GRID_BUCKET(cell, GRID_BUCKETS)]; p != NULL; p = p->grid_next) {
+	        if (p->cell == cell) {
+	          check_station (s, p);
+	        }
+	      }
+	    }
+	  }
+	}
+
+	MHEARD_UNLOCK;
+}
+
+
+int mheard_range (double dlat, double dlon, double km, int time_limit, mheard_info_t *result, int max_results)
+{
+	struct search_s s;
+	struct ll_grid_span_s span;
+
+	memset (&s, 0, sizeof(s));
+	s.kind = MATCH_RANGE;
+	s.dlat = dlat;
+	s.dlon = dlon;
+	s.km = km;
+	s.since = time_limit > 0 ? time(NULL) - time_limit : 0;
+	s.result = result;
+	s.max_results = max_results;
+
+	ll_grid_circle (GRID_DEG, dlat, dlon, km, &span);
+	search_cells (&s, &span);
+
+	return (s.found);
+}
+
+
+int mheard_box (double north, double west, double south, double east, int time_limit, mheard_info_t *result, int max_results)
+{
+	struct search_s s;
+	struct ll_grid_span_s span;
+
+	memset (&s, 0, sizeof(s));
+	s.kind = MATCH_BOX;
+	s.north = north;
+	s.west = west;
+	s.south = south;
+	s.east = east;
+	s.since = time_limit > 0 ? time(NULL) - time_limit : 0;
+	s.result = result;
+	s.max_results = max_results;
+
+	if (west > east) {
+	  east += 360;
+	}
+	ll_grid_box (GRID_DEG, south, west, north, east, &span);
+	search_cells (&s, &span);
+
+	return (s.found);
+}
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        mheard_init
+ *
+ * Purpose:     Start the server for queries from other applications.
+ *
+ * Inputs:	port	- TCP port number or 0 for none.
+ *
+ *--------------------------------------------------------------------*/
+
+
+#if __WIN32__
+static unsigned __stdcall query_thread (void *arg);
+#else
+static void * query_thread (void *arg);
+#endif
+
+
+void mheard_init (int port)
+{
+#if __WIN32__
+	HANDLE query_th;
+#else
+	pthread_t query_tid;
+	int e;
+#endif
+
+#if __WIN32__
+	InitializeCriticalSection (&mheard_cs);
+#endif
+
+	if (port == 0) {
+	  return;
+	}
+
+#if __WIN32__
+	query_th = (HANDLE)_beginthreadex (NULL, 0, query_thread, (void *)(long)port, 0, NULL);
+	if (query_th == NULL) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Could not create stations heard query thread\n");
+	  return;
+	}
+#else
+	e = pthread_create (&query_tid, NULL, query_thread, (void *)(long)port);
+	if (e != 0) {
+	  text_color_set(DW_COLOR_ERROR);
+	  perror("Could not create stations heard query thread");
+	  return;
+	}
+#endif
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        query_thread
+ *
+ * Purpose:     Answer queries about stations heard.
+ *
+ * Inputs:	arg	- TCP port number.
+ *
+ * Description:	Each query is one line of text:
+ *
+ *			CALL callsign
+ *			RANGE lat lon km [minutes]
+ *			BOX north west south east [minutes]
+ *			LIST [minutes]
+ *
+ *		Latitude and longitude are in decimal degrees,
+ *		negative for south or west.  The optional minutes
+ *		limits the answer to stations heard that recently.
+ *
+ *		The answer is one line for each station, with
+ *		these fields separated by tabs:
+ *
+ *			callsign, latitude, longitude, seconds since
+ *			position, seconds since heard, channel,
+ *			digipeater hops, path
+ *
+ *		Unknown position is empty.  A blank line marks
+ *		the end of each answer.
+ *
+ *		Several queries can be sent at once.  The connection
+ *		is closed when idle for a couple seconds.  Queries are
+ *		quick so clients are simply handled one at a time.
+ *
+ *--------------------------------------------------------------------*/
+
+#define QUERY_MAX_RESULTS 2000
+
+#if __WIN32__
+typedef SOCKET sock_t;
+#else
+typedef int sock_t;
+#endif
+
+static void send_str (sock_t client, char *str)
+{
+	send (client, str, strlen(str), MSG_NOSIGNAL);	/* Client might be gone already. */
+}
+
+static void send_info (sock_t client, mheard_info_t *info, time_t now)
+{
+	char line[200];
+	char slat[20], slon[20], spos[20];
+
+	if (info->dlat != G_UNKNOWN && info->dlon != G_UNKNOWN) {
+	  snprintf (slat, sizeof(slat), "%.5f", info->dlat);
+	  snprintf (slon, sizeof(slon), "%.5f", info->dlon);
+	  snprintf (spos, sizeof(spos), "%ld", (long)(now - info->last_position));
+	}
+	else {
+	  strcpy (slat, "");
+	  strcpy (slon, "");
+	  strcpy (spos, "");
+	}
+
+	snprintf (line, sizeof(line), "%s\t%s\t%s\t%s\t%ld\t%d\t%d\t%s\n",
+		info->callsign, slat, slon, spos,
+		(long)(now - info->last_heard), info->chan,
+		info->num_digi_hops, info->path);
+
+	send_str (client, line);
+}
+
+
+static void answer (sock_t client, char *query, mheard_info_t *results)
+{
+	char *cmd, *t, *save;
+	double arg[5];
+	int nargs = 0;
+	int n, j;
+	int time_limit;
+	time_t now = time(NULL);
+	char callsign[AX25_MAX_ADDR_LEN];
+
+	cmd = strtok_r (query, " \t\r\n", &save);
+	if (cmd == NULL) {
+	  return;
+	}
+
+	if (strcasecmp(cmd, "CALL") == 0) {
+	  t = strtok_r (NULL, " \t\r\n", &save);
+	  if (t == NULL) {
+	    send_str (client, "? Missing callsign\n\n");
+	    return;
+	  }
+	  strncpy (callsign, t, sizeof(callsign) - 1);
+	  callsign[sizeof(callsign) - 1] = '\0';
+	  for (j = 0; callsign[j] != '\0'; j++) {
+	    if (islower(callsign[j])) callsign[j] = toupper(callsign[j]);
+	  }
+	  if (mheard_get (callsign, &results[0])) {
+	    send_info (client, &results[0], now);
+	  }
+	  send_str (client, "\n");
+	  return;
+	}
+
+	while (nargs < 5 && (t = strtok_r (NULL, " \t\r\n", &save)) != NULL) {
+	  arg[nargs++] = atof(t);
+	}
+
+	if (strcasecmp(cmd, "RANGE") == 0 && nargs >= 3) {
+	  time_limit = nargs >= 4 ? (int)(arg[3] * 60) : 0;
+	  n = mheard_range (arg[0], arg[1], arg[2], time_limit, results, QUERY_MAX_RESULTS);
+	}
+	else if (strcasecmp(cmd, "BOX") == 0 && nargs >= 4) {
+	  time_limit = nargs >= 5 ? (int)(arg[4] * 60) : 0;
+	  n = mheard_box (arg[0], arg[1], arg[2], arg[3], time_limit, results, QUERY_MAX_RESULTS);
+	}
+	else if (strcasecmp(cmd, "LIST") == 0) {
+	  mheard_t *p;
+	  time_t since = nargs >= 1 ? now - (time_t)(arg[0] * 60) : 0;
+
+	  n = 0;
+	  MHEARD_LOCK;
+	  for (j = 0; j < call_hash_size; j++) {
+	    for (p = call_hash[j]; p != NULL; p = p->call_next) {
+	      if (p->info.last_heard >= since) {
+	        if (n < QUERY_MAX_RESULTS) {
+	          memcpy (&results[n], &(p->info), sizeof(mheard_info_t));
+	        }
+	        n++;
+	      }
+	    }
+	  }
+	  MHEARD_UNLOCK;
+	}
+	else {
+	  send_str (client, "? Try CALL, RANGE, BOX, or LIST\n\n");
+	  return;
+	}
+
+	if (n > QUERY_MAX_RESULTS) {
+	  n = QUERY_MAX_RESULTS;
+	}
+	for (j = 0; j < n; j++) {
+	  send_info (client, &results[j], now);
+	}
+	send_str (client, "\n");
+}
+
+
+#if __WIN32__
+static unsigned __stdcall query_thread (void *arg)
+#else
+static void * query_thread (void *arg)
+#endif
+{
+	int port = (int)(long)arg;
+	mheard_info_t *results;
+	char req[1024];
+	char *eol;
+	int n, len;
+
+#if __WIN32__
+	WSADATA wsadata;
+	SOCKET listen_sock, client;
+	struct sockaddr_in sockaddr;
+	DWORD timeout = 2000;
+
+	if (WSAStartup (MAKEWORD(2,2), &wsadata) != 0) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf("WSAStartup failed for stations heard query server.\n");
+	  return (0);
+	}
+#else
+	int listen_sock, client;
+	struct sockaddr_in sockaddr;
+	struct timeval timeout;
+	int one = 1;
+
+	timeout.tv_sec = 2;
+	timeout.tv_usec = 0;
+#endif
+
+	results = malloc (QUERY_MAX_RESULTS * sizeof(mheard_info_t));
+	if (results == NULL) {
+	  return (0);
+	}
+
+	listen_sock = socket (AF_INET, SOCK_STREAM, 0);
+#if __WIN32__
+	if (listen_sock == INVALID_SOCKET) {
+#else
+	if (listen_sock == -1) {
+#endif
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Stations heard query server: Socket creation failed.\n");
+	  return (0);
+	}
+
+#if ! __WIN32__
+	setsockopt (listen_sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+#endif
+
+/*
+ * Only from this computer, like the metrics server.
+ */
+	memset (&sockaddr, 0, sizeof(sockaddr));
+	sockaddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	sockaddr.sin_port = htons(port);
+	sockaddr.sin_family = AF_INET;
+
+	if (bind (listen_sock, (struct sockaddr*)&sockaddr, sizeof(sockaddr)) != 0 ||
+	    listen (listen_sock, 5) != 0) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Stations heard query server: Could not listen on port %d.\n", port);
+	  return (0);
+	}
+
+	text_color_set(DW_COLOR_INFO);
+	dw_printf ("Ready to answer queries about stations heard on port %d ...\n", port);
+
+	while (1) {
+
+	  client = accept (listen_sock, NULL, NULL);
+#if __WIN32__
+	  if (client == INVALID_SOCKET) {
+#else
+	  if (client == -1) {
+#endif
+	    SLEEP_SEC(1);
+	    continue;
+	  }
+
+	  setsockopt (client, SOL_SOCKET, SO_RCVTIMEO, (char *)&timeout, sizeof(timeout));
+
+/*
+ * Answer each complete line until the client goes
+ * away or is quiet for a while.
+ */
+	  len = 0;
+	  while (1) {
+	    n = recv (client, req + len, sizeof(req) - 1 - len, 0);
+	    if (n <= 0) break;
+	    len += n;
+	    req[len] = '\0';
+
+	    while ((eol = strchr(req, '\n')) != NULL) {
+	      *eol = '\0';
+	      answer (client, req, results);
+	      len -= (eol + 1 - req);
+	      memmove (req, eol + 1, len + 1);
+	    }
+
+	    if (len >= (int)sizeof(req) - 1) {
+	      break;		/* Absurdly long line. */
+	    }
+	  }
+
+#if __WIN32__
+	  closesocket (client);
+#else
+	  close (client);
+#endif
+	}
+
+	return (0);
+
+} /* end query_thread */
+
+/* end mheard.c */
@@ -0,0 +1,108 @@
+
+/*------------------------------------------------------------------
+ *
+ * Module:      mheard.h
+ *
+ * Purpose:   	Remember stations heard on the radio, and where they are.
+ *
+ *---------------------------------------------------------------*/
+
+#ifndef MHEARD_H
+#define MHEARD_H 1
+
+#include <time.h>
+
+#include "ax25_pad.h"
+#include "decode_aprs.h"
+
+
+/*
+ * Information about one station.
+ * Queries return copies of these so the caller doesn't need
+ * to worry about the table changing while it is looking.
+ */
+
+#define MHEARD_PATH_LEN 80
+
+typedef struct mheard_info_s {
+
+	char callsign[AX25_MAX_ADDR_LEN];	/* Source address, including SSID. */
+
+	int chan;			/* Channel most recently heard on. */
+
+	time_t last_heard;		/* Most recent time heard on any channel. */
+
+	time_t last_heard_chan[MAX_CHANS];	/* Same for each channel, 0 if never. */
+
+	int num_digi_hops;		/* Number of digipeaters used for the most */
+					/* recent one.  0 means heard directly. */
+
+	char path[MHEARD_PATH_LEN];	/* Via path of most recent, e.g. "W1ABC*,WIDE2-1" */
+
+	double dlat, dlon;		/* Most recent position.  G_UNKNOWN if none yet. */
+
+	time_t last_position;		/* When position was received.  0 if never. */
+
+} mheard_info_t;
+
+
+/*
+ * Start the query socket if port is not 0.
+ */
+
+void mheard_init (int port);
+
+
+/*
+ * Call this for each frame received with a good CRC.
+ * A is the decoded APRS information or NULL for other frames.
+ */
+
+void mheard_save (int chan, decode_aprs_t *A, packet_t pp);
+
+
+/*
+ * Look up one station by callsign.  O(1).
+ * Returns 1 and fills in info if found.
+ */
+
+int mheard_get (char *callsign, mheard_info_t *info);
+
+
+/*
+ * Was the station heard on the radio within the last time_limit
+ * seconds using no more than max_hops digipeaters?
+ * Intended for IGate decisions such as gating a message to RF.
+ */
+
+int mheard_was_recently_nearby (char *callsign, int time_limit, int max_hops);
+
+
+/*
+ * Number of different stations heard on a channel within the
+ * last time_limit seconds using no more than max_hops digipeaters.
+ * Gives some idea of how busy the channel is, e.g. for
+ * digipeater policies.
+ */
+
+int mheard_count (int chan, int time_limit, int max_hops);
+
+
+/*
+ * Stations with a known position, heard within the last time_limit
+ * seconds (0 for any), within some distance of a point or within a box.
+ *
+ * Up to max_results are placed in result.
+ * The return value is the total number found, which could be larger.
+ *
+ * For the box, west > east means it crosses the 180 degree meridian.
+ */
+
+int mheard_range (double dlat, double dlon, double km, int time_limit, mheard_info_t *result, int max_results);
+
+int mheard_box (double north, double west, double south, double east, int time_limit, mheard_info_t *result, int max_results);
+
+
+#endif
+
+/* end mheard.h */
@@ -78,6 +78,7 @@
 #include "demod.h"
 #include "hdlc_rec.h"
 #include "hdlc_rec2.h"
+#include "airtime.h"
 
 
 // Properties of the radio channels.
@@ -298,6 +299,7 @@ void multi_modem_process_rec_frame (int chan, int subchan, unsigned char *fbuf,
  * If single modem, push it thru and forget about all this foolishness.
  */
 	if (modem.num_subchan[chan] == 1) {
+	  airtime_rec_frame (chan, retries == RETRY_TWO_SEP);
 	  app_process_rec_packet (chan, subchan, pp, alevel, retries, "");
 	  return;
 	}
@@ -337,6 +339,7 @@ void multi_modem_process_rec_frame (int chan, int subchan, unsigned char *fbuf,
 #if DEBUG
 	  dw_printf ("Send the best one along.\n");
 #endif
+	  airtime_rec_frame (chan, retries == RETRY_TWO_SEP);
 	  app_process_rec_packet (chan, subchan, pp, alevel, retries, spectrum);
 	  crc_of_last_to_app[chan] = mycrc;
 	  return;
@@ -456,6 +459,7 @@ static void pick_best_candidate (int chan)
 /*
  * send the best one along.
  */
+	airtime_rec_frame (chan, candidate[chan][best_subchan].retries == RETRY_TWO_SEP);
 	app_process_rec_packet (chan, best_subchan, 
 		candidate[chan][best_subchan].packet_p, 
 		candidate[chan][best_subchan].alevel, 
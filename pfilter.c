@@ -0,0 +1,1056 @@
+//
+//    This file is part of Dire Wolf, an amateur radio packet TNC.
+//
+//    Copyright (C) 2014  John Langner, WB2OSZ
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+/*------------------------------------------------------------------
+ *
+ * Module:      pfilter.c
+ *
+ * Purpose:   	Decide whether a packet should be passed along,
+ *		using the same filter syntax as the APRS-IS servers.
+ *
+ * Description:	The IGate server sends us everything selected by the
+ *		IGFILTER.  We might want a wide filter so client
+ *		applications can see what is going on, while only
+ *		a small part of that should be sent over the radio.
+ *		Rather than making the server do it twice, the
+ *		same kind of filter is applied locally.
+ *
+ *		A filter specification is a list of terms separated
+ *		by spaces.  A packet passes if it matches any term,
+ *		unless it also matches any term starting with "-".
+ *
+ *		r/lat/lon/dist		Position within dist km of a point.
+ *		a/latN/lonW/latS/lonE	Position within a box.
+ *		p/aa/bb/...		Source call starts with one of these.
+ *		b/call1/call2/...	Source call.  "*" is a wildcard.
+ *		o/obj1/obj2/...		Object or item name.  "*" is a wildcard.
+ *		d/digi1/digi2/...	Digipeater used.  "*" is a wildcard.
+ *		t/poimqstunw		Packet type.  Optionally followed
+ *		t/poimqstunw/call/km	by station and distance.
+ *		s/pri/alt/over		Symbol from primary table, alternate
+ *					table, and with these overlays.
+ *		f/call/dist		Position within dist km of a station.
+ *
+ *		For f/ and t/.../call/km, the other station's position
+ *		comes from the list of stations heard on the radio.
+ *
+ *		The specification is compiled into a tree so each
+ *		packet is evaluated without parsing the text again.
+ *		All of the r/ ranges are combined and put into a grid
+ *		so a filter with many of them only needs to look at
+ *		the few that are near the packet position.
+ *		The packet is decoded only if some term needs to know
+ *		the position or symbol.
+ *
+ *---------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <assert.h>
+
+#include "direwolf.h"
+#include "ax25_pad.h"
+#include "decode_aprs.h"
+#include "textcolor.h"
+#include "latlong.h"
+#include "mheard.h"
+#include "pfilter.h"
+
+#if __WIN32__
+char *strtok_r(char *str, const char *delim, char **saveptr);
+#endif
+
+#define MAX_VALUES 10		/* Most values after the filter letter. */
+
+
+enum pfkind_e { PF_OR, PF_AND, PF_NOT,
+		PF_RANGES, PF_AREA, PF_PREFIX, PF_BUDLIST, PF_OBJECT,
+		PF_DIGI, PF_TYPE, PF_SYMBOL, PF_FRIEND };
+
+
+/*
+ * Packet types for t/ filter.
+ */
+
+#define T_POSITION	0x001
+#define T_OBJECT	0x002
+#define T_ITEM		0x004
+#define T_MESSAGE	0x008
+#define T_QUERY		0x010
+#define T_STATUS	0x020
+#define T_TELEMETRY	0x040
+#define T_USER		0x080
+#define T_NWS		0x100
+#define T_WEATHER	0x200
+
+static const char type_letters[] = "poimqstunw";
+
+
+/*
+ * Circles from all r/ terms at the same level.
+ *
+ * The earth is divided into cells, RS_GRID_DEG on each side, and
+ * each circle is listed under the cells it overlaps.  The cells are
+ * hashed into a small number of buckets.  A circle overlapping
+ * more than RS_MAX_CELLS cells goes on the "wide" list which is
+ * always checked.  There shouldn't be many of those.
+ */
+
+#define RS_GRID_DEG 1.0
+#define RS_BUCKETS 256			/* Must be power of 2. */
+#define RS_MAX_CELLS 64
+
+struct circle_s {
+	double lat, lon, km;
+};
+
+struct rs_ent_s {
+	int cell;
+	int circle;
+	int next;			/* Next in same bucket or -1. */
+};
+
+struct rangeset_s {
+	int num_circles;
+	struct circle_s *circles;
+
+	int num_wide;
+	int *wide;
+
+	int head[RS_BUCKETS];		/* First in bucket or -1. */
+	int num_ent;
+	int max_ent;
+	struct rs_ent_s *ent;
+};
+
+
+struct pfnode_s {
+
+	enum pfkind_e kind;
+
+	struct pfnode_s *next;		/* Next in same list. */
+
+	struct pfnode_s *child;		/* First in list for PF_OR, PF_AND, PF_NOT. */
+
+	int num_args;			/* Strings for lists of calls, etc. */
+	char **args;
+
+	double v[4];			/* Numbers for area and friend distance. */
+
+	unsigned types;			/* PF_TYPE */
+
+	struct rangeset_s *rs;		/* PF_RANGES */
+};
+
+
+struct pfilter_s {
+	struct pfnode_s *root;
+};
+
+
+/*
+ * What we know about the packet being tested.
+ * Decoding is done only if needed, and only once.
+ */
+
+struct pkt_s {
+	packet_t pp;
+	unsigned char *pinfo;
+	int info_len;
+	char src[AX25_MAX_ADDR_LEN];
+	int decoded;
+	decode_aprs_t A;
+};
+
+
+static int eval (struct pfnode_s *n, struct pkt_s *k);
+static void free_node (struct pfnode_s *n);
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Grid for r/ ranges.  Cells come from latlong.c, shared
+ * with mheard.c.
+ *
+ *--------------------------------------------------------------------*/
+
+static struct rangeset_s * rs_new (void)
+{
+	struct rangeset_s *rs;
+	int b;
+
+	rs = calloc (1, sizeof(struct rangeset_s));
+	for (b = 0; b < RS_BUCKETS; b++) {
+	  rs->head[b] = -1;
+	}
+	return (rs);
+}
+
+static void rs_free (struct rangeset_s *rs)
+{
+	free (rs->circles);
+	free (rs->wide);
+	free (rs->ent);
+	free (rs);
+}
+
+static void rs_add (struct rangeset_s *rs, double lat, double lon, double km)
+{
+	int c = rs->num_circles;
+	struct ll_grid_span_s span;
+	int row, k;
+
+	rs->circles = realloc (rs->circles, (c + 1) * sizeof(struct circle_s));
+	rs->circles[c].lat = lat;
+	rs->circles[c].lon = lon;
+	rs->circles[c].km = km;
+	rs->num_circles++;
+
+	ll_grid_circle (RS_GRID_DEG, lat, lon, km, &span);
+
+	if ((span.row_hi - span.row_lo + 1) * span.ncols > RS_MAX_CELLS) {
+	  rs->wide = realloc (rs->wide, (rs->num_wide + 1) * sizeof(int));
+	  rs->wide[rs->num_wide++] = c;
+	  return;
+	}
+
+	for (row = span.row_lo; row <= span.row_hi; row++) {
+	  for (k = 0; k < span.ncols; k++) {
+	    int cell = row * span.cols + (span.col_lo + k) % span.cols;
+	    int b = LL_GRID_BUCKET(cell, RS_BUCKETS);
+
+	    if (rs->num_ent >= rs->max_ent) {
+	      rs->max_ent = rs->max_ent == 0 ? 64 : rs->max_ent * 2;
+	      rs->ent = realloc (rs->ent, rs->max_ent * sizeof(struct rs_ent_s));
+	    }
+	    rs->ent[rs->num_ent].cell = cell;
+	    rs->ent[rs->num_ent].circle = c;
+	    rs->ent[rs->num_ent].next = rs->head[b];
+	    rs->head[b] = rs->num_ent;
+	    rs->num_ent++;
+	  }
+	}
+}
+
+static int rs_match (struct rangeset_s *rs, double lat, double lon)
+{
+	int cell = ll_grid_cell (RS_GRID_DEG, lat, lon);
+	int e, j;
+	struct circle_s *c;
+
+	for (e = rs->head[LL_GRID_BUCKET(cell, RS_BUCKETS)]; e >= 0; e = rs->ent[e].next) {
+	  if (rs->ent[e].cell == cell) {
+	    c = &(rs->circles[rs->ent[e].circle]);
+	    if (ll_distance_km (c->lat, c->lon, lat, lon) <= c->km) {
+	      return (1);
+	    }
+	  }
+	}
+
+	for (j = 0; j < rs->num_wide; j++) {
+	  c = &(rs->circles[rs->wide[j]]);
+	  if (ll_distance_km (c->lat, c->lon, lat, lon) <= c->km) {
+	    return (1);
+	  }
+	}
+	return (0);
+}
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        pfilter_compile
+ *
+ * Purpose:     Turn filter specification into something quick to evaluate.
+ *
+ * Inputs:	spec		- Filter specification, e.g.
+ *				  "r/42.6/-71.3/50 t/m -b/N0CALL*"
+ *
+ *		errmsg_size	- Size of errmsg.
+ *
+ * Outputs:	errmsg		- Explanation if there is a problem.
+ *
+ * Returns:	Compiled filter or NULL for error.
+ *		Use pfilter_free when done with it.
+ *
+ * Description:	The result is:
+ *
+ *			OR (terms)				if no exclusions
+ *			AND (OR (terms), NOT (OR (-terms)))	otherwise
+ *
+ *		Terms which don't need the packet to be decoded
+ *		are put first so they can be tried quickly.
+ *
+ *--------------------------------------------------------------------*/
+
+static struct pfnode_s * new_node (enum pfkind_e kind)
+{
+	struct pfnode_s *n;
+
+	n = calloc (1, sizeof(struct pfnode_s));
+	n->kind = kind;
+	return (n);
+}
+
+static int needs_decode (struct pfnode_s *n)
+{
+	switch (n->kind) {
+	  case PF_RANGES:
+	  case PF_AREA:
+	  case PF_SYMBOL:
+	  case PF_FRIEND:
+	    return (1);
+	  case PF_TYPE:
+	    return ((n->types & T_WEATHER) != 0);
+	  case PF_AND:
+	    return (needs_decode (n->child) || needs_decode (n->child->next));
+	  default:
+	    return (0);
+	}
+}
+
+static void add_term (struct pfnode_s *list, struct pfnode_s *n)
+{
+	struct pfnode_s **pp;
+
+	if ( ! needs_decode(n)) {
+	  n->next = list->child;
+	  list->child = n;
+	}
+	else {
+	  for (pp = &(list->child); *pp != NULL; pp = &((*pp)->next)) {
+	  }
+	  *pp = n;
+	}
+}
+
+static int get_num (char *s, double *result)
+{
+	char *end;
+
+	if (*s == '\0') {
+	  return (0);
+	}
+	*result = strtod (s, &end);
+	return (*end == '\0');
+}
+
+
+pfilter_t * pfilter_compile (char *spec, char *errmsg, int errmsg_size)
+{
+	struct pfnode_s *include, *exclude, *list, *n;
+	struct rangeset_s *rs[2] = { NULL, NULL };
+	struct pfilter_s *pf;
+	char *copy, *term, *save;
+	char *vals = NULL;
+	char *args[MAX_VALUES];
+	int nargs;
+	int j;
+
+	include = new_node (PF_OR);
+	exclude = new_node (PF_OR);
+	strcpy (errmsg, "");
+
+	copy = strdup (spec);
+
+	for (term = strtok_r (copy, " \t\r\n", &save); term != NULL; term = strtok_r (NULL, " \t\r\n", &save)) {
+
+	  int ex = (term[0] == '-');
+	  char type;
+	  char *t, *slash;
+
+	  list = ex ? exclude : include;
+	  t = ex ? term + 1 : term;
+
+	  if (strlen(t) < 2 || t[1] != '/') {
+	    snprintf (errmsg, errmsg_size, "Filter term \"%s\" should be a letter, \"/\", and values.", term);
+	    goto error;
+	  }
+	  type = tolower(t[0]);
+
+/*
+ * Split into values separated by "/".
+ * A value can be empty, e.g.  "s//#"
+ * Work on a copy so error messages can show the whole term.
+ */
+	  free (vals);
+	  vals = strdup (t + 2);
+	  nargs = 0;
+	  t = vals;
+	  while (1) {
+	    if (nargs >= MAX_VALUES) {
+	      snprintf (errmsg, errmsg_size, "Filter term \"%s\" has more than %d values.", term, MAX_VALUES);
+	      goto error;
+	    }
+	    args[nargs++] = t;
+	    slash = strchr (t, '/');
+	    if (slash == NULL) break;
+	    *slash = '\0';
+	    t = slash + 1;
+	  }
+	  if (nargs == 1 && args[0][0] == '\0') {
+	    nargs = 0;
+	  }
+
+	  switch (type) {
+
+	    case 'r':
+	      {
+	        double lat, lon, km;
+
+	        if (nargs != 3 || ! get_num(args[0], &lat) || ! get_num(args[1], &lon) || ! get_num(args[2], &km)) {
+	          snprintf (errmsg, errmsg_size, "Range filter \"%s\" should be r/lat/lon/dist.", term);
+	          goto error;
+	        }
+	        if (rs[ex] == NULL) {
+	          rs[ex] = rs_new ();
+	          n = new_node (PF_RANGES);
+	          n->rs = rs[ex];
+	          add_term (list, n);
+	        }
+	        rs_add (rs[ex], lat, lon, km);
+	      }
+	      break;
+
+	    case 'a':
+	      n = new_node (PF_AREA);
+	      if (nargs != 4 || ! get_num(args[0], &(n->v[0])) || ! get_num(args[1], &(n->v[1])) ||
+				! get_num(args[2], &(n->v[2])) || ! get_num(args[3], &(n->v[3]))) {
+	        free_node (n);
+	        snprintf (errmsg, errmsg_size, "Area filter \"%s\" should be a/latN/lonW/latS/lonE.", term);
+	        goto error;
+	      }
+	      add_term (list, n);
+	      break;
+
+	    case 'p':
+	    case 'b':
+	    case 'o':
+	    case 'd':
+	      if (nargs < 1) {
+	        snprintf (errmsg, errmsg_size, "Filter \"%s\" needs at least one value.", term);
+	        goto error;
+	      }
+	      n = new_node (type == 'p' ? PF_PREFIX : type == 'b' ? PF_BUDLIST : type == 'o' ? PF_OBJECT : PF_DIGI);
+	      n->num_args = nargs;
+	      n->args = calloc (nargs, sizeof(char *));
+	      for (j = 0; j < nargs; j++) {
+	        char *c;
+	        n->args[j] = strdup (args[j]);
+	        /* Callsigns are upper case.  Object names could be anything. */
+	        if (type != 'o') {
+	          for (c = n->args[j]; *c != '\0'; c++) {
+	            if (islower(*c)) *c = toupper(*c);
+	          }
+	        }
+	      }
+	      add_term (list, n);
+	      break;
+
+	    case 't':
+	      {
+	        struct pfnode_s *tn;
+	        char *c;
+
+	        if ((nargs != 1 && nargs != 3) || strlen(args[0]) == 0) {
+	          snprintf (errmsg, errmsg_size, "Type filter \"%s\" should be t/poimqstunw or t/poimqstunw/call/km.", term);
+	          goto error;
+	        }
+	        tn = new_node (PF_TYPE);
+	        for (c = args[0]; *c != '\0'; c++) {
+	          char *p = strchr (type_letters, tolower(*c));
+	          if (p == NULL) {
+	            free_node (tn);
+	            snprintf (errmsg, errmsg_size, "Type filter \"%s\" has unknown type \"%c\".  Use some of %s.", term, *c, type_letters);
+	            goto error;
+	          }
+	          tn->types |= 1 << (p - type_letters);
+	        }
+	        if (nargs == 3) {
+	          struct pfnode_s *fn = new_node (PF_FRIEND);
+
+	          fn->num_args = 1;
+	          fn->args = calloc (1, sizeof(char *));
+	          fn->args[0] = strdup (args[1]);
+	          for (c = fn->args[0]; *c != '\0'; c++) {
+	            if (islower(*c)) *c = toupper(*c);
+	          }
+	          if ( ! get_num(args[2], &(fn->v[0]))) {
+	            free_node (tn);
+	            free_node (fn);
+	            snprintf (errmsg, errmsg_size, "Type filter \"%s\" has invalid distance.", term);
+	            goto error;
+	          }
+	          n = new_node (PF_AND);
+	          n->child = tn;
+	          tn->next = fn;
+	          add_term (list, n);
+	        }
+	        else {
+	          add_term (list, tn);
+	        }
+	      }
+	      break;
+
+	    case 's':
+	      if (nargs < 1 || nargs > 3) {
+	        snprintf (errmsg, errmsg_size, "Symbol filter \"%s\" should be s/pri/alt/over.", term);
+	        goto error;
+	      }
+	      n = new_node (PF_SYMBOL);
+	      n->num_args = 3;
+	      n->args = calloc (3, sizeof(char *));
+	      for (j = 0; j < 3; j++) {
+	        n->args[j] = strdup (j < nargs ? args[j] : "");
+	      }
+	      add_term (list, n);
+	      break;
+
+	    case 'f':
+	      {
+	        char *c;
+
+	        n = new_node (PF_FRIEND);
+	        if (nargs != 2 || ! get_num(args[1], &(n->v[0]))) {
+	          free_node (n);
+	          snprintf (errmsg, errmsg_size, "Friend filter \"%s\" should be f/call/dist.", term);
+	          goto error;
+	        }
+	        n->num_args = 1;
+	        n->args = calloc (1, sizeof(char *));
+	        n->args[0] = strdup (args[0]);
+	        for (c = n->args[0]; *c != '\0'; c++) {
+	          if (islower(*c)) *c = toupper(*c);
+	        }
+	        add_term (list, n);
+	      }
+	      break;
+
+	    default:
+	      snprintf (errmsg, errmsg_size, "Filter type \"%c\" in \"%s\" is not supported.  Use r, a, p, b, o, d, t, s, or f.", type, term);
+	      goto error;
+	  }
+	}
+
+	free (vals);
+	free (copy);
+
+	pf = calloc (1, sizeof(struct pfilter_s));
+
+	if (exclude->child == NULL) {
+	  free_node (exclude);
+	  pf->root = include;
+	}
+	else {
+	  struct pfnode_s *not = new_node (PF_NOT);
+
+	  not->child = exclude;
+	  pf->root = new_node (PF_AND);
+	  pf->root->child = include;
+	  include->next = not;
+	}
+	return (pf);
+
+error:
+	free (vals);
+	free (copy);
+	free_node (include);
+	free_node (exclude);
+	return (NULL);
+
+} /* end pfilter_compile */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        pfilter_free
+ *
+ * Purpose:     Free compiled filter.
+ *
+ *--------------------------------------------------------------------*/
+
+static void free_node (struct pfnode_s *n)
+{
+	struct pfnode_s *c, *next;
+	int j;
+
+	for (c = n->child; c != NULL; c = next) {
+	  next = c->next;
+	  free_node (c);
+	}
+	for (j = 0; j < n->num_args; j++) {
+	  free (n->args[j]);
+	}
+	free (n->args);
+	if (n->rs != NULL) {
+	  rs_free (n->rs);
+	}
+	free (n);
+}
+
+void pfilter_free (pfilter_t *pf)
+{
+	if (pf != NULL) {
+	  free_node (pf->root);
+	  free (pf);
+	}
+}
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        pfilter_match
+ *
+ * Purpose:     Apply filter to a packet.
+ *
+ * Inputs:	pf	- From pfilter_compile.
+ *
+ *		pp	- Packet object.
+ *
+ * Returns:	1 if it passes the filter, 0 if not.
+ *
+ *--------------------------------------------------------------------*/
+
+int pfilter_match (pfilter_t *pf, packet_t pp)
+{
+	struct pkt_s k;
+
+	k.pp = pp;
+	k.info_len = ax25_get_info (pp, &(k.pinfo));
+	ax25_get_addr_with_ssid (pp, AX25_SOURCE, k.src);
+	k.decoded = 0;
+
+	return (eval (pf->root, &k));
+}
+
+
+/*
+ * Decode the packet the first time it is needed.
+ */
+
+static decode_aprs_t * decoded (struct pkt_s *k)
+{
+	if ( ! k->decoded) {
+	  decode_aprs (&(k->A), k->pp, 1);
+	  k->decoded = 1;
+	}
+	return (&(k->A));
+}
+
+
+static int wild_match (char *pat, char *s)
+{
+	while (*pat != '\0') {
+	  if (*pat == '*') {
+	    pat++;
+	    if (*pat == '\0') {
+	      return (1);
+	    }
+	    for ( ; *s != '\0'; s++) {
+	      if (wild_match (pat, s)) {
+	        return (1);
+	      }
+	    }
+	    return (0);
+	  }
+	  if (*s != *pat) {
+	    return (0);
+	  }
+	  pat++;
+	  s++;
+	}
+	return (*s == '\0');
+}
+
+
+/*
+ * Types which can be determined from the data type indicator.
+ * Weather needs the packet to be decoded.
+ */
+
+static unsigned simple_types (struct pkt_s *k)
+{
+	char *p = (char *)(k->pinfo);
+
+	if (k->info_len < 1) {
+	  return (0);
+	}
+
+	switch (p[0]) {
+	  case '!':
+	  case '=':
+	  case '/':
+	  case '@':
+	  case '`':
+	  case '\'':
+	  case '$':
+	    return (T_POSITION);
+
+	  case ';':
+	    if (strncmp(k->src, "NWS", 3) == 0) return (T_OBJECT | T_NWS);
+	    return (T_OBJECT);
+
+	  case ')':
+	    return (T_ITEM);
+
+	  case ':':
+	    if (k->info_len >= 11 && p[10] == ':') {
+	      if (strncmp(p + 11, "PARM.", 5) == 0 || strncmp(p + 11, "UNIT.", 5) == 0 ||
+		  strncmp(p + 11, "EQNS.", 5) == 0 || strncmp(p + 11, "BITS.", 5) == 0) {
+	        return (T_TELEMETRY);
+	      }
+	      if (strncmp(p + 1, "NWS", 3) == 0 || strncmp(p + 1, "SKY", 3) == 0 ||
+		  strncmp(p + 1, "CWA", 3) == 0 || strncmp(p + 1, "BOM", 3) == 0) {
+	        return (T_MESSAGE | T_NWS);
+	      }
+	    }
+	    return (T_MESSAGE);
+
+	  case '?':
+	    return (T_QUERY);
+
+	  case '>':
+	    return (T_STATUS);
+
+	  case 'T':
+	    return (T_TELEMETRY);
+
+	  case '{':
+	    return (T_USER);
+
+	  default:
+	    return (0);
+	}
+}
+
+
+/*
+ * Object or item name.
+ */
+
+static int object_name (struct pkt_s *k, char *name)
+{
+	char *p = (char *)(k->pinfo);
+	int j;
+
+	if (k->info_len >= 11 && p[0] == ';') {
+	  memcpy (name, p + 1, 9);
+	  name[9] = '\0';
+	  for (j = 8; j >= 0 && name[j] == ' '; j--) {
+	    name[j] = '\0';
+	  }
+	  return (1);
+	}
+	if (k->info_len >= 5 && p[0] == ')') {
+	  for (j = 0; j < 9 && j + 1 < k->info_len && p[j+1] != '!' && p[j+1] != '_'; j++) {
+	    name[j] = p[j+1];
+	  }
+	  name[j] = '\0';
+	  return (j >= 3);
+	}
+	return (0);
+}
+
+
+/*
+ * Position, if there is one.
+ */
+
+static int position (struct pkt_s *k, double *lat, double *lon)
+{
+	decode_aprs_t *A = decoded (k);
+
+	if (A->g_lat == G_UNKNOWN || A->g_lon == G_UNKNOWN) {
+	  return (0);
+	}
+	*lat = A->g_lat;
+	*lon = A->g_lon;
+	return (1);
+}
+
+
+static int eval (struct pfnode_s *n, struct pkt_s *k)
+{
+	struct pfnode_s *c;
+	double lat, lon;
+	char name[AX25_MAX_ADDR_LEN];
+	int j;
+
+	switch (n->kind) {
+
+	  case PF_OR:
+	    for (c = n->child; c != NULL; c = c->next) {
+	      if (eval (c, k)) return (1);
+	    }
+	    return (0);
+
+	  case PF_AND:
+	    for (c = n->child; c != NULL; c = c->next) {
+	      if ( ! eval (c, k)) return (0);
+	    }
+	    return (1);
+
+	  case PF_NOT:
+	    return ( ! eval (n->child, k));
+
+	  case PF_RANGES:
+	    return (position (k, &lat, &lon) && rs_match (n->rs, lat, lon));
+
+	  case PF_AREA:
+	    if ( ! position (k, &lat, &lon)) return (0);
+	    if (lat > n->v[0] || lat < n->v[2]) return (0);
+	    if (n->v[1] <= n->v[3]) {
+	      return (lon >= n->v[1] && lon <= n->v[3]);
+	    }
+	    return (lon >= n->v[1] || lon <= n->v[3]);	/* Crosses 180. */
+
+	  case PF_PREFIX:
+	    for (j = 0; j < n->num_args; j++) {
+	      if (strncmp (k->src, n->args[j], strlen(n->args[j])) == 0) return (1);
+	    }
+	    return (0);
+
+	  case PF_BUDLIST:
+	    for (j = 0; j < n->num_args; j++) {
+	      if (wild_match (n->args[j], k->src)) return (1);
+	    }
+	    return (0);
+
+	  case PF_OBJECT:
+	    if ( ! object_name (k, name)) return (0);
+	    for (j = 0; j < n->num_args; j++) {
+	      if (wild_match (n->args[j], name)) return (1);
+	    }
+	    return (0);
+
+	  case PF_DIGI:
+	    {
+	      int nrep = ax25_get_num_repeaters (k->pp);
+	      int last_used = -1;
+	      int r;
+
+	      /* Anything before the last one marked as used was also used. */
+
+	      for (r = 0; r < nrep; r++) {
+	        if (ax25_get_h (k->pp, AX25_REPEATER_1 + r)) last_used = r;
+	      }
+	      for (r = 0; r <= last_used; r++) {
+	        ax25_get_addr_with_ssid (k->pp, AX25_REPEATER_1 + r, name);
+	        for (j = 0; j < n->num_args; j++) {
+	          if (wild_match (n->args[j], name)) return (1);
+	        }
+	      }
+	    }
+	    return (0);
+
+	  case PF_TYPE:
+	    if (simple_types(k) & n->types) return (1);
+	    if (n->types & T_WEATHER) {
+	      decode_aprs_t *A = decoded (k);
+	      if (strstr (A->g_msg_type, "Weather") != NULL || strcmp (A->g_msg_type, "Ultimeter") == 0) return (1);
+	    }
+	    return (0);
+
+	  case PF_SYMBOL:
+	    {
+	      decode_aprs_t *A = decoded (k);
+
+	      if (A->g_symbol_table == '/') {
+	        return (strchr (n->args[0], A->g_symbol_code) != NULL && A->g_symbol_code != '\0');
+	      }
+	      if (A->g_symbol_code == '\0' || strchr (n->args[1], A->g_symbol_code) == NULL) {
+	        return (0);
+	      }
+	      return (n->args[2][0] == '\0' || strchr (n->args[2], A->g_symbol_table) != NULL);
+	    }
+
+	  case PF_FRIEND:
+	    {
+	      mheard_info_t info;
+
+	      if ( ! mheard_get (n->args[0], &info) || info.dlat == G_UNKNOWN) return (0);
+	      if ( ! position (k, &lat, &lon)) return (0);
+	      return (ll_distance_km (info.dlat, info.dlon, lat, lon) <= n->v[0]);
+	    }
+	}
+
+	return (0);
+
+} /* end eval */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Unit test.
+ *
+ *--------------------------------------------------------------------*/
+
+#if PFTEST
+
+static int errors = 0;
+
+static void try (char *filter, char *packet, int expected)
+{
+	pfilter_t *pf;
+	packet_t pp;
+	char errmsg[200];
+	int result;
+
+	pf = pfilter_compile (filter, errmsg, sizeof(errmsg));
+	if (pf == NULL) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Filter \"%s\" failed to compile: %s\n", filter, errmsg);
+	  errors++;
+	  return;
+	}
+
+	pp = ax25_from_text (packet, 0);
+	assert (pp != NULL);
+
+	result = pfilter_match (pf, pp);
+	if (result != expected) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Filter \"%s\" packet \"%s\" result %d, expected %d\n", filter, packet, result, expected);
+	  errors++;
+	}
+
+	ax25_delete (pp);
+	pfilter_free (pf);
+}
+
+static void bad (char *filter)
+{
+	char errmsg[200];
+	pfilter_t *pf;
+
+	pf = pfilter_compile (filter, errmsg, sizeof(errmsg));
+	if (pf != NULL || strlen(errmsg) == 0) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Filter \"%s\" should have been rejected.\n", filter);
+	  errors++;
+	  pfilter_free (pf);
+	}
+	else if (strstr(errmsg, filter) == NULL) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Filter \"%s\" error message should show it: %s\n", filter, errmsg);
+	  errors++;
+	}
+}
+
+
+int main (int argc, char *argv[])
+{
+	char big[10000];
+	int j;
+
+	try ("b/W1ABC", "W1ABC>APRS:>status", 1);
+	try ("b/w1abc", "W1ABC>APRS:>status", 1);
+	try ("b/W1ABC", "W1ABC-9>APRS:>status", 0);
+	try ("b/W1ABC*", "W1ABC-9>APRS:>status", 1);
+	try ("b/N0CALL/W1*", "W1XYZ>APRS:>status", 1);
+	try ("p/K/N", "W1ABC>APRS:>status", 0);
+	try ("p/K/W", "W1ABC>APRS:>status", 1);
+
+	try ("t/m", "W1ABC>APRS::N0CALL   :hello{1", 1);
+	try ("t/p", "W1ABC>APRS::N0CALL   :hello{1", 0);
+	try ("t/p", "W1ABC>APRS:!4237.14N/07120.83W-", 1);
+	try ("t/t", "W1ABC>APRS::W1ABC    :PARM.A,B", 1);
+	try ("t/q", "W1ABC>APRS:?APRS?", 1);
+	try ("t/o", "W1ABC>APRS:;LEADER   *092345z4903.50N/07201.75W>", 1);
+	try ("t/i", "W1ABC>APRS:)AID #2!4903.50N/07201.75WA", 1);
+	try ("t/w", "W1ABC>APRS:_10090556c220s004g005t077r000p000P000h50b09900wRSW", 1);
+	try ("t/w", "W1ABC>APRS:!4237.14N/07120.83W-", 0);
+	try ("t/n", "W1ABC>APRS::NWS-WARN :test", 1);
+
+	try ("o/LEADER", "W1ABC>APRS:;LEADER   *092345z4903.50N/07201.75W>", 1);
+	try ("o/LEAD*", "W1ABC>APRS:;LEADER   *092345z4903.50N/07201.75W>", 1);
+	try ("o/AID*", "W1ABC>APRS:)AID #2!4903.50N/07201.75WA", 1);
+	try ("o/LEADER", "W1ABC>APRS:)AID #2!4903.50N/07201.75WA", 0);
+
+	try ("d/WIDE1-1", "W1ABC>APRS,WIDE1-1*,WIDE2-1:>status", 1);
+	try ("d/WIDE2*", "W1ABC>APRS,WIDE1-1*,WIDE2-1:>status", 0);
+	try ("d/W2XYZ", "W1ABC>APRS,W2XYZ,WIDE1*,WIDE2-1:>status", 1);
+
+	try ("r/42.6/-71.3/50", "W1ABC>APRS:!4237.14N/07120.83W-", 1);
+	try ("r/42.6/-71.3/50", "W1ABC>APRS:!4037.14N/07120.83W-", 0);
+	try ("r/40/-100/10 r/42.6/-71.3/50", "W1ABC>APRS:!4237.14N/07120.83W-", 1);
+	try ("r/42.6/-71.3/50", "W1ABC>APRS:>no position", 0);
+	try ("r/0/0/20000", "W1ABC>APRS:!4237.14N/07120.83W-", 1);
+	try ("r/-33.9/179.9/100", "W1ABC>APRS:!3354.00S/17954.00E-", 1);
+	try ("r/-33.9/179.9/100", "W1ABC>APRS:!3354.00S/17954.00W-", 1);
+
+	try ("a/43/-72/42/-71", "W1ABC>APRS:!4237.14N/07120.83W-", 1);
+	try ("a/43/-71/42/-70", "W1ABC>APRS:!4237.14N/07120.83W-", 0);
+	try ("a/-33/179/-34/-179", "W1ABC>APRS:!3354.00S/17954.00W-", 1);
+
+	try ("s/-", "W1ABC>APRS:!4237.14N/07120.83W-", 1);
+	try ("s/>", "W1ABC>APRS:!4237.14N/07120.83W-", 0);
+	try ("s//#", "W1ABC>APRS:!4237.14N\\07120.83W#", 1);
+	try ("s//#/T", "W1ABC>APRS:!4237.14N\\07120.83W#", 0);
+	try ("s//#/T", "W1ABC>APRS:!4237.14NT07120.83W#", 1);
+
+	try ("t/m -b/N0CALL", "N0CALL>APRS::W1ABC    :hello", 0);
+	try ("t/m -b/N0CALL", "W2XYZ>APRS::W1ABC    :hello", 1);
+	try ("-b/N0CALL", "W2XYZ>APRS::W1ABC    :hello", 0);
+	try ("t/m -r/42.6/-71.3/50", "W1ABC>APRS:!4237.14N/07120.83W-", 0);
+
+/* Many ranges.  Only the last one matches. */
+
+	strcpy (big, "");
+	for (j = 0; j < 200; j++) {
+	  sprintf (big + strlen(big), "r/%d/%d/30 ", j % 60 - 30, j - 100);
+	}
+	strcat (big, "r/42.6/-71.3/50");
+	try (big, "W1ABC>APRS:!4237.14N/07120.83W-", 1);
+	try (big, "W1ABC>APRS:!4037.14N/07120.83W-", 0);
+
+	bad ("x/1");
+	bad ("r/1/2");
+	bad ("r/a/b/c");
+	bad ("t/z");
+	bad ("b");
+	bad ("a/1/2/3");
+	bad ("f/W1ABC");
+	bad ("b/A/B/C/D/E/F/G/H/I/J/K");
+
+	try ("b/A/B/C/D/E/F/G/H/I/W1ABC", "W1ABC>APRS:>status", 1);
+
+	if (errors != 0) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("\nFAILED! %d errors.\n", errors);
+	  exit (EXIT_FAILURE);
+	}
+
+	text_color_set(DW_COLOR_INFO);
+	dw_printf ("\nSUCCESS -- All filter tests passed.\n");
+	exit (EXIT_SUCCESS);
+}
+
+#endif
+
+/* end pfilter.c */
@@ -0,0 +1,40 @@
+
+/*------------------------------------------------------------------
+ *
+ * Module:      pfilter.h
+ *
+ * Purpose:   	Packet filtering with the APRS-IS filter syntax.
+ *
+ *---------------------------------------------------------------*/
+
+#ifndef PFILTER_H
+#define PFILTER_H 1
+
+#include "ax25_pad.h"
+
+
+typedef struct pfilter_s pfilter_t;
+
+
+/*
+ * Compile filter specification, e.g.  "r/42.6/-71.3/50 t/m -b/N0CALL*"
+ * Returns NULL for an error and a description in errmsg.
+ */
+
+pfilter_t * pfilter_compile (char *spec, char *errmsg, int errmsg_size);
+
+
+/*
+ * Returns 1 if packet passes the filter, 0 if not.
+ * Safe to use from multiple threads at the same time.
+ */
+
+int pfilter_match (pfilter_t *pf, packet_t pp);
+
+
+void pfilter_free (pfilter_t *pf);
+
+
+#endif
+
+/* end pfilter.h */
@@ -0,0 +1,722 @@
+//
+//    This file is part of Dire Wolf, an amateur radio packet TNC.
+//
+//    Copyright (C) 2014  John Langner, WB2OSZ
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+/*------------------------------------------------------------------
+ *
+ * Module:      pktlog.c
+ *
+ * Purpose:   	Binary log of received frames, with index, for
+ *		keeping days of traffic and replaying it later.
+ *
+ * Description:	The only record of what was heard used to be the
+ *		text printed on the screen.  Here we save the raw
+ *		AX.25 frame, with a small fixed header for the time,
+ *		channel, demodulator, audio level, and bit fixing, so
+ *		nothing needs to be parsed or formatted while receiving.
+ *
+ *		The log is split into segments of a fixed size.  The
+ *		data and index files for the current segment are memory
+ *		mapped so adding a frame is just a couple of memcpy.
+ *		The operating system takes care of writing to disk,
+ *		even if we crash.
+ *
+ *		When a segment fills up, the files are trimmed to the
+ *		actual size, a copy of the index sorted by source
+ *		callsign is written, and a new segment is started.
+ *		Any segment left unfinished, by the application being
+ *		stopped, is finished the next time we start up.
+ *
+ *		The oldest segments are removed when the total size
+ *		of the log would be more than the configured limit.
+ *
+ *		See pktreplay.c for reading it back.
+ *
+ * Configuration:  PKTLOG directory [ segment-size-MB [ max-total-MB ] ]
+ *
+ *---------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <dirent.h>
+
+#if __WIN32__
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#include "direwolf.h"
+#include "ax25_pad.h"
+#include "textcolor.h"
+#include "pktlog.h"
+
+
+static int enabled = 0;
+
+static char g_dir[256];			/* Directory for log files. */
+
+static unsigned int g_size;		/* Size of .pkt file for each segment. */
+
+static long long g_max_total;		/* Remove oldest segments when the directory */
+					/* would have more than this.  0 = no limit. */
+
+static char g_base[300];		/* Current segment path without extension. */
+
+static struct pktlog_map_s data_map;
+static struct pktlog_map_s idx_map;
+
+static struct pktlog_hdr_s *hdr;	/* Start of current .pkt file. */
+static struct pktlog_idx_s *g_index;	/* Start of current .idx file. */
+static unsigned int max_index;		/* Number of entries allocated. */
+
+
+static int open_segment (void);
+static void finish_segment (char *base);
+static void remove_old_segments (void);
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        pktlog_map
+ *
+ * Purpose:     Map a file into memory.
+ *
+ * Inputs:	path	- File name.
+ *		size	- Size wanted.  File is created or extended if
+ *			  writable.  0 means use the current size.
+ *		writable - True for read/write, false for read only.
+ *
+ * Outputs:	m	- Address, size, and handles for pktlog_unmap.
+ *
+ * Returns:	0 for success, -1 for failure.
+ *
+ * Description:	When extending, the disk space is really allocated
+ *		here.  A sparse file would be fine until the disk
+ *		filled up, then storing into the mapped memory
+ *		would kill the process with SIGBUS.
+ *
+ *--------------------------------------------------------------------*/
+
+#if ! __WIN32__
+
+/*
+ * Make sure disk blocks are allocated for the whole file.
+ * Some file systems can't do posix_fallocate so write zeros there.
+ */
+
+static int reserve_space (int fd, unsigned int size)
+{
+	struct stat st;
+	static const char zeros[65536];
+	off_t pos;
+
+	if (posix_fallocate (fd, 0, (off_t)size) == 0) {
+	  return (0);
+	}
+
+	if (fstat (fd, &st) != 0) {
+	  return (-1);
+	}
+
+	for (pos = st.st_size; pos < (off_t)size; ) {
+	  size_t n = sizeof(zeros);
+	  ssize_t w;
+
+	  if ((off_t)n > (off_t)size - pos) {
+	    n = (size_t)((off_t)size - pos);
+	  }
+	  w = pwrite (fd, zeros, n, pos);
+	  if (w <= 0) {
+	    return (-1);
+	  }
+	  pos += w;
+	}
+	return (0);
+}
+
+#endif
+
+
+int pktlog_map (char *path, unsigned int size, int writable, struct pktlog_map_s *m)
+{
+	memset (m, 0, sizeof(struct pktlog_map_s));
+
+#if __WIN32__
+
+	m->hfile = CreateFile (path, writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+			FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+			writable ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (m->hfile == INVALID_HANDLE_VALUE) {
+	  return (-1);
+	}
+
+	if (size == 0) {
+	  size = GetFileSize (m->hfile, NULL);
+	  if (size == 0 || size == INVALID_FILE_SIZE) {
+	    CloseHandle (m->hfile);
+	    return (-1);
+	  }
+	}
+
+	m->hmap = CreateFileMapping (m->hfile, NULL, writable ? PAGE_READWRITE : PAGE_READONLY, 0, size, NULL);
+	if (m->hmap == NULL) {
+	  CloseHandle (m->hfile);
+	  return (-1);
+	}
+
+	m->addr = MapViewOfFile (m->hmap, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+	if (m->addr == NULL) {
+	  CloseHandle (m->hmap);
+	  CloseHandle (m->hfile);
+	  return (-1);
+	}
+
+#else
+	struct stat st;
+	void *a;
+
+	m->fd = open (path, writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+	if (m->fd < 0) {
+	  return (-1);
+	}
+
+	if (size == 0) {
+	  if (fstat (m->fd, &st) != 0 || st.st_size == 0) {
+	    close (m->fd);
+	    return (-1);
+	  }
+	  size = (unsigned int)(st.st_size);
+	}
+	else if (writable) {
+	  if (reserve_space (m->fd, size) != 0) {
+	    close (m->fd);
+	    return (-1);
+	  }
+	}
+
+	a = mmap (NULL, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, m->fd, 0);
+	if (a == MAP_FAILED) {
+	  close (m->fd);
+	  return (-1);
+	}
+	m->addr = a;
+#endif
+
+	m->size = size;
+	return (0);
+
+} /* end pktlog_map */
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        pktlog_unmap
+ *
+ * Purpose:     Undo pktlog_map.
+ *
+ * Inputs:	m		- From pktlog_map.
+ *		truncate	- True to change file size afterward.
+ *		new_size	- New file size.
+ *
+ *--------------------------------------------------------------------*/
+
+void pktlog_unmap (struct pktlog_map_s *m, int truncate, unsigned int new_size)
+{
+	if (m->addr == NULL) {
+	  return;
+	}
+
+#if __WIN32__
+	UnmapViewOfFile (m->addr);
+	CloseHandle (m->hmap);
+	if (truncate) {
+	  SetFilePointer (m->hfile, new_size, NULL, FILE_BEGIN);
+	  SetEndOfFile (m->hfile);
+	}
+	CloseHandle (m->hfile);
+#else
+	munmap (m->addr, m->size);
+	if (truncate) {
+	  if (ftruncate (m->fd, new_size) != 0) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf ("Packet log: Could not trim file.\n");
+	  }
+	}
+	close (m->fd);
+#endif
+	m->addr = NULL;
+}
+
+
+/*
+ * Current time in microseconds since 1970.
+ */
+
+static long long now_us (void)
+{
+#if __WIN32__
+	/* 64 bit integer is number of 100 nanosecond intervals from Jan 1, 1601. */
+	FILETIME ft;
+	long long t;
+
+	GetSystemTimeAsFileTime (&ft);
+	t = ((long long)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+	return (t / 10 - 11644473600000000LL);
+#else
+	struct timespec ts;
+
+	clock_gettime (CLOCK_REALTIME, &ts);
+	return ((long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+#endif
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        pktlog_init
+ *
+ * Purpose:     Start logging received frames.
+ *
+ * Inputs:	dir		- Directory for log files.  Created if necessary.
+ *				  Empty string means logging is disabled.
+ *		segment_mb	- Size of each segment, in megabytes.
+ *		max_total_mb	- Limit for all segments together, in
+ *				  megabytes.  0 means no limit.
+ *
+ * Description:	Finish any segments left over from last time
+ *		then start a new one.
+ *
+ *--------------------------------------------------------------------*/
+
+void pktlog_init (char *dir, int segment_mb, int max_total_mb)
+{
+	DIR *dp;
+	struct dirent *ep;
+
+	enabled = 0;
+
+	if (strlen(dir) == 0) {
+	  return;
+	}
+
+	strncpy (g_dir, dir, sizeof(g_dir)-1);
+	g_dir[sizeof(g_dir)-1] = '\0';
+
+	if (segment_mb < 1 || segment_mb > PKTLOG_MAX_SEGMENT_MB) {
+	  segment_mb = PKTLOG_DEFAULT_SEGMENT_MB;
+	}
+	g_size = (unsigned int)segment_mb * 1024 * 1024;
+
+	g_max_total = (long long)max_total_mb * 1024 * 1024;
+	if (g_max_total > 0 && g_max_total < 2LL * g_size) {
+	  g_max_total = 2LL * g_size;	/* Keep at least the previous segment. */
+	}
+
+/*
+ * Enough index entries for an average frame of 48 bytes.
+ * If we run out, the segment is finished early.
+ */
+	max_index = g_size / 64;
+
+#if __WIN32__
+	mkdir (g_dir);
+#else
+	mkdir (g_dir, 0755);
+#endif
+
+	dp = opendir (g_dir);
+	if (dp == NULL) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Packet log: Can't open directory %s.\n", g_dir);
+	  return;
+	}
+
+	while ((ep = readdir(dp)) != NULL) {
+	  int n = strlen(ep->d_name);
+	  char base[300];
+
+	  if (n > 4 && strcmp(ep->d_name + n - 4, ".pkt") == 0) {
+	    snprintf (base, sizeof(base), "%s/%.*s", g_dir, n - 4, ep->d_name);
+	    finish_segment (base);
+	  }
+	}
+	closedir (dp);
+
+	remove_old_segments ();
+
+	if (open_segment() != 0) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Packet log disabled.\n");
+	  return;
+	}
+
+	enabled = 1;
+
+	text_color_set(DW_COLOR_INFO);
+	dw_printf ("Logging received frames to %s\n", g_dir);
+
+} /* end pktlog_init */
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        open_segment
+ *
+ * Purpose:     Create files for a new segment and map them.
+ *
+ * Returns:	0 for success.
+ *
+ * Description:	The name comes from the current UTC time.
+ *		If that is already taken, because we restarted
+ *		quickly, add a suffix.  Readers go by the
+ *		time in the header, not the name, for ordering.
+ *
+ *--------------------------------------------------------------------*/
+
+static int open_segment (void)
+{
+	long long t;
+	time_t sec;
+	struct tm tm;
+	char name[20];
+	char path[320];
+	struct stat st;
+	int n;
+
+	t = now_us();
+	sec = (time_t)(t / 1000000);
+#if __WIN32__
+	tm = *gmtime (&sec);
+#else
+	gmtime_r (&sec, &tm);
+#endif
+	strftime (name, sizeof(name), "%Y%m%d-%H%M%S", &tm);
+
+	snprintf (g_base, sizeof(g_base), "%s/%s", g_dir, name);
+	for (n = 1; ; n++) {
+	  snprintf (path, sizeof(path), "%s.pkt", g_base);
+	  if (stat (path, &st) != 0) break;
+	  snprintf (g_base, sizeof(g_base), "%s/%s-%d", g_dir, name, n);
+	}
+
+	if (pktlog_map (path, g_size, 1, &data_map) != 0) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Packet log: Can't create %s.  Is the disk full?\n", path);
+	  remove (path);
+	  return (-1);
+	}
+
+	snprintf (path, sizeof(path), "%s.idx", g_base);
+	if (pktlog_map (path, max_index * sizeof(struct pktlog_idx_s), 1, &idx_map) != 0) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Packet log: Can't create %s.  Is the disk full?\n", path);
+	  remove (path);
+	  pktlog_unmap (&data_map, 1, 0);
+	  snprintf (path, sizeof(path), "%s.pkt", g_base);
+	  remove (path);
+	  return (-1);
+	}
+
+	hdr = (struct pktlog_hdr_s *)(data_map.addr);
+	g_index = (struct pktlog_idx_s *)(idx_map.addr);
+
+	memset (hdr, 0, sizeof(struct pktlog_hdr_s));
+	memcpy (hdr->magic, PKTLOG_MAGIC, sizeof(hdr->magic));
+	hdr->start_us = t;
+	hdr->size = g_size;
+	hdr->used = sizeof(struct pktlog_hdr_s);
+	hdr->count = 0;
+	hdr->closed = 0;
+
+	return (0);
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        finish_segment
+ *
+ * Purpose:     Trim files for a segment to actual size and
+ *		create the index sorted by source.
+ *
+ * Inputs:	base	- Path without extension.
+ *
+ * Description:	Nothing happens if the segment has already been
+ *		finished.  The segment must not be mapped elsewhere
+ *		in this process.
+ *
+ *--------------------------------------------------------------------*/
+
+static int compare_source (const void *a, const void *b)
+{
+	const struct pktlog_idx_s *ea = a;
+	const struct pktlog_idx_s *eb = b;
+	int c;
+
+	c = strncmp (ea->source, eb->source, sizeof(ea->source));
+	if (c != 0) return (c);
+	if (ea->time_us < eb->time_us) return (-1);
+	if (ea->time_us > eb->time_us) return (1);
+	return (0);
+}
+
+static void finish_segment (char *base)
+{
+	char path[320];
+	struct pktlog_map_s dm, im;
+	struct pktlog_hdr_s *h;
+	struct pktlog_idx_s *sorted;
+	unsigned int count;
+	FILE *fp;
+
+	snprintf (path, sizeof(path), "%s.pkt", base);
+	if (pktlog_map (path, 0, 1, &dm) != 0) {
+	  return;
+	}
+
+	h = (struct pktlog_hdr_s *)(dm.addr);
+	if (dm.size < sizeof(struct pktlog_hdr_s) ||
+	    memcmp (h->magic, PKTLOG_MAGIC, sizeof(h->magic)) != 0 ||
+	    h->closed) {
+	  pktlog_unmap (&dm, 0, 0);
+	  return;
+	}
+
+	count = h->count;
+
+	snprintf (path, sizeof(path), "%s.idx", base);
+	if (pktlog_map (path, 0, 1, &im) == 0) {
+
+	  if (count > im.size / sizeof(struct pktlog_idx_s)) {
+	    count = im.size / sizeof(struct pktlog_idx_s);
+	  }
+
+	  sorted = malloc (count * sizeof(struct pktlog_idx_s) + 1);
+	  if (sorted != NULL) {
+	    memcpy (sorted, im.addr, count * sizeof(struct pktlog_idx_s));
+	    qsort (sorted, count, sizeof(struct pktlog_idx_s), compare_source);
+
+	    snprintf (path, sizeof(path), "%s.src", base);
+	    fp = fopen (path, "wb");
+	    if (fp != NULL) {
+	      fwrite (sorted, sizeof(struct pktlog_idx_s), count, fp);
+	      fclose (fp);
+	    }
+	    free (sorted);
+	  }
+	  pktlog_unmap (&im, 1, count * sizeof(struct pktlog_idx_s));
+	}
+
+	h->count = count;
+	h->closed = 1;
+	pktlog_unmap (&dm, 1, h->used);
+
+} /* end finish_segment */
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        remove_old_segments
+ *
+ * Purpose:     Delete the oldest segments until the total size
+ *		of the log, including a new segment about to be
+ *		created, is within the limit.
+ *
+ * Description:	Names come from the UTC time so sorting them
+ *		puts the oldest first.  The .pkt, .idx, and .src
+ *		files of a segment are removed together.
+ *
+ *--------------------------------------------------------------------*/
+
+struct seg_s {
+	char name[256];			/* Without extension. */
+	long long bytes;		/* All files for the segment. */
+};
+
+static int compare_seg (const void *a, const void *b)
+{
+	return (strcmp (((const struct seg_s *)a)->name, ((const struct seg_s *)b)->name));
+}
+
+static void remove_old_segments (void)
+{
+	static const char *ext[3] = { ".pkt", ".idx", ".src" };
+	DIR *dp;
+	struct dirent *ep;
+	struct seg_s *seg = NULL;
+	int nseg = 0, alloc = 0;
+	long long total;
+	char path[560];
+	struct stat st;
+	int i, e;
+
+	if (g_max_total <= 0) {
+	  return;
+	}
+
+	dp = opendir (g_dir);
+	if (dp == NULL) {
+	  return;
+	}
+
+	while ((ep = readdir(dp)) != NULL) {
+	  int n = strlen(ep->d_name);
+
+	  if (n > 4 && n - 4 < (int)sizeof(seg[0].name) && strcmp(ep->d_name + n - 4, ".pkt") == 0) {
+	    if (nseg >= alloc) {
+	      struct seg_s *p;
+
+	      alloc = alloc ? alloc * 2 : 32;
+	      p = realloc (seg, alloc * sizeof(struct seg_s));
+	      if (p == NULL) break;
+	      seg = p;
+	    }
+	    memset (&seg[nseg], 0, sizeof(struct seg_s));
+	    memcpy (seg[nseg].name, ep->d_name, n - 4);
+	    nseg++;
+	  }
+	}
+	closedir (dp);
+
+/* Space for the segment about to be created. */
+
+	total = (long long)g_size + (long long)max_index * sizeof(struct pktlog_idx_s);
+
+	for (i = 0; i < nseg; i++) {
+	  for (e = 0; e < 3; e++) {
+	    snprintf (path, sizeof(path), "%s/%s%s", g_dir, seg[i].name, ext[e]);
+	    if (stat (path, &st) == 0) {
+	      seg[i].bytes += st.st_size;
+	    }
+	  }
+	  total += seg[i].bytes;
+	}
+
+	if (nseg > 1) {
+	  qsort (seg, nseg, sizeof(struct seg_s), compare_seg);
+	}
+
+	for (i = 0; i < nseg && total > g_max_total; i++) {
+	  for (e = 0; e < 3; e++) {
+	    snprintf (path, sizeof(path), "%s/%s%s", g_dir, seg[i].name, ext[e]);
+	    remove (path);
+	  }
+	  total -= seg[i].bytes;
+	}
+
+	if (i > 0) {
+	  text_color_set(DW_COLOR_INFO);
+	  dw_printf ("Packet log: Removed %d old segment%s.\n", i, i == 1 ? "" : "s");
+	}
+
+	if (seg != NULL) {
+	  free (seg);
+	}
+
+} /* end remove_old_segments */
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        pktlog_write
+ *
+ * Purpose:     Add a received frame to the log.
+ *
+ * Inputs:	chan, subchan, alevel, retries - Same as for app_process_rec_packet.
+ *		pp	- Packet object.  Caller still owns it.
+ *
+ * Description:	This is called only from the receive dispatcher
+ *		thread so no locking is needed.  The count is updated
+ *		last so anyone reading the live segment never sees
+ *		an incomplete record.
+ *
+ *--------------------------------------------------------------------*/
+
+void pktlog_write (int chan, int subchan, int alevel, int retries, packet_t pp)
+{
+	unsigned char frame[AX25_MAX_PACKET_LEN];
+	int flen;
+	unsigned int need;
+	struct pktlog_rec_s *rec;
+	struct pktlog_idx_s *ent;
+	long long t;
+
+	if ( ! enabled) {
+	  return;
+	}
+
+	flen = ax25_pack (pp, frame);
+	if (flen <= 0) {
+	  return;
+	}
+
+	need = (sizeof(struct pktlog_rec_s) + flen + 7) & ~7;
+
+	if (hdr->used + need > g_size || hdr->count >= max_index) {
+	  pktlog_unmap (&idx_map, 0, 0);
+	  pktlog_unmap (&data_map, 0, 0);
+	  finish_segment (g_base);
+	  remove_old_segments ();
+	  if (open_segment() != 0) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf ("Packet log disabled.\n");
+	    enabled = 0;
+	    return;
+	  }
+	}
+
+	t = now_us();
+
+	rec = (struct pktlog_rec_s *)(data_map.addr + hdr->used);
+	memset (rec, 0, need);
+	rec->time_us = t;
+	rec->len = flen;
+	rec->alevel = alevel;
+	rec->chan = chan;
+	rec->subchan = subchan;
+	rec->retries = retries;
+	memcpy ((unsigned char *)(rec + 1), frame, flen);
+
+	ent = &g_index[hdr->count];
+	memset (ent, 0, sizeof(struct pktlog_idx_s));
+	ent->time_us = t;
+	ent->offset = hdr->used;
+	if (ax25_get_num_addr(pp) >= 2) {
+	  char src[AX25_MAX_ADDR_LEN];
+
+	  ax25_get_addr_with_ssid (pp, AX25_SOURCE, src);
+	  strncpy (ent->source, src, sizeof(ent->source)-1);
+	}
+
+	hdr->used += need;
+	__atomic_store_n (&hdr->count, hdr->count + 1, __ATOMIC_RELEASE);
+
+} /* end pktlog_write */
+
+/* end pktlog.c */
@@ -0,0 +1,123 @@
+
+/*------------------------------------------------------------------
+ *
+ * Module:      pktlog.h
+ *
+ * Purpose:   	Binary log of received frames, with index, for
+ *		keeping days of traffic and replaying it later.
+ *
+ *---------------------------------------------------------------*/
+
+#ifndef PKTLOG_H
+#define PKTLOG_H 1
+
+#if __WIN32__
+#include <windows.h>
+#endif
+
+#include "ax25_pad.h"		/* for packet_t */
+
+
+/*
+ * Each segment of the log is a set of files with the same
+ * name, from the time it was created, e.g. 20141019-153000
+ *
+ *	.pkt	- Header followed by records of received frames.
+ *	.idx	- Fixed size entry for each record, in time order.
+ *	.src	- Same entries sorted by source callsign then time.
+ *		  Created when the segment is finished.
+ *
+ * Everything is in the native byte order of the
+ * computer that wrote it.
+ */
+
+#define PKTLOG_MAGIC "DWPKTLG1"
+
+#define PKTLOG_DEFAULT_SEGMENT_MB 64
+#define PKTLOG_MAX_SEGMENT_MB 1024
+#define PKTLOG_DEFAULT_MAX_TOTAL_MB 1024
+
+struct pktlog_hdr_s {			/* At start of .pkt file. */
+
+	char magic[8];			/* PKTLOG_MAGIC */
+
+	long long start_us;		/* When segment was created, */
+					/* microseconds since 1970. */
+
+	unsigned int size;		/* Space allocated for .pkt file. */
+
+	unsigned int used;		/* Bytes used, including this header. */
+
+	unsigned int count;		/* Number of records.  Updated last, after */
+					/* the record and index entry are complete, */
+					/* so a reader can follow a live segment. */
+
+	int closed;			/* Segment finished and .src file created. */
+
+	char reserved[32];
+};
+
+struct pktlog_rec_s {			/* Before each frame in .pkt file. */
+
+	long long time_us;		/* When received, microseconds since 1970. */
+
+	unsigned short len;		/* Number of frame bytes following, */
+					/* not including FCS. */
+
+	short alevel;			/* Audio level. */
+
+	signed char chan;		/* Radio channel. */
+
+	signed char subchan;		/* Which demodulator.  -1 for APRStt. */
+
+	unsigned char retries;		/* Level of bit fixing.  See retry_t. */
+
+	unsigned char reserved;
+
+	/* Frame follows, then padding to multiple of 8 bytes. */
+};
+
+struct pktlog_idx_s {			/* Entry in .idx and .src files. */
+
+	long long time_us;		/* Same as record. */
+
+	unsigned int offset;		/* Position of record in .pkt file. */
+
+	unsigned int reserved;
+
+	char source[16];		/* Source address with SSID.  Empty if none. */
+};
+
+
+/*
+ * Memory mapped file.
+ */
+
+struct pktlog_map_s {
+	unsigned char *addr;
+	unsigned int size;
+#if __WIN32__
+	HANDLE hfile;
+	HANDLE hmap;
+#else
+	int fd;
+#endif
+};
+
+int pktlog_map (char *path, unsigned int size, int writable, struct pktlog_map_s *m);
+
+void pktlog_unmap (struct pktlog_map_s *m, int truncate, unsigned int new_size);
+
+
+/*
+ * Writing, by the application.
+ */
+
+void pktlog_init (char *dir, int segment_mb, int max_total_mb);
+
+void pktlog_write (int chan, int subchan, int alevel, int retries, packet_t pp);
+
+
+#endif
+
+/* end pktlog.h */
@@ -0,0 +1,441 @@
+//
+//    This file is part of Dire Wolf, an amateur radio packet TNC.
+//
+//    Copyright (C) 2014  John Langner, WB2OSZ
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+/*------------------------------------------------------------------
+ *
+ * Module:      pktreplay.c
+ *
+ * Purpose:   	Read back frames saved by the PKTLOG feature.
+ *
+ * Usage:	pktreplay [options] directory
+ *
+ *		-s time		Start time, local, e.g. "2014-10-19 15:30".
+ *				Trailing parts can be left off.
+ *		-e time		End time, same format.
+ *		-c call		Only frames from this source.
+ *				Without SSID, all SSIDs match.
+ *		-t		Text only, TNC-2 monitor format, suitable
+ *				for piping into decode_aprs.
+ *		-n		Just count matching frames.
+ *
+ * Description:	The log segments are memory mapped so nothing is
+ *		read from disk that isn't needed.  Time ranges are found
+ *		by binary search of the index, in time order.  For a
+ *		source callsign, the index sorted by source is used
+ *		when available; for the segment still being written,
+ *		the time index is scanned instead.
+ *
+ *		It's fine to run this while the application is still
+ *		adding to the current segment.
+ *
+ *---------------------------------------------------------------*/
+
+#define PKTREPLAY_C 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <getopt.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+#include "direwolf.h"
+#include "ax25_pad.h"
+#include "textcolor.h"
+#include "hdlc_rec2.h"		/* for retry_text */
+#include "pktlog.h"
+
+
+struct seg_s {
+	char base[300];		/* Path without extension. */
+	long long start_us;
+};
+
+static long long t_start = 0;			/* Selection criteria. */
+static long long t_end = 0x7fffffffffffffffLL;
+static char want_call[16] = "";
+
+static int text_only = 0;
+static int count_only = 0;
+
+static long long num_found = 0;
+static long long num_bad = 0;
+
+
+static void usage (void);
+static long long parse_time (char *str);
+static int list_segments (char *dir, struct seg_s **result);
+static void replay_segment (struct seg_s *s);
+
+
+
+int main (int argc, char *argv[])
+{
+	int c, n, j;
+	struct seg_s *segs;
+
+	while ((c = getopt(argc, argv, "s:e:c:tn")) != -1) {
+	  switch (c) {
+	    case 's':
+	      t_start = parse_time (optarg);
+	      break;
+	    case 'e':
+	      t_end = parse_time (optarg);
+	      break;
+	    case 'c':
+	      strncpy (want_call, optarg, sizeof(want_call)-1);
+	      for (j = 0; want_call[j] != '\0'; j++) {
+	        want_call[j] = toupper(want_call[j]);
+	      }
+	      break;
+	    case 't':
+	      text_only = 1;
+	      break;
+	    case 'n':
+	      count_only = 1;
+	      break;
+	    default:
+	      usage ();
+	  }
+	}
+
+	if (optind != argc - 1) {
+	  usage ();
+	}
+
+	text_color_init (0);
+
+	n = list_segments (argv[optind], &segs);
+	if (n < 0) {
+	  fprintf (stderr, "Can't open directory %s.\n", argv[optind]);
+	  exit (1);
+	}
+
+	for (j = 0; j < n; j++) {
+	  if (segs[j].start_us > t_end) break;
+	  replay_segment (&segs[j]);
+	}
+
+	if (count_only || ! text_only) {
+	  printf ("%lld frames", num_found);
+	  if (num_bad > 0) {
+	    printf (", %lld could not be read", num_bad);
+	  }
+	  printf (".\n");
+	}
+
+	exit (0);
+}
+
+
+static void usage (void)
+{
+	fprintf (stderr, "Usage:  pktreplay [options] directory\n");
+	fprintf (stderr, "  -s time   Start, local time e.g. \"2014-10-19 15:30\".\n");
+	fprintf (stderr, "  -e time   End, same format.\n");
+	fprintf (stderr, "  -c call   Source callsign.  All SSIDs if none specified.\n");
+	fprintf (stderr, "  -t        Text only, for piping into decode_aprs.\n");
+	fprintf (stderr, "  -n        Only count matching frames.\n");
+	exit (1);
+}
+
+
+/*
+ * Convert "YYYY-MM-DD HH:MM:SS" local time to microseconds since 1970.
+ * Anything after the date can be left off.
+ */
+
+static long long parse_time (char *str)
+{
+	struct tm tm;
+	int n;
+
+	memset (&tm, 0, sizeof(tm));
+	n = sscanf (str, "%d-%d-%d%*[ T]%d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+				&tm.tm_hour, &tm.tm_min, &tm.tm_sec);
+	if (n < 3) {
+	  fprintf (stderr, "Time \"%s\" is not in the form YYYY-MM-DD HH:MM:SS\n", str);
+	  exit (1);
+	}
+	tm.tm_year -= 1900;
+	tm.tm_mon -= 1;
+	tm.tm_isdst = -1;
+
+	return ((long long)mktime(&tm) * 1000000);
+}
+
+
+/*
+ * Find all segments in directory, ordered by time.
+ */
+
+static int compare_start (const void *a, const void *b)
+{
+	const struct seg_s *sa = a;
+	const struct seg_s *sb = b;
+
+	if (sa->start_us < sb->start_us) return (-1);
+	if (sa->start_us > sb->start_us) return (1);
+	return (0);
+}
+
+static int list_segments (char *dir, struct seg_s **result)
+{
+	DIR *dp;
+	struct dirent *ep;
+	int n = 0, nalloc = 64;
+	struct seg_s *segs;
+
+	dp = opendir (dir);
+	if (dp == NULL) {
+	  return (-1);
+	}
+
+	segs = malloc (nalloc * sizeof(struct seg_s));
+
+	while ((ep = readdir(dp)) != NULL) {
+	  int len = strlen(ep->d_name);
+	  char path[320];
+	  struct pktlog_map_s m;
+	  struct pktlog_hdr_s *h;
+
+	  if (len <= 4 || strcmp(ep->d_name + len - 4, ".pkt") != 0) continue;
+
+	  if (n >= nalloc) {
+	    nalloc *= 2;
+	    segs = realloc (segs, nalloc * sizeof(struct seg_s));
+	  }
+
+	  snprintf (segs[n].base, sizeof(segs[n].base), "%s/%.*s", dir, len - 4, ep->d_name);
+	  snprintf (path, sizeof(path), "%s.pkt", segs[n].base);
+
+	  if (pktlog_map (path, 0, 0, &m) != 0) continue;
+	  h = (struct pktlog_hdr_s *)(m.addr);
+	  if (m.size >= sizeof(struct pktlog_hdr_s) &&
+	      memcmp (h->magic, PKTLOG_MAGIC, sizeof(h->magic)) == 0) {
+	    segs[n].start_us = h->start_us;
+	    n++;
+	  }
+	  pktlog_unmap (&m, 0, 0);
+	}
+	closedir (dp);
+
+	qsort (segs, n, sizeof(struct seg_s), compare_start);
+	*result = segs;
+	return (n);
+}
+
+
+/*
+ * Does source in index match what we are looking for?
+ */
+
+static int match_call (const char *source)
+{
+	int len = strlen(want_call);
+
+	if (len == 0) {
+	  return (1);
+	}
+	if (strchr(want_call, '-') != NULL) {
+	  return (strncmp(source, want_call, 16) == 0);
+	}
+	return (strncmp(source, want_call, len) == 0 && (source[len] == '\0' || source[len] == '-'));
+}
+
+
+/*
+ * Display one frame.
+ */
+
+static void replay_one (struct pktlog_map_s *dm, unsigned int used, struct pktlog_idx_s *ent)
+{
+	struct pktlog_rec_s *rec;
+	packet_t pp;
+	char stemp[500];
+	unsigned char *pinfo;
+	int info_len;
+	time_t sec;
+	struct tm tm;
+	char ts[40];
+
+	if (ent->offset < sizeof(struct pktlog_hdr_s) ||
+	    ent->offset + sizeof(struct pktlog_rec_s) > used) {
+	  num_bad++;
+	  return;
+	}
+
+	rec = (struct pktlog_rec_s *)(dm->addr + ent->offset);
+	if (ent->offset + sizeof(struct pktlog_rec_s) + rec->len > used) {
+	  num_bad++;
+	  return;
+	}
+
+	num_found++;
+	if (count_only) {
+	  return;
+	}
+
+	pp = ax25_from_frame ((unsigned char *)(rec + 1), rec->len, rec->alevel);
+	if (pp == NULL) {
+	  num_bad++;
+	  return;
+	}
+
+	if ( ! text_only) {
+	  sec = (time_t)(rec->time_us / 1000000);
+	  tm = *localtime (&sec);
+	  strftime (ts, sizeof(ts), "%Y-%m-%d %H:%M:%S", &tm);
+
+	  if (rec->subchan < 0) {
+	    dw_printf ("%s.%03d [%d.dtmf] ", ts, (int)(rec->time_us / 1000 % 1000), rec->chan);
+	  }
+	  else {
+	    dw_printf ("%s.%03d [%d.%d] ", ts, (int)(rec->time_us / 1000 % 1000), rec->chan, rec->subchan);
+	  }
+	  dw_printf ("%3d %-7s ", rec->alevel, rec->retries <= RETRY_TWO_SEP ? retry_text[rec->retries] : "?");
+	}
+
+	ax25_format_addrs (pp, stemp);
+	info_len = ax25_get_info (pp, &pinfo);
+	dw_printf ("%s", stemp);
+	ax25_safe_print ((char *)pinfo, info_len, 0);
+	dw_printf ("\n");
+
+	ax25_delete (pp);
+}
+
+
+/*
+ * Display matching frames from one segment.
+ */
+
+static int compare_time (const void *a, const void *b)
+{
+	const struct pktlog_idx_s *ea = *(const struct pktlog_idx_s **)a;
+	const struct pktlog_idx_s *eb = *(const struct pktlog_idx_s **)b;
+
+	if (ea->time_us < eb->time_us) return (-1);
+	if (ea->time_us > eb->time_us) return (1);
+	return (0);
+}
+
+static void replay_segment (struct seg_s *s)
+{
+	char path[320];
+	struct pktlog_map_s dm, im, sm;
+	struct pktlog_hdr_s *h;
+	struct pktlog_idx_s *idx;
+	unsigned int count, used, lo, hi, j;
+
+	snprintf (path, sizeof(path), "%s.pkt", s->base);
+	if (pktlog_map (path, 0, 0, &dm) != 0) {
+	  return;
+	}
+	h = (struct pktlog_hdr_s *)(dm.addr);
+
+/* Count is updated last, by the writer, so everything before it is complete. */
+
+	count = __atomic_load_n (&h->count, __ATOMIC_ACQUIRE);
+	used = h->used;
+	if (used > dm.size) used = dm.size;
+
+	snprintf (path, sizeof(path), "%s.idx", s->base);
+	if (pktlog_map (path, 0, 0, &im) != 0) {
+	  pktlog_unmap (&dm, 0, 0);
+	  return;
+	}
+	if (count > im.size / sizeof(struct pktlog_idx_s)) {
+	  count = im.size / sizeof(struct pktlog_idx_s);
+	}
+	idx = (struct pktlog_idx_s *)(im.addr);
+
+	if (count == 0 || idx[count-1].time_us < t_start) {
+	  pktlog_unmap (&im, 0, 0);
+	  pktlog_unmap (&dm, 0, 0);
+	  return;
+	}
+
+	snprintf (path, sizeof(path), "%s.src", s->base);
+
+	if (strlen(want_call) > 0 && h->closed && pktlog_map (path, 0, 0, &sm) == 0) {
+
+/*
+ * Finished segment.  Binary search of source index.
+ */
+	  struct pktlog_idx_s *src = (struct pktlog_idx_s *)(sm.addr);
+	  unsigned int ns = sm.size / sizeof(struct pktlog_idx_s);
+	  int len = strlen(want_call);
+	  struct pktlog_idx_s **found;
+	  unsigned int nf = 0;
+
+	  lo = 0;
+	  hi = ns;
+	  while (lo < hi) {
+	    unsigned int mid = (lo + hi) / 2;
+	    if (strncmp(src[mid].source, want_call, 16) < 0) lo = mid + 1;
+	    else hi = mid;
+	  }
+
+	  found = malloc ((ns - lo + 1) * sizeof(struct pktlog_idx_s *));
+	  for (j = lo; j < ns && strncmp(src[j].source, want_call, len) == 0; j++) {
+	    if (match_call(src[j].source) && src[j].time_us >= t_start && src[j].time_us <= t_end) {
+	      found[nf++] = &src[j];
+	    }
+	  }
+
+	  /* Could be more than one SSID.  Put back into time order. */
+
+	  qsort (found, nf, sizeof(struct pktlog_idx_s *), compare_time);
+	  for (j = 0; j < nf; j++) {
+	    replay_one (&dm, used, found[j]);
+	  }
+	  free (found);
+	  pktlog_unmap (&sm, 0, 0);
+	}
+	else {
+
+/*
+ * Binary search of time index for start.
+ */
+	  lo = 0;
+	  hi = count;
+	  while (lo < hi) {
+	    unsigned int mid = (lo + hi) / 2;
+	    if (idx[mid].time_us < t_start) lo = mid + 1;
+	    else hi = mid;
+	  }
+
+	  for (j = lo; j < count && idx[j].time_us <= t_end; j++) {
+	    if (match_call(idx[j].source)) {
+	      replay_one (&dm, used, &idx[j]);
+	    }
+	  }
+	}
+
+	pktlog_unmap (&im, 0, 0);
+	pktlog_unmap (&dm, 0, 0);
+
+} /* end replay_segment */
+
+/* end pktreplay.c */
@@ -0,0 +1,432 @@
+
+//
+//    This file is part of Dire Wolf, an amateur radio packet TNC.
+//
+//    Copyright (C) 2014  John Langner, WB2OSZ
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        rbench.c
+ *
+ * Purpose:     Benchmark the strategies for fixing frames with bad FCS.
+ *
+ * Description:	With SPILLFILE in the configuration file, or the atest -S
+ *		option, blocks of received bits which could not be fixed
+ *		are saved.  This tries each of the bit fixing strategies,
+ *		on each saved block, and reports how many were recovered
+ *		and how much CPU time it took.
+ *
+ *		Unlike the application, which tries the strategies in
+ *		order of increasing effort, each one is tried on its own
+ *		so its cost and success rate can be seen separately.
+ *		The "ladder" line shows what it would cost to try them
+ *		in the order listed, stopping at the first success, as
+ *		the application does.
+ *
+ *		The decoding in hdlc_rec2.c keeps its state on the stack
+ *		so the work is divided among several threads.  CPU time is
+ *		measured for each thread so it is not inflated when there
+ *		are more threads than processors.
+ *
+ * Usage:	rbench  [options]  file ...
+ *
+ *		-j n		Number of threads.  Default is number of processors.
+ *		-F list		Strategies, same values as FIX_BITS.
+ *				e.g.  1,2,3,4  which is the default.
+ *		-v		Show each block which was recovered.
+ *
+ * Example:	rbench -F 3,4 spill.bin
+ *
+ *--------------------------------------------------------------------*/
+
+
+#define RBENCH_C 1
+
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+
+#if __WIN32__
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+#include "direwolf.h"
+#include "textcolor.h"
+#include "rrbb.h"
+#include "hdlc_rec2.h"
+
+
+#define MAX_STRATEGIES 5
+#define MAX_THREADS 64
+
+
+static rrbb_t *blocks = NULL;
+static int num_blocks = 0;
+
+static retry_t strategies[MAX_STRATEGIES];
+static int num_strategies = 0;
+
+static int v_opt = 0;
+
+
+/*
+ * One job for each combination of block and strategy.
+ * Job n is block n / num_strategies.
+ */
+
+static struct job_s {
+	int ok;				/* Frame was recovered. */
+	double cpu_sec;			/* CPU time for this thread. */
+} *jobs;
+
+static int num_jobs = 0;
+static int next_job = 0;		/* Next one for a worker to take. */
+
+#if __WIN32__
+static CRITICAL_SECTION job_cs;
+static unsigned __stdcall worker (void *arg);
+#else
+static pthread_mutex_t job_mutex;
+static void * worker (void *arg);
+#endif
+
+static void usage (void);
+static void read_file (char *fname);
+static double thread_cpu_sec (void);
+
+
+
+int main (int argc, char *argv[])
+{
+	int c;
+	int n, b, s;
+	int num_threads = 0;
+	char *p;
+	time_t start_time;
+	int ladder_ok;
+	double ladder_cpu;
+#if __WIN32__
+	HANDLE th[MAX_THREADS];
+	SYSTEM_INFO si;
+#else
+	pthread_t th[MAX_THREADS];
+#endif
+
+	while ((c = getopt(argc, argv, "j:F:v")) != -1) {
+
+	  switch (c) {
+
+	    case 'j':
+	      num_threads = atoi(optarg);
+	      break;
+
+	    case 'F':
+	      num_strategies = 0;
+	      for (p = strtok(optarg, ","); p != NULL; p = strtok(NULL, ",")) {
+	        n = atoi(p);
+	        if (n < RETRY_NONE || n > RETRY_TWO_SEP || num_strategies >= MAX_STRATEGIES) {
+	          fprintf (stderr, "-F must be a list of values in range of %d to %d.\n", RETRY_NONE, RETRY_TWO_SEP);
+	          exit (EXIT_FAILURE);
+	        }
+	        strategies[num_strategies++] = (retry_t)n;
+	      }
+	      break;
+
+	    case 'v':
+	      v_opt = 1;
+	      break;
+
+	    default:
+	      usage ();
+	  }
+	}
+
+	if (optind >= argc) {
+	  usage ();
+	}
+
+	if (num_strategies == 0) {
+	  for (n = RETRY_SINGLE; n <= RETRY_TWO_SEP; n++) {
+	    strategies[num_strategies++] = (retry_t)n;
+	  }
+	}
+
+	for ( ; optind < argc; optind++) {
+	  read_file (argv[optind]);
+	}
+	if (num_blocks == 0) {
+	  fprintf (stderr, "No saved blocks found.\n");
+	  exit (EXIT_FAILURE);
+	}
+
+	if (num_threads <= 0) {
+#if __WIN32__
+	  GetSystemInfo (&si);
+	  num_threads = si.dwNumberOfProcessors;
+#else
+	  num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	}
+	if (num_threads < 1) num_threads = 1;
+	if (num_threads > MAX_THREADS) num_threads = MAX_THREADS;
+
+	num_jobs = num_blocks * num_strategies;
+	jobs = calloc (num_jobs, sizeof(struct job_s));
+	if (jobs == NULL) {
+	  fprintf (stderr, "Out of memory.\n");
+	  exit (EXIT_FAILURE);
+	}
+
+	if (num_threads > num_jobs) num_threads = num_jobs;
+
+	fprintf (stderr, "%d blocks, %d strategies, %d threads.\n", num_blocks, num_strategies, num_threads);
+
+	start_time = time(NULL);
+
+#if __WIN32__
+	InitializeCriticalSection (&job_cs);
+	for (n = 0; n < num_threads; n++) {
+	  th[n] = (HANDLE)_beginthreadex (NULL, 0, worker, NULL, 0, NULL);
+	  if (th[n] == NULL) {
+	    fprintf (stderr, "Could not create worker thread\n");
+	    exit (EXIT_FAILURE);
+	  }
+	}
+	for (n = 0; n < num_threads; n++) {
+	  WaitForSingleObject (th[n], INFINITE);
+	}
+#else
+	pthread_mutex_init (&job_mutex, NULL);
+	for (n = 0; n < num_threads; n++) {
+	  if (pthread_create (&th[n], NULL, worker, NULL) != 0) {
+	    perror ("Could not create worker thread");
+	    exit (EXIT_FAILURE);
+	  }
+	}
+	for (n = 0; n < num_threads; n++) {
+	  pthread_join (th[n], NULL);
+	}
+#endif
+
+/*
+ * Summary for each strategy.
+ */
+	printf ("\n");
+	printf ("strategy    blocks  recovered   rate    cpu sec  ms/block  ms/recovered\n");
+	printf ("--------    ------  ---------  ------  --------  --------  ------------\n");
+
+	for (s = 0; s < num_strategies; s++) {
+	  int ok = 0;
+	  double cpu = 0;
+
+	  for (b = 0; b < num_blocks; b++) {
+	    ok += jobs[b * num_strategies + s].ok;
+	    cpu += jobs[b * num_strategies + s].cpu_sec;
+	  }
+
+	  printf ("%-8s  %8d  %9d  %5.1f%%  %8.3f  %8.3f  %12.3f\n", retry_text[strategies[s]],
+		num_blocks, ok, 100. * ok / num_blocks, cpu,
+		1000. * cpu / num_blocks, ok > 0 ? 1000. * cpu / ok : 0.);
+	}
+
+/*
+ * Cost of trying them in order until one works.
+ * This recovers any block which at least one of them can.
+ */
+	ladder_ok = 0;
+	ladder_cpu = 0;
+
+	for (b = 0; b < num_blocks; b++) {
+	  for (s = 0; s < num_strategies; s++) {
+	    ladder_cpu += jobs[b * num_strategies + s].cpu_sec;
+	    if (jobs[b * num_strategies + s].ok) {
+	      ladder_ok++;
+	      break;
+	    }
+	  }
+	}
+
+	printf ("--------    ------  ---------  ------  --------  --------  ------------\n");
+
+	printf ("%-8s  %8d  %9d  %5.1f%%  %8.3f  %8.3f  %12.3f\n", "ladder",
+		num_blocks, ladder_ok, 100. * ladder_ok / num_blocks, ladder_cpu,
+		1000. * ladder_cpu / num_blocks, ladder_ok > 0 ? 1000. * ladder_cpu / ladder_ok : 0.);
+
+	printf ("\n%d seconds elapsed.\n", (int)(time(NULL) - start_time));
+
+	for (b = 0; b < num_blocks; b++) {
+	  rrbb_delete (blocks[b]);
+	}
+	free (blocks);
+	free (jobs);
+
+	exit (EXIT_SUCCESS);
+}
+
+
+
+/*
+ * Each worker takes the next combination of block and strategy
+ * until there are no more.
+ */
+
+#if __WIN32__
+static unsigned __stdcall worker (void *arg)
+#else
+static void * worker (void *arg)
+#endif
+{
+	int n;
+	double start;
+
+	while (1) {
+
+#if __WIN32__
+	  EnterCriticalSection (&job_cs);
+	  n = next_job++;
+	  LeaveCriticalSection (&job_cs);
+#else
+	  pthread_mutex_lock (&job_mutex);
+	  n = next_job++;
+	  pthread_mutex_unlock (&job_mutex);
+#endif
+	  if (n >= num_jobs) {
+	    break;
+	  }
+
+	  start = thread_cpu_sec ();
+	  jobs[n].ok = hdlc_rec2_try_strategy (blocks[n / num_strategies], strategies[n % num_strategies]);
+	  jobs[n].cpu_sec = thread_cpu_sec () - start;
+
+	  if (v_opt && jobs[n].ok) {
+	    fprintf (stderr, "Block %d, %d bits, recovered by %s in %.3f sec.\n",
+			n / num_strategies, rrbb_get_len(blocks[n / num_strategies]),
+			retry_text[strategies[n % num_strategies]], jobs[n].cpu_sec);
+	  }
+	}
+
+	return (0);
+}
+
+
+
+/*
+ * Read all blocks from a file written by the application.
+ */
+
+static void read_file (char *fname)
+{
+	FILE *fp;
+	char magic[8];
+	rrbb_t b;
+	int fix_bits;
+	int count = 0;
+
+	fp = fopen (fname, "rb");
+	if (fp == NULL) {
+	  fprintf (stderr, "Can't open %s for read.\n", fname);
+	  exit (EXIT_FAILURE);
+	}
+
+	if (fread (magic, sizeof(magic), 1, fp) != 1 ||
+	    memcmp (magic, RRBB_FILE_MAGIC, sizeof(magic)) != 0) {
+	  fprintf (stderr, "%s is not a file of saved blocks.\n", fname);
+	  exit (EXIT_FAILURE);
+	}
+
+	while ((b = rrbb_read (fp, &fix_bits)) != NULL) {
+	  blocks = realloc (blocks, (num_blocks + 1) * sizeof(rrbb_t));
+	  if (blocks == NULL) {
+	    fprintf (stderr, "Out of memory.\n");
+	    exit (EXIT_FAILURE);
+	  }
+	  blocks[num_blocks++] = b;
+	  count++;
+	}
+	fclose (fp);
+
+	fprintf (stderr, "%s: %d blocks.\n", fname, count);
+}
+
+
+
+/*
+ * CPU time used by the calling thread.
+ */
+
+static double thread_cpu_sec (void)
+{
+#if __WIN32__
+	FILETIME creation, exit, kernel, user;
+
+	GetThreadTimes (GetCurrentThread(), &creation, &exit, &kernel, &user);
+
+	/* 100 nanosecond units. */
+
+	return (((double)user.dwHighDateTime * (256. * 256. * 256. * 256.) + (double)user.dwLowDateTime +
+		 (double)kernel.dwHighDateTime * (256. * 256. * 256. * 256.) + (double)kernel.dwLowDateTime) / 10000000.);
+#else
+	struct timespec ts;
+
+	clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts);
+
+	return (ts.tv_sec + ts.tv_nsec / 1000000000.);
+#endif
+}
+
+
+
+/*
+ * Stand-ins for the rest of the application.
+ * The frame is not needed;  success is reported by the return value.
+ */
+
+void multi_modem_process_rec_frame (int chan, int subchan, unsigned char *fbuf, int flen, int alevel, retry_t retries)
+{
+}
+
+void rdq_append (rrbb_t rrbb)
+{
+}
+
+
+
+static void usage (void)
+{
+	fprintf (stderr, "\n");
+	fprintf (stderr, "rbench - Benchmark the strategies for fixing frames with bad FCS.\n");
+	fprintf (stderr, "\n");
+	fprintf (stderr, "Usage:  rbench  [options]  file ...\n");
+	fprintf (stderr, "\n");
+	fprintf (stderr, "  -j n      Number of threads.  Default is number of processors.\n");
+	fprintf (stderr, "  -F list   Strategies, same values as FIX_BITS.  Default 1,2,3,4\n");
+	fprintf (stderr, "  -v        Show each block which was recovered.\n");
+	fprintf (stderr, "\n");
+	fprintf (stderr, "Files are written by the application with SPILLFILE in the\n");
+	fprintf (stderr, "configuration file, or by atest with the -S option.\n");
+	exit (EXIT_FAILURE);
+}
+
+/* end rbench.c */
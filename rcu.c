@@ -0,0 +1,138 @@
+//
+//    This file is part of Dire Wolf, an amateur radio packet TNC.
+//
+//    Copyright (C) 2014  John Langner, WB2OSZ
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+/*------------------------------------------------------------------
+ *
+ * Module:      rcu.c
+ *
+ * Purpose:   	Read-copy-update for data replaced at run time,
+ *		mainly configuration reloaded on SIGHUP.
+ *
+ * Description:	Readers follow a pointer to the current copy and
+ *		never wait.  A writer makes a new copy, changes the
+ *		pointer, and then must wait until nobody could still
+ *		be using the old copy before freeing it.
+ *
+ *		Readers are counted in one of two groups.  The writer
+ *		switches new readers to the other group and waits for
+ *		the count of the previous group to drop to zero.
+ *		Anyone who started after the switch sees the new
+ *		pointer so they don't matter.
+ *
+ *		A reader is just two atomic operations so this is
+ *		cheap enough to do for each packet.  Writers are
+ *		rare and may wait a little while.
+ *
+ *---------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "direwolf.h"
+#include "rcu.h"
+
+
+static int rcu_group = 0;		/* Group for new readers. */
+
+static int rcu_readers[2] = { 0, 0 };	/* Number of readers in each group. */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        rcu_read_lock
+ *
+ * Purpose:     Start using shared data.
+ *
+ * Returns:	Value to pass to rcu_read_unlock.
+ *
+ * Description:	Pick up the pointer to the shared data after this.
+ *		Readers can be nested.
+ *
+ *--------------------------------------------------------------------*/
+
+int rcu_read_lock (void)
+{
+	int g;
+
+	while (1) {
+	  g = __atomic_load_n (&rcu_group, __ATOMIC_SEQ_CST);
+	  __atomic_fetch_add (&rcu_readers[g], 1, __ATOMIC_SEQ_CST);
+
+	  /* If the writer switched groups in the meantime, it might */
+	  /* not be waiting for the one we just joined.  Try again. */
+
+	  if (__atomic_load_n (&rcu_group, __ATOMIC_SEQ_CST) == g) {
+	    return (g);
+	  }
+	  __atomic_fetch_sub (&rcu_readers[g], 1, __ATOMIC_SEQ_CST);
+	}
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        rcu_read_unlock
+ *
+ * Purpose:     Done using shared data.
+ *
+ * Inputs:	r	- Value from rcu_read_lock.
+ *
+ *--------------------------------------------------------------------*/
+
+void rcu_read_unlock (int r)
+{
+	assert (r == 0 || r == 1);
+
+	__atomic_fetch_sub (&rcu_readers[r], 1, __ATOMIC_RELEASE);
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        rcu_synchronize
+ *
+ * Purpose:     Wait until all readers that might have seen the
+ *		old pointer are finished.
+ *
+ * Description:	Call this after storing the new pointer and
+ *		before freeing the old data.
+ *		Don't call it from inside rcu_read_lock / unlock.
+ *		Only one thread at a time may call this.
+ *
+ *--------------------------------------------------------------------*/
+
+void rcu_synchronize (void)
+{
+	int old;
+
+	__atomic_thread_fence (__ATOMIC_SEQ_CST);
+	old = rcu_group;
+	__atomic_store_n (&rcu_group, 1 - old, __ATOMIC_SEQ_CST);
+
+	while (__atomic_load_n (&rcu_readers[old], __ATOMIC_ACQUIRE) != 0) {
+	  SLEEP_MS (1);
+	}
+}
+
+
+/* end rcu.c */
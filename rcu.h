@@ -0,0 +1,40 @@
+
+/*------------------------------------------------------------------
+ *
+ * Module:      rcu.h
+ *
+ * Purpose:   	Replace shared data, such as configuration, while
+ *		other threads are using it.
+ *
+ *---------------------------------------------------------------*/
+
+#ifndef RCU_H
+#define RCU_H 1
+
+
+/*
+ * Reader:
+ *
+ *	r = rcu_read_lock ();
+ *	p = __atomic_load_n (&shared_p, __ATOMIC_ACQUIRE);
+ *	... use *p ...
+ *	rcu_read_unlock (r);
+ *
+ * Writer:
+ *
+ *	old = shared_p;
+ *	__atomic_store_n (&shared_p, new, __ATOMIC_RELEASE);
+ *	rcu_synchronize ();
+ *	... free old ...
+ */
+
+int rcu_read_lock (void);
+
+void rcu_read_unlock (int r);
+
+void rcu_synchronize (void);
+
+
+#endif
+
+/* end rcu.h */
@@ -41,11 +41,15 @@
 #include "audio.h"
 #include "rdq.h"
 #include "dedupe.h"
+#include "xmit.h"		/* for dtime_now */
+#include "metrics.h"
 
 
 
 static rrbb_t queue_head;			/* Head of linked list for queue. */
 
+static volatile int queue_length;		/* Number in the queue, for performance counters. */
+
 #if __WIN32__
 
 static CRITICAL_SECTION rdq_cs;			/* Critical section for updating queues. */
@@ -141,6 +145,9 @@ void rdq_init (void)
 	}
 #endif
 
+	queue_length = 0;
+	metrics_int (METRICS_GAUGE, "redecode_queue_length",
+			"Frames with bad FCS waiting to be fixed.", "", &queue_length);
 
 } /* end rdq_init */
 
@@ -194,6 +201,10 @@ void rdq_append (rrbb_t rrbb)
 	//if (queue_head != NULL) {
 	       //was_empty = 0;
 	//}
+
+	rrbb_set_queued_at (rrbb, dtime_now());
+	queue_length++;
+
 	if (queue_head == NULL) {
 	  queue_head = rrbb;
 	}
@@ -427,6 +438,7 @@ rrbb_t rdq_remove (void)
 	  result_p = queue_head;
 	  queue_head = rrbb_get_nextp(result_p);
 	  rrbb_set_nextp (result_p, NULL);
+	  queue_length--;
 	}
 	 
 #if __WIN32__
@@ -60,6 +60,9 @@
 #include "audio.h"
 #include "rdq.h"
 #include "redecode.h"
+#include "rtsched.h"
+#include "metrics.h"
+#include "xmit.h"		/* for dtime_now */
 #include "hdlc_send.h"
 #include "hdlc_rec2.h"
 #include "ptt.h"
@@ -184,6 +187,12 @@ static void * redecode_thread (void *arg)
 	int blen;
 	int chan, subchan;
 	int alevel;
+	metrics_t m_candidates, m_latency;
+
+	m_candidates = metrics_counter ("redecode_candidates_total",
+			"Frames with bad FCS processed by the redecode thread.", "");
+	m_latency = metrics_counter_scaled ("redecode_latency_seconds_total",
+			"Sum of time from being queued to finishing the fix attempt.", "", 0.000001);
 
 
 #if __WIN32__
@@ -198,6 +207,8 @@ static void * redecode_thread (void *arg)
 	//dw_printf ("New redecode thread priority=%d\n", tp);
 #endif
 
+	rtsched_apply (RTSCHED_REDECODE);
+
 	while (1) {
 
 	  rdq_wait_while_empty ();
@@ -229,6 +240,9 @@ static void * redecode_thread (void *arg)
 
 	    hdlc_rec2_try_to_fix_later (block, chan, subchan, alevel);
 
+	    metrics_add (m_candidates, 1);
+	    metrics_add (m_latency, (long long)((dtime_now() - rrbb_get_queued_at(block)) * 1000000.));
+
 #if DEBUG
 	    text_color_set(DW_COLOR_DEBUG);
 	    dw_printf ("redecode_thread: finished processing %p\n", block);
@@ -155,6 +155,7 @@ void rrbb_clear (rrbb_t b, int is_scrambled, int descram_state)
 
 	b->nextp = NULL;
 	b->audio_level = 9999;
+	b->queued_at = 0;
 	b->len = 0;
 
 	b->is_scrambled = is_scrambled;
@@ -572,6 +573,37 @@ int rrbb_get_audio_level (rrbb_t b)
 }
 
 
+/***********************************************************************************
+ *
+ * Name:	rrbb_set_queued_at	
+ *		rrbb_get_queued_at
+ *
+ * Purpose:	Time when it was put in the queue for trying to fix bits.
+ *
+ * Inputs:	b	Handle for bit array.
+ *		t	Time in seconds.  Only differences are meaningful.
+ *		
+ ***********************************************************************************/
+
+void rrbb_set_queued_at (rrbb_t b, double t)
+{
+	assert (b != NULL);
+	assert (b->magic1 == MAGIC1);
+	assert (b->magic2 == MAGIC2);
+
+	b->queued_at = t;
+}
+
+double rrbb_get_queued_at (rrbb_t b)
+{
+	assert (b != NULL);
+	assert (b->magic1 == MAGIC1);
+	assert (b->magic2 == MAGIC2);
+
+	return (b->queued_at);
+}
+
+
 /***********************************************************************************
  *
  * Name:	rrbb_get_is_scrambled	
@@ -615,6 +647,117 @@ int rrbb_get_descram_state (rrbb_t b)
 }
 
 
+/***********************************************************************************
+ *
+ * Name:	rrbb_write	
+ *
+ * Purpose:	Save a block in a file for later experiments.
+ *
+ * Inputs:	b		- Handle for bit array.
+ *
+ *		fix_bits	- Highest level of bit fixing which was 
+ *				  tried without success.
+ *
+ *		fp		- File opened for binary write.
+ *				  The caller is responsible for writing
+ *				  RRBB_FILE_MAGIC at the beginning.
+ *
+ * Returns:	0 for success, -1 for error.
+ *		
+ ***********************************************************************************/
+
+int rrbb_write (rrbb_t b, int fix_bits, FILE *fp)
+{
+	struct rrbb_file_rec_s rec;
+	unsigned char packed[(MAX_NUM_BITS+7)/8];
+	unsigned int i;
+
+	assert (b != NULL);
+	assert (b->magic1 == MAGIC1);
+	assert (b->magic2 == MAGIC2);
+
+	memset (&rec, 0, sizeof(rec));
+	rec.nbits = b->len;
+	rec.chan = b->chan;
+	rec.subchan = b->subchan;
+	rec.alevel = b->audio_level;
+	rec.is_scrambled = b->is_scrambled;
+	rec.fix_bits = fix_bits;
+	rec.descram_state = b->descram_state;
+
+	memset (packed, 0, sizeof(packed));
+	for (i = 0; i < b->len; i++) {
+	  if (rrbb_get_bit (b, i)) {
+	    packed[i / 8] |= 1 << (i % 8);
+	  }
+	}
+
+	if (fwrite (&rec, sizeof(rec), 1, fp) != 1 ||
+	    fwrite (packed, (b->len + 7) / 8, 1, fp) != 1) {
+	  return (-1);
+	}
+	return (0);
+}
+
+
+/***********************************************************************************
+ *
+ * Name:	rrbb_read	
+ *
+ * Purpose:	Get the next block from a file written by rrbb_write.
+ *
+ * Inputs:	fp		- File opened for binary read, positioned
+ *				  after RRBB_FILE_MAGIC or a previous block.
+ *
+ * Outputs:	fix_bits	- Level of bit fixing tried when it was saved.
+ *
+ * Returns:	Handle for a new bit array, or NULL at end of file.
+ *		The caller must rrbb_delete it.
+ *		
+ ***********************************************************************************/
+
+rrbb_t rrbb_read (FILE *fp, int *fix_bits)
+{
+	struct rrbb_file_rec_s rec;
+	unsigned char packed[(MAX_NUM_BITS+7)/8];
+	rrbb_t b;
+	unsigned int i;
+
+	if (fread (&rec, sizeof(rec), 1, fp) != 1) {
+	  return (NULL);
+	}
+
+	if (rec.chan < 0 || rec.chan >= MAX_CHANS ||
+	    rec.subchan < 0 || rec.subchan >= MAX_SUBCHANS ||
+	    rec.nbits > MAX_NUM_BITS || rec.is_scrambled > 1) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Saved bit block is not valid.  Is this the right kind of file?\n");
+	  return (NULL);
+	}
+
+	if (rec.nbits > 0 && fread (packed, (rec.nbits + 7) / 8, 1, fp) != 1) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Saved bit block is truncated.\n");
+	  return (NULL);
+	}
+
+	b = rrbb_new (rec.chan, rec.subchan, rec.is_scrambled, rec.descram_state);
+	rrbb_set_audio_level (b, rec.alevel);
+
+	for (i = 0; i < rec.nbits; i++) {
+	  int bit = (packed[i / 8] >> (i % 8)) & 1;
+#if SLICENDICE
+	  rrbb2_append_bit (b, bit ? 1.0 : -1.0);
+#else
+	  rrbb_append_bit (b, bit);
+#endif
+	}
+
+	*fix_bits = rec.fix_bits;
+	return (b);
+}
+
+
 /* end rrbb.c */
 
 
@@ -3,6 +3,8 @@
 
 #define RRBB_H
 
+#include <stdio.h>		/* for FILE */
+
 
 /* Try something new in version 1.0 */
 /* Get back to this later.  Disable for now. */
@@ -36,6 +38,8 @@ typedef struct rrbb_s {
 	int chan;		/* Radio channel from which it was received. */
 	int subchan;		/* Which modem when more than one per channel. */
 	int audio_level;	/* Received audio level at time of frame capture. */
+	double queued_at;	/* When it was put in the redecode queue. */
+				/* For measuring how long it takes to get through. */
 	unsigned int len;	/* Current number of samples in array. */
 
 	int is_scrambled;	/* Is data scrambled G3RUH / K9NG style? */
@@ -95,8 +99,40 @@ void rrbb_set_audio_level (rrbb_t b, int a);
 
 int rrbb_get_audio_level (rrbb_t b);
 
+void rrbb_set_queued_at (rrbb_t b, double t);
+
+double rrbb_get_queued_at (rrbb_t b);
+
 int rrbb_get_is_scrambled (rrbb_t b);
 
 int rrbb_get_descram_state (rrbb_t b);
 
+
+/*
+ * Blocks which could not be decoded can be saved in a file
+ * for later experiments with the bit fixing strategies.
+ *
+ * The file starts with RRBB_FILE_MAGIC.  Each block is a
+ * fixed size header followed by the bits, packed 8 per byte,
+ * first bit in the least significant position.
+ * Native byte order.
+ */
+
+#define RRBB_FILE_MAGIC "DWRRBB01"
+
+struct rrbb_file_rec_s {
+	unsigned short nbits;		/* Number of bits following. */
+	signed char chan;		/* Radio channel. */
+	signed char subchan;		/* Which demodulator. */
+	short alevel;			/* Audio level. */
+	unsigned char is_scrambled;	/* For 9600 baud. */
+	unsigned char fix_bits;		/* Highest retry level that was */
+					/* tried, without success. */
+	int descram_state;		/* Descrambler state before first bit. */
+};
+
+int rrbb_write (rrbb_t b, int fix_bits, FILE *fp);
+
+rrbb_t rrbb_read (FILE *fp, int *fix_bits);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,361 @@
+//
+//    This file is part of Dire Wolf, an amateur radio packet TNC.
+//
+//    Copyright (C) 2014  John Langner, WB2OSZ
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+/*------------------------------------------------------------------
+ *
+ * Module:      rtsched.c
+ *
+ * Purpose:   	Scheduling policy, priority, and CPU affinity for
+ *		each class of thread.
+ *
+ * Description:	On a busy computer, other processes can hold off
+ *		the audio input long enough for the sound card buffer
+ *		to overflow.  The THREAD configuration command allows
+ *		the time critical threads to be given real time priority
+ *		and/or kept on their own CPUs.
+ *
+ *		Each thread calls rtsched_apply, with its class, when
+ *		it starts running.  The settings are then read back
+ *		and reported so the user can see whether they actually
+ *		took effect.  Typically real time priority requires
+ *		root or an "rtprio" limit in /etc/security/limits.conf.
+ *
+ *		Windows has only a handful of thread priority levels.
+ *		Real time policies are mapped to "highest" or, for
+ *		priority 50 and above, "time critical."
+ *
+ *---------------------------------------------------------------*/
+
+#if ! __WIN32__
+#define _GNU_SOURCE 1		/* for pthread_setaffinity_np */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#if __WIN32__
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "direwolf.h"
+#include "textcolor.h"
+#include "rtsched.h"
+
+
+static struct rtsched_s g_config[RTSCHED_NUM_CLASSES];
+
+static volatile int reported[RTSCHED_NUM_CLASSES];
+
+static const char *class_name[RTSCHED_NUM_CLASSES] = {
+	"AUDIO", "REDECODE", "DISPATCH", "XMIT", "BEACON", "IGATE", "KISS", "AGW" };
+
+static const char *policy_name[] = { "default", "OTHER", "FIFO", "RR" };
+
+
+static void cpus_to_text (unsigned long long cpus, char *text);
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        rtsched_class_lookup
+ *
+ * Purpose:     Find thread class by name.
+ *
+ * Inputs:	name	- Name from configuration file, e.g. "XMIT".
+ *
+ * Returns:	Thread class or -1 if not recognized.
+ *
+ *--------------------------------------------------------------------*/
+
+int rtsched_class_lookup (char *name)
+{
+	int n;
+
+	for (n = 0; n < RTSCHED_NUM_CLASSES; n++) {
+	  if (strcasecmp(name, class_name[n]) == 0) {
+	    return (n);
+	  }
+	}
+	return (-1);
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        rtsched_init
+ *
+ * Purpose:     Remember the settings for later.
+ *
+ * Inputs:	pconfig	- Array, indexed by thread class, from the
+ *			  configuration file.
+ *
+ * Description:	This must be called before starting any threads.
+ *
+ *--------------------------------------------------------------------*/
+
+void rtsched_init (struct rtsched_s *pconfig)
+{
+	memcpy (g_config, pconfig, sizeof(g_config));
+	memset ((void *)reported, 0, sizeof(reported));
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        rtsched_apply
+ *
+ * Purpose:     Apply scheduling settings to the calling thread.
+ *
+ * Inputs:	tclass	- What sort of thread this is.
+ *
+ * Description:	Set CPU affinity and scheduling policy, if specified
+ *		for this class, then read back what is actually in
+ *		effect and report it.  Several threads can share the
+ *		same class so success is reported only the first time.
+ *		Any failure is always reported.
+ *
+ *		Nothing is done, or displayed, for a class that was
+ *		not mentioned in the configuration file.
+ *
+ *--------------------------------------------------------------------*/
+
+void rtsched_apply (enum rtsched_class_e tclass)
+{
+	struct rtsched_s *p;
+	char want_cpus[200];
+#if ! __WIN32__
+	char have_cpus[200];
+#endif
+	int ok = 1;
+
+	if (tclass < 0 || tclass >= RTSCHED_NUM_CLASSES) {
+	  return;
+	}
+
+	p = &g_config[tclass];
+
+	if (p->policy == RTSCHED_POLICY_DEFAULT && p->cpus == 0) {
+	  return;
+	}
+
+#if __WIN32__
+
+	int want_prio, have_prio;
+
+	cpus_to_text (p->cpus, want_cpus);
+
+/*
+ * CPU affinity.
+ */
+	if (p->cpus != 0) {
+	  DWORD_PTR mask = (DWORD_PTR)(p->cpus);
+
+	  if (SetThreadAffinityMask (GetCurrentThread(), mask) == 0) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf ("Thread class %s: Could not run on CPU %s, error %d.\n",
+			class_name[tclass], want_cpus, (int)GetLastError());
+	    ok = 0;
+	  }
+	}
+
+/*
+ * Priority.
+ */
+	if (p->policy != RTSCHED_POLICY_DEFAULT) {
+
+	  if (p->policy == RTSCHED_POLICY_OTHER) {
+	    want_prio = THREAD_PRIORITY_NORMAL;
+	  }
+	  else if (p->priority >= 50) {
+	    want_prio = THREAD_PRIORITY_TIME_CRITICAL;
+	  }
+	  else {
+	    want_prio = THREAD_PRIORITY_HIGHEST;
+	  }
+
+	  SetThreadPriority (GetCurrentThread(), want_prio);
+	  have_prio = GetThreadPriority (GetCurrentThread());
+
+	  if (have_prio != want_prio) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf ("Thread class %s: Requested priority %d but running at %d.\n",
+			class_name[tclass], want_prio, have_prio);
+	    ok = 0;
+	  }
+	}
+
+	if (ok && ! reported[tclass]) {
+	  reported[tclass] = 1;
+	  text_color_set(DW_COLOR_INFO);
+	  dw_printf ("Thread class %s: %s priority %d, CPU %s.\n",
+		class_name[tclass], policy_name[p->policy], p->priority, want_cpus);
+	}
+
+#else
+
+	int e;
+	int want_policy = SCHED_OTHER;
+	int have_policy;
+	struct sched_param sp;
+	cpu_set_t cpuset;
+	unsigned long long have_mask;
+	int n;
+
+	cpus_to_text (p->cpus, want_cpus);
+
+/*
+ * CPU affinity.
+ */
+	if (p->cpus != 0) {
+
+	  CPU_ZERO (&cpuset);
+	  for (n = 0; n < 64; n++) {
+	    if (p->cpus & (1ULL << n)) {
+	      CPU_SET (n, &cpuset);
+	    }
+	  }
+
+	  e = pthread_setaffinity_np (pthread_self(), sizeof(cpuset), &cpuset);
+	  if (e != 0) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf ("Thread class %s: Could not run on CPU %s: %s\n",
+			class_name[tclass], want_cpus, strerror(e));
+	    ok = 0;
+	  }
+	}
+
+/*
+ * Policy and priority.
+ * Real time priority is clipped to the range allowed for the
+ * policy and also to RTSCHED_MAX_PRIORITY.
+ */
+	if (p->policy != RTSCHED_POLICY_DEFAULT) {
+
+	  switch (p->policy) {
+	    case RTSCHED_POLICY_FIFO:	want_policy = SCHED_FIFO;	break;
+	    case RTSCHED_POLICY_RR:	want_policy = SCHED_RR;		break;
+	    default:			want_policy = SCHED_OTHER;	break;
+	  }
+
+	  memset (&sp, 0, sizeof(sp));
+	  if (want_policy != SCHED_OTHER) {
+	    int pmin = sched_get_priority_min (want_policy);
+	    int pmax = sched_get_priority_max (want_policy);
+
+	    if (pmax > RTSCHED_MAX_PRIORITY) pmax = RTSCHED_MAX_PRIORITY;
+
+	    sp.sched_priority = p->priority;
+	    if (sp.sched_priority < pmin) sp.sched_priority = pmin;
+	    if (sp.sched_priority > pmax) sp.sched_priority = pmax;
+	  }
+
+	  e = pthread_setschedparam (pthread_self(), want_policy, &sp);
+	  if (e != 0) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf ("Thread class %s: Could not set %s priority %d: %s\n",
+			class_name[tclass], policy_name[p->policy], sp.sched_priority, strerror(e));
+	    if (e == EPERM) {
+	      dw_printf ("Real time scheduling requires root or an \"rtprio\" limit in /etc/security/limits.conf.\n");
+	    }
+	    ok = 0;
+	  }
+	}
+
+/*
+ * Self check.  What did we actually get?
+ */
+	e = pthread_getschedparam (pthread_self(), &have_policy, &sp);
+	if (e != 0) {
+	  have_policy = -1;
+	  sp.sched_priority = 0;
+	}
+
+	have_mask = 0;
+	CPU_ZERO (&cpuset);
+	if (pthread_getaffinity_np (pthread_self(), sizeof(cpuset), &cpuset) == 0) {
+	  for (n = 0; n < 64; n++) {
+	    if (CPU_ISSET (n, &cpuset)) {
+	      have_mask |= 1ULL << n;
+	    }
+	  }
+	}
+	cpus_to_text (have_mask, have_cpus);
+
+	if (p->policy != RTSCHED_POLICY_DEFAULT && have_policy != want_policy) {
+	  ok = 0;
+	}
+	if (p->cpus != 0 && have_mask != p->cpus) {
+	  ok = 0;
+	}
+
+	if ( ! ok || ! reported[tclass]) {
+	  reported[tclass] = 1;
+	  text_color_set(ok ? DW_COLOR_INFO : DW_COLOR_ERROR);
+	  dw_printf ("Thread class %s: %s, running %s priority %d on CPU %s.\n",
+		class_name[tclass],
+		ok ? "OK" : "NOT AS REQUESTED",
+		have_policy == SCHED_FIFO ? "FIFO" : have_policy == SCHED_RR ? "RR" : "OTHER",
+		sp.sched_priority, have_cpus);
+	}
+#endif
+
+} /* end rtsched_apply */
+
+
+/*
+ * Convert CPU mask to human readable list like "0,2-3".
+ */
+
+static void cpus_to_text (unsigned long long cpus, char *text)
+{
+	int n, m;
+	char stemp[40];
+
+	if (cpus == 0) {
+	  strcpy (text, "any");
+	  return;
+	}
+
+	strcpy (text, "");
+	for (n = 0; n < 64; n++) {
+	  if (cpus & (1ULL << n)) {
+	    m = n;
+	    while (m + 1 < 64 && (cpus & (1ULL << (m + 1)))) {
+	      m++;
+	    }
+	    if (m > n) {
+	      sprintf (stemp, "%s%d-%d", text[0] ? "," : "", n, m);
+	    }
+	    else {
+	      sprintf (stemp, "%s%d", text[0] ? "," : "", n);
+	    }
+	    strcat (text, stemp);
+	    n = m;
+	  }
+	}
+}
+
+/* end rtsched.c */
@@ -0,0 +1,73 @@
+
+/*------------------------------------------------------------------
+ *
+ * Module:      rtsched.h
+ *
+ * Purpose:   	Scheduling policy, priority, and CPU affinity for
+ *		each class of thread.
+ *
+ *---------------------------------------------------------------*/
+
+#ifndef RTSCHED_H
+#define RTSCHED_H 1
+
+
+/*
+ * Threads are grouped by what they do.
+ * Each group can be given its own scheduling.
+ */
+
+enum rtsched_class_e {
+	RTSCHED_AUDIO,		/* Audio input and demodulators.  Main thread. */
+	RTSCHED_REDECODE,	/* Trying to fix frames with bad FCS. */
+	RTSCHED_DISPATCH,	/* Processing of received frames. */
+	RTSCHED_XMIT,		/* Transmit queue and audio output. */
+	RTSCHED_BEACON,
+	RTSCHED_IGATE,
+	RTSCHED_KISS,		/* KISS over network, pseudo terminal, serial port. */
+	RTSCHED_AGW,		/* AGW network protocol. */
+	RTSCHED_NUM_CLASSES };
+
+
+enum rtsched_policy_e {
+	RTSCHED_POLICY_DEFAULT,		/* Leave it alone. */
+	RTSCHED_POLICY_OTHER,		/* Normal time sharing. */
+	RTSCHED_POLICY_FIFO,		/* Real time, run until blocked. */
+	RTSCHED_POLICY_RR };		/* Real time, round robin among equal priority. */
+
+
+/*
+ * Real time priorities are limited to this so we can't
+ * lock out kernel threads which normally run at the top.
+ */
+
+#define RTSCHED_MAX_PRIORITY 90
+
+/*
+ * Used when FIFO or RR is specified without a priority.
+ */
+
+#define RTSCHED_DEFAULT_PRIORITY 50
+
+
+struct rtsched_s {
+
+	enum rtsched_policy_e policy;
+
+	int priority;			/* For FIFO and RR:  1 .. RTSCHED_MAX_PRIORITY. */
+
+	unsigned long long cpus;	/* Bit mask of CPUs allowed to run on. */
+					/* 0 means no restriction. */
+};
+
+
+int rtsched_class_lookup (char *name);
+
+void rtsched_init (struct rtsched_s *pconfig);
+
+void rtsched_apply (enum rtsched_class_e tclass);
+
+
+#endif
+
+/* end rtsched.h */
@@ -0,0 +1,468 @@
+//
+//    This file is part of Dire Wolf, an amateur radio packet TNC.
+//
+//    Copyright (C) 2014  John Langner, WB2OSZ
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+/*------------------------------------------------------------------
+ *
+ * Module:      rxq.c
+ *
+ * Purpose:   	Receive queue - hand off decoded frames from the
+ *		audio and redecode threads to the dispatcher thread.
+ *
+ * Description:	Previously, everything done with a received frame
+ *		(printing, APRS decoding, sending to KISS & AGW clients,
+ *		IGate, digipeater) happened in the audio input thread.
+ *		A slow client or a burst of activity could delay reading
+ *		the sound card long enough to lose audio samples.
+ *
+ *		Now the audio thread only puts the frame into a queue
+ *		and goes back to demodulating.  A separate dispatcher
+ *		thread takes frames out and does the rest.
+ *
+ *		There are two threads that produce frames:  the audio
+ *		thread and the redecode thread.  Each has its own ring
+ *		buffer so each ring has exactly one writer and one reader.
+ *		That allows them to be used without any locking.
+ *		The producer only ever changes "head" and the consumer
+ *		only ever changes "tail."  A memory barrier makes sure
+ *		the slot contents are visible before the index moving
+ *		past it.
+ *
+ *		The only lock is for waking up the dispatcher when it
+ *		has run out of work, and the producer only touches it
+ *		when the dispatcher says it is waiting.
+ *
+ *		If a ring fills up, the new frame is discarded and
+ *		counted rather than blocking the audio thread.
+ *
+ *---------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+
+#include "direwolf.h"
+#include "ax25_pad.h"
+#include "textcolor.h"
+#include "rxq.h"
+#include "rtsched.h"
+
+
+/*
+ * What gets passed from producer to consumer.
+ * Spectrum is "tt" for APRStt or one character per subchannel.
+ */
+
+struct rxq_slot_s {
+	int chan;
+	int subchan;
+	packet_t pp;
+	int alevel;
+	retry_t retries;
+	char spectrum[MAX_SUBCHANS+2];
+};
+
+
+static struct rxq_ring_s {
+
+	volatile unsigned int head;		/* Next slot to be filled.  Written only by producer. */
+
+	volatile unsigned int tail;		/* Next slot to be removed.  Written only by consumer. */
+
+	struct rxq_slot_s slot[RXQ_RING_SIZE];
+
+	struct rxq_stats_s stats;		/* appended & overruns written only by producer, */
+						/* the others only by consumer. */
+} ring[RXQ_NUM_PRODUCERS];
+
+
+static rxq_dispatch_t dispatch_func;
+
+static volatile int dispatcher_is_waiting = 0;
+
+static int was_init = 0;
+
+
+/*
+ * The thread that called rxq_init is the audio input thread.
+ * Anyone else is the redecode thread.
+ */
+
+#if __WIN32__
+
+static DWORD audio_thread_id;
+
+static HANDLE wake_up_event;
+
+static unsigned rxq_dispatch_thread (void *arg);
+
+#else
+
+static pthread_t audio_thread_id;
+
+static pthread_cond_t wake_up_cond;
+
+static pthread_mutex_t wake_up_mutex;
+
+static void * rxq_dispatch_thread (void *arg);
+
+#endif
+
+
+/*
+ * Full barrier.  Also keeps the compiler from moving
+ * loads and stores across it.
+ */
+
+#define RXQ_BARRIER() __sync_synchronize()
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        rxq_init
+ *
+ * Purpose:     Initialize the receive queues and start the dispatcher thread.
+ *
+ * Inputs:	dispatch	- Function to process each received frame.
+ *
+ * Description:	Must be called from the audio input thread
+ *		before any frames are received.
+ *
+ *--------------------------------------------------------------------*/
+
+
+void rxq_init (rxq_dispatch_t dispatch)
+{
+#if __WIN32__
+	HANDLE dispatch_th;
+#else
+	pthread_t dispatch_tid;
+	int e;
+#endif
+
+	assert ((RXQ_RING_SIZE & (RXQ_RING_SIZE - 1)) == 0);
+
+	memset (ring, 0, sizeof(ring));
+	dispatch_func = dispatch;
+	dispatcher_is_waiting = 0;
+
+#if __WIN32__
+	audio_thread_id = GetCurrentThreadId();
+
+	wake_up_event = CreateEvent (NULL, 0, 0, NULL);
+	if (wake_up_event == NULL) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("rxq_init: CreateEvent: can't create receive wake up event");
+	  exit (1);
+	}
+
+	dispatch_th = _beginthreadex (NULL, 0, rxq_dispatch_thread, NULL, 0, NULL);
+	if (dispatch_th == NULL) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Could not create receive dispatch thread\n");
+	  exit (1);
+	}
+#else
+	audio_thread_id = pthread_self();
+
+	pthread_mutex_init (&wake_up_mutex, NULL);
+	pthread_cond_init (&wake_up_cond, NULL);
+
+	e = pthread_create (&dispatch_tid, NULL, rxq_dispatch_thread, (void *)0);
+	if (e != 0) {
+	  text_color_set(DW_COLOR_ERROR);
+	  perror("Could not create receive dispatch thread");
+	  exit (1);
+	}
+#endif
+
+	was_init = 1;
+
+} /* end rxq_init */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        rxq_append
+ *
+ * Purpose:     Add a received frame to the queue for the dispatcher thread.
+ *
+ * Inputs:	Same as app_process_rec_packet.
+ *
+ * Description:	Called from the audio or redecode thread.
+ *		Never blocks.  If the ring is full the frame is
+ *		discarded and counted.
+ *		The caller must not use pp after this.
+ *
+ *--------------------------------------------------------------------*/
+
+
+void rxq_append (int chan, int subchan, packet_t pp, int alevel, retry_t retries, char *spectrum)
+{
+	struct rxq_ring_s *r;
+	struct rxq_slot_s *s;
+	unsigned int head;
+
+	assert (was_init);
+
+#if __WIN32__
+	r = &ring[GetCurrentThreadId() == audio_thread_id ? RXQ_PRODUCER_AUDIO : RXQ_PRODUCER_REDECODE];
+#else
+	r = &ring[pthread_equal(pthread_self(), audio_thread_id) ? RXQ_PRODUCER_AUDIO : RXQ_PRODUCER_REDECODE];
+#endif
+
+	head = r->head;
+
+	if (head - r->tail >= RXQ_RING_SIZE) {
+
+	  r->stats.overruns++;
+
+	  /* Don't flood the screen if the dispatcher is stuck. */
+
+	  if (r->stats.overruns == 1 || r->stats.overruns % 100 == 0) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf ("Received frame discarded because receive queue is full.  %u lost so far.\n", r->stats.overruns);
+	  }
+	  ax25_delete (pp);
+	  return;
+	}
+
+	s = &(r->slot[head & (RXQ_RING_SIZE - 1)]);
+	s->chan = chan;
+	s->subchan = subchan;
+	s->pp = pp;
+	s->alevel = alevel;
+	s->retries = retries;
+	strncpy (s->spectrum, spectrum, sizeof(s->spectrum)-1);
+	s->spectrum[sizeof(s->spectrum)-1] = '\0';
+
+/*
+ * Slot contents must be visible before the new head.
+ * Then the head must be visible before we look at the
+ * waiting flag, otherwise the dispatcher could decide
+ * to sleep just as we decide not to wake it up.
+ */
+	RXQ_BARRIER();
+	r->head = head + 1;
+	r->stats.appended++;
+	RXQ_BARRIER();
+
+	if (dispatcher_is_waiting) {
+#if __WIN32__
+	  SetEvent (wake_up_event);
+#else
+	  pthread_mutex_lock (&wake_up_mutex);
+	  pthread_cond_signal (&wake_up_cond);
+	  pthread_mutex_unlock (&wake_up_mutex);
+#endif
+	}
+
+} /* end rxq_append */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        rxq_remove_one
+ *
+ * Purpose:     Take the oldest frame out of the given ring and process it.
+ *
+ * Returns:	1 if a frame was processed, 0 if the ring was empty.
+ *
+ * Description:	Tail is not advanced until processing is complete
+ *		so rxq_flush can tell when all the work is done.
+ *
+ *--------------------------------------------------------------------*/
+
+
+static int rxq_remove_one (struct rxq_ring_s *r)
+{
+	unsigned int tail, depth;
+	struct rxq_slot_s *s;
+
+	tail = r->tail;
+	depth = r->head - tail;
+
+	if (depth == 0) {
+	  return (0);
+	}
+
+	if (depth > r->stats.high_water) {
+	  r->stats.high_water = depth;
+	}
+	if (depth >= RXQ_RING_SIZE * 3 / 4) {
+	  r->stats.backlogged++;
+	}
+
+	RXQ_BARRIER();		/* Read slot only after seeing head. */
+
+	s = &(r->slot[tail & (RXQ_RING_SIZE - 1)]);
+
+	dispatch_func (s->chan, s->subchan, s->pp, s->alevel, s->retries, s->spectrum);
+
+	r->stats.dispatched++;
+
+	RXQ_BARRIER();		/* Finished with slot before producer can reuse it. */
+	r->tail = tail + 1;
+
+	return (1);
+}
+
+
+static int rxq_is_empty (void)
+{
+	int n;
+
+	for (n = 0; n < RXQ_NUM_PRODUCERS; n++) {
+	  if (ring[n].head != ring[n].tail) {
+	    return (0);
+	  }
+	}
+	return (1);
+}
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        rxq_dispatch_thread
+ *
+ * Purpose:     Process received frames as they arrive.
+ *
+ * Description:	Alternate between the rings, one frame at a time,
+ *		so a flood of redecoded frames can't hold up the
+ *		normal ones.  Sleep when both are empty.
+ *
+ *--------------------------------------------------------------------*/
+
+
+#if __WIN32__
+static unsigned rxq_dispatch_thread (void *arg)
+#else
+static void * rxq_dispatch_thread (void *arg)
+#endif
+{
+	int n, did;
+
+	rtsched_apply (RTSCHED_DISPATCH);
+
+	while (1) {
+
+	  did = 0;
+	  for (n = 0; n < RXQ_NUM_PRODUCERS; n++) {
+	    did += rxq_remove_one (&ring[n]);
+	  }
+
+	  if (did) {
+	    continue;
+	  }
+
+/*
+ * Nothing to do.  Announce that we are going to sleep
+ * and then check once more before actually doing so.
+ */
+
+#if __WIN32__
+	  dispatcher_is_waiting = 1;
+	  RXQ_BARRIER();
+	  if (rxq_is_empty()) {
+	    WaitForSingleObject (wake_up_event, INFINITE);
+	  }
+	  dispatcher_is_waiting = 0;
+#else
+	  pthread_mutex_lock (&wake_up_mutex);
+	  dispatcher_is_waiting = 1;
+	  RXQ_BARRIER();
+	  if (rxq_is_empty()) {
+	    pthread_cond_wait (&wake_up_cond, &wake_up_mutex);
+	  }
+	  dispatcher_is_waiting = 0;
+	  pthread_mutex_unlock (&wake_up_mutex);
+#endif
+	}
+
+	return (0);
+}
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        rxq_flush
+ *
+ * Purpose:     Wait for everything in the queues to be processed.
+ *
+ * Description:	Used at end of input, when reading audio from a file
+ *		or pipe, so the last frames are not lost when we exit.
+ *		Give up after a few seconds in case something is stuck.
+ *
+ *--------------------------------------------------------------------*/
+
+
+void rxq_flush (void)
+{
+	int n;
+
+	if ( ! was_init) {
+	  return;
+	}
+
+	for (n = 0; n < 500 && ! rxq_is_empty(); n++) {
+	  SLEEP_MS(10);
+	}
+
+	for (n = 0; n < RXQ_NUM_PRODUCERS; n++) {
+	  if (ring[n].stats.overruns > 0) {
+	    text_color_set(DW_COLOR_ERROR);
+	    dw_printf ("%s receive queue: %u frames lost, maximum %u waiting.\n",
+		n == RXQ_PRODUCER_AUDIO ? "Audio" : "Redecode",
+		ring[n].stats.overruns, ring[n].stats.high_water);
+	  }
+	}
+
+} /* end rxq_flush */
+
+
+
+/*-------------------------------------------------------------------
+ *
+ * Name:        rxq_get_stats
+ *
+ * Purpose:     Get counters for one of the rings.
+ *
+ * Inputs:	producer	- RXQ_PRODUCER_AUDIO or RXQ_PRODUCER_REDECODE.
+ *
+ * Outputs:	result		- Copy of the counters.  Values may be
+ *				  slightly out of date by the time they are used.
+ *
+ *--------------------------------------------------------------------*/
+
+
+void rxq_get_stats (int producer, struct rxq_stats_s *result)
+{
+	assert (producer >= 0 && producer < RXQ_NUM_PRODUCERS);
+
+	*result = ring[producer].stats;
+}
+
+/* end rxq.c */
@@ -0,0 +1,70 @@
+
+/*------------------------------------------------------------------
+ *
+ * Module:      rxq.h
+ *
+ * Purpose:   	Receive queue - hand off decoded frames from the
+ *		audio and redecode threads to the dispatcher thread.
+ *
+ *---------------------------------------------------------------*/
+
+#ifndef RXQ_H
+#define RXQ_H 1
+
+#include "direwolf.h"
+#include "ax25_pad.h"
+#include "hdlc_rec2.h"		/* for retry_t */
+
+
+/*
+ * Each producer thread gets its own ring so there is
+ * exactly one writer and one reader for each.
+ */
+
+#define RXQ_PRODUCER_AUDIO 0		/* Audio input thread.  Also APRStt. */
+#define RXQ_PRODUCER_REDECODE 1		/* Thread fixing frames with bad FCS. */
+
+#define RXQ_NUM_PRODUCERS 2
+
+/*
+ * Number of frames that can be waiting in each ring.  Must be a power of 2.
+ */
+
+#define RXQ_RING_SIZE 64
+
+
+/*
+ * Called by the dispatcher thread for each frame, in the
+ * order it was received.  Responsible for deleting the packet.
+ */
+
+typedef void (*rxq_dispatch_t) (int chan, int subchan, packet_t pp, int alevel, retry_t retries, char *spectrum);
+
+
+struct rxq_stats_s {
+
+	unsigned int appended;		/* Producer: frames put into ring. */
+
+	unsigned int overruns;		/* Producer: ring was full so frame was discarded. */
+
+	unsigned int dispatched;	/* Consumer: frames taken out and processed. */
+
+	unsigned int high_water;	/* Consumer: greatest number found waiting at once. */
+
+	unsigned int backlogged;	/* Consumer: number of times ring was found */
+					/* at least 3/4 full, i.e. about to overrun. */
+};
+
+
+void rxq_init (rxq_dispatch_t dispatch);
+
+void rxq_append (int chan, int subchan, packet_t pp, int alevel, retry_t retries, char *spectrum);
+
+void rxq_flush (void);
+
+void rxq_get_stats (int producer, struct rxq_stats_s *result);
+
+
+#endif
+
+/* end rxq.h */
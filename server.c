@@ -120,6 +120,8 @@
 #include "textcolor.h"
 #include "audio.h"
 #include "server.h"
+#include "rtsched.h"
+#include "metrics.h"
 
 
 
@@ -290,6 +292,24 @@ static void debug_print (fromto_t fromto, struct agwpe_s *pmsg, int msg_len)
 
 }
 
+/*
+ * Bytes waiting in the socket for the client to read, for metrics.
+ * A client that can't keep up shows here before anything is lost.
+ */
+
+#ifdef TIOCOUTQ
+static double client_queue_bytes (int arg)
+{
+	int n = 0;
+
+	if (client_sock <= 0 || ioctl (client_sock, TIOCOUTQ, &n) < 0) {
+	  n = 0;
+	}
+	return (n);
+}
+#endif
+
+
 /*-------------------------------------------------------------------
  *
  * Name:        server_init
@@ -334,6 +354,11 @@ void server_init (struct misc_config_s *mc)
 	enable_send_monitor_to_client = 0;
 	num_channels = mc->num_channels;
 
+#ifdef TIOCOUTQ
+	metrics_func (METRICS_GAUGE, "client_queue_bytes",
+			"Bytes sent to client application but not read yet.", "client=\"agw\"", client_queue_bytes, 0);
+#endif
+
 /*
  * This waits for a client to connect and sets client_sock.
  */
@@ -822,6 +847,8 @@ static void * cmd_listen_thread (void *arg)
 					/* Maximum for 'V': 1 + 8*10 + 256 */
 	} cmd;
 
+	rtsched_apply (RTSCHED_AGW);
+
 	while (1) {
 
 	  while (client_sock <= 0) {
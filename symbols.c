@@ -303,6 +303,26 @@ static new_sym_t *new_sym_ptr = NULL;	/* Dynamically allocated array. */
 static int new_sym_size = 0;		/* Number of elements allocated. */
 static int new_sym_len = 0;			/* Number of elements used. */
 
+/*
+ * Direct lookup of "new" symbols by overlay and symbol code so
+ * symbols_get_description doesn't need to search the list.
+ * Overlay is 0-9 or A-Z.  (/ and \ don't occur in the file but
+ * are allowed for.)  Value is 1 + index into new_sym_ptr, 0 for none.
+ */
+
+#define NEW_SYM_NUM_OVERLAYS 38
+
+static short new_sym_index[NEW_SYM_NUM_OVERLAYS][SYMTAB_SIZE];
+
+static int overlay_index (char overlay)
+{
+	if (overlay >= '0' && overlay <= '9') return (overlay - '0');
+	if (overlay >= 'A' && overlay <= 'Z') return (overlay - 'A' + 10);
+	if (overlay == '/') return (36);
+	if (overlay == '\\') return (37);
+	return (-1);
+}
+
 
 void symbols_init (void)
 {
@@ -315,7 +335,7 @@ void symbols_init (void)
 	  char sp2;
 	  char description[150];
 	} stuff;
-	int j;
+	int j, k;
 
 #define GOOD_LINE(x) ((x.overlay == '/' || x.overlay == '\\' || isupper(x.overlay) || isdigit(x.overlay)) \
 			&& x.symbol >= '!' && x.symbol <= '~' \
@@ -372,6 +392,13 @@ void symbols_init (void)
 	    new_sym_ptr[new_sym_len].overlay = stuff.overlay;
 	    new_sym_ptr[new_sym_len].symbol = stuff.symbol;
 	    strncpy(new_sym_ptr[new_sym_len].description, stuff.description, NEW_SYM_DESC_LEN);
+
+	    /* First one wins if there are duplicates, same as the search did. */
+
+	    k = overlay_index(stuff.overlay);
+	    if (k >= 0 && new_sym_index[k][stuff.symbol - ' '] == 0) {
+	      new_sym_index[k][stuff.symbol - ' '] = new_sym_len + 1;
+	    }
 	    new_sym_len++;
 	  }
 	}
@@ -637,7 +664,7 @@ int symbols_into_dest (char symtab, char symbol, char *dest)
 void symbols_get_description (char symtab, char symbol, char *description)
 {
 	char tmp2[2];
-	int j;
+	int j, k;
 
 	symbols_init();
 
@@ -674,12 +701,13 @@ void symbols_get_description (char symtab, char symbol, char *description)
 
 // First try to match with the "new" symbols.
 
-	for (j=0; j<new_sym_len; j++) {
-	  if (symtab == new_sym_ptr[j].overlay && symbol == new_sym_ptr[j].symbol) {
-	    strcpy (description, new_sym_ptr[j].description);
-	    return;
-	  }
-	}  
+	k = overlay_index(symtab);
+	j = (k >= 0) ? new_sym_index[k][symbol - ' '] : 0;
+	if (j != 0) {
+	  strcpy (description, new_sym_ptr[j-1].description);
+	  return;
+	}
+
 
 // Otherwise use the original symbol tables.
 
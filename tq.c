@@ -38,6 +38,8 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include <time.h>
+#include <errno.h>
 
 #include "direwolf.h"
 #include "ax25_pad.h"
@@ -45,6 +47,7 @@
 #include "audio.h"
 #include "tq.h"
 #include "dedupe.h"
+#include "airtime.h"
 
 
 
@@ -244,6 +247,20 @@ void tq_append (int chan, int prio, packet_t pp)
 	  return;
 	}
 
+/* 
+ * Hold back low priority traffic if we measured the channel as being too busy.
+ * Digipeated packets, in the high priority queue, are not affected.
+ */
+
+	if (prio == TQ_PRIO_1_LO && airtime_congested(chan)) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("Channel %d utilization is %d%%, above the MAXUTIL setting.  Discarding transmit request.\n", 
+			chan, airtime_utilization(chan, AIRTIME_DEFAULT_WINDOW));
+	  ax25_delete(pp);
+	  return;
+	}
+
+
 #if DEBUG
 	text_color_set(DW_COLOR_DEBUG);
 	dw_printf ("tq_append: enter critical section\n");
@@ -455,6 +472,68 @@ void tq_wait_while_empty (void)
 }
 
 
+/*-------------------------------------------------------------------
+ *
+ * Name:        tq_wait_for_append
+ *
+ * Purpose:     Sleep until something is added to the transmit queue
+ *		or the time limit is reached.
+ *
+ * Inputs:	max_ms	- Time limit in milliseconds.
+ *
+ * Description:	The transmit thread uses this while holding back
+ *		low priority frames for LINGER.  The queue is not empty
+ *		so tq_wait_while_empty would return right away.
+ *		Returning early is harmless; the caller checks again.
+ *		
+ *--------------------------------------------------------------------*/
+
+void tq_wait_for_append (int max_ms)
+{
+#if __WIN32__
+	WaitForSingleObject (wake_up_event, max_ms);
+#else
+	struct timespec deadline;
+	int err;
+
+	clock_gettime (CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += max_ms / 1000;
+	deadline.tv_nsec += (max_ms % 1000) * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L) {
+	  deadline.tv_sec++;
+	  deadline.tv_nsec -= 1000000000L;
+	}
+
+	err = pthread_mutex_lock (&wake_up_mutex);
+	if (err != 0) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("tq_wait_for_append: pthread_mutex_lock wu err=%d", err);
+	  perror ("");
+	  exit (1);
+	}
+
+	xmit_thread_is_waiting = 1;
+	err = pthread_cond_timedwait (&wake_up_cond, &wake_up_mutex, &deadline);
+	xmit_thread_is_waiting = 0;
+
+	if (err != 0 && err != ETIMEDOUT) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("tq_wait_for_append: pthread_cond_timedwait err=%d", err);
+	  perror ("");
+	  exit (1);
+	}
+
+	err = pthread_mutex_unlock (&wake_up_mutex);
+	if (err != 0) {
+	  text_color_set(DW_COLOR_ERROR);
+	  dw_printf ("tq_wait_for_append: pthread_mutex_unlock wu err=%d", err);
+	  perror ("");
+	  exit (1);
+	}
+#endif
+}
+
+
 /*-------------------------------------------------------------------
  *
  * Name:        tq_remove
@@ -26,6 +26,8 @@ void tq_append (int chan, int prio, packet_t pp);
 
 void tq_wait_while_empty (void);
 
+void tq_wait_for_append (int max_ms);
+
 packet_t tq_remove (int chan, int prio);
 
 int tq_count (int chan, int prio);
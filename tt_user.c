@@ -36,6 +36,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <ctype.h>
@@ -57,13 +58,20 @@
 /* 
  * Information kept about local APRStt users.
  *
- * For now, just use a fixed size array for simplicity.
+ * The table is allocated at start up time.  The number of entries
+ * comes from the TTMAXUSERS configuration option.  Event deployments
+ * could have thousands of users so nothing here should look at
+ * every entry.
+ *
+ *	- Hash tables find users by callsign and by digit suffix.
+ *	- A list in order of last heard finds those to be purged,
+ *	  or the one to replace if the table is full.
+ *	- A heap in order of next transmit time finds object
+ *	  reports which are due.
  */
 
 #if TT_MAIN
-#define MAX_TT_USERS 3		
-#else
-#define MAX_TT_USERS 100
+#define TT_MAIN_MAX_USERS 3
 #endif
 
 #define MAX_CALLSIGN_LEN 9	/* "Object Report" names can be up to 9 characters. */
@@ -126,13 +134,54 @@ static struct tt_user_s {
 
 	char dao[8];				/* Enhanced position information. */
 
-} tt_user[MAX_TT_USERS];
+} *tt_user = NULL;
+
+
+/*
+ * Everything below refers to table entries by index.  -1 for none.
+ * These are kept separately from the user information so clear_user
+ * doesn't need to know about them.
+ */
+
+static struct tt_link_s {
+
+	int call_next;				/* Next in same callsign hash chain. */
+
+	int suffix_next;			/* Next in same digit suffix hash chain. */
+
+	int heard_prev;				/* Ordered by last heard, oldest first. */
+	int heard_next;				/* Unused entries are also kept in a */
+						/* list with heard_next. */
+
+	int heap_pos;				/* Position in transmit heap, -1 if */
+						/* no more transmissions are pending. */
+} *tt_link = NULL;
+
+static int max_users = 0;
+
+static int hash_size = 0;			/* Power of 2. */
+static int *call_hash = NULL;			/* First entry in each chain. */
+static int *suffix_hash = NULL;
+
+static int heard_oldest = -1;
+static int heard_newest = -1;
+static int unused_first = -1;
+
+static int *xmit_heap = NULL;			/* Entries with transmissions pending. */
+static int xmit_heap_len = 0;			/* Earliest next_xmit is first. */
+static int *xmit_due = NULL;			/* Taken from heap by tt_user_background. */
+
+static char *corral_used = NULL;		/* Which corral slots are taken. */
+static int corral_lowest = 1;			/* No free slot below this. */
 
 
 static void clear_user(int i);
 
 static void xmit_object_report (int i, double c_lat, double c_long, int ambiguity, double c_offs);
 
+static int corral_slot (void);
+static void corral_release (int slot);
+
 
 /*------------------------------------------------------------------
  *
@@ -179,15 +228,71 @@ void tt_user_init (struct tt_config_s *p)
 	tt_config.corral_offset = 0.02 / 60;
 	tt_config.corral_ambiguity = 0;
 
+	tt_config.max_users = TT_MAIN_MAX_USERS;
+
 #else
 	memcpy (&tt_config, p, sizeof(struct tt_config_s));
 #endif
 
-	for (i=0; i<MAX_TT_USERS; i++) {
+	max_users = tt_config.max_users > 0 ? tt_config.max_users : TT_DEFAULT_MAX_USERS;
+
+	for (hash_size = 16; hash_size < max_users * 2; hash_size *= 2) {
+	}
+
+	free (tt_user);
+	free (tt_link);
+	free (call_hash);
+	free (suffix_hash);
+	free (xmit_heap);
+	free (xmit_due);
+	free (corral_used);
+
+	tt_user = malloc (sizeof(struct tt_user_s) * max_users);
+	tt_link = malloc (sizeof(struct tt_link_s) * max_users);
+	call_hash = malloc (sizeof(int) * hash_size);
+	suffix_hash = malloc (sizeof(int) * hash_size);
+	xmit_heap = malloc (sizeof(int) * max_users);
+	xmit_due = malloc (sizeof(int) * max_users);
+	corral_used = calloc ((size_t)max_users + 1, 1);	/* Slots 1 thru max_users. */
+
+	for (i=0; i<hash_size; i++) {
+	  call_hash[i] = -1;
+	  suffix_hash[i] = -1;
+	}
+
+	for (i=0; i<max_users; i++) {
 	  clear_user (i);
+	  tt_link[i].call_next = -1;
+	  tt_link[i].suffix_next = -1;
+	  tt_link[i].heard_prev = -1;
+	  tt_link[i].heard_next = i + 1 < max_users ? i + 1 : -1;
+	  tt_link[i].heap_pos = -1;
+	}
+
+	heard_oldest = -1;
+	heard_newest = -1;
+	unused_first = 0;
+	xmit_heap_len = 0;
+	corral_lowest = 1;
+}
+
+
+/*
+ * Hash for callsign or digit suffix.
+ * Overlay is included for the callsign, space for the suffix.
+ */
+
+static int user_hash (char *s, char overlay)
+{
+	unsigned int h = (unsigned char)overlay;
+
+	while (*s != '\0') {
+	  h = h * 31 + (unsigned char)(*s++);
 	}
+	return ((int)(h & (hash_size - 1)));
 }
 
+
 /*------------------------------------------------------------------
  *
  * Name:        tt_user_search
@@ -210,7 +315,7 @@ int tt_user_search (char *callsign, char overlay)
 /*
  * First, look for exact match to full call and overlay.
  */
-	for (i=0; i<MAX_TT_USERS; i++) {
+	for (i = call_hash[user_hash(callsign, overlay)]; i >= 0; i = tt_link[i].call_next) {
 	  if (strcmp(callsign, tt_user[i].callsign) == 0 && 
 		overlay == tt_user[i].overlay) {
 	    return (i);
@@ -220,21 +325,23 @@ int tt_user_search (char *callsign, char overlay)
 /*
  * Look for digits only suffix plus overlay.
  */
-	for (i=0; i<MAX_TT_USERS; i++) {
-	  if (strcmp(callsign, tt_user[i].digit_suffix) == 0 && 
-		overlay != ' ' &&
-		overlay == tt_user[i].overlay) {
-	    return (i);
+	if (overlay != ' ') {
+	  for (i = suffix_hash[user_hash(callsign, ' ')]; i >= 0; i = tt_link[i].suffix_next) {
+	    if (strcmp(callsign, tt_user[i].digit_suffix) == 0 &&
+		  overlay == tt_user[i].overlay) {
+	      return (i);
+	    }
 	  }
 	}
 
 /*
  * Look for digits only suffix if no overlay was specified.
  */
-	for (i=0; i<MAX_TT_USERS; i++) {
-	  if (strcmp(callsign, tt_user[i].digit_suffix) == 0 && 
-		overlay == ' ') {
-	    return (i);
+	else {
+	  for (i = suffix_hash[user_hash(callsign, ' ')]; i >= 0; i = tt_link[i].suffix_next) {
+	    if (strcmp(callsign, tt_user[i].digit_suffix) == 0) {
+	      return (i);
+	    }
 	  }
 	}
 
@@ -258,13 +365,156 @@ int tt_user_search (char *callsign, char overlay)
 
 static void clear_user(int i)
 {
-	assert (i >= 0 && i < MAX_TT_USERS);
+	assert (i >= 0 && i < max_users);
 
 	memset (&tt_user[i], 0, sizeof (struct tt_user_s));
 
 } /* end clear_user */
 
 
+/*
+ * Transmit heap.  Each entry is smaller (earlier) than its children.
+ */
+
+static void heap_set (int pos, int i)
+{
+	xmit_heap[pos] = i;
+	tt_link[i].heap_pos = pos;
+}
+
+static void heap_up (int pos)
+{
+	int i = xmit_heap[pos];
+
+	while (pos > 0 && tt_user[xmit_heap[(pos-1)/2]].next_xmit > tt_user[i].next_xmit) {
+	  heap_set (pos, xmit_heap[(pos-1)/2]);
+	  pos = (pos-1)/2;
+	}
+	heap_set (pos, i);
+}
+
+static void heap_down (int pos)
+{
+	int i = xmit_heap[pos];
+
+	while (2*pos+1 < xmit_heap_len) {
+	  int child = 2*pos+1;
+
+	  if (child+1 < xmit_heap_len && tt_user[xmit_heap[child+1]].next_xmit < tt_user[xmit_heap[child]].next_xmit) {
+	    child++;
+	  }
+	  if (tt_user[xmit_heap[child]].next_xmit >= tt_user[i].next_xmit) {
+	    break;
+	  }
+	  heap_set (pos, xmit_heap[child]);
+	  pos = child;
+	}
+	heap_set (pos, i);
+}
+
+/* Add to heap, or move to the right place after next_xmit changed. */
+
+static void heap_schedule (int i)
+{
+	int pos = tt_link[i].heap_pos;
+
+	if (pos < 0) {
+	  pos = xmit_heap_len++;
+	  heap_set (pos, i);
+	}
+	heap_up (pos);
+	heap_down (tt_link[i].heap_pos);
+}
+
+static void heap_remove (int i)
+{
+	int pos = tt_link[i].heap_pos;
+
+	if (pos < 0) {
+	  return;
+	}
+	tt_link[i].heap_pos = -1;
+	xmit_heap_len--;
+	if (pos < xmit_heap_len) {
+	  heap_set (pos, xmit_heap[xmit_heap_len]);
+	  heap_up (pos);
+	  heap_down (tt_link[xmit_heap[pos]].heap_pos);
+	}
+}
+
+
+/*
+ * List in order of last heard.
+ */
+
+static void heard_unlink (int i)
+{
+	if (tt_link[i].heard_prev >= 0) tt_link[tt_link[i].heard_prev].heard_next = tt_link[i].heard_next;
+	else heard_oldest = tt_link[i].heard_next;
+
+	if (tt_link[i].heard_next >= 0) tt_link[tt_link[i].heard_next].heard_prev = tt_link[i].heard_prev;
+	else heard_newest = tt_link[i].heard_prev;
+}
+
+static void heard_append (int i)
+{
+	tt_link[i].heard_prev = heard_newest;
+	tt_link[i].heard_next = -1;
+	if (heard_newest >= 0) tt_link[heard_newest].heard_next = i;
+	else heard_oldest = i;
+	heard_newest = i;
+}
+
+
+/*
+ * Remove from a hash chain.
+ */
+
+static void chain_unlink (int *head, int i, int offset)
+{
+	int *p = head;
+
+	while (*p >= 0) {
+	  if (*p == i) {
+	    *p = *(int *)((char *)&tt_link[i] + offset);
+	    return;
+	  }
+	  p = (int *)((char *)&tt_link[*p] + offset);
+	}
+}
+
+
+/*------------------------------------------------------------------
+ *
+ * Name:        remove_user
+ *
+ * Purpose:     Take user out of the table and all the indexes.
+ *
+ * Inputs:      handle for user table entry.
+ *
+ *----------------------------------------------------------------*/
+
+static void remove_user (int i)
+{
+	assert (i >= 0 && i < max_users);
+	assert (tt_user[i].callsign[0] != '\0');
+
+	chain_unlink (&call_hash[user_hash(tt_user[i].callsign, tt_user[i].overlay)], i, offsetof(struct tt_link_s, call_next));
+	chain_unlink (&suffix_hash[user_hash(tt_user[i].digit_suffix, ' ')], i, offsetof(struct tt_link_s, suffix_next));
+	heard_unlink (i);
+	heap_remove (i);
+	if (tt_user[i].corral_slot > 0) {
+	  corral_release (tt_user[i].corral_slot);
+	}
+
+	clear_user (i);
+
+	tt_link[i].heard_next = unused_first;
+	unused_first = i;
+
+} /* end remove_user */
+
+
 /*------------------------------------------------------------------
  *
  * Name:        find_avail
@@ -283,27 +533,18 @@ static void clear_user(int i)
 static int find_avail (void)
 {
 	int i;
-	int i_oldest;
 
-	for (i=0; i<MAX_TT_USERS; i++) {
-	  if (tt_user[i].callsign[0] == '\0') {
-	    clear_user (i);
-	    return (i);
-	  }
-	}
+	if (unused_first < 0) {
 
 /* Remove least recently heard. */
 
-	i_oldest = 0;
-
-	for (i=1; i<MAX_TT_USERS; i++) {
-	  if (tt_user[i].last_heard < tt_user[i_oldest].last_heard) {
-	    i_oldest = i;
-	  }
+	  remove_user (heard_oldest);
 	}
 
-	clear_user (i_oldest);
-	return (i_oldest);
+	i = unused_first;
+	unused_first = tt_link[i].heard_next;
+	clear_user (i);
+	return (i);
 
 } /* end find_avail */
 
@@ -318,27 +559,36 @@ static int find_avail (void)
  *
  * Returns:     Small integer >= 1 not already in use.
  *
+ * Description:	The caller doesn't have one yet so there must be
+ *		one free in the range of 1 thru max_users.
+ *
  *----------------------------------------------------------------*/
 
 static int corral_slot (void)
 {
-	int slot, i, used;
+	int slot;
 
-	for (slot=1; ; slot++) {
-	  used = 0;;
-	  for (i=0; i<MAX_TT_USERS && ! used; i++) {
-	    if (tt_user[i].callsign[0] != '\0' && tt_user[i].corral_slot == slot) {
-	      used = 1;
-	    }
-	  }
-	  if (!used) {
-	    return (slot);
-	  }
+	for (slot = corral_lowest; corral_used[slot]; slot++) {
+	  assert (slot < max_users);
 	}
+	corral_used[slot] = 1;
+	corral_lowest = slot + 1;
+	return (slot);
 
 } /* end corral_slot */
 
 
+static void corral_release (int slot)
+{
+	assert (slot >= 1 && slot <= max_users);
+
+	corral_used[slot] = 0;
+	if (slot < corral_lowest) {
+	  corral_lowest = slot;
+	}
+}
+
+
 /*------------------------------------------------------------------
  *
  * Name:        digit_suffix
@@ -400,6 +650,7 @@ int tt_user_heard (char *callsign, int ssid, char overlay, char symbol, double l
 		double longitude, char *freq, char *comment, char mic_e, char *dao)
 {
 	int i;
+	int h;
 	
 /*
  * At this time all messages are expected to contain a callsign.
@@ -423,7 +674,7 @@ int tt_user_heard (char *callsign, int ssid, char overlay, char symbol, double l
  */
 	  i = find_avail ();
 
-	  assert (i >= 0 && i < MAX_TT_USERS);
+	  assert (i >= 0 && i < max_users);
 	  strncpy (tt_user[i].callsign, callsign, MAX_CALLSIGN_LEN);
 	  tt_user[i].callsign[MAX_CALLSIGN_LEN] = '\0';
 	  tt_user[i].ssid = ssid;
@@ -446,17 +697,33 @@ int tt_user_heard (char *callsign, int ssid, char overlay, char symbol, double l
 	  tt_user[i].comment[MAX_COMMENT_LEN] = '\0';
 	  tt_user[i].mic_e = mic_e;
 	  strncpy(tt_user[i].dao, dao, 6);
+
+	  /* Add to indexes.  Callsign and overlay don't change after this. */
+
+	  h = user_hash (tt_user[i].callsign, tt_user[i].overlay);
+	  tt_link[i].call_next = call_hash[h];
+	  call_hash[h] = i;
+
+	  h = user_hash (tt_user[i].digit_suffix, ' ');
+	  tt_link[i].suffix_next = suffix_hash[h];
+	  suffix_hash[h] = i;
+
+	  heard_append (i);
+	  tt_link[i].heap_pos = -1;
 	}
 	else {
 /*
  * Known user.  Update with any new information.
  */
-	  assert (i >= 0 && i < MAX_TT_USERS);
+	  assert (i >= 0 && i < max_users);
 
 	  /* Any reason to look at ssid here? */
 
 	  if (latitude != G_UNKNOWN && longitude != G_UNKNOWN) {
 	    /* We have specific location. */
+	    if (tt_user[i].corral_slot > 0) {
+	      corral_release (tt_user[i].corral_slot);
+	    }
 	    tt_user[i].corral_slot = 0;
 	    tt_user[i].latitude = latitude;
 	    tt_user[i].longitude = longitude;
@@ -478,6 +745,9 @@ int tt_user_heard (char *callsign, int ssid, char overlay, char symbol, double l
 	    strncpy(tt_user[i].dao, dao, 6);
 	    tt_user[i].dao[5] = '\0';
 	  }
+
+	  heard_unlink (i);
+	  heard_append (i);
 	}
 
 /*
@@ -487,6 +757,10 @@ int tt_user_heard (char *callsign, int ssid, char overlay, char symbol, double l
 	tt_user[i].xmits = 0;
 	tt_user[i].next_xmit = tt_user[i].last_heard + tt_config.xmit_delay[0];
 
+	if (tt_config.num_xmits > 0) {
+	  heap_schedule (i);
+	}
+
 	return (0);	/* Success! */
 
 } /* end tt_user_heard */
@@ -496,7 +770,8 @@ int tt_user_heard (char *callsign, int ssid, char overlay, char symbol, double l
  *
  * Name:        tt_user_background
  *
- * Purpose:     
+ * Purpose:     Send object reports which are due and purge users
+ *		not heard for a while.
  *
  * Inputs:      
  *
@@ -504,7 +779,12 @@ int tt_user_heard (char *callsign, int ssid, char overlay, char symbol, double l
  *
  * Returns:     None
  *
- * Description:	...... TBD
+ * Description:	This is called frequently so only the entries which
+ *		need attention are looked at.  Those due for transmission
+ *		are at the beginning of the heap.  Those to be purged are
+ *		at the beginning of the list in order of last heard.
+ *
+ *		Each user gets at most one transmission each time.
  *
  *----------------------------------------------------------------*/
 
@@ -512,40 +792,51 @@ void tt_user_background (void)
 {
 	time_t now = time(NULL);
 	int i;
+	int n, ndue;
 
-	for (i=0; i<MAX_TT_USERS; i++) {
-	  if (tt_user[i].callsign[0] != '\0') {
-	    if (tt_user[i].xmits < tt_config.num_xmits && tt_user[i].next_xmit <= now) {
+	if (tt_user == NULL) {
+	  return;
+	}
+
+/*
+ * Take all that are due out of the heap first.
+ * Otherwise one with a short delay could be sent again right away.
+ */
+	ndue = 0;
+	while (xmit_heap_len > 0 && tt_user[xmit_heap[0]].next_xmit <= now) {
+	  i = xmit_heap[0];
+	  heap_remove (i);
+	  xmit_due[ndue++] = i;
+	}
 
-	      xmit_object_report (i, tt_config.corral_lat, tt_config.corral_lon,
+	for (n = 0; n < ndue; n++) {
+	  i = xmit_due[n];
+
+	  xmit_object_report (i, tt_config.corral_lat, tt_config.corral_lon,
 			tt_config.corral_ambiguity, tt_config.corral_offset);	
  
-	      /* Increase count of number times this one was sent. */
-	      tt_user[i].xmits++;
-	      if (tt_user[i].xmits < tt_config.num_xmits) {
-	        /* Schedule next one. */
-	        tt_user[i].next_xmit += tt_config.xmit_delay[tt_user[i].xmits];    
-	      }
-	    }
+	  /* Increase count of number times this one was sent. */
+	  tt_user[i].xmits++;
+	  if (tt_user[i].xmits < tt_config.num_xmits) {
+	    /* Schedule next one. */
+	    tt_user[i].next_xmit += tt_config.xmit_delay[tt_user[i].xmits];
+	    heap_schedule (i);
 	  }
 	}
 
 /*
  * Purge if too old.
  */
-	for (i=0; i<MAX_TT_USERS; i++) {
-	  if (tt_user[i].callsign[0] != '\0') {
-	    if (tt_user[i].last_heard + tt_config.retain_time < now) {
+	while (heard_oldest >= 0 && tt_user[heard_oldest].last_heard + tt_config.retain_time < now) {
 
-//TODO: remove printf ("debug: purging expired user %d\n", i);
+//TODO: remove printf ("debug: purging expired user %d\n", heard_oldest);
 
-	      clear_user (i);
-	    }
-	  }
+	  remove_user (heard_oldest);
 	}
 }
 
 
+
 /*------------------------------------------------------------------
  *
  * Name:        xmit_object_report
@@ -601,7 +892,7 @@ static void xmit_object_report (int i, double c_lat, double c_long, int ambiguit
 	int flen;
 
 
-	assert (i >= 0 && i < MAX_TT_USERS);
+	assert (i >= 0 && i < max_users);
 
 /*
  * Prepare the object name.  
@@ -725,7 +1016,7 @@ void tt_user_dump (void)
 	time_t now = time(NULL);
 	
 	printf ("call  ov suf lsthrd xmit nxt cor  lat    long freq       m comment\n");
-	for (i=0; i<MAX_TT_USERS; i++) {
+	for (i=0; i<max_users; i++) {
 	  if (tt_user[i].callsign[0] != '\0') {
 	    printf ("%-6s %c%c %-3s %6d %d %+6d %d %6.2f %7.2f %-10s %c %s\n",
 	    	tt_user[i].callsign,
@@ -73,6 +73,8 @@
 #include "hdlc_send.h"
 #include "hdlc_rec.h"
 #include "ptt.h"
+#include "airtime.h"
+#include "rtsched.h"
 
 
 static int xmit_num_channels;		/* Number of radio channels. */
@@ -111,6 +113,15 @@ static int xmit_bits_per_sec[MAX_CHANS];	/* Data transmission rate. */
 					/* modulation techniques. */
 
 
+static int xmit_maxframe[MAX_CHANS];	/* Maximum number of frames for one transmission. */
+
+static int xmit_linger[MAX_CHANS];	/* Hold low priority frames up to this long, */
+					/* 10 mS units, waiting for others to bundle. */
+
+static double linger_until[MAX_CHANS];	/* When to stop holding back low priority */
+					/* frames for LINGER.  0 when not lingering. */
+
+
 #define BITS_TO_MS(b,ch) (((b)*1000)/xmit_bits_per_sec[(ch)])
 
 #define MS_TO_BITS(ms,ch) (((ms)*xmit_bits_per_sec[(ch)])/1000)
@@ -119,6 +130,7 @@ static int xmit_bits_per_sec[MAX_CHANS];	/* Data transmission rate. */
 
 static void * xmit_thread (void *arg);
 static int wait_for_clear_channel (int channel, int nowait, int slotttime, int persist);
+static int send_one_frame (int c, int p, packet_t pp);
 
 
 /*-------------------------------------------------------------------
@@ -148,8 +160,6 @@ void xmit_init (struct audio_s *p_modem)
 #if __WIN32__
 	HANDLE xmit_th;
 #else
-	//pthread_attr_t attr;
-	//struct sched_param sp;
 	pthread_t xmit_tid;
 #endif
 	int e;
@@ -185,6 +195,8 @@ void xmit_init (struct audio_s *p_modem)
 	  xmit_persist[j] = p_modem->persist[j];
 	  xmit_txdelay[j] = p_modem->txdelay[j];
 	  xmit_txtail[j] = p_modem->txtail[j];
+	  xmit_maxframe[j] = p_modem->maxframe[j];
+	  xmit_linger[j] = p_modem->linger[j];
 	}
 
 #if DEBUG
@@ -198,8 +210,7 @@ void xmit_init (struct audio_s *p_modem)
 	dw_printf ("xmit_init: about to create thread \n");
 #endif
 
-//TODO:  xmit thread should be higher priority to avoid
-// underrun on the audio output device.
+/* Priority can be set with THREAD XMIT in the configuration file. */
 
 #if __WIN32__
 	xmit_th = _beginthreadex (NULL, 0, xmit_thread, NULL, 0, NULL);
@@ -210,34 +221,7 @@ void xmit_init (struct audio_s *p_modem)
 	}
 #else
 
-#if 0
-
-//TODO: not this simple.  probably need FIFO policy.
-	pthread_attr_init (&attr);
-  	e = pthread_attr_getschedparam (&attr, &sp);
-	if (e != 0) {
-	  text_color_set(DW_COLOR_ERROR);
-	  perror("pthread_attr_getschedparam");
-	}
-
-	text_color_set(DW_COLOR_ERROR);
-	dw_printf ("Default scheduling priority = %d, min=%d, max=%d\n", 
-		sp.sched_priority, 
-		sched_get_priority_min(SCHED_OTHER),
-		sched_get_priority_max(SCHED_OTHER));
-	sp.sched_priority--;
-
-  	e = pthread_attr_setschedparam (&attr, &sp);
-	if (e != 0) {
-	  text_color_set(DW_COLOR_ERROR);
-	  perror("pthread_attr_setschedparam");
-	}
-	
-	e = pthread_create (&xmit_tid, &attr, xmit_thread, (void *)0);
-	pthread_attr_destroy (&attr);
-#else
 	e = pthread_create (&xmit_tid, NULL, xmit_thread, (void *)0);
-#endif
 	if (e != 0) {
 	  text_color_set(DW_COLOR_ERROR);
 	  perror("Could not create xmit thread");
@@ -375,17 +359,27 @@ void xmit_set_txtail (int channel, int value)
  *		we try setting the maximum number automatically.
  *		1 for digipeated frames, 7 for others.
  *
+ * Version 1.1:	On a busy digipeater, TXDELAY and TXTAIL can take more
+ *		time than the frames themselves.  Once the transmitter is
+ *		keyed, we now send whatever is waiting for the channel,
+ *		high priority first, up to MAXFRAME (default 7) frames.
+ *		Previously, digipeated frames each got their own transmission
+ *		even if more were waiting.
+ *
+ *		LINGER can be set to hold a low priority frame briefly
+ *		in case more show up to share the same transmission.
+ *		The time saved is recorded with the airtime statistics.
+ *
+ *		Lingering on one channel must not hold up the others so
+ *		it is a deadline checked each time the queues are looked
+ *		at rather than a sleep.
+ *
  *--------------------------------------------------------------------*/
 
 static void * xmit_thread (void *arg)
 {
 	packet_t pp;
-    	unsigned char fbuf[AX25_MAX_PACKET_LEN+2];
-    	int flen;
 	int c, p;
-	char stemp[1024];	/* max size needed? */
-	int info_len;
-	unsigned char *pinfo;
 	int pre_flags, post_flags;
 	int num_bits;		/* Total number of bits in transmission */
 				/* including all flags and bit stuffing. */
@@ -396,6 +390,7 @@ static void * xmit_thread (void *arg)
 
 	int maxframe;		/* Maximum number of frames for one transmission. */
 	int numframe;		/* Number of frames sent during this transmission. */
+	int saved;		/* TXDELAY + TXTAIL time avoided by bundling, mS. */
 
 /*
  * These are for timing of a transmission.
@@ -403,12 +398,15 @@ static void * xmit_thread (void *arg)
  */
 	double time_ptt;	/* Time when PTT is turned on. */
 	double time_now;	/* Current time. */
+	double next_linger;	/* Earliest LINGER deadline, 0 for none. */
 
 
+	rtsched_apply (RTSCHED_XMIT);
 
 	while (1) {
 
 	  tq_wait_while_empty ();
+	  next_linger = 0;
 #if DEBUG
 	  text_color_set(DW_COLOR_DEBUG);
 	  dw_printf ("xmit_thread: woke up\n");
@@ -418,6 +416,31 @@ static void * xmit_thread (void *arg)
 
 	    for (c=0; c<xmit_num_channels; c++) {
 
+	      maxframe = xmit_maxframe[c];
+
+/*
+ * For the low priority queue, we might hang around a little
+ * while in hopes that more frames will arrive and can share
+ * the same TXDELAY.  Stop waiting as soon as we have enough 
+ * to fill a transmission or something with high priority shows up.
+ */
+	      if (p == TQ_PRIO_1_LO && xmit_linger[c] > 0 &&
+			tq_count (c, TQ_PRIO_1_LO) > 0 &&
+			tq_count (c, TQ_PRIO_1_LO) < maxframe &&
+			tq_count (c, TQ_PRIO_0_HI) == 0) {
+
+	        time_now = dtime_now ();
+	        if (linger_until[c] == 0) {
+	          linger_until[c] = time_now + xmit_linger[c] * 0.01;
+	        }
+	        if (time_now < linger_until[c]) {
+	          if (next_linger == 0 || linger_until[c] < next_linger) {
+	            next_linger = linger_until[c];
+	          }
+	          continue;
+	        }
+	      }
+
 	      pp = tq_remove (c, p);
 #if DEBUG
 	      text_color_set(DW_COLOR_DEBUG);
@@ -425,7 +448,8 @@ static void * xmit_thread (void *arg)
 #endif
 	      if (pp != NULL) {
 
-		maxframe = (p == TQ_PRIO_0_HI) ? 1 : 7;
+		linger_until[c] = 0;
+
 /* 
  * Wait for the channel to be clear.
  * For the high priority queue, begin transmitting immediately.
@@ -447,53 +471,37 @@ static void * xmit_thread (void *arg)
 		  pre_flags = MS_TO_BITS(xmit_txdelay[c] * 10, c) / 8;
 		  num_bits =  hdlc_send_flags (c, pre_flags, 0);
 
-/*
- * Print trasmitted packet.  Prefix by channel and priority.
- */
-	          ax25_format_addrs (pp, stemp);
-	          info_len = ax25_get_info (pp, &pinfo);
-	          text_color_set(DW_COLOR_XMIT);
-	          dw_printf ("[%d%c] ", c, p==TQ_PRIO_0_HI ? 'H' : 'L');
-	          dw_printf ("%s", stemp);			/* stations followed by : */
-	          ax25_safe_print ((char *)pinfo, info_len, 0);
-	          dw_printf ("\n");
-
-		  flen = ax25_pack (pp, fbuf);
-		  assert (flen <= sizeof(fbuf));
 /*
  * Transmit the frame.
  */		
-		  num_bits += hdlc_send_frame (c, fbuf, flen);
+		  num_bits += send_one_frame (c, p, pp);
 		  numframe = 1;
-		  ax25_delete (pp);
 
 /*
  * Additional packets if available and not exceeding max.
+ *
+ * Now that the transmitter is already keyed, there is no reason to 
+ * make anything else wait for another TXDELAY.  Take anything
+ * for this channel, high priority first, regardless of which
+ * queue caused us to start transmitting.
  */
 
-		  while (numframe < maxframe && tq_count (c,p) > 0) {
+		  while (numframe < maxframe) {
+		    int p2;
 
-	            pp = tq_remove (c, p);
+		    pp = NULL;
+		    for (p2 = 0; p2 < TQ_NUM_PRIO && pp == NULL; p2++) {
+	              pp = tq_remove (c, p2);
+		    }
+		    if (pp == NULL) {
+		      break;
+		    }
 #if DEBUG
 	            text_color_set(DW_COLOR_DEBUG);
-	            dw_printf ("xmit_thread: tq_remove(chan=%d, prio=%d) returned %p\n", c, p, pp);
+	            dw_printf ("xmit_thread: tq_remove(chan=%d, prio=%d) returned %p\n", c, p2-1, pp);
 #endif
-	            ax25_format_addrs (pp, stemp);
-	            info_len = ax25_get_info (pp, &pinfo);
-	            text_color_set(DW_COLOR_XMIT);
-	            dw_printf ("[%d%c] ", c, p==TQ_PRIO_0_HI ? 'H' : 'L');
-	            dw_printf ("%s", stemp);			/* stations followed by : */
-	            ax25_safe_print ((char *)pinfo, info_len, 0);
-	            dw_printf ("\n");
-
-		    flen = ax25_pack (pp, fbuf);
-		    assert (flen <= sizeof(fbuf));
-/*
- * Transmit the frame.
- */		
-		    num_bits += hdlc_send_frame (c, fbuf, flen);
+		    num_bits += send_one_frame (c, p2-1, pp);
 		    numframe++;
-		    ax25_delete (pp);
 		  }
 
 /* 
@@ -537,9 +545,23 @@ static void * xmit_thread (void *arg)
 
 /*
  * Turn off transmitter.
+ * Remember how long the channel was occupied by us and how
+ * much we avoided by not keying up separately for each frame.
  */
 		
 		  ptt_set (c, 0);
+
+		  saved = (numframe - 1) * (xmit_txdelay[c] + xmit_txtail[c]) * 10;
+		  airtime_xmit (c, duration, saved);
+
+		  if (numframe > 1) {
+		    struct airtime_stats_s s;
+
+		    airtime_get_stats (c, AIRTIME_HISTORY_SEC, &s);
+	            text_color_set(DW_COLOR_INFO);
+		    dw_printf ("[%d] Sent %d frames in one transmission, saving %d mS.  Total saved in last %d minutes: %d mS.\n",
+				c, numframe, saved, AIRTIME_HISTORY_SEC / 60, s.saved_ms);
+		  }
 	        }
 	        else {
 /*
@@ -547,6 +569,9 @@ static void * xmit_thread (void *arg)
  * Discard the packet.
  * Display with ERROR color rather than XMIT color.
  */
+		  char stemp[1024];	/* max size needed? */
+		  int info_len;
+		  unsigned char *pinfo;
 
 	          text_color_set(DW_COLOR_ERROR);
 		  dw_printf ("Waited too long for clear channel.  Discarding packet below.\n");
@@ -567,12 +592,75 @@ static void * xmit_thread (void *arg)
 	      } /* for each channel */
 	    } /* for high priority then low priority */
 	  }
+
+/*
+ * Something is being held back for LINGER.  The queue isn't empty
+ * so sleep until the deadline or until something else is added.
+ */
+	  if (next_linger != 0) {
+	    int ms = (int)((next_linger - dtime_now()) * 1000.) + 1;
+
+	    if (ms > 0) {
+	      tq_wait_for_append (ms);
+	    }
+	  }
 	}
 
+	return (NULL);	/* Unreachable but avoids compiler warning. */
+
 } /* end xmit_thread */
 
 
 
+/*-------------------------------------------------------------------
+ *
+ * Name:        send_one_frame
+ *
+ * Purpose:     Display and send one frame while the transmitter is keyed.
+ *
+ * Inputs:	c	- Radio channel.
+ *
+ *		p	- Priority queue it came from.  Used only for display.
+ *
+ *		pp	- Packet object.  It is deleted here.
+ *
+ * Returns:	Number of bits sent, including bit stuffing.
+ *
+ *--------------------------------------------------------------------*/
+
+static int send_one_frame (int c, int p, packet_t pp)
+{
+	unsigned char fbuf[AX25_MAX_PACKET_LEN+2];
+	int flen;
+	char stemp[1024];	/* max size needed? */
+	int info_len;
+	unsigned char *pinfo;
+	int num_bits;
+
+/*
+ * Print trasmitted packet.  Prefix by channel and priority.
+ */
+	ax25_format_addrs (pp, stemp);
+	info_len = ax25_get_info (pp, &pinfo);
+	text_color_set(DW_COLOR_XMIT);
+	dw_printf ("[%d%c] ", c, p==TQ_PRIO_0_HI ? 'H' : 'L');
+	dw_printf ("%s", stemp);			/* stations followed by : */
+	ax25_safe_print ((char *)pinfo, info_len, 0);
+	dw_printf ("\n");
+
+	flen = ax25_pack (pp, fbuf);
+	assert (flen <= sizeof(fbuf));
+
+	num_bits = hdlc_send_frame (c, fbuf, flen);
+
+	ax25_delete (pp);
+
+	return (num_bits);
+
+} /* end send_one_frame */
+
+
+
 /*-------------------------------------------------------------------
  *
  * Name:        wait_for_clear_channel
@@ -595,7 +683,9 @@ static void * xmit_thread (void *arg)
  *
  * Returns:	1 for OK.  0 for timeout.
  *
- * Description:	
+ * Description:	The receiver announces each change of data carrier
+ *		detect so we wake up as soon as the channel becomes
+ *		clear rather than checking periodically.
  *
  * Transmit delay algorithm:
  *
@@ -603,6 +693,7 @@ static void * xmit_thread (void *arg)
  *		Return if nowait is true.
  *
  *		Wait slottime * 10 milliseconds.
+ *		If the channel became busy in the meantime, start over.
  *		Generate an 8 bit random number in range of 0 - 255.
  *		If random number <= persist value, return.
  *		Otherwise repeat.
@@ -627,20 +718,13 @@ static void * xmit_thread (void *arg)
 /* Give up if we can't get a clear channel in a minute. */
 
 #define WAIT_TIMEOUT_MS (60 * 1000)	
-#define WAIT_CHECK_EVERY_MS 10
 
 static int wait_for_clear_channel (int channel, int nowait, int slottime, int persist)
 {
 	int r;
-	int n;
-
-	n = 0;
-	while (hdlc_rec_data_detect_any(channel)) {
-	  SLEEP_MS(WAIT_CHECK_EVERY_MS);
-	  n++;
-	  if (n > (WAIT_TIMEOUT_MS / WAIT_CHECK_EVERY_MS)) {
-	    return 0;
-	  }
+
+	if ( ! hdlc_rec_dcd_wait (channel, 0, WAIT_TIMEOUT_MS)) {
+	  return 0;
 	}
 
 	if (nowait) {
@@ -649,10 +733,16 @@ static int wait_for_clear_channel (int channel, int nowait, int slottime, int pe
 
 	while (1) {
 
-	  SLEEP_MS (slottime * 10);
-
-	  if (hdlc_rec_data_detect_any(channel)) {
-	    continue;   
+/*
+ * Sleep for one slot time but wake up right away if someone
+ * else starts transmitting.  In that case wait for them to
+ * finish and try again.
+ */
+	  if (hdlc_rec_dcd_wait (channel, 1, slottime * 10)) {
+	    if ( ! hdlc_rec_dcd_wait (channel, 0, WAIT_TIMEOUT_MS)) {
+	      return 0;
+	    }
+	    continue;
 	  }
 
 	  r = rand() & 0xff;